@@ -5,6 +5,7 @@
 
 #include <atomic>
 #include <cstdio>
+#include <thread>
 
 #if defined(CONF_FAMILY_WINDOWS)
 #define WIN32_LEAN_AND_MEAN
@@ -215,6 +216,197 @@ std::unique_ptr<ILogger> log_logger_collection(std::vector<std::shared_ptr<ILogg
 	return std::make_unique<CLoggerCollection>(std::move(vpLoggers));
 }
 
+static void log_message_copy(CLogMessage *pTo, const CLogMessage *pFrom)
+{
+	// only copy the used part of the line
+	pTo->m_Level = pFrom->m_Level;
+	pTo->m_HaveColor = pFrom->m_HaveColor;
+	pTo->m_Color = pFrom->m_Color;
+	mem_copy(pTo->m_aTimestamp, pFrom->m_aTimestamp, pFrom->m_TimestampLength + 1);
+	mem_copy(pTo->m_aSystem, pFrom->m_aSystem, pFrom->m_SystemLength + 1);
+	mem_copy(pTo->m_aLine, pFrom->m_aLine, pFrom->m_LineLength + 1);
+	pTo->m_TimestampLength = pFrom->m_TimestampLength;
+	pTo->m_SystemLength = pFrom->m_SystemLength;
+	pTo->m_LineLength = pFrom->m_LineLength;
+	pTo->m_LineMessageOffset = pFrom->m_LineMessageOffset;
+}
+
+// Bounded multi-producer single-consumer queue, each slot has a sequence
+// number telling whether it's free for the producer at that position or
+// ready for the consumer.
+class CLoggerRing : public ILogger
+{
+	enum
+	{
+		NUM_SLOTS = 1024,
+	};
+
+	struct CSlot
+	{
+		std::atomic<unsigned> m_Sequence;
+		CLogMessage m_Message;
+	};
+
+	std::unique_ptr<ILogger> m_pLogger;
+	std::unique_ptr<CSlot[]> m_pSlots;
+	std::atomic<unsigned> m_WritePos{0};
+	std::atomic<unsigned> m_ReadPos{0};
+	std::atomic<int> m_NumDropped{0};
+	// the logger thread should exit after the messages that are ready
+	std::atomic<bool> m_Finish{false};
+	// messages are forwarded directly after finishing
+	std::atomic<bool> m_Finished{false};
+	SEMAPHORE m_Ready;
+	void *m_pThread;
+	std::atomic<std::thread::id> m_ThreadID;
+
+	bool TryPush(const CLogMessage *pMessage, unsigned MaxUsed)
+	{
+		unsigned Pos = m_WritePos.load(std::memory_order_relaxed);
+		CSlot *pSlot;
+		while(true)
+		{
+			if(Pos - m_ReadPos.load(std::memory_order_acquire) >= MaxUsed)
+				return false;
+			pSlot = &m_pSlots[Pos % NUM_SLOTS];
+			const int Diff = (int)(pSlot->m_Sequence.load(std::memory_order_acquire) - Pos);
+			if(Diff == 0)
+			{
+				if(m_WritePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if(Diff < 0)
+				return false;
+			else
+				Pos = m_WritePos.load(std::memory_order_relaxed);
+		}
+		log_message_copy(&pSlot->m_Message, pMessage);
+		pSlot->m_Sequence.store(Pos + 1, std::memory_order_release);
+		sphore_signal(&m_Ready);
+		return true;
+	}
+
+	// forwards all messages that are ready, in order
+	void Drain()
+	{
+		unsigned Pos = m_ReadPos.load(std::memory_order_relaxed);
+		while(true)
+		{
+			CSlot *pSlot = &m_pSlots[Pos % NUM_SLOTS];
+			if(pSlot->m_Sequence.load(std::memory_order_acquire) != Pos + 1)
+				break;
+			m_pLogger->Log(&pSlot->m_Message);
+			pSlot->m_Sequence.store(Pos + NUM_SLOTS, std::memory_order_release);
+			Pos++;
+			m_ReadPos.store(Pos, std::memory_order_release);
+		}
+
+		const int NumDropped = m_NumDropped.exchange(0, std::memory_order_relaxed);
+		if(NumDropped > 0)
+		{
+			CLogMessage Msg;
+			Msg.m_Level = LEVEL_WARN;
+			Msg.m_HaveColor = false;
+			Msg.m_Color = LOG_COLOR{0, 0, 0};
+			str_timestamp_format(Msg.m_aTimestamp, sizeof(Msg.m_aTimestamp), FORMAT_SPACE);
+			Msg.m_TimestampLength = str_length(Msg.m_aTimestamp);
+			str_copy(Msg.m_aSystem, "log");
+			Msg.m_SystemLength = str_length(Msg.m_aSystem);
+			str_format(Msg.m_aLine, sizeof(Msg.m_aLine), "%s %c %s: ", Msg.m_aTimestamp, "EWIDT"[Msg.m_Level], Msg.m_aSystem);
+			Msg.m_LineMessageOffset = str_length(Msg.m_aLine);
+			str_format(Msg.m_aLine + Msg.m_LineMessageOffset, sizeof(Msg.m_aLine) - Msg.m_LineMessageOffset, "dropped %d messages, logging faster than they can be written", NumDropped);
+			Msg.m_LineLength = str_length(Msg.m_aLine);
+			m_pLogger->Log(&Msg);
+		}
+	}
+
+	static void Thread(void *pUser)
+	{
+		CLoggerRing *pThis = static_cast<CLoggerRing *>(pUser);
+		pThis->m_ThreadID.store(std::this_thread::get_id(), std::memory_order_release);
+		while(true)
+		{
+			sphore_wait(&pThis->m_Ready);
+			pThis->Drain();
+			if(pThis->m_Finish.load(std::memory_order_acquire))
+				break;
+		}
+	}
+
+public:
+	CLoggerRing(std::unique_ptr<ILogger> &&pLogger) :
+		m_pLogger(std::move(pLogger)),
+		m_pSlots(std::make_unique<CSlot[]>(NUM_SLOTS))
+	{
+		for(unsigned i = 0; i < NUM_SLOTS; i++)
+			m_pSlots[i].m_Sequence.store(i, std::memory_order_relaxed);
+		sphore_init(&m_Ready);
+		m_pThread = thread_init(Thread, this, "logger");
+	}
+	void Log(const CLogMessage *pMessage) override
+	{
+		if(m_Finished.load(std::memory_order_acquire))
+		{
+			m_pLogger->Log(pMessage);
+			return;
+		}
+
+		if(pMessage->m_Level >= LEVEL_DEBUG)
+		{
+			if(!TryPush(pMessage, NUM_SLOTS / 2))
+				m_NumDropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		else if(pMessage->m_Level == LEVEL_INFO)
+		{
+			if(!TryPush(pMessage, NUM_SLOTS))
+				m_NumDropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			while(!TryPush(pMessage, NUM_SLOTS))
+			{
+				// the logger thread can't wait for itself
+				if(std::this_thread::get_id() == m_ThreadID.load(std::memory_order_acquire))
+				{
+					m_NumDropped.fetch_add(1, std::memory_order_relaxed);
+					break;
+				}
+				thread_yield();
+			}
+		}
+	}
+	~CLoggerRing()
+	{
+		Stop();
+		sphore_destroy(&m_Ready);
+	}
+	void Stop()
+	{
+		if(m_Finished.exchange(true, std::memory_order_acq_rel))
+			return;
+		m_Finish.store(true, std::memory_order_release);
+		if(std::this_thread::get_id() == m_ThreadID.load(std::memory_order_acquire))
+		{
+			// finishing while the wrapped logger handles a message, e.g. on
+			// a failed assertion in it, the rest of the ring is lost
+			return;
+		}
+		sphore_signal(&m_Ready);
+		thread_wait(m_pThread);
+		Drain();
+	}
+	void GlobalFinish() override
+	{
+		Stop();
+		m_pLogger->GlobalFinish();
+	}
+};
+
+std::unique_ptr<ILogger> log_logger_ring(std::unique_ptr<ILogger> &&pLogger)
+{
+	return std::make_unique<CLoggerRing>(std::move(pLogger));
+}
+
 class CLoggerAsync : public ILogger
 {
 	ASYNCIO *m_pAio;
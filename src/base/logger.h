@@ -168,6 +168,22 @@ std::unique_ptr<ILogger> log_logger_android();
  */
 std::unique_ptr<ILogger> log_logger_collection(std::vector<std::shared_ptr<ILogger>> &&vpLoggers);
 
+/**
+ * @ingroup Log
+ *
+ * Logger that forwards the log messages to the given logger from a
+ * background thread. Logging threads only copy the message into a lock-free
+ * ring buffer, the formatting and output of the wrapped logger happen on the
+ * background thread.
+ *
+ * If the ring buffer runs full, debug and trace messages are dropped once it
+ * is half full, info messages once it is full, and warnings and errors wait
+ * for free space. The number of dropped messages is logged as a warning.
+ *
+ * @param pLogger The logger to forward the messages to.
+ */
+std::unique_ptr<ILogger> log_logger_ring(std::unique_ptr<ILogger> &&pLogger);
+
 /**
  * @ingroup Log
  *
@@ -3817,6 +3817,10 @@ const char *CClient::DemoPlayer_Play(const char *pFilename, int StorageType)
 	if(m_DemoPlayer.Load(Storage(), m_pConsole, pFilename, StorageType))
 		return "error loading demo";
 
+	// reset slice markers
+	g_Config.m_ClDemoSliceBegin = -1;
+	g_Config.m_ClDemoSliceEnd = -1;
+
 	// load map
 	const CMapInfo *pMapInfo = m_DemoPlayer.GetMapInfo();
 	int Crc = pMapInfo->m_Crc;
@@ -113,7 +113,8 @@ class IDemoEditor : public IInterface
 {
 	MACRO_INTERFACE("demoeditor", 0)
 public:
-	virtual void Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser) = 0;
+	// returns false if the demo couldn't be read or the slice couldn't be written
+	virtual bool Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser) = 0;
 };
 
 #endif
@@ -259,6 +259,10 @@ public:
 	virtual const char *GetMapName() const = 0;
 
 	virtual bool IsSixup(int ClientID) const = 0;
+
+	// Registry of the metrics served in the Prometheus text format.
+	virtual class CMetrics *Metrics() = 0;
+	virtual class CDbConnectionPool *DbPool() = 0;
 };
 
 class IGameServer : public IInterface
@@ -50,6 +50,14 @@ public:
 	// has to be called to return the connection back to the pool
 	virtual void Disconnect() = 0;
 
+	// Groups the queries until EndBatch into one transaction, so that many
+	// small writes don't wait for the disk one by one. The connection has to
+	// be established. Without support, the queries are committed each.
+	//
+	// returns true on failure
+	virtual bool BeginBatch(char *pError, int ErrorSize) { return false; }
+	virtual bool EndBatch(char *pError, int ErrorSize) { return false; }
+
 	// ? for Placeholders, connection has to be established, can overwrite previous prepared statements
 	//
 	// returns true on failure
@@ -104,7 +112,8 @@ bool MysqlAvailable();
 int MysqlInit();
 void MysqlUninit();
 
-std::unique_ptr<IDbConnection> CreateSqliteConnection(const char *pFilename, bool Setup);
+// Opens the database with the SQLite default settings if pConfig is nullptr.
+std::unique_ptr<IDbConnection> CreateSqliteConnection(const char *pFilename, bool Setup, const CSqliteConfig *pConfig = nullptr);
 // Returns nullptr if MySQL support is not compiled in.
 std::unique_ptr<IDbConnection> CreateMysqlConnection(CMysqlConfig Config);
 
@@ -4,6 +4,7 @@
 #include <base/system.h>
 #include <cstring>
 #include <engine/console.h>
+#include <engine/shared/packer.h>
 
 #include <chrono>
 #include <iterator>
@@ -26,7 +27,8 @@ struct CSqlExecData
 		const char *pName);
 	CSqlExecData(
 		CDbConnectionPool::Mode m,
-		const char aFileName[64]);
+		const char aFileName[64],
+		const CSqliteConfig *pSqliteConfig);
 	CSqlExecData(
 		CDbConnectionPool::Mode m,
 		const CMysqlConfig *pMysqlConfig);
@@ -54,6 +56,7 @@ struct CSqlExecData
 		{
 			CDbConnectionPool::Mode m_Mode;
 			char m_FileName[64];
+			CSqliteConfig m_Config;
 		} m_Sqlite;
 		struct
 		{
@@ -90,13 +93,15 @@ CSqlExecData::CSqlExecData(
 
 CSqlExecData::CSqlExecData(
 	CDbConnectionPool::Mode m,
-	const char aFileName[64]) :
+	const char aFileName[64],
+	const CSqliteConfig *pSqliteConfig) :
 	m_Mode(ADD_SQLITE),
 	m_pThreadData(nullptr),
 	m_pName("add sqlite server")
 {
 	m_Ptr.m_Sqlite.m_Mode = m;
 	mem_copy(m_Ptr.m_Sqlite.m_FileName, aFileName, sizeof(m_Ptr.m_Sqlite.m_FileName));
+	mem_copy(&m_Ptr.m_Sqlite.m_Config, pSqliteConfig, sizeof(m_Ptr.m_Sqlite.m_Config));
 }
 CSqlExecData::CSqlExecData(CDbConnectionPool::Mode m,
 	const CMysqlConfig *pMysqlConfig) :
@@ -119,25 +124,55 @@ CSqlExecData::CSqlExecData(IConsole *pConsole, CDbConnectionPool::Mode m) :
 
 CDbConnectionPool::~CDbConnectionPool() = default;
 
+void CDbConnectionPool::Enqueue(std::unique_ptr<CSqlExecData> pData)
+{
+	// The queue is a fixed ring. When it is full, e.g. while replaying a big
+	// spill file or with an unreachable database, the query waits in the
+	// overflow instead of blocking the main thread or overwriting a query
+	// that didn't run yet.
+	const bool WasFull = !m_vpOverflow.empty();
+	m_vpOverflow.push_back(std::move(pData));
+	Update();
+	if(!WasFull && !m_vpOverflow.empty())
+		dbg_msg("sql", "query queue is full, keeping the queries until the database worker catches up");
+}
+
+void CDbConnectionPool::Update()
+{
+	const int Capacity = std::size(m_pShared->m_aQueries);
+	while(!m_vpOverflow.empty() && NumInQueue() < Capacity)
+	{
+		m_pShared->m_aQueries[m_InsertIdx++] = std::move(m_vpOverflow.front());
+		m_vpOverflow.pop_front();
+		m_InsertIdx %= std::size(m_pShared->m_aQueries);
+		m_NumQueued++;
+		m_pShared->m_NumBackup.Signal();
+	}
+}
+
+int CDbConnectionPool::NumInQueue() const
+{
+	return m_NumQueued - m_pShared->m_NumProcessed.load();
+}
+
+int CDbConnectionPool::QueueSize() const
+{
+	return NumInQueue() + m_vpOverflow.size();
+}
+
 void CDbConnectionPool::Print(IConsole *pConsole, Mode DatabaseMode)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pConsole, DatabaseMode);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	Enqueue(std::make_unique<CSqlExecData>(pConsole, DatabaseMode));
 }
 
-void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFileName[64])
+void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFileName[64], const CSqliteConfig *pSqliteConfig)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, aFileName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	Enqueue(std::make_unique<CSqlExecData>(DatabaseMode, aFileName, pSqliteConfig));
 }
 
 void CDbConnectionPool::RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	Enqueue(std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig));
 }
 
 void CDbConnectionPool::Execute(
@@ -145,9 +180,7 @@ void CDbConnectionPool::Execute(
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	Enqueue(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName));
 }
 
 void CDbConnectionPool::ExecuteWrite(
@@ -155,26 +188,193 @@ void CDbConnectionPool::ExecuteWrite(
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	Enqueue(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName));
+}
+
+// The spill file starts with the magic, followed by the spilled queries.
+// Each query is stored as its size (4 bytes, big endian) followed by the
+// packed name of the query and the data written by ISqlData::Spill.
+static const unsigned char s_aSpillMagic[] = {'S', 'Q', 'L', 'S', 'P', 'I', 'L', '1'};
+
+void CDbConnectionPool::RegisterSpill(const char *pName, FWrite pFunc, FUnspill pfnUnspill)
+{
+	for(const auto &SpillType : m_pShared->m_vSpillTypes)
+	{
+		if(SpillType.m_pFunc == pFunc)
+			return;
+	}
+	m_pShared->m_vSpillTypes.push_back({pName, pFunc, pfnUnspill});
+}
+
+void CDbConnectionPool::SetSpillFile(const char *pFilename)
+{
+	str_copy(m_pShared->m_aSpillFile, pFilename);
 }
 
-void CDbConnectionPool::OnShutdown()
+void CDbConnectionPool::ReplaySpill()
+{
+	if(m_pShared->m_aSpillFile[0] == '\0')
+		return;
+	IOHANDLE File = io_open(m_pShared->m_aSpillFile, IOFLAG_READ);
+	if(!File)
+		return;
+	void *pFileData;
+	unsigned FileSize;
+	io_read_all(File, &pFileData, &FileSize);
+	io_close(File);
+
+	const unsigned char *pData = (const unsigned char *)pFileData;
+	unsigned Offset = sizeof(s_aSpillMagic);
+	int NumReplayed = 0;
+	int NumFailed = 0;
+	if(FileSize < sizeof(s_aSpillMagic) || mem_comp(pData, s_aSpillMagic, sizeof(s_aSpillMagic)) != 0)
+	{
+		dbg_msg("sql", "ignoring spill file '%s' with unknown format", m_pShared->m_aSpillFile);
+		Offset = FileSize;
+	}
+	while(Offset + 4 <= FileSize)
+	{
+		unsigned Size = (pData[Offset] << 24) | (pData[Offset + 1] << 16) | (pData[Offset + 2] << 8) | pData[Offset + 3];
+		Offset += 4;
+		if(Size > FileSize - Offset)
+		{
+			NumFailed++;
+			break;
+		}
+		CUnpacker Unpacker;
+		Unpacker.Reset(pData + Offset, Size);
+		Offset += Size;
+
+		const char *pName = Unpacker.GetString(0);
+		const CSharedData::CSpillType *pType = nullptr;
+		for(const auto &SpillType : m_pShared->m_vSpillTypes)
+		{
+			if(str_comp(SpillType.m_pName, pName) == 0)
+				pType = &SpillType;
+		}
+		std::unique_ptr<const ISqlData> pSqlRequestData = pType ? pType->m_pfnUnspill(&Unpacker) : nullptr;
+		if(!pSqlRequestData || Unpacker.Error())
+		{
+			NumFailed++;
+			continue;
+		}
+		ExecuteWrite(pType->m_pFunc, std::move(pSqlRequestData), pType->m_pName);
+		NumReplayed++;
+	}
+	free(pFileData);
+
+	dbg_msg("sql", "replaying %d queries from spill file '%s' (%d invalid)", NumReplayed, m_pShared->m_aSpillFile, NumFailed);
+	fs_remove(m_pShared->m_aSpillFile);
+}
+
+void CDbConnectionPool::OnShutdown(int DrainTimeout)
 {
 	m_pShared->m_Shutdown.store(true);
-	m_pShared->m_NumBackup.Signal();
-	int i = 0;
+	const int Capacity = std::size(m_pShared->m_aQueries);
+	const int NumTotal = QueueSize();
+	const int64_t Start = time_get();
+	int64_t NextProgress = Start + time_freq();
+	bool Spilling = false;
+	bool Ended = false;
 	while(m_pShared->m_Shutdown.load())
 	{
-		// print a log about every two seconds
-		if(i % 20 == 0 && i > 0)
+		// the overflow is drained as well, the threads exit at the first
+		// empty slot after it
+		if(!Ended)
+		{
+			Update();
+			if(m_vpOverflow.empty() && NumInQueue() < Capacity)
+			{
+				m_pShared->m_NumBackup.Signal();
+				Ended = true;
+			}
+		}
+		const int64_t Now = time_get();
+		if(!Spilling && DrainTimeout > 0 && Now >= Start + DrainTimeout * time_freq() && m_pShared->m_aSpillFile[0] != '\0')
+		{
+			dbg_msg("sql", "Drain timeout reached, spilling the remaining write queries to '%s'", m_pShared->m_aSpillFile);
+			m_pShared->m_Spill.store(true);
+			Spilling = true;
+		}
+		// print the progress about every second
+		if(Now >= NextProgress)
+		{
+			const int NumLeft = QueueSize();
+			const float Seconds = (Now - Start) / (float)time_freq();
+			const float Rate = (NumTotal - NumLeft) / Seconds;
+			if(Rate > 0.0f)
+				dbg_msg("sql", "Waiting for score threads to complete: %d/%d queries left, %.1f queries/s, ETA %ds", NumLeft, NumTotal, Rate, (int)(NumLeft / Rate) + 1);
+			else
+				dbg_msg("sql", "Waiting for score threads to complete: %d/%d queries left (%ds)", NumLeft, NumTotal, (int)Seconds);
+			NextProgress += time_freq();
+		}
+		std::this_thread::sleep_for(Ended ? 100ms : 1ms);
+	}
+	if(NumTotal > 0)
+		dbg_msg("sql", "Completed %d queries in %.1fs", NumTotal, (time_get() - Start) / (float)time_freq());
+}
+
+// Groups the write queries of the shutdown drain into transactions, so the
+// backup database doesn't sync after every single query.
+class CWriteBatch
+{
+public:
+	enum
+	{
+		MAX_QUERIES = 128,
+	};
+
+	// starts a batch on pConnection unless one is running already
+	void Add(IDbConnection *pConnection);
+	// commits the running batch, if the last added query filled it or if
+	// Force is set
+	void End(bool Force);
+
+private:
+	IDbConnection *m_pConnection = nullptr;
+	int m_NumQueries = 0;
+};
+
+void CWriteBatch::Add(IDbConnection *pConnection)
+{
+	if(m_pConnection == nullptr && pConnection != nullptr)
+	{
+		char aError[256] = "error message not initialized";
+		if(pConnection->Connect(aError, sizeof(aError)))
+		{
+			dbg_msg("sql", "failed connecting to db: %s", aError);
+			return;
+		}
+		bool Failed = pConnection->BeginBatch(aError, sizeof(aError));
+		pConnection->Disconnect();
+		if(Failed)
 		{
-			dbg_msg("sql", "Waiting for score threads to complete (%ds)", i / 10);
+			dbg_msg("sql", "failed starting a batch: %s", aError);
+			return;
 		}
-		++i;
-		std::this_thread::sleep_for(100ms);
+		m_pConnection = pConnection;
+		m_NumQueries = 0;
 	}
+	if(m_pConnection != nullptr)
+		m_NumQueries++;
+}
+
+void CWriteBatch::End(bool Force)
+{
+	if(m_pConnection == nullptr || (!Force && m_NumQueries < MAX_QUERIES))
+		return;
+	char aError[256] = "error message not initialized";
+	if(m_pConnection->Connect(aError, sizeof(aError)))
+	{
+		dbg_msg("sql", "failed connecting to db: %s", aError);
+	}
+	else
+	{
+		if(m_pConnection->EndBatch(aError, sizeof(aError)))
+			dbg_msg("sql", "failed committing a batch of %d queries: %s", m_NumQueries, aError);
+		m_pConnection->Disconnect();
+	}
+	m_pConnection = nullptr;
 }
 
 // The backup worker thread looks at write queries and stores them
@@ -193,6 +393,7 @@ private:
 	void ProcessQueries();
 
 	std::unique_ptr<IDbConnection> m_pWriteBackup;
+	CWriteBatch m_Batch;
 
 	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
 };
@@ -209,12 +410,16 @@ void CBackup::ProcessQueries()
 {
 	for(int JobNum = 0;; JobNum++)
 	{
+		// the worker thread waits for the database lock while a batch runs
+		if(m_pShared->m_NumBackup.GetApproximateValue() == 0)
+			m_Batch.End(true);
 		m_pShared->m_NumBackup.Wait();
 		CSqlExecData *pThreadData = m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)].get();
 
 		// work through all database jobs after OnShutdown is called before exiting the thread
 		if(pThreadData == nullptr)
 		{
+			m_Batch.End(true);
 			m_pShared->m_NumWorker.Signal();
 			return;
 		}
@@ -222,12 +427,15 @@ void CBackup::ProcessQueries()
 		if(pThreadData->m_Mode == CSqlExecData::ADD_SQLITE &&
 			pThreadData->m_Ptr.m_Sqlite.m_Mode == CDbConnectionPool::Mode::WRITE_BACKUP)
 		{
-			m_pWriteBackup = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true);
+			m_pWriteBackup = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true, &pThreadData->m_Ptr.m_Sqlite.m_Config);
 		}
 		else if(pThreadData->m_Mode == CSqlExecData::WRITE_ACCESS && m_pWriteBackup.get())
 		{
+			if(m_pShared->m_Shutdown)
+				m_Batch.Add(m_pWriteBackup.get());
 			bool Success = CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData, Write::BACKUP_FIRST);
 			dbg_msg("sql", "[%i] %s done on write backup database, Success=%i", JobNum, pThreadData->m_pName, Success);
+			m_Batch.End(false);
 		}
 		m_pShared->m_NumWorker.Signal();
 	}
@@ -247,6 +455,9 @@ public:
 
 private:
 	void Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode);
+	// returns true if the query was written to the spill file
+	bool Spill(const CSqlExecData *pThreadData);
+	IOHANDLE m_SpillFile = nullptr;
 
 	// There are two possible configurations
 	//  * sqlite mode: There exists exactly one READ and the same WRITE server
@@ -259,6 +470,7 @@ private:
 	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
 	std::unique_ptr<IDbConnection> m_pWriteConnection;
 	std::unique_ptr<IDbConnection> m_pWriteBackup;
+	CWriteBatch m_Batch;
 
 	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
 };
@@ -280,15 +492,23 @@ void CWorker::ProcessQueries()
 	bool FailMode = false;
 	for(int JobNum = 0;; JobNum++)
 	{
-		if(FailMode && m_pShared->m_NumWorker.GetApproximateValue() == 0)
+		if(m_pShared->m_NumWorker.GetApproximateValue() == 0)
 		{
 			FailMode = false;
+			// the backup thread waits for the database lock while a batch runs
+			m_Batch.End(true);
 		}
 		m_pShared->m_NumWorker.Wait();
 		auto pThreadData = std::move(m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)]);
 		// work through all database jobs after OnShutdown is called before exiting the thread
 		if(pThreadData == nullptr)
 		{
+			m_Batch.End(true);
+			if(m_SpillFile)
+			{
+				io_sync(m_SpillFile);
+				io_close(m_SpillFile);
+			}
 			m_pShared->m_Shutdown.store(false);
 			return;
 		}
@@ -326,6 +546,14 @@ void CWorker::ProcessQueries()
 		break;
 		case CSqlExecData::WRITE_ACCESS:
 		{
+			if(m_pShared->m_Spill && Spill(pThreadData.get()))
+			{
+				dbg_msg("sql", "[%i] %s spilled to '%s'", JobNum, pThreadData->m_pName, m_pShared->m_aSpillFile);
+				Success = true;
+				break;
+			}
+			if(m_pShared->m_Shutdown)
+				m_Batch.Add(m_pWriteBackup != nullptr ? m_pWriteBackup.get() : m_pWriteConnection.get());
 			if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
 			{
 				dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
@@ -347,6 +575,7 @@ void CWorker::ProcessQueries()
 				dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
 				Success = true;
 			}
+			m_Batch.End(false);
 		}
 		break;
 		case CSqlExecData::ADD_MYSQL:
@@ -371,7 +600,7 @@ void CWorker::ProcessQueries()
 		}
 		case CSqlExecData::ADD_SQLITE:
 		{
-			auto pSqlite = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true);
+			auto pSqlite = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true, &pThreadData->m_Ptr.m_Sqlite.m_Config);
 			switch(pThreadData->m_Ptr.m_Sqlite.m_Mode)
 			{
 			case CDbConnectionPool::Mode::READ:
@@ -401,7 +630,42 @@ void CWorker::ProcessQueries()
 			pThreadData->m_pThreadData->m_pResult->m_Success = Success;
 			pThreadData->m_pThreadData->m_pResult->m_Completed.store(true);
 		}
+		m_pShared->m_NumProcessed++;
+	}
+}
+
+bool CWorker::Spill(const CSqlExecData *pThreadData)
+{
+	const CDbConnectionPool::CSharedData::CSpillType *pType = nullptr;
+	for(const auto &SpillType : m_pShared->m_vSpillTypes)
+	{
+		if(SpillType.m_pFunc == pThreadData->m_Ptr.m_pWriteFunc)
+			pType = &SpillType;
+	}
+	if(!pType)
+		return false;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddString(pType->m_pName, 0);
+	if(!pThreadData->m_pThreadData->Spill(&Packer) || Packer.Error())
+		return false;
+
+	if(!m_SpillFile)
+	{
+		m_SpillFile = io_open(m_pShared->m_aSpillFile, IOFLAG_APPEND);
+		if(!m_SpillFile)
+		{
+			dbg_msg("sql", "failed to open spill file '%s'", m_pShared->m_aSpillFile);
+			return false;
+		}
+		if(io_length(m_SpillFile) == 0)
+			io_write(m_SpillFile, s_aSpillMagic, sizeof(s_aSpillMagic));
 	}
+	const unsigned Size = Packer.Size();
+	const unsigned char aSize[4] = {(unsigned char)(Size >> 24), (unsigned char)(Size >> 16), (unsigned char)(Size >> 8), (unsigned char)Size};
+	return io_write(m_SpillFile, aSize, sizeof(aSize)) == sizeof(aSize) &&
+	       io_write(m_SpillFile, Packer.Data(), Size) == Size;
 }
 
 void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
@@ -2,10 +2,14 @@
 #define ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
 
 #include <atomic>
+#include <base/system.h>
 #include <base/tl/threading.h>
+#include <deque>
 #include <memory>
 #include <vector>
 
+class CPacker;
+class CUnpacker;
 class IDbConnection;
 
 struct ISqlResult
@@ -28,6 +32,11 @@ struct ISqlData
 	}
 	virtual ~ISqlData() = default;
 
+	// Serializes the request, so that it can be executed after a restart if
+	// it is still queued when the drain timeout passes during shutdown.
+	// Returns false if the request can't be spilled.
+	virtual bool Spill(CPacker *pPacker) const { return false; }
+
 	mutable std::shared_ptr<ISqlResult> m_pResult;
 };
 
@@ -57,6 +66,17 @@ struct CMysqlConfig
 	bool m_Setup;
 };
 
+struct CSqliteConfig
+{
+	// use WAL journal with synchronous=NORMAL, memory mapped I/O and a
+	// bigger page cache instead of the SQLite defaults
+	bool m_Tuned;
+	// size of the memory map in MiB, 0 disables memory mapped I/O
+	int m_MmapSize;
+	// size of the page cache in KiB
+	int m_CacheSize;
+};
+
 class CDbConnectionPool
 {
 public:
@@ -67,6 +87,8 @@ public:
 	// Returns false on success.
 	typedef bool (*FRead)(IDbConnection *, const ISqlData *, char *pError, int ErrorSize);
 	typedef bool (*FWrite)(IDbConnection *, const ISqlData *, Write, char *pError, int ErrorSize);
+	// Recreates a request written by ISqlData::Spill, returns nullptr on error.
+	typedef std::unique_ptr<const ISqlData> (*FUnspill)(CUnpacker *pUnpacker);
 
 	enum Mode
 	{
@@ -78,7 +100,7 @@ public:
 
 	void Print(IConsole *pConsole, Mode DatabaseMode);
 
-	void RegisterSqliteDatabase(Mode DatabaseMode, const char FileName[64]);
+	void RegisterSqliteDatabase(Mode DatabaseMode, const char FileName[64], const CSqliteConfig *pSqliteConfig);
 	void RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig);
 
 	void Execute(
@@ -92,17 +114,45 @@ public:
 		std::unique_ptr<const ISqlData> pSqlRequestData,
 		const char *pName);
 
-	void OnShutdown();
+	// Write queries executed with a registered function are persisted to the
+	// spill file if they are still queued when the drain timeout passes.
+	void RegisterSpill(const char *pName, FWrite pFunc, FUnspill pfnUnspill);
+	void SetSpillFile(const char *pFilename);
+	// Queues the write queries from the spill file and removes it. All
+	// spilled functions have to be registered before.
+	void ReplaySpill();
+
+	// Moves the queries that didn't fit into the queue anymore to it, has to
+	// be called regularly by the main thread.
+	void Update();
+
+	// Dismisses all read queries and waits for the write queries to complete.
+	// After DrainTimeout seconds (0 waits forever) the remaining write
+	// queries are persisted to the spill file instead of executed.
+	void OnShutdown(int DrainTimeout);
+
+	// Number of queries waiting for or in execution, only for the main thread.
+	int QueueSize() const;
 
 	friend class CWorker;
 	friend class CBackup;
 
 private:
 	static bool ExecSqlFunc(IDbConnection *pConnection, struct CSqlExecData *pData, Write w);
+	void Enqueue(std::unique_ptr<struct CSqlExecData> pData);
+
+	// Number of queries in the queue waiting for or in execution.
+	int NumInQueue() const;
 
 	// Only the main thread accesses this variable. It points to the index,
 	// where the next query is added to the queue.
 	int m_InsertIdx = 0;
+	// Number of queries added to the queue, only accessed by the main thread.
+	int m_NumQueued = 0;
+	// Queries that didn't fit into the queue, e.g. while the database is
+	// unreachable. Only accessed by the main thread, which moves them to the
+	// queue when the worker thread frees slots.
+	std::deque<std::unique_ptr<struct CSqlExecData>> m_vpOverflow;
 
 	struct CSharedData
 	{
@@ -121,6 +171,23 @@ private:
 
 		// spsc queue with additional backup worker to look at queries first.
 		std::unique_ptr<struct CSqlExecData> m_aQueries[512];
+
+		// Number of queries completed by the worker thread, used to report
+		// the progress during shutdown.
+		std::atomic_int m_NumProcessed{0};
+		// Set by the main thread when the drain timeout passed. The worker
+		// thread writes the remaining spillable write queries to the spill
+		// file instead of executing them.
+		std::atomic_bool m_Spill{false};
+		// Only changed by the main thread before m_Spill is set.
+		char m_aSpillFile[IO_MAX_PATH_LENGTH] = "";
+		struct CSpillType
+		{
+			const char *m_pName;
+			FWrite m_pFunc;
+			FUnspill m_pfnUnspill;
+		};
+		std::vector<CSpillType> m_vSpillTypes;
 	};
 
 	std::shared_ptr<CSharedData> m_pShared;
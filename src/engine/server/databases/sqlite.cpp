@@ -6,11 +6,12 @@
 #include <engine/console.h>
 
 #include <atomic>
+#include <limits>
 
 class CSqliteConnection : public IDbConnection
 {
 public:
-	CSqliteConnection(const char *pFilename, bool Setup);
+	CSqliteConnection(const char *pFilename, bool Setup, const CSqliteConfig *pConfig);
 	virtual ~CSqliteConnection();
 	void Print(IConsole *pConsole, const char *pMode) override;
 
@@ -31,6 +32,8 @@ public:
 
 	bool Connect(char *pError, int ErrorSize) override;
 	void Disconnect() override;
+	bool BeginBatch(char *pError, int ErrorSize) override;
+	bool EndBatch(char *pError, int ErrorSize) override;
 
 	bool PrepareStatement(const char *pStmt, char *pError, int ErrorSize) override;
 
@@ -63,12 +66,19 @@ private:
 	// copy of config vars
 	char m_aFilename[IO_MAX_PATH_LENGTH];
 	bool m_Setup;
+	bool m_Tuned;
+	int m_MmapSize;
+	int m_CacheSize;
 
 	sqlite3 *m_pDb;
 	sqlite3_stmt *m_pStmt;
 	bool m_Done; // no more rows available for Step
 	// returns false, if the query succeeded
 	bool Execute(const char *pQuery, char *pError, int ErrorSize);
+	// applies the per connection pragmas of the tuned mode
+	bool Tune(char *pError, int ErrorSize);
+	// indices for the lookups done in scoreworker.cpp
+	bool CreateIndices(char *pError, int ErrorSize);
 
 	// returns true if an error was formatted
 	bool FormatError(int Result, char *pError, int ErrorSize);
@@ -77,9 +87,12 @@ private:
 	std::atomic_bool m_InUse;
 };
 
-CSqliteConnection::CSqliteConnection(const char *pFilename, bool Setup) :
+CSqliteConnection::CSqliteConnection(const char *pFilename, bool Setup, const CSqliteConfig *pConfig) :
 	IDbConnection("record"),
 	m_Setup(Setup),
+	m_Tuned(pConfig != nullptr && pConfig->m_Tuned),
+	m_MmapSize(pConfig != nullptr ? pConfig->m_MmapSize : 0),
+	m_CacheSize(pConfig != nullptr ? pConfig->m_CacheSize : 0),
 	m_pDb(nullptr),
 	m_pStmt(nullptr),
 	m_Done(true),
@@ -100,8 +113,8 @@ void CSqliteConnection::Print(IConsole *pConsole, const char *pMode)
 {
 	char aBuf[512];
 	str_format(aBuf, sizeof(aBuf),
-		"SQLite-%s: DB: '%s'",
-		pMode, m_aFilename);
+		"SQLite-%s: DB: '%s', Tuned: %d, Mmap: %dMiB, Cache: %dKiB",
+		pMode, m_aFilename, m_Tuned, m_Tuned ? m_MmapSize : 0, m_Tuned ? m_CacheSize : 0);
 	pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 }
 
@@ -112,7 +125,11 @@ void CSqliteConnection::ToUnixTimestamp(const char *pTimestamp, char *aBuf, unsi
 
 CSqliteConnection *CSqliteConnection::Copy()
 {
-	return new CSqliteConnection(m_aFilename, m_Setup);
+	CSqliteConfig Config;
+	Config.m_Tuned = m_Tuned;
+	Config.m_MmapSize = m_MmapSize;
+	Config.m_CacheSize = m_CacheSize;
+	return new CSqliteConnection(m_aFilename, m_Setup, &Config);
 }
 
 bool CSqliteConnection::Connect(char *pError, int ErrorSize)
@@ -139,8 +156,14 @@ bool CSqliteConnection::Connect(char *pError, int ErrorSize)
 		return true;
 	}
 
-	// wait for database to unlock so we don't have to handle SQLITE_BUSY errors
-	sqlite3_busy_timeout(m_pDb, -1);
+	// wait for database to unlock so we don't have to handle SQLITE_BUSY errors,
+	// a negative timeout would turn the waiting off
+	sqlite3_busy_timeout(m_pDb, std::numeric_limits<int>::max());
+
+	// the connection stays open until the object is destroyed, so the
+	// connection local pragmas only have to be applied once
+	if(m_Tuned && Tune(pError, ErrorSize))
+		return true;
 
 	if(m_Setup)
 	{
@@ -172,6 +195,9 @@ bool CSqliteConnection::Connect(char *pError, int ErrorSize)
 		FormatCreateSaves(aBuf, sizeof(aBuf), /* Backup */ true);
 		if(Execute(aBuf, pError, ErrorSize))
 			return true;
+
+		if(CreateIndices(pError, ErrorSize))
+			return true;
 		m_Setup = false;
 	}
 	return false;
@@ -185,6 +211,18 @@ void CSqliteConnection::Disconnect()
 	m_InUse.store(false);
 }
 
+bool CSqliteConnection::BeginBatch(char *pError, int ErrorSize)
+{
+	// take the write lock right away, a deferred transaction can't wait for
+	// the other database thread when upgrading to a write
+	return Execute("BEGIN IMMEDIATE", pError, ErrorSize);
+}
+
+bool CSqliteConnection::EndBatch(char *pError, int ErrorSize)
+{
+	return Execute("COMMIT", pError, ErrorSize);
+}
+
 bool CSqliteConnection::PrepareStatement(const char *pStmt, char *pError, int ErrorSize)
 {
 	if(m_pStmt != nullptr)
@@ -363,6 +401,49 @@ bool CSqliteConnection::Execute(const char *pQuery, char *pError, int ErrorSize)
 	return false;
 }
 
+bool CSqliteConnection::Tune(char *pError, int ErrorSize)
+{
+	// WAL lets the backup thread write without blocking readers, with
+	// synchronous=NORMAL only checkpoints wait for fsync. A crash can lose the
+	// last transactions but never corrupts the database.
+	if(Execute("PRAGMA journal_mode=WAL", pError, ErrorSize))
+		return true;
+	if(Execute("PRAGMA synchronous=NORMAL", pError, ErrorSize))
+		return true;
+	if(Execute("PRAGMA temp_store=MEMORY", pError, ErrorSize))
+		return true;
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "PRAGMA mmap_size=%lld", (long long)m_MmapSize * 1024 * 1024);
+	if(Execute(aBuf, pError, ErrorSize))
+		return true;
+	// negative values are interpreted as KiB instead of pages
+	str_format(aBuf, sizeof(aBuf), "PRAGMA cache_size=-%d", m_CacheSize);
+	return Execute(aBuf, pError, ErrorSize);
+}
+
+bool CSqliteConnection::CreateIndices(char *pError, int ErrorSize)
+{
+	// The primary key of the race table already covers lookups by Map and
+	// by (Map, Name). Rankings sort all times of a map and the points and
+	// player data lookups filter by Name only.
+	const char *apIndices[][3] = {
+		{"race_MapTime", "race", "Map, Time"},
+		{"race_Name", "race", "Name, Map"},
+		{"teamrace_MapTime", "teamrace", "Map, Time"},
+		{"teamrace_MapName", "teamrace", "Map, Name"},
+	};
+	for(const auto &aIndex : apIndices)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf),
+			"CREATE INDEX IF NOT EXISTS %s_%s ON %s_%s (%s)",
+			GetPrefix(), aIndex[0], GetPrefix(), aIndex[1], aIndex[2]);
+		if(Execute(aBuf, pError, ErrorSize))
+			return true;
+	}
+	return false;
+}
+
 bool CSqliteConnection::FormatError(int Result, char *pError, int ErrorSize)
 {
 	if(Result != SQLITE_OK)
@@ -439,7 +520,7 @@ bool CSqliteConnection::ChangePowerStatus(const char *pPlayer, const char *Power
 	return Step(&End, pError, ErrorSize);
 }
 
-std::unique_ptr<IDbConnection> CreateSqliteConnection(const char *pFilename, bool Setup)
+std::unique_ptr<IDbConnection> CreateSqliteConnection(const char *pFilename, bool Setup, const CSqliteConfig *pConfig)
 {
-	return std::make_unique<CSqliteConnection>(pFilename, Setup);
+	return std::make_unique<CSqliteConnection>(pFilename, Setup, pConfig);
 }
@@ -79,9 +79,13 @@ int main(int argc, const char **argv)
 	vpLoggers.push_back(pFutureFileLogger);
 	std::shared_ptr<CFutureLogger> pFutureConsoleLogger = std::make_shared<CFutureLogger>();
 	vpLoggers.push_back(pFutureConsoleLogger);
+	// the assertion logger has to see the last messages before a crash, the
+	// others are written from a background thread
+	std::vector<std::shared_ptr<ILogger>> vpGlobalLoggers;
+	vpGlobalLoggers.push_back(std::shared_ptr<ILogger>(log_logger_ring(log_logger_collection(std::move(vpLoggers)))));
 	std::shared_ptr<CFutureLogger> pFutureAssertionLogger = std::make_shared<CFutureLogger>();
-	vpLoggers.push_back(pFutureAssertionLogger);
-	log_set_global_logger(log_logger_collection(std::move(vpLoggers)).release());
+	vpGlobalLoggers.push_back(pFutureAssertionLogger);
+	log_set_global_logger(log_logger_collection(std::move(vpGlobalLoggers)).release());
 
 	if(secure_random_init() != 0)
 	{
@@ -184,7 +188,9 @@ int main(int argc, const char **argv)
 			dbg_msg("client", "failed to open '%s' for logging", g_Config.m_Logfile);
 		}
 	}
-	pEngine->SetAdditionalLogger(std::make_unique<CServerLogger>(pServer));
+	std::unique_ptr<CServerLogger> pServerLogger = std::make_unique<CServerLogger>(pServer);
+	pServer->SetServerLogger(pServerLogger.get());
+	pEngine->SetAdditionalLogger(std::move(pServerLogger));
 
 	// run the server
 	dbg_msg("server", "starting...");
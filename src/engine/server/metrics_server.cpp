@@ -0,0 +1,144 @@
+#include "metrics_server.h"
+
+#include <engine/shared/metrics.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+CMetricsServer::~CMetricsServer()
+{
+	Close();
+}
+
+bool CMetricsServer::Open(NETADDR BindAddr, const CMetrics *pMetrics)
+{
+	Close();
+	m_Socket = net_tcp_create(BindAddr);
+	if(!m_Socket)
+		return false;
+	if(net_tcp_listen(m_Socket, 8))
+	{
+		net_tcp_close(m_Socket);
+		m_Socket = nullptr;
+		return false;
+	}
+	net_set_non_blocking(m_Socket);
+
+	m_pMetrics = pMetrics;
+	m_Stop.store(false);
+	m_pThread = thread_init(ThreadFunc, this, "metrics");
+	return true;
+}
+
+void CMetricsServer::Close()
+{
+	if(m_pThread)
+	{
+		m_Stop.store(true);
+		thread_wait(m_pThread);
+		m_pThread = nullptr;
+	}
+	if(m_Socket)
+	{
+		net_tcp_close(m_Socket);
+		m_Socket = nullptr;
+	}
+}
+
+void CMetricsServer::ThreadFunc(void *pUser)
+{
+	static_cast<CMetricsServer *>(pUser)->Run();
+}
+
+void CMetricsServer::Run()
+{
+	while(!m_Stop.load())
+	{
+		// wake up regularly to notice Close()
+		if(net_socket_read_wait(m_Socket, 100000) <= 0)
+			continue;
+
+		NETSOCKET Socket;
+		NETADDR Addr;
+		while(net_tcp_accept(m_Socket, &Socket, &Addr) > 0)
+		{
+			// a scraper that stops reading mustn't block the thread,
+			// Close() waits for it
+			net_set_non_blocking(Socket);
+			HandleClient(Socket);
+			net_tcp_close(Socket);
+		}
+	}
+}
+
+void CMetricsServer::HandleClient(NETSOCKET Socket)
+{
+	// read the request header, giving up on slow or oversized requests
+	char aRequest[2048];
+	int Size = 0;
+	const int64_t Deadline = time_get() + time_freq() * 2;
+	while(true)
+	{
+		const int64_t Left = Deadline - time_get();
+		if(Left <= 0 || Size == (int)sizeof(aRequest) - 1)
+			return;
+		if(net_socket_read_wait(Socket, Left * 1000000 / time_freq()) <= 0)
+			return;
+		int Bytes = net_tcp_recv(Socket, aRequest + Size, sizeof(aRequest) - 1 - Size);
+		if(Bytes < 0 && net_would_block())
+			continue;
+		if(Bytes <= 0)
+			return;
+		Size += Bytes;
+		aRequest[Size] = '\0';
+		if(str_find(aRequest, "\r\n\r\n") || str_find(aRequest, "\n\n"))
+			break;
+	}
+
+	std::string Body;
+	const char *pStatus;
+	const char *pPath = str_startswith(aRequest, "GET ");
+	if(!pPath)
+	{
+		pStatus = "405 Method Not Allowed";
+		Body = "only GET is supported\n";
+	}
+	else if(str_startswith(pPath, "/metrics ") || str_startswith(pPath, "/ "))
+	{
+		pStatus = "200 OK";
+		Body.reserve(64 * 1024);
+		m_pMetrics->Format(Body);
+	}
+	else
+	{
+		pStatus = "404 Not Found";
+		Body = "metrics are served at /metrics\n";
+	}
+
+	char aHeader[256];
+	str_format(aHeader, sizeof(aHeader),
+		"HTTP/1.0 %s\r\n"
+		"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+		"Content-Length: %d\r\n"
+		"Connection: close\r\n"
+		"\r\n",
+		pStatus, (int)Body.size());
+	std::string Response = aHeader + Body;
+	const int64_t SendDeadline = time_get() + time_freq() * 5;
+	for(size_t Sent = 0; Sent < Response.size();)
+	{
+		int Bytes = net_tcp_send(Socket, Response.data() + Sent, Response.size() - Sent);
+		if(Bytes < 0 && net_would_block())
+		{
+			// drop clients that don't take the response in time
+			if(m_Stop.load() || time_get() > SendDeadline)
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		if(Bytes <= 0)
+			return;
+		Sent += Bytes;
+	}
+}
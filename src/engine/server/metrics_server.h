@@ -0,0 +1,33 @@
+#ifndef ENGINE_SERVER_METRICS_SERVER_H
+#define ENGINE_SERVER_METRICS_SERVER_H
+
+#include <base/system.h>
+
+#include <atomic>
+
+class CMetrics;
+
+// Answers HTTP requests with the metrics in the Prometheus text format. The
+// requests are handled on a thread of its own, so slow scrapers never block
+// the tick.
+class CMetricsServer
+{
+	const CMetrics *m_pMetrics = nullptr;
+	NETSOCKET m_Socket = nullptr;
+	void *m_pThread = nullptr;
+	std::atomic_bool m_Stop{false};
+
+	static void ThreadFunc(void *pUser);
+	void Run();
+	void HandleClient(NETSOCKET Socket);
+
+public:
+	~CMetricsServer();
+
+	// Returns false on error.
+	bool Open(NETADDR BindAddr, const CMetrics *pMetrics);
+	void Close();
+	bool IsOpen() const { return m_pThread != nullptr; }
+};
+
+#endif // ENGINE_SERVER_METRICS_SERVER_H
@@ -36,12 +36,14 @@
 
 // DDRace
 #include <engine/shared/linereader.h>
+#include <algorithm>
 #include <vector>
 #include <zlib.h>
 
 #include "databases/connection.h"
 #include "databases/connection_pool.h"
 #include "register.h"
+#include "server_logger.h"
 
 extern bool IsInterrupted();
 
@@ -307,8 +309,8 @@ CServer::CServer()
 {
 	m_pConfig = &g_Config;
 	for(int i = 0; i < MAX_CLIENTS; i++)
-		m_aDemoRecorder[i] = CDemoRecorder(&m_SnapshotDelta, true);
-	m_aDemoRecorder[MAX_CLIENTS] = CDemoRecorder(&m_SnapshotDelta, false);
+		m_aDemoRecorder[i] = CDemoRecorder(&m_DemoSnapshotDelta, true, &m_DemoWriter);
+	m_aDemoRecorder[MAX_CLIENTS] = CDemoRecorder(&m_DemoSnapshotDelta, false, &m_DemoWriter);
 
 	m_TickSpeed = SERVER_TICK_SPEED;
 
@@ -345,6 +347,11 @@ CServer::CServer()
 
 	m_aErrorShutdownReason[0] = 0;
 
+	m_pMetricSnapshotSize = m_Metrics.Histogram("ddnet_snapshot_size_bytes", "Size of the compressed snapshot deltas sent to clients", {64, 128, 256, 512, 1024, 2048, 4096, 8192});
+	m_pMetricTickDuration = m_Metrics.Histogram("ddnet_tick_duration_seconds", "Time spent in a game tick", {100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 20000000, 50000000}, 1e9);
+	m_pMetricSqlQueue = m_Metrics.Gauge("ddnet_sql_queue_size", "Number of queued database queries");
+	m_pMetricDemoRecorders = m_Metrics.Gauge("ddnet_demo_recorders", "Number of demos being recorded");
+
 	Init();
 }
 
@@ -365,6 +372,9 @@ CServer::~CServer()
 
 	delete m_pRegister;
 	delete m_pConnectionPool;
+
+	if(m_pServerLogger)
+		m_pServerLogger->OnServerDeletion();
 }
 
 bool CServer::IsClientNameAvailable(int ClientID, const char *pNameRequest)
@@ -811,6 +821,7 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 
 		if(!(Flags & MSGFLAG_NOSEND))
 		{
+			int NumSent = 0;
 			for(int i = 0; i < MAX_CLIENTS; i++)
 			{
 				if(m_aClients[i].m_State == CClient::STATE_INGAME)
@@ -824,8 +835,10 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 						continue;
 					}
 					m_NetServer.Send(&Packet);
+					NumSent++;
 				}
 			}
+			MsgMetric(true, pMsg->m_System, pMsg->m_MsgID)->Add(NumSent);
 		}
 	}
 	else
@@ -834,29 +847,42 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 		if(RepackMsg(pMsg, Pack, m_aClients[ClientID].m_Sixup))
 			return -1;
 
-		Packet.m_ClientID = ClientID;
-		Packet.m_pData = Pack.Data();
-		Packet.m_DataSize = Pack.Size();
+		SendPackedMsg(Pack.Data(), Pack.Size(), Flags, ClientID);
+		if(!(Flags & MSGFLAG_NOSEND))
+			MsgMetric(true, pMsg->m_System, pMsg->m_MsgID)->Add();
+	}
 
-		if(Antibot()->OnEngineServerMessage(ClientID, Packet.m_pData, Packet.m_DataSize, Flags))
-		{
-			return 0;
-		}
+	return 0;
+}
 
-		// write message to demo recorders
-		if(!(Flags & MSGFLAG_NORECORD))
-		{
-			if(m_aDemoRecorder[ClientID].IsRecording())
-				m_aDemoRecorder[ClientID].RecordMessage(Pack.Data(), Pack.Size());
-			if(m_aDemoRecorder[MAX_CLIENTS].IsRecording())
-				m_aDemoRecorder[MAX_CLIENTS].RecordMessage(Pack.Data(), Pack.Size());
-		}
+void CServer::SendPackedMsg(const void *pData, int Size, int Flags, int ClientID)
+{
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(CNetChunk));
+	if(Flags & MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags & MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+	Packet.m_ClientID = ClientID;
+	Packet.m_pData = pData;
+	Packet.m_DataSize = Size;
 
-		if(!(Flags & MSGFLAG_NOSEND))
-			m_NetServer.Send(&Packet);
+	if(Antibot()->OnEngineServerMessage(ClientID, Packet.m_pData, Packet.m_DataSize, Flags))
+	{
+		return;
 	}
 
-	return 0;
+	// write message to demo recorders
+	if(!(Flags & MSGFLAG_NORECORD))
+	{
+		if(m_aDemoRecorder[ClientID].IsRecording())
+			m_aDemoRecorder[ClientID].RecordMessage(pData, Size);
+		if(m_aDemoRecorder[MAX_CLIENTS].IsRecording())
+			m_aDemoRecorder[MAX_CLIENTS].RecordMessage(pData, Size);
+	}
+
+	if(!(Flags & MSGFLAG_NOSEND))
+		m_NetServer.Send(&Packet);
 }
 
 void CServer::SendMsgRaw(int ClientID, const void *pData, int Size, int Flags)
@@ -969,6 +995,15 @@ void CServer::DoSnapshot()
 				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
 				int NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
 
+				m_pMetricSnapshotSize->Observe(SnapshotSize);
+				if(!m_apMetricSnapshotBytes[i])
+				{
+					char aLabels[32];
+					str_format(aLabels, sizeof(aLabels), "client=\"%d\"", i);
+					m_apMetricSnapshotBytes[i] = m_Metrics.Counter("ddnet_snapshot_bytes_total", "Bytes of compressed snapshot deltas sent per client slot", aLabels);
+				}
+				m_apMetricSnapshotBytes[i]->Add(SnapshotSize);
+
 				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
 				{
 					int Chunk = Left < MaxSize ? Left : MaxSize;
@@ -1331,20 +1366,131 @@ void CServer::SendRconCmdRem(const IConsole::CCommandInfo *pCommandInfo, int Cli
 	SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
 }
 
-void CServer::UpdateClientRconCommands()
+const CServer::CRconCmdList *CServer::RconCmdList(int AccessLevel)
 {
-	int ClientID = Tick() % MAX_CLIENTS;
+	CRconCmdList *pList = &m_aRconCmdLists[AccessLevel];
+	if(pList->m_Valid)
+		return pList;
 
-	if(m_aClients[ClientID].m_State != CClient::STATE_EMPTY && m_aClients[ClientID].m_Authed)
+	pList->m_vpCommands.clear();
+	for(auto &vData : pList->m_avData)
+		vData.clear();
+	for(auto &vOffsets : pList->m_avOffsets)
+		vOffsets.clear();
+	for(const IConsole::CCommandInfo *pInfo = Console()->FirstCommandInfo(AccessLevel, CFGFLAG_SERVER); pInfo; pInfo = pInfo->NextCommandInfo(AccessLevel, CFGFLAG_SERVER))
 	{
-		int ConsoleAccessLevel = m_aClients[ClientID].m_Authed == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : m_aClients[ClientID].m_Authed == AUTHED_MOD ? IConsole::ACCESS_LEVEL_MOD :
-																				      IConsole::ACCESS_LEVEL_HELPER;
-		for(int i = 0; i < MAX_RCONCMD_SEND && m_aClients[ClientID].m_pRconCmdToSend; ++i)
+		CMsgPacker Msg(NETMSG_RCON_CMD_ADD, true);
+		Msg.AddString(pInfo->m_pName, IConsole::TEMPCMD_NAME_LENGTH);
+		Msg.AddString(pInfo->m_pHelp, IConsole::TEMPCMD_HELP_LENGTH);
+		Msg.AddString(pInfo->m_pParams, IConsole::TEMPCMD_PARAMS_LENGTH);
+		for(int Sixup = 0; Sixup < 2; Sixup++)
 		{
-			SendRconCmdAdd(m_aClients[ClientID].m_pRconCmdToSend, ClientID);
-			m_aClients[ClientID].m_pRconCmdToSend = m_aClients[ClientID].m_pRconCmdToSend->NextCommandInfo(ConsoleAccessLevel, CFGFLAG_SERVER);
+			CPacker Pack;
+			RepackMsg(&Msg, Pack, Sixup);
+			pList->m_avOffsets[Sixup].push_back(pList->m_avData[Sixup].size());
+			pList->m_avData[Sixup].insert(pList->m_avData[Sixup].end(), Pack.Data(), Pack.Data() + Pack.Size());
+		}
+		pList->m_vpCommands.push_back(pInfo);
+	}
+	for(int Sixup = 0; Sixup < 2; Sixup++)
+		pList->m_avOffsets[Sixup].push_back(pList->m_avData[Sixup].size());
+	pList->m_Valid = true;
+	return pList;
+}
+
+void CServer::UpdateClientRconCommands()
+{
+	for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+	{
+		CClient *pClient = &m_aClients[ClientID];
+		if(pClient->m_State == CClient::STATE_EMPTY || !pClient->m_Authed || !pClient->m_pRconCmdToSend)
+			continue;
+
+		int NumUnacked, UnackedSize;
+		m_NetServer.UnackedChunks(ClientID, &NumUnacked, &UnackedSize);
+		int Budget = RCONCMD_SEND_BUFFER - UnackedSize;
+		int NumChunks = RCONCMD_SEND_CHUNKS - NumUnacked;
+		if(Budget <= 0 || NumChunks <= 0)
+			continue;
+
+		const int ConsoleAccessLevel = pClient->m_Authed == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : pClient->m_Authed == AUTHED_MOD ? IConsole::ACCESS_LEVEL_MOD : IConsole::ACCESS_LEVEL_HELPER;
+		const CRconCmdList *pList = RconCmdList(ConsoleAccessLevel);
+		const int NumCommands = pList->m_vpCommands.size();
+
+		// continue after the commands that were already sent, the list
+		// may have been rebuilt since
+		const char *pNext = pClient->m_pRconCmdToSend->m_pName;
+		int Index = std::lower_bound(pList->m_vpCommands.begin(), pList->m_vpCommands.end(), pNext, [](const IConsole::CCommandInfo *pInfo, const char *pName) {
+			return str_comp(pInfo->m_pName, pName) < 0;
+		}) - pList->m_vpCommands.begin();
+
+		// the chunks are queued without flushing, so the network layer packs
+		// as many of them into each packet as fit
+		const int Sixup = pClient->m_Sixup;
+		const unsigned char *pData = pList->m_avData[Sixup].data();
+		const int *pOffsets = pList->m_avOffsets[Sixup].data();
+		const int FirstIndex = Index;
+		for(; Index < NumCommands && NumChunks > 0; Index++, NumChunks--)
+		{
+			const int Size = pOffsets[Index + 1] - pOffsets[Index];
+			Budget -= sizeof(CNetChunkResend) + Size;
+			if(Budget < 0)
+				break;
+			SendPackedMsg(pData + pOffsets[Index], Size, MSGFLAG_VITAL, ClientID);
 		}
+		MsgMetric(true, true, NETMSG_RCON_CMD_ADD)->Add(Index - FirstIndex);
+		pClient->m_pRconCmdToSend = Index < NumCommands ? pList->m_vpCommands[Index] : nullptr;
+	}
+}
+
+CMetricCounter *CServer::MsgMetric(bool Out, bool System, int MsgID)
+{
+	const int Index = MsgID >= 0 && MsgID < METRIC_MSG_IDS ? MsgID : METRIC_MSG_IDS;
+	CMetricCounter **ppCounter = Out ? &m_aapMetricMsgsOut[System][Index] : &m_aapMetricMsgsIn[System][Index];
+	if(!*ppCounter)
+	{
+		char aLabels[64];
+		if(Index == METRIC_MSG_IDS)
+			str_format(aLabels, sizeof(aLabels), "system=\"%d\",id=\"other\"", System);
+		else
+			str_format(aLabels, sizeof(aLabels), "system=\"%d\",id=\"%d\"", System, Index);
+		if(Out)
+			*ppCounter = m_Metrics.Counter("ddnet_messages_sent_total", "Messages sent to clients by type", aLabels);
+		else
+			*ppCounter = m_Metrics.Counter("ddnet_messages_received_total", "Messages received from clients by type", aLabels);
+	}
+	return *ppCounter;
+}
+
+void CServer::UpdateMetrics()
+{
+	m_pMetricSqlQueue->Set(DbPool()->QueueSize());
+	int NumRecorders = 0;
+	for(const auto &Recorder : m_aDemoRecorder)
+		NumRecorders += Recorder.IsRecording();
+	m_pMetricDemoRecorders->Set(NumRecorders);
+}
+
+void CServer::OpenMetricsServer()
+{
+	if(Config()->m_SvMetricsPort == 0)
+		return;
+
+	// unlike econ, a bind address that can't be resolved doesn't fall back to
+	// all interfaces
+	NETADDR BindAddr;
+	mem_zero(&BindAddr, sizeof(BindAddr));
+	BindAddr.type = NETTYPE_ALL;
+	if(Config()->m_SvMetricsBindaddr[0] && net_host_lookup(Config()->m_SvMetricsBindaddr, &BindAddr, NETTYPE_ALL) != 0)
+	{
+		dbg_msg("metrics", "couldn't resolve bind address '%s'", Config()->m_SvMetricsBindaddr);
+		return;
 	}
+	BindAddr.port = Config()->m_SvMetricsPort;
+	if(m_MetricsServer.Open(BindAddr, &m_Metrics))
+		dbg_msg("metrics", "serving metrics on %s:%d", Config()->m_SvMetricsBindaddr, Config()->m_SvMetricsPort);
+	else
+		dbg_msg("metrics", "couldn't open socket. port %d might already be in use", Config()->m_SvMetricsPort);
 }
 
 static inline int MsgFromSixup(int Msg, bool System)
@@ -1386,6 +1532,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 	{
 		return;
 	}
+	MsgMetric(false, Sys, Msg)->Add();
 
 	if(Config()->m_SvNetlimit && Msg != NETMSG_REQUEST_MAP_DATA)
 	{
@@ -2548,17 +2695,29 @@ int CServer::Run()
 		char aFullPath[IO_MAX_PATH_LENGTH];
 		Storage()->GetCompletePath(IStorage::TYPE_SAVE_OR_ABSOLUTE, Config()->m_SvSqliteFile, aFullPath, sizeof(aFullPath));
 
+		CSqliteConfig SqliteConfig;
+		SqliteConfig.m_Tuned = Config()->m_SvSqliteTuned;
+		SqliteConfig.m_MmapSize = Config()->m_SvSqliteMmapSize;
+		SqliteConfig.m_CacheSize = Config()->m_SvSqliteCacheSize;
+
 		if(Config()->m_SvUseSQL)
 		{
-			DbPool()->RegisterSqliteDatabase(CDbConnectionPool::WRITE_BACKUP, aFullPath);
+			DbPool()->RegisterSqliteDatabase(CDbConnectionPool::WRITE_BACKUP, aFullPath, &SqliteConfig);
 		}
 		else
 		{
-			DbPool()->RegisterSqliteDatabase(CDbConnectionPool::READ, aFullPath);
-			DbPool()->RegisterSqliteDatabase(CDbConnectionPool::WRITE, aFullPath);
+			DbPool()->RegisterSqliteDatabase(CDbConnectionPool::READ, aFullPath, &SqliteConfig);
+			DbPool()->RegisterSqliteDatabase(CDbConnectionPool::WRITE, aFullPath, &SqliteConfig);
 		}
 	}
 
+	if(Config()->m_SvSqlSpillFile[0] != '\0')
+	{
+		char aFullPath[IO_MAX_PATH_LENGTH];
+		Storage()->GetCompletePath(IStorage::TYPE_SAVE_OR_ABSOLUTE, Config()->m_SvSqlSpillFile, aFullPath, sizeof(aFullPath));
+		DbPool()->SetSpillFile(aFullPath);
+	}
+
 	// start server
 	NETADDR BindAddr;
 	int NetType = Config()->m_SvIpv4Only ? NETTYPE_IPV4 : NETTYPE_ALL;
@@ -2591,6 +2750,7 @@ int CServer::Run()
 	m_NetServer.SetCallbacks(NewClientCallback, NewClientNoAuthCallback, ClientRejoinCallback, DelClientCallback, this);
 
 	m_Econ.Init(Config(), Console(), &m_ServerBan);
+	OpenMetricsServer();
 
 #if defined(CONF_FAMILY_UNIX)
 	m_Fifo.Init(Console(), Config()->m_SvInputFifo, CFGFLAG_SERVER);
@@ -2736,6 +2896,7 @@ int CServer::Run()
 
 			while(t > TickStartTime(m_CurrentGameTick + 1))
 			{
+				const int64_t TickStart = time_get_nanoseconds().count();
 				GameServer()->OnPreTickTeehistorian();
 
 				for(int c = 0; c < MAX_CLIENTS; c++)
@@ -2778,10 +2939,13 @@ int CServer::Run()
 				}
 
 				GameServer()->OnTick();
+				m_pMetricTickDuration->Observe(time_get_nanoseconds().count() - TickStart);
 				if(ErrorShutdown())
 				{
 					break;
 				}
+				if(m_CurrentGameTick % TickSpeed() == 0)
+					UpdateMetrics();
 			}
 
 			// snap game
@@ -2791,10 +2955,13 @@ int CServer::Run()
 					DoSnapshot();
 
 				UpdateClientRconCommands();
+				if(m_pServerLogger)
+					m_pServerLogger->Update();
 
 #if defined(CONF_FAMILY_UNIX)
 				m_Fifo.Update();
 #endif
+				DbPool()->Update();
 			}
 
 			// master server stuff
@@ -2872,6 +3039,7 @@ int CServer::Run()
 	}
 
 	m_Econ.Shutdown();
+	m_MetricsServer.Close();
 
 #if defined(CONF_FAMILY_UNIX)
 	m_Fifo.Shutdown();
@@ -2880,7 +3048,7 @@ int CServer::Run()
 	GameServer()->OnShutdown();
 	m_pMap->Unload();
 
-	DbPool()->OnShutdown();
+	DbPool()->OnShutdown(Config()->m_SvSqlDrainTimeout);
 
 #if defined(CONF_UPNP)
 	m_UPnP.Shutdown();
@@ -3482,6 +3650,8 @@ void CServer::ConchainCommandAccessUpdate(IConsole::IResult *pResult, void *pUse
 		pfnCallback(pResult, pCallbackUserData);
 		if(pInfo && OldAccessLevel != pInfo->GetAccessLevel())
 		{
+			for(auto &List : pThis->m_aRconCmdLists)
+				List.m_Valid = false;
 			for(int i = 0; i < MAX_CLIENTS; ++i)
 			{
 				if(pThis->m_aClients[i].m_State == CServer::CClient::STATE_EMPTY ||
@@ -3723,6 +3893,12 @@ void *CServer::SnapNewItem(int Type, int ID, int Size)
 void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
+
+	// let the demo writer finish the deltas it has queued before changing
+	// the sizes under it
+	for(auto &Recorder : m_aDemoRecorder)
+		m_DemoWriter.Flush(&Recorder);
+	m_DemoSnapshotDelta.SetStaticsize(ItemType, Size);
 }
 
 CServer *CreateServer() { return new CServer(); }
@@ -11,6 +11,7 @@
 #include <engine/shared/demo.h>
 #include <engine/shared/econ.h>
 #include <engine/shared/fifo.h>
+#include <engine/shared/metrics.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
 #include <engine/shared/protocol.h>
@@ -23,6 +24,7 @@
 
 #include "antibot.h"
 #include "authmanager.h"
+#include "metrics_server.h"
 #include "name_ban.h"
 
 #if defined(CONF_UPNP)
@@ -120,6 +122,29 @@ class CServer : public IServer
 
 	class CDbConnectionPool *m_pConnectionPool;
 
+	class CServerLogger *m_pServerLogger = nullptr;
+
+	CMetrics m_Metrics;
+	CMetricsServer m_MetricsServer;
+	enum
+	{
+		// message IDs above are counted together
+		METRIC_MSG_IDS = 64,
+	};
+	// registered on first use, indexed by [System][MsgID]
+	CMetricCounter *m_aapMetricMsgsIn[2][METRIC_MSG_IDS + 1] = {};
+	CMetricCounter *m_aapMetricMsgsOut[2][METRIC_MSG_IDS + 1] = {};
+	CMetricCounter *m_apMetricSnapshotBytes[MAX_CLIENTS] = {};
+	CMetricHistogram *m_pMetricSnapshotSize;
+	CMetricHistogram *m_pMetricTickDuration;
+	CMetricGauge *m_pMetricSqlQueue;
+	CMetricGauge *m_pMetricDemoRecorders;
+
+	CMetricCounter *MsgMetric(bool Out, bool System, int MsgID);
+	// samples the gauges, called once per second
+	void UpdateMetrics();
+	void OpenMetricsServer();
+
 public:
 	class IGameServer *GameServer() { return m_pGameServer; }
 	class CConfig *Config() { return m_pConfig; }
@@ -127,11 +152,30 @@ public:
 	class IConsole *Console() { return m_pConsole; }
 	class IStorage *Storage() { return m_pStorage; }
 	class IEngineAntibot *Antibot() { return m_pAntibot; }
-	class CDbConnectionPool *DbPool() { return m_pConnectionPool; }
+	class CDbConnectionPool *DbPool() override { return m_pConnectionPool; }
 
 	enum
 	{
-		MAX_RCONCMD_SEND = 16,
+		// resend buffer space and number of unacked vital chunks up to
+		// which the command list is sent to a client, half of what the
+		// connection can take so other vital messages still fit
+		RCONCMD_SEND_BUFFER = NET_CONN_BUFFERSIZE / 2,
+		RCONCMD_SEND_CHUNKS = NET_MAX_SEQUENCE / 4,
+	};
+
+	// NETMSG_RCON_CMD_ADD messages for all commands of an access level,
+	// packed once for 0.6 and 0.7 clients and reused for every client
+	// logging in with that level
+	class CRconCmdList
+	{
+	public:
+		bool m_Valid = false;
+		// sorted by name like the console's command list
+		std::vector<const IConsole::CCommandInfo *> m_vpCommands;
+		// message i is at m_avData[Sixup][m_avOffsets[Sixup][i]] and ends
+		// at the next offset
+		std::vector<unsigned char> m_avData[2];
+		std::vector<int> m_avOffsets[2];
 	};
 
 	class CClient
@@ -215,6 +259,8 @@ public:
 
 	CClient m_aClients[MAX_CLIENTS];
 	int m_aIdMap[MAX_CLIENTS * VANILLA_MAX_CLIENTS];
+	// admin, moderator and helper, rebuilt when access levels change
+	CRconCmdList m_aRconCmdLists[IConsole::ACCESS_LEVEL_USER];
 
 	CSnapshotDelta m_SnapshotDelta;
 	CSnapshotBuilder m_SnapshotBuilder;
@@ -260,7 +306,12 @@ public:
 	unsigned char *m_apCurrentMapData[NUM_MAP_TYPES];
 	unsigned int m_aCurrentMapSize[NUM_MAP_TYPES];
 
+	// only used on the thread of the demo writer, the one above gets its
+	// static sizes changed per client while snapping
+	CSnapshotDelta m_DemoSnapshotDelta;
 	CDemoRecorder m_aDemoRecorder[MAX_CLIENTS + 1];
+	// after the recorders, so that it finishes their chunks before they go away
+	CDemoWriter m_DemoWriter;
 	CAuthManager m_AuthManager;
 
 	int64_t m_ServerInfoFirstRequest;
@@ -295,6 +346,8 @@ public:
 	int Init();
 
 	void SendLogLine(const CLogMessage *pMessage);
+	// the logger that collects the lines for SendLogLine, updated every tick
+	void SetServerLogger(class CServerLogger *pServerLogger) { m_pServerLogger = pServerLogger; }
 	void SetRconCID(int ClientID) override;
 	int GetAuthedState(int ClientID) const override;
 	const char *GetAuthName(int ClientID) const override;
@@ -314,6 +367,8 @@ public:
 
 	int GetClientVersion(int ClientID) const override;
 	int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) override;
+	// sends a message that's already repacked for the client's protocol
+	void SendPackedMsg(const void *pData, int Size, int Flags, int ClientID);
 
 	void DoSnapshot();
 
@@ -334,6 +389,7 @@ public:
 
 	void SendRconCmdAdd(const IConsole::CCommandInfo *pCommandInfo, int ClientID);
 	void SendRconCmdRem(const IConsole::CCommandInfo *pCommandInfo, int ClientID);
+	const CRconCmdList *RconCmdList(int AccessLevel);
 	void UpdateClientRconCommands();
 
 	void ProcessClientPacket(CNetChunk *pPacket);
@@ -475,6 +531,8 @@ public:
 
 	bool IsSixup(int ClientID) const override { return ClientID != SERVER_DEMO_CLIENT && m_aClients[ClientID].m_Sixup; }
 
+	CMetrics *Metrics() override { return &m_Metrics; }
+
 #ifdef CONF_FAMILY_UNIX
 	enum CONN_LOGGING_CMD
 	{
@@ -2,6 +2,8 @@
 
 #include "server.h"
 
+#include <engine/shared/config.h>
+
 CServerLogger::CServerLogger(CServer *pServer) :
 	m_pServer(pServer),
 	m_MainThread(std::this_thread::get_id())
@@ -11,28 +13,43 @@ CServerLogger::CServerLogger(CServer *pServer) :
 
 void CServerLogger::Log(const CLogMessage *pMessage)
 {
+	// don't keep what neither rcon nor econ would show
+	if(pMessage->m_Level > IConsole::ToLogLevel(g_Config.m_ConsoleOutputLevel) &&
+		pMessage->m_Level > IConsole::ToLogLevel(g_Config.m_EcOutputLevel))
+	{
+		return;
+	}
+
 	m_PendingLock.lock();
-	if(m_MainThread == std::this_thread::get_id())
+	if((int)m_vPending.size() < MAX_PENDING)
+		m_vPending.push_back(*pMessage);
+	else
+		m_NumDropped++;
+	m_PendingLock.unlock();
+}
+
+void CServerLogger::Update()
+{
+	dbg_assert(m_MainThread == std::this_thread::get_id(), "CServerLogger::Update not called from the main thread");
+
+	m_PendingLock.lock();
+	std::swap(m_vPending, m_vSending);
+	const int NumDropped = m_NumDropped;
+	m_NumDropped = 0;
+	m_PendingLock.unlock();
+
+	if(m_pServer)
 	{
-		if(!m_vPending.empty())
+		for(const auto &Message : m_vSending)
 		{
-			if(m_pServer)
-			{
-				for(const auto &Message : m_vPending)
-				{
-					m_pServer->SendLogLine(&Message);
-				}
-			}
-			m_vPending.clear();
+			m_pServer->SendLogLine(&Message);
 		}
-		m_PendingLock.unlock();
-		if(m_pServer)
-			m_pServer->SendLogLine(pMessage);
 	}
-	else
+	m_vSending.clear();
+
+	if(NumDropped > 0)
 	{
-		m_vPending.push_back(*pMessage);
-		m_PendingLock.unlock();
+		log_warn("server", "dropped %d log lines for rcon and econ", NumDropped);
 	}
 }
 
@@ -6,17 +6,28 @@
 
 class CServer;
 
+// Collects the log lines for rcon and econ from any thread, they are sent
+// once per tick by the main thread.
 class CServerLogger : public ILogger
 {
+	enum
+	{
+		MAX_PENDING = 1024,
+	};
+
 	CServer *m_pServer = nullptr;
 	std::mutex m_PendingLock;
 	std::vector<CLogMessage> m_vPending;
+	std::vector<CLogMessage> m_vSending;
+	int m_NumDropped = 0;
 	std::thread::id m_MainThread;
 
 public:
 	CServerLogger(CServer *pServer);
 	void Log(const CLogMessage *pMessage) override;
 	// Must be called from the main thread!
+	void Update();
+	// Must be called from the main thread!
 	void OnServerDeletion();
 };
 
@@ -14,6 +14,7 @@ MACRO_CONFIG_STR(Logfile, logfile, 128, "", CFGFLAG_SAVE | CFGFLAG_CLIENT | CFGF
 MACRO_CONFIG_INT(Loglevel, loglevel, 2, 0, 4, CFGFLAG_SAVE | CFGFLAG_CLIENT | CFGFLAG_SERVER, "Log level (0 = Error, 1 = Warn, 2 = Info, 3 = Debug, 4 = Trace)")
 MACRO_CONFIG_INT(ConsoleOutputLevel, console_output_level, 0, 0, 2, CFGFLAG_CLIENT | CFGFLAG_SERVER, "Adjusts the amount of information in the console")
 MACRO_CONFIG_INT(ConsoleEnableColors, console_enable_colors, 1, 0, 1, CFGFLAG_CLIENT | CFGFLAG_SERVER, "Enable colors in console output")
+MACRO_CONFIG_INT(PackedCollision, packed_collision, 1, 0, 1, CFGFLAG_SAVE | CFGFLAG_CLIENT | CFGFLAG_SERVER, "Interleave the tile layers into one packed record per tile at map load for faster tile lookups")
 MACRO_CONFIG_INT(Events, events, 1, 0, 1, CFGFLAG_SAVE | CFGFLAG_CLIENT | CFGFLAG_SERVER, "Enable triggering of events, (eye emotes on some holidays in server, christmas skins in client).")
 
 MACRO_CONFIG_STR(SteamName, steam_name, 16, "", CFGFLAG_SAVE | CFGFLAG_CLIENT, "Last seen name of the Steam profile")
@@ -166,6 +167,10 @@ MACRO_CONFIG_INT(SvRconBantime, sv_rcon_bantime, 5, 0, 1440, CFGFLAG_SERVER, "Th
 MACRO_CONFIG_INT(SvAutoDemoRecord, sv_auto_demo_record, 0, 0, 1, CFGFLAG_SERVER, "Automatically record demos")
 MACRO_CONFIG_INT(SvAutoDemoMax, sv_auto_demo_max, 10, 0, 1000, CFGFLAG_SERVER, "Maximum number of automatically recorded demos (0 = no limit)")
 MACRO_CONFIG_INT(SvTeeHistorian, sv_tee_historian, 0, 0, 1, CFGFLAG_SERVER, "Activate the tee historian that writes complete gameplay data to disk (WARNING: This will use a lot of disk space)")
+MACRO_CONFIG_INT(SvTeeHistorianCompress, sv_tee_historian_compress, 0, 0, 1, CFGFLAG_SERVER, "Write the tee historian data in zlib compressed frames (.teehistorian.z)")
+MACRO_CONFIG_INT(SvTeeHistorianRotateSize, sv_tee_historian_rotate_size, 0, 0, 1000000, CFGFLAG_SERVER, "Continue the tee historian data in a new file after this many MiB (0 = never)")
+MACRO_CONFIG_INT(SvTeeHistorianRotateTime, sv_tee_historian_rotate_time, 0, 0, 43200, CFGFLAG_SERVER, "Continue the tee historian data in a new file after this many minutes (0 = never)")
+MACRO_CONFIG_INT(SvTeeHistorianVersion, sv_tee_historian_version, 3, 2, 3, CFGFLAG_SERVER, "Tee historian format version to write (2 for older parsers, 3 is more compact)")
 MACRO_CONFIG_INT(SvVanillaAntiSpoof, sv_vanilla_antispoof, 1, 0, 1, CFGFLAG_SERVER, "Enable vanilla Antispoof")
 MACRO_CONFIG_INT(SvDnsbl, sv_dnsbl, 0, 0, 1, CFGFLAG_SERVER, "Enable DNSBL (DNS-based Blackhole List)")
 MACRO_CONFIG_STR(SvDnsblHost, sv_dnsbl_host, 128, "", CFGFLAG_SERVER, "Hostname of DNSBL provider to use for IP Verification")
@@ -274,6 +279,7 @@ MACRO_CONFIG_STR(SvScoreFolder, sv_score_folder, 32, "records", CFGFLAG_SERVER,
 MACRO_CONFIG_STR(SvRegionName, sv_region_name, 5, "UNK", CFGFLAG_SERVER, "Server region. Used for regional bans")
 MACRO_CONFIG_STR(SvSqlServerName, sv_sql_servername, 5, "UNK", CFGFLAG_SERVER, "SQL Server name that is inserted into record table")
 MACRO_CONFIG_INT(SvSaveGames, sv_savegames, 1, 0, 1, CFGFLAG_SERVER, "Enables savegames (/save and /load)")
+MACRO_CONFIG_INT(SvSaveBinary, sv_save_binary, 0, 0, 1, CFGFLAG_SERVER, "Store savegames in the compact binary format (only enable if all servers using the database can load it)")
 MACRO_CONFIG_INT(SvSaveSwapGamesDelay, sv_saveswapgames_delay, 30, 0, 10000, CFGFLAG_SERVER, "Delay in seconds for loading a savegame or before swapping")
 MACRO_CONFIG_INT(SvSaveSwapGamesPenalty, sv_saveswapgames_penalty, 60, 0, 10000, CFGFLAG_SERVER, "Penalty in seconds for saving or swapping position")
 MACRO_CONFIG_INT(SvSwapTimeout, sv_swap_timeout, 180, 0, 10000, CFGFLAG_SERVER, "Timeout in seconds before option to swap expires")
@@ -281,6 +287,11 @@ MACRO_CONFIG_INT(SvSwap, sv_swap, 1, 0, 1, CFGFLAG_SERVER, "Enable /swap")
 MACRO_CONFIG_INT(SvUseSQL, sv_use_sql, 0, 0, 1, CFGFLAG_SERVER, "Enables MySQL backend instead of SQLite backend (sv_sqlite_file is still used as fallback write server when no MySQL server is reachable)")
 MACRO_CONFIG_INT(SvSqlQueriesDelay, sv_sql_queries_delay, 1, 0, 20, CFGFLAG_SERVER, "Delay in seconds between SQL queries of a single player")
 MACRO_CONFIG_STR(SvSqliteFile, sv_sqlite_file, 64, "ddnet-server.sqlite", CFGFLAG_SERVER, "File to store ranks in case sv_use_sql is turned off or used as backup sql server")
+MACRO_CONFIG_INT(SvSqliteTuned, sv_sqlite_tuned, 1, 0, 1, CFGFLAG_SERVER, "Open the SQLite database with WAL journal, synchronous=NORMAL, memory mapped I/O and a bigger page cache")
+MACRO_CONFIG_INT(SvSqliteMmapSize, sv_sqlite_mmap_size, 256, 0, 4096, CFGFLAG_SERVER, "Size of the SQLite memory map in MiB when sv_sqlite_tuned is enabled (0 to disable)")
+MACRO_CONFIG_INT(SvSqliteCacheSize, sv_sqlite_cache_size, 16384, 2048, 1048576, CFGFLAG_SERVER, "Size of the SQLite page cache in KiB when sv_sqlite_tuned is enabled")
+MACRO_CONFIG_INT(SvSqlDrainTimeout, sv_sql_drain_timeout, 10, 0, 600, CFGFLAG_SERVER, "Seconds to wait for queued score writes on shutdown before spilling them to sv_sql_spill_file (0 to wait until all are done)")
+MACRO_CONFIG_STR(SvSqlSpillFile, sv_sql_spill_file, 64, "ddnet-server-sql-spill.bin", CFGFLAG_SERVER, "File to persist score writes to that didn't complete during shutdown, they are replayed on the next start")
 MACRO_CONFIG_STR(SvSqlBindaddr, sv_sql_bindaddr, 128, "", CFGFLAG_SERVER, "Address to bind the SQL connections to")
 
 #if defined(CONF_UPNP)
@@ -409,6 +420,9 @@ MACRO_CONFIG_INT(SvNetlimitAlpha, sv_netlimit_alpha, 50, 1, 100, CFGFLAG_SERVER,
 MACRO_CONFIG_INT(SvConnlimit, sv_connlimit, 5, 0, 100, CFGFLAG_SERVER, "Connlimit: Number of connections an IP is allowed to do in a timespan")
 MACRO_CONFIG_INT(SvConnlimitTime, sv_connlimit_time, 20, 0, 1000, CFGFLAG_SERVER, "Connlimit: Time in which IP's connections are counted")
 
+MACRO_CONFIG_STR(SvMetricsBindaddr, sv_metrics_bindaddr, 128, "localhost", CFGFLAG_SERVER, "Address to serve the Prometheus metrics on. Anything but 'localhost' exposes them publicly")
+MACRO_CONFIG_INT(SvMetricsPort, sv_metrics_port, 0, 0, 65535, CFGFLAG_SERVER, "Port to serve the Prometheus metrics on over HTTP (0 = off)")
+
 #if defined(CONF_FAMILY_UNIX)
 MACRO_CONFIG_STR(SvConnLoggingServer, sv_conn_logging_server, 128, "", CFGFLAG_SERVER, "Unix socket server for IP address logging (Unix only)")
 #endif
@@ -14,6 +14,8 @@ class CConsole : public IConsole
 	{
 	public:
 		CCommand *m_pNext;
+		// next command in the same bucket of the name hash
+		CCommand *m_pNextHash;
 		int m_Flags;
 		bool m_Temp;
 		FCommandCallback m_pfnCallback;
@@ -38,6 +40,14 @@ class CConsole : public IConsole
 	const char *m_apStrokeStr[2];
 	CCommand *m_pFirstCommand;
 
+	enum
+	{
+		COMMAND_HASH_SIZE = 2048,
+	};
+	// the commands by case-insensitive name, kept in sync with the sorted
+	// list so lookups don't have to walk it
+	CCommand *m_apCommandHash[COMMAND_HASH_SIZE];
+
 	class CExecFile
 	{
 	public:
@@ -186,6 +196,9 @@ class CConsole : public IConsole
 		}
 	} m_ExecutionQueue;
 
+	static unsigned CommandHash(const char *pName);
+	void AddCommandHash(CCommand *pCommand);
+	void RemoveCommandHash(CCommand *pCommand);
 	void AddCommandSorted(CCommand *pCommand);
 	CCommand *FindCommand(const char *pName, int FlagMask);
 
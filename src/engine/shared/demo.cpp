@@ -18,6 +18,8 @@
 #include "network.h"
 #include "snapshot.h"
 
+#include <memory>
+
 const double g_aSpeeds[g_DemoSpeeds] = {0.1, 0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0, 20.0, 24.0, 28.0, 32.0, 40.0, 48.0, 56.0, 64.0};
 const CUuid SHA256_EXTENSION =
 	{{0x6b, 0xe6, 0xda, 0x4a, 0xce, 0xbd, 0x38, 0x0c,
@@ -31,17 +33,28 @@ static const unsigned char gs_VersionTickCompression = 5; // demo files with thi
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
 
+// The recorder stores the position of the keyframe index in the last two
+// timeline marker slots, which older versions never read.
+static const unsigned char gs_aIndexMarker[4] = {'D', 'I', 'D', 'X'};
+static const int gs_IndexMarkerSlot = MAX_TIMELINE_MARKERS - 2;
+static const int gs_IndexVersion = 1;
+
 static const ColorRGBA gs_DemoPrintColor{0.75f, 0.7f, 0.7f, 1.0f};
 
-CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData)
+CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData, CDemoWriter *pWriter)
 {
 	m_File = 0;
 	m_aCurrentFilename[0] = '\0';
 	m_pfnFilter = 0;
 	m_pUser = 0;
 	m_LastTickMarker = -1;
+	m_FirstTick = -1;
+	m_LastTick = -1;
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_NoMapData = NoMapData;
+	m_pWriter = pWriter;
+	m_NumPending = 0;
+	m_NumDropped = 0;
 }
 
 // Record
@@ -67,6 +80,7 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 
 	CDemoHeader Header;
 	CTimelineMarkers TimelineMarkers;
+	mem_zero(&TimelineMarkers, sizeof(TimelineMarkers));
 	if(m_File)
 	{
 		io_close(DemoFile);
@@ -118,6 +132,8 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 				str_format(aBuf, sizeof(aBuf), "Unable to open mapfile '%s'", pMap);
 				m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf, gs_DemoPrintColor);
 			}
+			io_close(DemoFile);
+			pStorage->RemoveFile(pFilename, IStorage::TYPE_SAVE);
 			return -1;
 		}
 
@@ -175,7 +191,10 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
+	m_LastTick = -1;
+	m_vKeyFrames.clear();
 	m_NumTimelineMarkers = 0;
+	m_NumDropped = 0;
 
 	if(m_pConsole)
 	{
@@ -212,6 +231,7 @@ enum
 	CHUNKMASK_TYPE = 0x60,
 	CHUNKMASK_SIZE = 0x1f,
 
+	CHUNKTYPE_INDEX = 0, // skipped by the player while playing
 	CHUNKTYPE_SNAPSHOT = 1,
 	CHUNKTYPE_MESSAGE = 2,
 	CHUNKTYPE_DELTA = 3,
@@ -240,8 +260,6 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 	}
 
 	m_LastTickMarker = Tick;
-	if(m_FirstTick < 0)
-		m_FirstTick = Tick;
 }
 
 void CDemoRecorder::Write(int Type, const void *pData, int Size)
@@ -295,9 +313,23 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 }
 
 void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	m_LastTick = Tick;
+	if(m_FirstTick < 0)
+		m_FirstTick = Tick;
+
+	if(m_pWriter)
+		m_pWriter->Enqueue(this, CDemoWriter::JOB_SNAPSHOT, Tick, pData, Size);
+	else
+		WriteSnapshot(Tick, pData, Size);
+}
+
+void CDemoRecorder::WriteSnapshot(int Tick, const void *pData, int Size)
 {
 	if(m_LastKeyFrame == -1 || (Tick - m_LastKeyFrame) > SERVER_TICK_SPEED * 5)
 	{
+		m_vKeyFrames.push_back({Tick, io_tell(m_File)});
+
 		// write full tickmarker
 		WriteTickMarker(Tick, 1);
 
@@ -335,7 +367,45 @@ void CDemoRecorder::RecordMessage(const void *pData, int Size)
 			return;
 		}
 	}
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
+	if(m_pWriter)
+		m_pWriter->Enqueue(this, CDemoWriter::JOB_MESSAGE, m_LastTick, pData, Size);
+	else
+		Write(CHUNKTYPE_MESSAGE, pData, Size);
+}
+
+long CDemoRecorder::WriteIndex()
+{
+	/*
+		Index chunk, a normal chunk of type CHUNKTYPE_INDEX after the last tick:
+			version, first tick, last tick, number of keyframes,
+			then tick and file position of each keyframe, delta coded
+	*/
+	const int NumKeyFrames = m_vKeyFrames.size();
+	if(NumKeyFrames == 0 || NumKeyFrames > (CSnapshot::MAX_SIZE / (int)sizeof(int) - 4) / 2)
+		return -1;
+
+	std::vector<int> vIndex;
+	vIndex.reserve(4 + NumKeyFrames * 2);
+	vIndex.push_back(gs_IndexVersion);
+	vIndex.push_back(m_vKeyFrames.front().m_Tick);
+	vIndex.push_back(m_LastTickMarker);
+	vIndex.push_back(NumKeyFrames);
+	CKeyFrame Prev = {0, 0};
+	for(const CKeyFrame &KeyFrame : m_vKeyFrames)
+	{
+		vIndex.push_back(KeyFrame.m_Tick - Prev.m_Tick);
+		vIndex.push_back(KeyFrame.m_Filepos - Prev.m_Filepos);
+		Prev = KeyFrame;
+	}
+
+	const long IndexPos = io_tell(m_File);
+	if(IndexPos < 0 || IndexPos > 0x7fffffff)
+		return -1;
+	Write(CHUNKTYPE_INDEX, vIndex.data(), vIndex.size() * sizeof(int));
+	// the chunk is silently dropped if it doesn't compress
+	if(io_tell(m_File) == IndexPos)
+		return -1;
+	return IndexPos;
 }
 
 int CDemoRecorder::Stop()
@@ -343,6 +413,19 @@ int CDemoRecorder::Stop()
 	if(!m_File)
 		return -1;
 
+	if(m_pWriter)
+	{
+		m_pWriter->Flush(this);
+		if(m_NumDropped && m_pConsole)
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "Dropped %d chunks because the demo writer could not keep up", m_NumDropped);
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf, gs_DemoPrintColor);
+		}
+	}
+
+	const long IndexPos = m_NumTimelineMarkers <= gs_IndexMarkerSlot ? WriteIndex() : -1;
+
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	unsigned char aLength[4];
@@ -361,6 +444,16 @@ int CDemoRecorder::Stop()
 		io_write(m_File, aMarker, sizeof(aMarker));
 	}
 
+	// point to the index if both of its slots are free
+	if(m_NumTimelineMarkers <= gs_IndexMarkerSlot && IndexPos >= 0)
+	{
+		unsigned char aIndexPos[4];
+		int_to_bytes_be(aIndexPos, IndexPos);
+		io_seek(m_File, gs_NumMarkersOffset + sizeof(CTimelineMarkers::m_aNumTimelineMarkers) + gs_IndexMarkerSlot * sizeof(aIndexPos), IOSEEK_START);
+		io_write(m_File, gs_aIndexMarker, sizeof(gs_aIndexMarker));
+		io_write(m_File, aIndexPos, sizeof(aIndexPos));
+	}
+
 	io_close(m_File);
 	m_File = 0;
 	if(m_pConsole)
@@ -371,9 +464,104 @@ int CDemoRecorder::Stop()
 
 void CDemoRecorder::AddDemoMarker()
 {
-	if(m_LastTickMarker < 0)
+	if(m_LastTick < 0)
 		return;
-	AddDemoMarker(m_LastTickMarker);
+	AddDemoMarker(m_LastTick);
+}
+
+CDemoWriter::CDemoWriter(int MaxQueuedBytes) :
+	m_MaxQueuedBytes(MaxQueuedBytes)
+{
+}
+
+CDemoWriter::~CDemoWriter()
+{
+	{
+		std::unique_lock<std::mutex> Lock(m_Lock);
+		m_Shutdown = true;
+	}
+	m_JobAdded.notify_all();
+	if(m_Thread.joinable())
+		m_Thread.join();
+}
+
+bool CDemoWriter::Enqueue(CDemoRecorder *pRecorder, int Type, int Tick, const void *pData, int Size)
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	if(m_QueuedBytes + Size > m_MaxQueuedBytes)
+	{
+		m_NumDropped++;
+		pRecorder->m_NumDropped++;
+		return false;
+	}
+
+	if(!m_Thread.joinable())
+		m_Thread = std::thread([this]() { Run(); });
+
+	CJob Job;
+	Job.m_pRecorder = pRecorder;
+	Job.m_Type = Type;
+	Job.m_Tick = Tick;
+	if(!m_vvFreeBuffers.empty())
+	{
+		Job.m_vData = std::move(m_vvFreeBuffers.back());
+		m_vvFreeBuffers.pop_back();
+	}
+	Job.m_vData.assign((const unsigned char *)pData, (const unsigned char *)pData + Size);
+	m_Jobs.push_back(std::move(Job));
+
+	m_QueuedBytes += Size;
+	m_PeakQueuedBytes = maximum(m_PeakQueuedBytes, m_QueuedBytes);
+	pRecorder->m_NumPending++;
+	Lock.unlock();
+	m_JobAdded.notify_one();
+	return true;
+}
+
+void CDemoWriter::Flush(CDemoRecorder *pRecorder)
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	m_JobDone.wait(Lock, [pRecorder]() { return pRecorder->m_NumPending == 0; });
+}
+
+int CDemoWriter::NumDropped()
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	return m_NumDropped;
+}
+
+int CDemoWriter::PeakQueuedBytes()
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	return m_PeakQueuedBytes;
+}
+
+void CDemoWriter::Run()
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	while(true)
+	{
+		m_JobAdded.wait(Lock, [this]() { return m_Shutdown || !m_Jobs.empty(); });
+		// finish the queued chunks before shutting down
+		if(m_Jobs.empty())
+			return;
+
+		CJob Job = std::move(m_Jobs.front());
+		m_Jobs.pop_front();
+		Lock.unlock();
+
+		const int Size = Job.m_vData.size();
+		if(Job.m_Type == JOB_SNAPSHOT)
+			Job.m_pRecorder->WriteSnapshot(Job.m_Tick, Job.m_vData.data(), Size);
+		else
+			Job.m_pRecorder->Write(CHUNKTYPE_MESSAGE, Job.m_vData.data(), Size);
+
+		Lock.lock();
+		m_QueuedBytes -= Size;
+		Job.m_pRecorder->m_NumPending--;
+		m_vvFreeBuffers.push_back(std::move(Job.m_vData));
+		m_JobDone.notify_all();
+	}
 }
 
 void CDemoRecorder::AddDemoMarker(int Tick)
@@ -412,7 +600,9 @@ void CDemoPlayer::Construct(class CSnapshotDelta *pSnapshotDelta)
 {
 	m_File = 0;
 	m_pKeyFrames = 0;
+	m_Indexed = false;
 	m_SpeedIndex = 4;
+	m_VideoRecording = false;
 
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_LastSnapshotDataSize = -1;
@@ -483,6 +673,74 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 	return 0;
 }
 
+bool CDemoPlayer::ReadIndex()
+{
+	if(m_Info.m_Header.m_Version <= gs_OldVersion ||
+		bytes_be_to_int(m_Info.m_TimelineMarkers.m_aNumTimelineMarkers) > gs_IndexMarkerSlot ||
+		mem_comp(m_Info.m_TimelineMarkers.m_aTimelineMarkers[gs_IndexMarkerSlot], gs_aIndexMarker, sizeof(gs_aIndexMarker)) != 0)
+		return false;
+
+	const long StartPos = io_tell(m_File);
+	const long IndexPos = bytes_be_to_int(m_Info.m_TimelineMarkers.m_aTimelineMarkers[gs_IndexMarkerSlot + 1]);
+	if(IndexPos <= StartPos || io_seek(m_File, IndexPos, IOSEEK_START) != 0)
+		return false;
+
+	int ChunkType, ChunkSize, ChunkTick = 0;
+	int aIndex[CSnapshot::MAX_SIZE / sizeof(int)];
+	int DataSize = -1;
+	if(!ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick) && ChunkType == CHUNKTYPE_INDEX && ChunkSize > 0 &&
+		io_read(m_File, m_aCompressedChunkData, ChunkSize) == (unsigned)ChunkSize)
+	{
+		DataSize = CNetBase::Decompress(m_aCompressedChunkData, ChunkSize, m_aDecompressedChunkData, sizeof(m_aDecompressedChunkData));
+		if(DataSize >= 0)
+			DataSize = CVariableInt::Decompress(m_aDecompressedChunkData, DataSize, aIndex, sizeof(aIndex));
+	}
+
+	const int NumInts = DataSize / (int)sizeof(int);
+	const int NumKeyFrames = NumInts >= 4 ? aIndex[3] : -1;
+	if(NumKeyFrames < 1 || aIndex[0] != gs_IndexVersion || NumInts < 4 + NumKeyFrames * 2)
+	{
+		io_seek(m_File, StartPos, IOSEEK_START);
+		return false;
+	}
+
+	CKeyFrame *pKeyFrames = (CKeyFrame *)calloc(NumKeyFrames, sizeof(CKeyFrame));
+	CKeyFrame Prev = {0, 0};
+	bool Valid = true;
+	for(int i = 0; i < NumKeyFrames && Valid; i++)
+	{
+		pKeyFrames[i].m_Tick = Prev.m_Tick + aIndex[4 + i * 2];
+		pKeyFrames[i].m_Filepos = Prev.m_Filepos + aIndex[4 + i * 2 + 1];
+		Valid = pKeyFrames[i].m_Filepos >= StartPos && pKeyFrames[i].m_Filepos < IndexPos && (i == 0 || (pKeyFrames[i].m_Tick > Prev.m_Tick && pKeyFrames[i].m_Filepos > Prev.m_Filepos));
+		Prev = pKeyFrames[i];
+	}
+
+	// make sure the index belongs to this file, e.g. it wasn't cut by something unaware of it
+	for(int i : {0, NumKeyFrames - 1})
+	{
+		if(!Valid)
+			break;
+		ChunkTick = 0;
+		Valid = io_seek(m_File, pKeyFrames[i].m_Filepos, IOSEEK_START) == 0 &&
+			!ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick) &&
+			(ChunkType & CHUNKTYPEFLAG_TICKMARKER) && (ChunkType & CHUNKTICKFLAG_KEYFRAME) &&
+			ChunkTick == pKeyFrames[i].m_Tick;
+	}
+
+	io_seek(m_File, StartPos, IOSEEK_START);
+	if(!Valid || aIndex[1] != pKeyFrames[0].m_Tick || aIndex[2] < pKeyFrames[NumKeyFrames - 1].m_Tick)
+	{
+		free(pKeyFrames);
+		return false;
+	}
+
+	m_pKeyFrames = pKeyFrames;
+	m_Info.m_SeekablePoints = NumKeyFrames;
+	m_Info.m_Info.m_FirstTick = aIndex[1];
+	m_Info.m_Info.m_LastTick = aIndex[2];
+	return true;
+}
+
 void CDemoPlayer::ScanFile()
 {
 	CHeap Heap;
@@ -581,11 +839,9 @@ void CDemoPlayer::DoTick()
 
 		// read the chunk
 		int DataSize = 0;
-		static char s_aData[CSnapshot::MAX_SIZE];
 		if(ChunkSize)
 		{
-			static char s_aCompresseddata[CSnapshot::MAX_SIZE];
-			if(io_read(m_File, s_aCompresseddata, ChunkSize) != (unsigned)ChunkSize)
+			if(io_read(m_File, m_aCompressedChunkData, ChunkSize) != (unsigned)ChunkSize)
 			{
 				// stop on error or eof
 				if(m_pConsole)
@@ -594,8 +850,7 @@ void CDemoPlayer::DoTick()
 				break;
 			}
 
-			static char s_aDecompressed[CSnapshot::MAX_SIZE];
-			DataSize = CNetBase::Decompress(s_aCompresseddata, ChunkSize, s_aDecompressed, sizeof(s_aDecompressed));
+			DataSize = CNetBase::Decompress(m_aCompressedChunkData, ChunkSize, m_aDecompressedChunkData, sizeof(m_aDecompressedChunkData));
 			if(DataSize < 0)
 			{
 				// stop on error or eof
@@ -605,7 +860,7 @@ void CDemoPlayer::DoTick()
 				break;
 			}
 
-			DataSize = CVariableInt::Decompress(s_aDecompressed, DataSize, s_aData, sizeof(s_aData));
+			DataSize = CVariableInt::Decompress(m_aDecompressedChunkData, DataSize, m_aChunkData, sizeof(m_aChunkData));
 
 			if(DataSize < 0)
 			{
@@ -619,9 +874,8 @@ void CDemoPlayer::DoTick()
 		if(ChunkType == CHUNKTYPE_DELTA)
 		{
 			// process delta snapshot
-			static char s_aNewsnap[CSnapshot::MAX_SIZE];
-			CSnapshot *pNewsnap = (CSnapshot *)s_aNewsnap;
-			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot *)m_aLastSnapshotData, pNewsnap, s_aData, DataSize);
+			CSnapshot *pNewsnap = (CSnapshot *)m_aSnapshotData;
+			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot *)m_aLastSnapshotData, pNewsnap, m_aChunkData, DataSize);
 
 			if(DataSize < 0)
 			{
@@ -644,17 +898,17 @@ void CDemoPlayer::DoTick()
 			else
 			{
 				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(s_aNewsnap, DataSize);
+					m_pListener->OnDemoPlayerSnapshot(m_aSnapshotData, DataSize);
 
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, s_aNewsnap, DataSize);
+				mem_copy(m_aLastSnapshotData, m_aSnapshotData, DataSize);
 				GotSnapshot = true;
 			}
 		}
 		else if(ChunkType == CHUNKTYPE_SNAPSHOT)
 		{
 			// process full snapshot
-			CSnapshot *pSnap = (CSnapshot *)s_aData;
+			CSnapshot *pSnap = (CSnapshot *)m_aChunkData;
 			if(!pSnap->IsValid(DataSize))
 			{
 				if(m_pConsole)
@@ -669,9 +923,9 @@ void CDemoPlayer::DoTick()
 				GotSnapshot = true;
 
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, s_aData, DataSize);
+				mem_copy(m_aLastSnapshotData, m_aChunkData, DataSize);
 				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(s_aData, DataSize);
+					m_pListener->OnDemoPlayerSnapshot(m_aChunkData, DataSize);
 			}
 		}
 		else
@@ -692,7 +946,7 @@ void CDemoPlayer::DoTick()
 			else if(ChunkType == CHUNKTYPE_MESSAGE)
 			{
 				if(m_pListener)
-					m_pListener->OnDemoPlayerMessage(s_aData, DataSize);
+					m_pListener->OnDemoPlayerMessage(m_aChunkData, DataSize);
 			}
 		}
 	}
@@ -830,12 +1084,10 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 		}
 	}
 
-	// scan the file for interesting points
-	ScanFile();
-
-	// reset slice markers
-	g_Config.m_ClDemoSliceBegin = -1;
-	g_Config.m_ClDemoSliceEnd = -1;
+	// read the keyframes from the index or scan the file for them
+	m_Indexed = ReadIndex();
+	if(!m_Indexed)
+		ScanFile();
 
 	// ready for playback
 	return 0;
@@ -893,12 +1145,11 @@ bool CDemoPlayer::ExtractMap(class IStorage *pStorage)
 int64_t CDemoPlayer::Time()
 {
 #if defined(CONF_VIDEORECORDER)
-	static bool s_Recording = false;
 	if(IVideo::Current())
 	{
-		if(!s_Recording)
+		if(!m_VideoRecording)
 		{
-			s_Recording = true;
+			m_VideoRecording = true;
 			m_Info.m_LastUpdate = IVideo::Time();
 		}
 		return IVideo::Time();
@@ -906,9 +1157,9 @@ int64_t CDemoPlayer::Time()
 	else
 	{
 		int64_t Now = time_get();
-		if(s_Recording)
+		if(m_VideoRecording)
 		{
-			s_Recording = false;
+			m_VideoRecording = false;
 			m_Info.m_LastUpdate = Now;
 		}
 		return Now;
@@ -1137,13 +1388,14 @@ void CDemoEditor::Init(const char *pNetVersion, class CSnapshotDelta *pSnapshotD
 	m_pStorage = pStorage;
 }
 
-void CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser)
+bool CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser)
 {
-	class CDemoPlayer DemoPlayer(m_pSnapshotDelta);
-	class CDemoRecorder DemoRecorder(m_pSnapshotDelta);
+	// too big for the stack of job threads
+	std::unique_ptr<CDemoPlayer> pDemoPlayer = std::make_unique<CDemoPlayer>(m_pSnapshotDelta);
+	std::unique_ptr<CDemoRecorder> pDemoRecorder = std::make_unique<CDemoRecorder>(m_pSnapshotDelta);
 
-	m_pDemoPlayer = &DemoPlayer;
-	m_pDemoRecorder = &DemoRecorder;
+	m_pDemoPlayer = pDemoPlayer.get();
+	m_pDemoRecorder = pDemoRecorder.get();
 
 	m_pDemoPlayer->SetListener(this);
 
@@ -1152,7 +1404,7 @@ void CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int
 	m_Stop = false;
 
 	if(m_pDemoPlayer->Load(m_pStorage, m_pConsole, pDemo, IStorage::TYPE_ALL_OR_ABSOLUTE) == -1)
-		return;
+		return false;
 
 	const CMapInfo *pMapInfo = m_pDemoPlayer->GetMapInfo();
 	const CDemoPlayer::CPlaybackInfo *pInfo = m_pDemoPlayer->Info();
@@ -1168,7 +1420,10 @@ void CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int
 	const int Result = m_pDemoRecorder->Start(m_pStorage, m_pConsole, pDst, m_pNetVersion, pMapInfo->m_aName, &Sha256, pMapInfo->m_Crc, "client", pMapInfo->m_Size, pMapData, NULL, pfnFilter, pUser) == -1;
 	free(pMapData);
 	if(Result != 0)
-		return;
+	{
+		m_pDemoPlayer->Stop();
+		return false;
+	}
 
 	m_pDemoPlayer->Play();
 
@@ -1191,6 +1446,7 @@ void CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int
 
 	m_pDemoPlayer->Stop();
 	m_pDemoRecorder->Stop();
+	return true;
 } // NOLINT(clang-analyzer-unix.Malloc)
 
 void CDemoEditor::OnDemoPlayerSnapshot(void *pData, int Size)
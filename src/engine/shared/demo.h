@@ -7,20 +7,87 @@
 
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
+
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "snapshot.h"
 
 typedef std::function<void()> TUpdateIntraTimesFunc;
 
+class CDemoRecorder;
+
+// Worker thread that creates the deltas, compresses and writes the chunks of
+// any number of demo recorders, so that recording doesn't block the caller
+// on the disk. The queue is bounded, chunks that don't fit are dropped.
+class CDemoWriter
+{
+	struct CJob
+	{
+		CDemoRecorder *m_pRecorder;
+		int m_Type;
+		int m_Tick;
+		std::vector<unsigned char> m_vData;
+	};
+
+	std::thread m_Thread;
+	std::mutex m_Lock;
+	std::condition_variable m_JobAdded;
+	std::condition_variable m_JobDone;
+	std::deque<CJob> m_Jobs;
+	// buffers of finished jobs, reused to not allocate in steady state
+	std::vector<std::vector<unsigned char>> m_vvFreeBuffers;
+	bool m_Shutdown = false;
+
+	int m_MaxQueuedBytes;
+	int m_QueuedBytes = 0;
+	int m_PeakQueuedBytes = 0;
+	int m_NumDropped = 0;
+
+	void Run();
+
+public:
+	enum
+	{
+		JOB_SNAPSHOT = 0,
+		JOB_MESSAGE,
+	};
+
+	CDemoWriter(int MaxQueuedBytes = 32 * 1024 * 1024);
+	~CDemoWriter();
+
+	// returns false if the queue is full and the chunk got dropped
+	bool Enqueue(CDemoRecorder *pRecorder, int Type, int Tick, const void *pData, int Size);
+	// waits until all chunks of the recorder are written
+	void Flush(CDemoRecorder *pRecorder);
+
+	int NumDropped();
+	int PeakQueuedBytes();
+};
+
 class CDemoRecorder : public IDemoRecorder
 {
+	friend class CDemoWriter;
+
 	class IConsole *m_pConsole;
 	IOHANDLE m_File;
 	char m_aCurrentFilename[256];
+	// written by the demo writer when recording asynchronously
 	int m_LastTickMarker;
 	int m_LastKeyFrame;
+	struct CKeyFrame
+	{
+		int m_Tick;
+		long m_Filepos;
+	};
+	std::vector<CKeyFrame> m_vKeyFrames;
+	// game thread side, for the length and markers
 	int m_FirstTick;
+	int m_LastTick;
 	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
 	class CSnapshotDelta *m_pSnapshotDelta;
 	int m_NumTimelineMarkers;
@@ -31,11 +98,20 @@ class CDemoRecorder : public IDemoRecorder
 	DEMOFUNC_FILTER m_pfnFilter;
 	void *m_pUser;
 
+	// protected by the lock of the demo writer
+	CDemoWriter *m_pWriter;
+	int m_NumPending;
+	int m_NumDropped;
+
 	void WriteTickMarker(int Tick, int Keyframe);
 	void Write(int Type, const void *pData, int Size);
+	void WriteSnapshot(int Tick, const void *pData, int Size);
+	// returns the file position of the index chunk or -1 if none was written
+	long WriteIndex();
 
 public:
-	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData = false);
+	// with a writer, deltas, compression and file writes happen on its thread
+	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData = false, CDemoWriter *pWriter = nullptr);
 	CDemoRecorder() {}
 
 	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, SHA256_DIGEST *pSha256, unsigned MapCrc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile = nullptr, DEMOFUNC_FILTER pfnFilter = nullptr, void *pUser = nullptr);
@@ -50,7 +126,7 @@ public:
 	bool IsRecording() const override { return m_File != nullptr; }
 	char *GetCurrentFilename() override { return m_aCurrentFilename; }
 
-	int Length() const override { return (m_LastTickMarker - m_FirstTick) / SERVER_TICK_SPEED; }
+	int Length() const override { return (m_LastTick - m_FirstTick) / SERVER_TICK_SPEED; }
 };
 
 class CDemoPlayer : public IDemoPlayer
@@ -107,6 +183,7 @@ private:
 	long m_MapOffset;
 	char m_aFilename[IO_MAX_PATH_LENGTH];
 	CKeyFrame *m_pKeyFrames;
+	bool m_Indexed;
 	CMapInfo m_MapInfo;
 	int m_SpeedIndex;
 
@@ -114,10 +191,17 @@ private:
 	int m_DemoType;
 	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
 	int m_LastSnapshotDataSize;
+	// chunk buffers, per player so that several can play at once
+	char m_aCompressedChunkData[CSnapshot::MAX_SIZE];
+	char m_aDecompressedChunkData[CSnapshot::MAX_SIZE];
+	char m_aChunkData[CSnapshot::MAX_SIZE];
+	char m_aSnapshotData[CSnapshot::MAX_SIZE];
+	bool m_VideoRecording;
 	class CSnapshotDelta *m_pSnapshotDelta;
 
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
 	void DoTick();
+	bool ReadIndex();
 	void ScanFile();
 
 	int64_t Time();
@@ -153,6 +237,8 @@ public:
 
 	const CPlaybackInfo *Info() const { return &m_Info; }
 	bool IsPlaying() const override { return m_File != nullptr; }
+	// whether the keyframes were read from the index instead of scanning the file
+	bool IsIndexed() const { return m_Indexed; }
 	const CMapInfo *GetMapInfo() const { return &m_MapInfo; }
 };
 
@@ -171,7 +257,7 @@ class CDemoEditor : public IDemoEditor, public CDemoPlayer::IListener
 
 public:
 	virtual void Init(const char *pNetVersion, class CSnapshotDelta *pSnapshotDelta, class IConsole *pConsole, class IStorage *pStorage);
-	void Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser) override;
+	bool Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser) override;
 
 	void OnDemoPlayerSnapshot(void *pData, int Size) override;
 	void OnDemoPlayerMessage(void *pData, int Size) override;
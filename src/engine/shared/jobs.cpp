@@ -79,7 +79,7 @@ void CJobPool::Init(int NumThreads)
 {
 	// start threads
 	m_NumThreads = NumThreads > MAX_THREADS ? MAX_THREADS : NumThreads;
-	for(int i = 0; i < NumThreads; i++)
+	for(int i = 0; i < m_NumThreads; i++)
 		m_apThreads[i] = thread_init(WorkerThread, this, "CJobPool worker");
 }
 
@@ -0,0 +1,170 @@
+#include "metrics.h"
+
+#include <base/system.h>
+
+CMetricHistogram::CMetricHistogram(const std::vector<int64_t> &vBounds, double Scale) :
+	m_vBounds(vBounds), m_pCounts(new std::atomic<int64_t>[vBounds.size() + 1]), m_Scale(Scale)
+{
+	for(int i = 0; i < NumBuckets(); i++)
+		m_pCounts[i].store(0);
+}
+
+void CMetricHistogram::Observe(int64_t Value)
+{
+	// there are only a few buckets, a linear search is fastest
+	unsigned Bucket = 0;
+	while(Bucket < m_vBounds.size() && Value > m_vBounds[Bucket])
+		Bucket++;
+	m_pCounts[Bucket].fetch_add(1, std::memory_order_relaxed);
+	m_Sum.fetch_add(Value, std::memory_order_relaxed);
+}
+
+CMetrics::CSeries *CMetrics::FindOrAdd(const char *pName, const char *pHelp, EType Type, const char *pLabels, bool *pAdded)
+{
+	CFamily *pFamily = nullptr;
+	for(auto &pFam : m_vpFamilies)
+	{
+		if(pFam->m_Name == pName)
+		{
+			pFamily = pFam.get();
+			break;
+		}
+	}
+	if(!pFamily)
+	{
+		m_vpFamilies.push_back(std::make_unique<CFamily>());
+		pFamily = m_vpFamilies.back().get();
+		pFamily->m_Name = pName;
+		pFamily->m_Help = pHelp;
+		pFamily->m_Type = Type;
+	}
+	dbg_assert(pFamily->m_Type == Type, "metric registered with different types");
+
+	*pAdded = false;
+	for(auto &pSeries : pFamily->m_vpSeries)
+	{
+		if(pSeries->m_Labels == pLabels)
+			return pSeries.get();
+	}
+	pFamily->m_vpSeries.push_back(std::make_unique<CSeries>());
+	CSeries *pSeries = pFamily->m_vpSeries.back().get();
+	pSeries->m_Labels = pLabels;
+	*pAdded = true;
+	return pSeries;
+}
+
+CMetricCounter *CMetrics::Counter(const char *pName, const char *pHelp, const char *pLabels)
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	bool Added;
+	CSeries *pSeries = FindOrAdd(pName, pHelp, TYPE_COUNTER, pLabels, &Added);
+	if(Added)
+		pSeries->m_pCounter = std::make_unique<CMetricCounter>();
+	return pSeries->m_pCounter.get();
+}
+
+CMetricGauge *CMetrics::Gauge(const char *pName, const char *pHelp, const char *pLabels)
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	bool Added;
+	CSeries *pSeries = FindOrAdd(pName, pHelp, TYPE_GAUGE, pLabels, &Added);
+	if(Added)
+		pSeries->m_pGauge = std::make_unique<CMetricGauge>();
+	return pSeries->m_pGauge.get();
+}
+
+CMetricHistogram *CMetrics::Histogram(const char *pName, const char *pHelp, const std::vector<int64_t> &vBounds, double Scale, const char *pLabels)
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	bool Added;
+	CSeries *pSeries = FindOrAdd(pName, pHelp, TYPE_HISTOGRAM, pLabels, &Added);
+	if(Added)
+		pSeries->m_pHistogram = std::make_unique<CMetricHistogram>(vBounds, Scale);
+	return pSeries->m_pHistogram.get();
+}
+
+static void FormatSample(std::string &Out, const char *pName, const char *pSuffix, const std::string &Labels, const char *pExtraLabel, const char *pValue)
+{
+	Out += pName;
+	Out += pSuffix;
+	if(!Labels.empty() || pExtraLabel[0])
+	{
+		Out += '{';
+		Out += Labels;
+		if(!Labels.empty() && pExtraLabel[0])
+			Out += ',';
+		Out += pExtraLabel;
+		Out += '}';
+	}
+	Out += ' ';
+	Out += pValue;
+	Out += '\n';
+}
+
+static void FormatScaled(char *pBuf, int BufSize, int64_t Value, double Scale)
+{
+	if(Scale == 1.0)
+		str_format(pBuf, BufSize, "%lld", (long long)Value);
+	else
+		str_format(pBuf, BufSize, "%.9g", Value / Scale);
+}
+
+void CMetrics::Format(std::string &Out) const
+{
+	static const char *const s_apTypes[] = {"counter", "gauge", "histogram"};
+
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	char aValue[64];
+	char aLabel[64];
+	for(const auto &pFamily : m_vpFamilies)
+	{
+		const char *pName = pFamily->m_Name.c_str();
+		Out += "# HELP ";
+		Out += pFamily->m_Name;
+		Out += ' ';
+		Out += pFamily->m_Help;
+		Out += "\n# TYPE ";
+		Out += pFamily->m_Name;
+		Out += ' ';
+		Out += s_apTypes[pFamily->m_Type];
+		Out += '\n';
+		for(const auto &pSeries : pFamily->m_vpSeries)
+		{
+			switch(pFamily->m_Type)
+			{
+			case TYPE_COUNTER:
+				str_format(aValue, sizeof(aValue), "%lld", (long long)pSeries->m_pCounter->Value());
+				FormatSample(Out, pName, "", pSeries->m_Labels, "", aValue);
+				break;
+			case TYPE_GAUGE:
+				str_format(aValue, sizeof(aValue), "%lld", (long long)pSeries->m_pGauge->Value());
+				FormatSample(Out, pName, "", pSeries->m_Labels, "", aValue);
+				break;
+			case TYPE_HISTOGRAM:
+			{
+				// buckets are cumulative in the output
+				const CMetricHistogram *pHistogram = pSeries->m_pHistogram.get();
+				int64_t Count = 0;
+				for(int i = 0; i < pHistogram->NumBuckets(); i++)
+				{
+					Count += pHistogram->Count(i);
+					if(i == pHistogram->NumBuckets() - 1)
+						str_copy(aLabel, "le=\"+Inf\"");
+					else
+					{
+						FormatScaled(aValue, sizeof(aValue), pHistogram->Bound(i), pHistogram->Scale());
+						str_format(aLabel, sizeof(aLabel), "le=\"%s\"", aValue);
+					}
+					str_format(aValue, sizeof(aValue), "%lld", (long long)Count);
+					FormatSample(Out, pName, "_bucket", pSeries->m_Labels, aLabel, aValue);
+				}
+				FormatScaled(aValue, sizeof(aValue), pHistogram->Sum(), pHistogram->Scale());
+				FormatSample(Out, pName, "_sum", pSeries->m_Labels, "", aValue);
+				str_format(aValue, sizeof(aValue), "%lld", (long long)Count);
+				FormatSample(Out, pName, "_count", pSeries->m_Labels, "", aValue);
+				break;
+			}
+			}
+		}
+	}
+}
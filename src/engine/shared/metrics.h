@@ -0,0 +1,108 @@
+#ifndef ENGINE_SHARED_METRICS_H
+#define ENGINE_SHARED_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// All metric updates are single relaxed atomic operations, so they can be
+// done from any thread and are cheap enough for hot paths. Look the metric
+// up once and keep the pointer, the registry lookup takes a lock.
+
+// Value that only goes up, e.g. the number of received messages.
+class CMetricCounter
+{
+	std::atomic<int64_t> m_Value{0};
+
+public:
+	void Add(int64_t Amount = 1) { m_Value.fetch_add(Amount, std::memory_order_relaxed); }
+	int64_t Value() const { return m_Value.load(std::memory_order_relaxed); }
+};
+
+// Value that can go up and down, e.g. the number of queued queries.
+class CMetricGauge
+{
+	std::atomic<int64_t> m_Value{0};
+
+public:
+	void Set(int64_t Value) { m_Value.store(Value, std::memory_order_relaxed); }
+	void Add(int64_t Amount) { m_Value.fetch_add(Amount, std::memory_order_relaxed); }
+	int64_t Value() const { return m_Value.load(std::memory_order_relaxed); }
+};
+
+// Distribution of observed values in fixed buckets, e.g. tick durations.
+class CMetricHistogram
+{
+	std::vector<int64_t> m_vBounds;
+	// one more than bounds, the last one counts the values above all bounds
+	std::unique_ptr<std::atomic<int64_t>[]> m_pCounts;
+	std::atomic<int64_t> m_Sum{0};
+	double m_Scale;
+
+public:
+	// `vBounds` are the inclusive upper bounds of the buckets in ascending
+	// order. Bounds and sum are divided by `Scale` when formatted, so that
+	// values can be observed in e.g. nanoseconds and reported in seconds.
+	CMetricHistogram(const std::vector<int64_t> &vBounds, double Scale);
+
+	void Observe(int64_t Value);
+
+	int NumBuckets() const { return m_vBounds.size() + 1; }
+	// Upper bound of the bucket, the last bucket has none.
+	int64_t Bound(int Bucket) const { return m_vBounds[Bucket]; }
+	// Number of values in the bucket, not including the lower ones.
+	int64_t Count(int Bucket) const { return m_pCounts[Bucket].load(std::memory_order_relaxed); }
+	int64_t Sum() const { return m_Sum.load(std::memory_order_relaxed); }
+	double Scale() const { return m_Scale; }
+};
+
+// Registry of named metrics that formats them in the Prometheus text format.
+//
+// Names follow the Prometheus conventions, labels are passed preformatted,
+// e.g. `type="sys",id="4"`. Registering the same name and labels again
+// returns the existing metric, so a game context recreated on map change
+// keeps reporting to the same series.
+class CMetrics
+{
+public:
+	CMetricCounter *Counter(const char *pName, const char *pHelp, const char *pLabels = "");
+	CMetricGauge *Gauge(const char *pName, const char *pHelp, const char *pLabels = "");
+	CMetricHistogram *Histogram(const char *pName, const char *pHelp, const std::vector<int64_t> &vBounds, double Scale = 1.0, const char *pLabels = "");
+
+	// Appends all metrics, can be called from any thread.
+	void Format(std::string &Out) const;
+
+private:
+	enum EType
+	{
+		TYPE_COUNTER,
+		TYPE_GAUGE,
+		TYPE_HISTOGRAM,
+	};
+
+	struct CSeries
+	{
+		std::string m_Labels;
+		std::unique_ptr<CMetricCounter> m_pCounter;
+		std::unique_ptr<CMetricGauge> m_pGauge;
+		std::unique_ptr<CMetricHistogram> m_pHistogram;
+	};
+
+	struct CFamily
+	{
+		std::string m_Name;
+		std::string m_Help;
+		EType m_Type;
+		std::vector<std::unique_ptr<CSeries>> m_vpSeries;
+	};
+
+	CSeries *FindOrAdd(const char *pName, const char *pHelp, EType Type, const char *pLabels, bool *pAdded);
+
+	mutable std::mutex m_Lock;
+	std::vector<std::unique_ptr<CFamily>> m_vpFamilies;
+};
+
+#endif // ENGINE_SHARED_METRICS_H
@@ -284,6 +284,9 @@ public:
 	int SeqSequence() const { return m_Sequence; }
 	int SecurityToken() const { return m_SecurityToken; }
 	CStaticRingBuffer<CNetChunkResend, NET_CONN_BUFFERSIZE> *ResendBuffer() { return &m_Buffer; }
+	// vital chunks that are waiting for an ack and the space they take
+	// in the resend buffer
+	void UnackedChunks(int *pNum, int *pSize);
 
 	void SetTimedOut(const NETADDR *pAddr, int Sequence, int Ack, SECURITY_TOKEN SecurityToken, CStaticRingBuffer<CNetChunkResend, NET_CONN_BUFFERSIZE> *pResendBuffer, bool Sixup);
 
@@ -433,6 +436,7 @@ public:
 
 	int ResetErrorString(int ClientID);
 	const char *ErrorString(int ClientID);
+	void UnackedChunks(int ClientID, int *pNum, int *pSize) { m_aSlots[ClientID].m_Connection.UnackedChunks(pNum, pSize); }
 
 	// anti spoof
 	SECURITY_TOKEN GetGlobalToken();
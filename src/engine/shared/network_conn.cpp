@@ -83,6 +83,17 @@ void CNetConnection::AckChunks(int Ack)
 	}
 }
 
+void CNetConnection::UnackedChunks(int *pNum, int *pSize)
+{
+	*pNum = 0;
+	*pSize = 0;
+	for(CNetChunkResend *pResend = m_Buffer.First(); pResend; pResend = m_Buffer.Next(pResend))
+	{
+		(*pNum)++;
+		*pSize += sizeof(CNetChunkResend) + pResend->m_DataSize;
+	}
+}
+
 void CNetConnection::SignalResend()
 {
 	m_Construct.m_Flags |= NET_PACKETFLAG_RESEND;
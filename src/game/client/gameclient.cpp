@@ -1491,12 +1491,14 @@ void CGameClient::OnNewSnapshot()
 				}
 
 				// update switch types
-				for(auto &Switcher : Switchers())
+				for(int j = 0; j < (int)Switchers().size(); j++)
 				{
+					SSwitchers &Switcher = Switchers()[j];
 					if(Switcher.m_aStatus[Team])
 						Switcher.m_aType[Team] = Switcher.m_aEndTick[Team] ? TILE_SWITCHTIMEDOPEN : TILE_SWITCHOPEN;
 					else
 						Switcher.m_aType[Team] = Switcher.m_aEndTick[Team] ? TILE_SWITCHTIMEDCLOSE : TILE_SWITCHCLOSE;
+					m_GameWorld.m_Core.ScheduleSwitch(j, Team);
 				}
 
 				if(!GotSwitchStateTeam)
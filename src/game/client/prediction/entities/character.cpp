@@ -591,6 +591,9 @@ void CCharacter::Tick()
 
 	m_PrevPrevPos = m_PrevPos;
 	m_PrevPos = m_Core.m_Pos;
+
+	// tiles and weapons may have teleported us
+	GameWorld()->m_Core.UpdateBroadphase(GetCID());
 }
 
 void CCharacter::TickDeferred()
@@ -598,6 +601,7 @@ void CCharacter::TickDeferred()
 	m_Core.Move();
 	m_Core.Quantize();
 	m_Pos = m_Core.m_Pos;
+	GameWorld()->m_Core.UpdateBroadphase(GetCID());
 }
 
 bool CCharacter::TakeDamage(vec2 Force, int Dmg, int From, int Weapon)
@@ -733,6 +737,7 @@ void CCharacter::HandleTiles(int Index)
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aEndTick[Team()] = GameWorld()->GameTick() + 1 + Collision()->GetSwitchDelay(MapIndex) * GameWorld()->GameTickSpeed();
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aType[Team()] = TILE_SWITCHTIMEDOPEN;
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aLastUpdateTick[Team()] = GameWorld()->GameTick();
+		GameWorld()->m_Core.ScheduleSwitch(Collision()->GetSwitchNumber(MapIndex), Team());
 	}
 	else if(Collision()->GetSwitchType(MapIndex) == TILE_SWITCHTIMEDCLOSE && Team() != TEAM_SUPER && Collision()->GetSwitchNumber(MapIndex) > 0)
 	{
@@ -740,6 +745,7 @@ void CCharacter::HandleTiles(int Index)
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aEndTick[Team()] = GameWorld()->GameTick() + 1 + Collision()->GetSwitchDelay(MapIndex) * GameWorld()->GameTickSpeed();
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aType[Team()] = TILE_SWITCHTIMEDCLOSE;
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aLastUpdateTick[Team()] = GameWorld()->GameTick();
+		GameWorld()->m_Core.ScheduleSwitch(Collision()->GetSwitchNumber(MapIndex), Team());
 	}
 	else if(Collision()->GetSwitchType(MapIndex) == TILE_SWITCHCLOSE && Team() != TEAM_SUPER && Collision()->GetSwitchNumber(MapIndex) > 0)
 	{
@@ -1036,14 +1042,12 @@ void CCharacter::DDRacePostCoreTick()
 	HandleSkippableTiles(CurrentIndex);
 
 	// handle Anti-Skip tiles
-	std::list<int> Indices = Collision()->GetMapIndices(m_PrevPos, m_Pos);
-	if(!Indices.empty())
-		for(int Index : Indices)
-			HandleTiles(Index);
-	else
-	{
+	const int NumIndices = Collision()->WalkMapIndices(m_PrevPos, m_Pos, [&](int Index) {
+		HandleTiles(Index);
+		return true;
+	});
+	if(!NumIndices)
 		HandleTiles(CurrentIndex);
-	}
 }
 
 bool CCharacter::Freeze(int Seconds)
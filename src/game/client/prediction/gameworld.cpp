@@ -162,6 +162,7 @@ void CGameWorld::RemoveCharacter(CCharacter *pChar)
 	{
 		m_apCharacters[ID] = 0;
 		m_Core.m_apCharacters[ID] = 0;
+		m_Core.UpdateBroadphase(ID);
 	}
 }
 
@@ -187,6 +188,8 @@ bool distCompare(std::pair<float, int> a, std::pair<float, int> b)
 
 void CGameWorld::Tick()
 {
+	m_Core.BuildBroadphase();
+
 	// update all objects
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 	{
@@ -221,27 +224,12 @@ void CGameWorld::Tick()
 			pEnt = m_pNextTraverseEntity;
 		}
 
+	m_Core.ClearBroadphase();
+
 	RemoveEntities();
 
 	// update switch state
-	for(auto &Switcher : Switchers())
-	{
-		for(int j = 0; j < MAX_CLIENTS; ++j)
-		{
-			if(Switcher.m_aEndTick[j] <= GameTick() && Switcher.m_aType[j] == TILE_SWITCHTIMEDOPEN)
-			{
-				Switcher.m_aStatus[j] = false;
-				Switcher.m_aEndTick[j] = 0;
-				Switcher.m_aType[j] = TILE_SWITCHCLOSE;
-			}
-			else if(Switcher.m_aEndTick[j] <= GameTick() && Switcher.m_aType[j] == TILE_SWITCHTIMEDCLOSE)
-			{
-				Switcher.m_aStatus[j] = true;
-				Switcher.m_aEndTick[j] = 0;
-				Switcher.m_aType[j] = TILE_SWITCHOPEN;
-			}
-		}
-	}
+	m_Core.UpdateSwitchers(GameTick());
 
 	OnModified();
 }
@@ -584,6 +572,7 @@ void CGameWorld::CopyWorld(CGameWorld *pFrom)
 	m_pTuningList = pFrom->m_pTuningList;
 	m_Teams = pFrom->m_Teams;
 	m_Core.m_vSwitchers = pFrom->m_Core.m_vSwitchers;
+	m_Core.m_SwitchTimers = pFrom->m_Core.m_SwitchTimers;
 	// delete the previous entities
 	Clear();
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -1,5 +1,4 @@
 #include <cctype>
-#include <list>
 
 #include <game/client/gameclient.h>
 #include <game/mapitems.h>
@@ -76,16 +75,14 @@ bool CRaceHelper::IsStart(CGameClient *pClient, vec2 Prev, vec2 Pos)
 	}
 	else
 	{
-		std::list<int> Indices = pCollision->GetMapIndices(Prev, Pos);
-		if(!Indices.empty())
-			for(int &Indice : Indices)
-			{
-				if(pCollision->GetTileIndex(Indice) == TILE_START)
-					return true;
-				if(pCollision->GetFTileIndex(Indice) == TILE_START)
-					return true;
-			}
-		else
+		bool Start = false;
+		const int NumIndices = pCollision->WalkMapIndices(Prev, Pos, [&](int Index) {
+			Start = pCollision->GetTileIndex(Index) == TILE_START || pCollision->GetFTileIndex(Index) == TILE_START;
+			return !Start;
+		});
+		if(Start)
+			return true;
+		if(!NumIndices)
 		{
 			if(pCollision->GetTileIndex(pCollision->GetPureMapIndex(Pos)) == TILE_START)
 				return true;
@@ -49,6 +49,9 @@ CCollision::CCollision()
 	m_pSwitch = 0;
 	m_pDoor = 0;
 	m_pTune = 0;
+	m_pPacked = 0;
+	m_pTileFlags = 0;
+	m_pSolidDistance = 0;
 }
 
 CCollision::~CCollision()
@@ -131,6 +134,79 @@ void CCollision::Init(class CLayers *pLayers)
 			}
 		}
 	}
+
+	if(g_Config.m_PackedCollision)
+		InitPacked();
+
+	m_pTileFlags = new unsigned char[m_Width * m_Height];
+	for(int i = 0; i < m_Width * m_Height; i++)
+		m_pTileFlags[i] = ComputeTileFlags(i);
+
+	InitSolidDistance();
+}
+
+void CCollision::InitPacked()
+{
+	static_assert(sizeof(CPackedTile) == 16, "packed tiles should not straddle cache lines");
+
+	const int NumTiles = m_Width * m_Height;
+	m_pPacked = new CPackedTile[NumTiles];
+	mem_zero(m_pPacked, (size_t)NumTiles * sizeof(CPackedTile));
+	size_t LayerSize = sizeof(CTile);
+	for(int i = 0; i < NumTiles; i++)
+	{
+		m_pPacked[i].m_Index = m_pTiles[i].m_Index;
+		m_pPacked[i].m_Flags = m_pTiles[i].m_Flags;
+	}
+	if(m_pFront)
+	{
+		LayerSize += sizeof(CTile);
+		for(int i = 0; i < NumTiles; i++)
+		{
+			m_pPacked[i].m_FIndex = m_pFront[i].m_Index;
+			m_pPacked[i].m_FFlags = m_pFront[i].m_Flags;
+		}
+	}
+	if(m_pTele)
+	{
+		LayerSize += sizeof(CTeleTile);
+		for(int i = 0; i < NumTiles; i++)
+		{
+			m_pPacked[i].m_TeleType = m_pTele[i].m_Type;
+			m_pPacked[i].m_TeleNumber = m_pTele[i].m_Number;
+		}
+	}
+	if(m_pSwitch)
+	{
+		LayerSize += sizeof(CSwitchTile);
+		for(int i = 0; i < NumTiles; i++)
+		{
+			m_pPacked[i].m_SwitchType = m_pSwitch[i].m_Type;
+			m_pPacked[i].m_SwitchNumber = m_pSwitch[i].m_Number;
+			m_pPacked[i].m_SwitchDelay = m_pSwitch[i].m_Delay;
+		}
+	}
+	if(m_pSpeedup)
+	{
+		LayerSize += sizeof(CSpeedupTile);
+		for(int i = 0; i < NumTiles; i++)
+		{
+			m_pPacked[i].m_SpeedupForce = m_pSpeedup[i].m_Force;
+			m_pPacked[i].m_SpeedupMaxSpeed = m_pSpeedup[i].m_MaxSpeed;
+			m_pPacked[i].m_SpeedupAngle = m_pSpeedup[i].m_Angle;
+		}
+	}
+	if(m_pTune)
+	{
+		LayerSize += sizeof(CTuneTile);
+		for(int i = 0; i < NumTiles; i++)
+		{
+			m_pPacked[i].m_TuneType = m_pTune[i].m_Type;
+			m_pPacked[i].m_TuneNumber = m_pTune[i].m_Number;
+		}
+	}
+
+	dbg_msg("collision", "packed %dx%d tiles into %d KiB, on top of %d KiB of layer data", m_Width, m_Height, (int)((size_t)NumTiles * sizeof(CPackedTile) / 1024), (int)((size_t)NumTiles * LayerSize / 1024));
 }
 
 void CCollision::FillAntibot(CAntibotMapData *pMapData)
@@ -288,6 +364,116 @@ int CCollision::GetTile(int x, int y) const
 	return 0;
 }
 
+enum
+{
+	MAX_SOLID_DISTANCE = 32,
+};
+
+bool CCollision::IsRayBlocker(int Index) const
+{
+	int GameIndex = m_pTiles[Index].m_Index;
+	if((GameIndex >= TILE_SOLID && GameIndex <= TILE_NOLASER) || GameIndex == TILE_THROUGH_ALL || GameIndex == TILE_THROUGH_DIR)
+		return true;
+	if(m_pFront)
+	{
+		int FrontIndex = m_pFront[Index].m_Index;
+		if(FrontIndex == TILE_NOLASER || FrontIndex == TILE_THROUGH_ALL || FrontIndex == TILE_THROUGH_DIR)
+			return true;
+	}
+	return m_pTele && m_pTele[Index].m_Type;
+}
+
+void CCollision::InitSolidDistance()
+{
+	m_pSolidDistance = new unsigned char[m_Width * m_Height];
+	for(int i = 0; i < m_Width * m_Height; i++)
+		m_pSolidDistance[i] = IsRayBlocker(i) ? 0 : MAX_SOLID_DISTANCE;
+
+	// two pass chamfer transform, exact for the chebyshev metric
+	for(int y = 0; y < m_Height; y++)
+	{
+		for(int x = 0; x < m_Width; x++)
+		{
+			int d = m_pSolidDistance[y * m_Width + x];
+			if(x > 0)
+				d = minimum(d, m_pSolidDistance[y * m_Width + x - 1] + 1);
+			if(y > 0)
+			{
+				for(int ox = maximum(x - 1, 0); ox <= minimum(x + 1, m_Width - 1); ox++)
+					d = minimum(d, m_pSolidDistance[(y - 1) * m_Width + ox] + 1);
+			}
+			m_pSolidDistance[y * m_Width + x] = d;
+		}
+	}
+	for(int y = m_Height - 1; y >= 0; y--)
+	{
+		for(int x = m_Width - 1; x >= 0; x--)
+		{
+			int d = m_pSolidDistance[y * m_Width + x];
+			if(x < m_Width - 1)
+				d = minimum(d, m_pSolidDistance[y * m_Width + x + 1] + 1);
+			if(y < m_Height - 1)
+			{
+				for(int ox = maximum(x - 1, 0); ox <= minimum(x + 1, m_Width - 1); ox++)
+					d = minimum(d, m_pSolidDistance[(y + 1) * m_Width + ox] + 1);
+			}
+			m_pSolidDistance[y * m_Width + x] = d;
+		}
+	}
+}
+
+void CCollision::UpdateSolidDistance(int Index)
+{
+	// only ever lower the distances, a removed blocker just makes the field
+	// more conservative until the next map load
+	if(!m_pSolidDistance || !IsRayBlocker(Index) || m_pSolidDistance[Index] == 0)
+		return;
+	int Tx = Index % m_Width;
+	int Ty = Index / m_Width;
+	for(int y = maximum(Ty - MAX_SOLID_DISTANCE, 0); y <= minimum(Ty + MAX_SOLID_DISTANCE, m_Height - 1); y++)
+	{
+		for(int x = maximum(Tx - MAX_SOLID_DISTANCE, 0); x <= minimum(Tx + MAX_SOLID_DISTANCE, m_Width - 1); x++)
+		{
+			int d = maximum(absolute(x - Tx), absolute(y - Ty));
+			if(d < m_pSolidDistance[y * m_Width + x])
+				m_pSolidDistance[y * m_Width + x] = d;
+		}
+	}
+}
+
+int CCollision::SkippableRaySamples(vec2 Pos0, vec2 Pos1, float NumSamples, vec2 Pos, int MaxSkip) const
+{
+	// far away from the map the float error of mix() could exceed the margin below
+	const float Limit = 1000000.0f;
+	if(absolute(Pos0.x) > Limit || absolute(Pos0.y) > Limit || absolute(Pos1.x) > Limit || absolute(Pos1.y) > Limit)
+		return 0;
+
+	int Tx = clamp(round_to_int(Pos.x) / 32, 0, m_Width - 1);
+	int Ty = clamp(round_to_int(Pos.y) / 32, 0, m_Height - 1);
+	int Radius = m_pSolidDistance[Ty * m_Width + Tx] - 1;
+	if(Radius < 0)
+		return 0;
+
+	// pixel range that rounds into the free box around the current tile,
+	// with the clamped map border extending to infinity
+	float MinX = Tx - Radius <= 0 ? -Limit * 2 : (Tx - Radius) * 32 + 1;
+	float MaxX = Tx + Radius >= m_Width - 1 ? Limit * 2 : (Tx + Radius) * 32 + 30;
+	float MinY = Ty - Radius <= 0 ? -Limit * 2 : (Ty - Radius) * 32 + 1;
+	float MaxY = Ty + Radius >= m_Height - 1 ? Limit * 2 : (Ty + Radius) * 32 + 30;
+
+	vec2 Step = (Pos1 - Pos0) / NumSamples;
+	float Skip = MaxSkip;
+	if(Step.x > 0)
+		Skip = minimum(Skip, (MaxX - Pos.x) / Step.x);
+	else if(Step.x < 0)
+		Skip = minimum(Skip, (MinX - Pos.x) / Step.x);
+	if(Step.y > 0)
+		Skip = minimum(Skip, (MaxY - Pos.y) / Step.y);
+	else if(Step.y < 0)
+		Skip = minimum(Skip, (MinY - Pos.y) / Step.y);
+	return Skip > 0 ? (int)Skip : 0;
+}
+
 // TODO: rewrite this smarter!
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
@@ -312,6 +498,14 @@ int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *p
 		}
 
 		Last = Pos;
+
+		// jump over the samples that can't hit anything
+		int Skip = SkippableRaySamples(Pos0, Pos1, End, Pos, End - i);
+		if(Skip > 0)
+		{
+			i += Skip;
+			Last = mix(Pos0, Pos1, i / (float)End);
+		}
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -369,6 +563,14 @@ int CCollision::IntersectLineTeleHook(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision,
 		}
 
 		Last = Pos;
+
+		// jump over the samples that can't hit anything
+		int Skip = SkippableRaySamples(Pos0, Pos1, End, Pos, End - i);
+		if(Skip > 0)
+		{
+			i += Skip;
+			Last = mix(Pos0, Pos1, i / (float)End);
+		}
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -414,6 +616,14 @@ int CCollision::IntersectLineTeleWeapon(vec2 Pos0, vec2 Pos1, vec2 *pOutCollisio
 		}
 
 		Last = Pos;
+
+		// jump over the samples that can't hit anything
+		int Skip = SkippableRaySamples(Pos0, Pos1, End, Pos, End - i);
+		if(Skip > 0)
+		{
+			i += Skip;
+			Last = mix(Pos0, Pos1, i / (float)End);
+		}
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -548,6 +758,9 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elas
 void CCollision::Dest()
 {
 	delete[] m_pDoor;
+	delete[] m_pPacked;
+	delete[] m_pTileFlags;
+	delete[] m_pSolidDistance;
 	m_pTiles = 0;
 	m_Width = 0;
 	m_Height = 0;
@@ -558,6 +771,9 @@ void CCollision::Dest()
 	m_pSwitch = 0;
 	m_pTune = 0;
 	m_pDoor = 0;
+	m_pPacked = 0;
+	m_pTileFlags = 0;
+	m_pSolidDistance = 0;
 }
 
 int CCollision::IsSolid(int x, int y) const
@@ -610,90 +826,52 @@ int CCollision::IsFNoLaser(int x, int y) const
 	return (CCollision::GetFTile(x, y) == TILE_NOLASER);
 }
 
-int CCollision::IsTeleport(int Index) const
+int CCollision::TeleNumber(int Index, int Type) const
 {
 	if(Index < 0 || !m_pTele)
 		return 0;
 
-	if(m_pTele[Index].m_Type == TILE_TELEIN)
+	if(m_pPacked)
+		return m_pPacked[Index].m_TeleType == Type ? m_pPacked[Index].m_TeleNumber : 0;
+	if(m_pTele[Index].m_Type == Type)
 		return m_pTele[Index].m_Number;
 
 	return 0;
 }
 
-int CCollision::IsEvilTeleport(int Index) const
+int CCollision::IsTeleport(int Index) const
 {
-	if(Index < 0)
-		return 0;
-	if(!m_pTele)
-		return 0;
-
-	if(m_pTele[Index].m_Type == TILE_TELEINEVIL)
-		return m_pTele[Index].m_Number;
+	return TeleNumber(Index, TILE_TELEIN);
+}
 
-	return 0;
+int CCollision::IsEvilTeleport(int Index) const
+{
+	return TeleNumber(Index, TILE_TELEINEVIL);
 }
 
 int CCollision::IsCheckTeleport(int Index) const
 {
-	if(Index < 0)
-		return 0;
-	if(!m_pTele)
-		return 0;
-
-	if(m_pTele[Index].m_Type == TILE_TELECHECKIN)
-		return m_pTele[Index].m_Number;
-
-	return 0;
+	return TeleNumber(Index, TILE_TELECHECKIN);
 }
 
 int CCollision::IsCheckEvilTeleport(int Index) const
 {
-	if(Index < 0)
-		return 0;
-	if(!m_pTele)
-		return 0;
-
-	if(m_pTele[Index].m_Type == TILE_TELECHECKINEVIL)
-		return m_pTele[Index].m_Number;
-
-	return 0;
+	return TeleNumber(Index, TILE_TELECHECKINEVIL);
 }
 
 int CCollision::IsTeleCheckpoint(int Index) const
 {
-	if(Index < 0)
-		return 0;
-
-	if(!m_pTele)
-		return 0;
-
-	if(m_pTele[Index].m_Type == TILE_TELECHECK)
-		return m_pTele[Index].m_Number;
-
-	return 0;
+	return TeleNumber(Index, TILE_TELECHECK);
 }
 
 int CCollision::IsTeleportWeapon(int Index) const
 {
-	if(Index < 0 || !m_pTele)
-		return 0;
-
-	if(m_pTele[Index].m_Type == TILE_TELEINWEAPON)
-		return m_pTele[Index].m_Number;
-
-	return 0;
+	return TeleNumber(Index, TILE_TELEINWEAPON);
 }
 
 int CCollision::IsTeleportHook(int Index) const
 {
-	if(Index < 0 || !m_pTele)
-		return 0;
-
-	if(m_pTele[Index].m_Type == TILE_TELEINHOOK)
-		return m_pTele[Index].m_Number;
-
-	return 0;
+	return TeleNumber(Index, TILE_TELEINHOOK);
 }
 
 int CCollision::IsSpeedup(int Index) const
@@ -701,7 +879,8 @@ int CCollision::IsSpeedup(int Index) const
 	if(Index < 0 || !m_pSpeedup)
 		return 0;
 
-	if(m_pSpeedup[Index].m_Force > 0)
+	int Force = m_pPacked ? m_pPacked[Index].m_SpeedupForce : m_pSpeedup[Index].m_Force;
+	if(Force > 0)
 		return Index;
 
 	return 0;
@@ -712,6 +891,8 @@ int CCollision::IsTune(int Index) const
 	if(Index < 0 || !m_pTune)
 		return 0;
 
+	if(m_pPacked)
+		return m_pPacked[Index].m_TuneType ? m_pPacked[Index].m_TuneNumber : 0;
 	if(m_pTune[Index].m_Type)
 		return m_pTune[Index].m_Number;
 
@@ -722,11 +903,23 @@ void CCollision::GetSpeedup(int Index, vec2 *pDir, int *pForce, int *pMaxSpeed)
 {
 	if(Index < 0 || !m_pSpeedup)
 		return;
-	float Angle = m_pSpeedup[Index].m_Angle * (pi / 180.0f);
-	*pForce = m_pSpeedup[Index].m_Force;
-	*pDir = vec2(cos(Angle), sin(Angle));
+	int Angle, MaxSpeed;
+	if(m_pPacked)
+	{
+		Angle = m_pPacked[Index].m_SpeedupAngle;
+		*pForce = m_pPacked[Index].m_SpeedupForce;
+		MaxSpeed = m_pPacked[Index].m_SpeedupMaxSpeed;
+	}
+	else
+	{
+		Angle = m_pSpeedup[Index].m_Angle;
+		*pForce = m_pSpeedup[Index].m_Force;
+		MaxSpeed = m_pSpeedup[Index].m_MaxSpeed;
+	}
+	float AngleRad = Angle * (pi / 180.0f);
+	*pDir = vec2(cos(AngleRad), sin(AngleRad));
 	if(pMaxSpeed)
-		*pMaxSpeed = m_pSpeedup[Index].m_MaxSpeed;
+		*pMaxSpeed = MaxSpeed;
 }
 
 int CCollision::GetSwitchType(int Index) const
@@ -734,8 +927,9 @@ int CCollision::GetSwitchType(int Index) const
 	if(Index < 0 || !m_pSwitch)
 		return 0;
 
-	if(m_pSwitch[Index].m_Type > 0)
-		return m_pSwitch[Index].m_Type;
+	int Type = m_pPacked ? m_pPacked[Index].m_SwitchType : m_pSwitch[Index].m_Type;
+	if(Type > 0)
+		return Type;
 
 	return 0;
 }
@@ -745,6 +939,8 @@ int CCollision::GetSwitchNumber(int Index) const
 	if(Index < 0 || !m_pSwitch)
 		return 0;
 
+	if(m_pPacked)
+		return m_pPacked[Index].m_SwitchType > 0 ? m_pPacked[Index].m_SwitchNumber : 0;
 	if(m_pSwitch[Index].m_Type > 0 && m_pSwitch[Index].m_Number > 0)
 		return m_pSwitch[Index].m_Number;
 
@@ -756,6 +952,8 @@ int CCollision::GetSwitchDelay(int Index) const
 	if(Index < 0 || !m_pSwitch)
 		return 0;
 
+	if(m_pPacked)
+		return m_pPacked[Index].m_SwitchType > 0 ? m_pPacked[Index].m_SwitchDelay : 0;
 	if(m_pSwitch[Index].m_Type > 0)
 		return m_pSwitch[Index].m_Delay;
 
@@ -816,26 +1014,40 @@ int CCollision::GetPureMapIndex(float x, float y) const
 	return Ny * m_Width + Nx;
 }
 
-bool CCollision::TileExists(int Index) const
+int CCollision::ComputeTileFlags(int Index) const
 {
 	if(Index < 0)
-		return false;
+		return 0;
 
+	int Flags = 0;
 	if((m_pTiles[Index].m_Index >= TILE_FREEZE && m_pTiles[Index].m_Index <= TILE_TELE_LASER_DISABLE) || (m_pTiles[Index].m_Index >= TILE_LFREEZE && m_pTiles[Index].m_Index <= TILE_LUNFREEZE))
-		return true;
+		Flags |= TILEFLAG_GAME;
 	if(m_pFront && ((m_pFront[Index].m_Index >= TILE_FREEZE && m_pFront[Index].m_Index <= TILE_TELE_LASER_DISABLE) || (m_pFront[Index].m_Index >= TILE_LFREEZE && m_pFront[Index].m_Index <= TILE_LUNFREEZE)))
-		return true;
+		Flags |= TILEFLAG_FRONT;
 	if(m_pTele && (m_pTele[Index].m_Type == TILE_TELEIN || m_pTele[Index].m_Type == TILE_TELEINEVIL || m_pTele[Index].m_Type == TILE_TELECHECKINEVIL || m_pTele[Index].m_Type == TILE_TELECHECK || m_pTele[Index].m_Type == TILE_TELECHECKIN))
-		return true;
+		Flags |= TILEFLAG_TELE;
 	if(m_pSpeedup && m_pSpeedup[Index].m_Force > 0)
-		return true;
+		Flags |= TILEFLAG_SPEEDUP;
 	if(m_pDoor && m_pDoor[Index].m_Index)
-		return true;
+		Flags |= TILEFLAG_DOOR;
 	if(m_pSwitch && m_pSwitch[Index].m_Type)
-		return true;
+		Flags |= TILEFLAG_SWITCH;
 	if(m_pTune && m_pTune[Index].m_Type)
-		return true;
-	return TileExistsNext(Index);
+		Flags |= TILEFLAG_TUNE;
+	if(TileExistsNext(Index))
+		Flags |= TILEFLAG_STOPPER;
+	return Flags;
+}
+
+void CCollision::UpdateTileFlags(int Index)
+{
+	// TileExistsNext looks at the direct neighbours, so they have to be refreshed as well
+	const int aNeighbours[] = {Index, Index - 1, Index + 1, Index - m_Width, Index + m_Width};
+	for(int Neighbour : aNeighbours)
+	{
+		if(Neighbour >= 0 && Neighbour < m_Width * m_Height)
+			m_pTileFlags[Neighbour] = ComputeTileFlags(Neighbour);
+	}
 }
 
 bool CCollision::TileExistsNext(int Index) const
@@ -892,9 +1104,80 @@ int CCollision::GetMapIndex(vec2 Pos) const
 		return -1;
 }
 
-std::list<int> CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxIndices) const
+int CCollision::SampleMapIndex(vec2 PrevPos, vec2 Pos, float Distance, int Sample) const
+{
+	float a = Sample / Distance;
+	vec2 Tmp = mix(PrevPos, Pos, a);
+	int Nx = clamp((int)Tmp.x / 32, 0, m_Width - 1);
+	int Ny = clamp((int)Tmp.y / 32, 0, m_Height - 1);
+	return Ny * m_Width + Nx;
+}
+
+int CCollision::NextMapIndexSample(vec2 PrevPos, vec2 Pos, float Distance, int Sample, int Current, int End) const
+{
+	// the tile coordinates are monotonic along the segment, so the samples
+	// that leave the current tile form a suffix of [Sample + 1, End)
+	const int Tx = Current % m_Width;
+	const int Ty = Current / m_Width;
+
+	// guess the exit from the next grid line crossing
+	float ExitT = 2.0f;
+	if(Pos.x > PrevPos.x && Tx < m_Width - 1)
+		ExitT = minimum(ExitT, ((Tx + 1) * 32 - PrevPos.x) / (Pos.x - PrevPos.x));
+	else if(Pos.x < PrevPos.x && Tx > 0)
+		ExitT = minimum(ExitT, (Tx * 32 - PrevPos.x) / (Pos.x - PrevPos.x));
+	if(Pos.y > PrevPos.y && Ty < m_Height - 1)
+		ExitT = minimum(ExitT, ((Ty + 1) * 32 - PrevPos.y) / (Pos.y - PrevPos.y));
+	else if(Pos.y < PrevPos.y && Ty > 0)
+		ExitT = minimum(ExitT, (Ty * 32 - PrevPos.y) / (Pos.y - PrevPos.y));
+
+	int Lo = Sample;
+	int Hi = End;
+	int Guess = ExitT >= 1.0f ? End : (int)std::ceil(maximum(ExitT, 0.0f) * Distance);
+	Guess = clamp(Guess, Lo + 1, Hi);
+
+	// gallop from the guess, the rounding of the samples only moves it by a step or two
+	if(Guess < Hi)
+	{
+		int Step = 1;
+		if(SampleMapIndex(PrevPos, Pos, Distance, Guess) != Current)
+		{
+			Hi = Guess;
+			while(Hi - Step > Lo && SampleMapIndex(PrevPos, Pos, Distance, Hi - Step) != Current)
+			{
+				Hi -= Step;
+				Step *= 2;
+			}
+			Lo = maximum(Lo, Hi - Step);
+		}
+		else
+		{
+			Lo = Guess;
+			while(Lo + Step < Hi && SampleMapIndex(PrevPos, Pos, Distance, Lo + Step) == Current)
+			{
+				Lo += Step;
+				Step *= 2;
+			}
+			Hi = minimum(Hi, Lo + Step);
+		}
+	}
+	while(Hi - Lo > 1)
+	{
+		int Mid = (Lo + Hi) / 2;
+		if(SampleMapIndex(PrevPos, Pos, Distance, Mid) != Current)
+			Hi = Mid;
+		else
+			Lo = Mid;
+	}
+	return Hi;
+}
+
+int CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, int *pIndices, int MaxIndices, int *pSample) const
 {
-	std::list<int> Indices;
+	const int Start = pSample ? *pSample : 0;
+	if(pSample)
+		*pSample = -1;
+	int NumIndices = 0;
 	float d = distance(PrevPos, Pos);
 	int End(d + 1);
 	if(!d)
@@ -903,35 +1186,32 @@ std::list<int> CCollision::GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxInd
 		int Ny = clamp((int)Pos.y / 32, 0, m_Height - 1);
 		int Index = Ny * m_Width + Nx;
 
-		if(TileExists(Index))
-		{
-			Indices.push_back(Index);
-			return Indices;
-		}
-		else
-			return Indices;
+		if(TileExists(Index) && MaxIndices > 0)
+			pIndices[NumIndices++] = Index;
+		return NumIndices;
 	}
-	else
+
+	// visits the same tiles as sampling every unit of distance, but skips
+	// straight to the first sample of the next tile. A continued walk starts
+	// at the tile that didn't fit anymore.
+	int LastIndex = Start ? -1 : 0;
+	for(int i = Start; i < End;)
 	{
-		int LastIndex = 0;
-		for(int i = 0; i < End; i++)
+		int Index = SampleMapIndex(PrevPos, Pos, d, i);
+		if(TileExists(Index) && LastIndex != Index)
 		{
-			float a = i / d;
-			vec2 Tmp = mix(PrevPos, Pos, a);
-			int Nx = clamp((int)Tmp.x / 32, 0, m_Width - 1);
-			int Ny = clamp((int)Tmp.y / 32, 0, m_Height - 1);
-			int Index = Ny * m_Width + Nx;
-			if(TileExists(Index) && LastIndex != Index)
+			if(NumIndices == MaxIndices)
 			{
-				if(MaxIndices && Indices.size() > MaxIndices)
-					return Indices;
-				Indices.push_back(Index);
-				LastIndex = Index;
+				if(pSample)
+					*pSample = i;
+				return NumIndices;
 			}
+			pIndices[NumIndices++] = Index;
+			LastIndex = Index;
 		}
-
-		return Indices;
+		i = NextMapIndexSample(PrevPos, Pos, d, i, Index, End);
 	}
+	return NumIndices;
 }
 
 vec2 CCollision::GetPos(int Index) const
@@ -948,6 +1228,8 @@ int CCollision::GetTileIndex(int Index) const
 {
 	if(Index < 0)
 		return 0;
+	if(m_pPacked)
+		return m_pPacked[Index].m_Index;
 	return m_pTiles[Index].m_Index;
 }
 
@@ -955,6 +1237,8 @@ int CCollision::GetFTileIndex(int Index) const
 {
 	if(Index < 0 || !m_pFront)
 		return 0;
+	if(m_pPacked)
+		return m_pPacked[Index].m_FIndex;
 	return m_pFront[Index].m_Index;
 }
 
@@ -962,6 +1246,8 @@ int CCollision::GetTileFlags(int Index) const
 {
 	if(Index < 0)
 		return 0;
+	if(m_pPacked)
+		return m_pPacked[Index].m_Flags;
 	return m_pTiles[Index].m_Flags;
 }
 
@@ -969,6 +1255,8 @@ int CCollision::GetFTileFlags(int Index) const
 {
 	if(Index < 0 || !m_pFront)
 		return 0;
+	if(m_pPacked)
+		return m_pPacked[Index].m_FFlags;
 	return m_pFront[Index].m_Flags;
 }
 
@@ -1085,6 +1373,10 @@ void CCollision::SetCollisionAt(float x, float y, int id)
 	int Ny = clamp(round_to_int(y) / 32, 0, m_Height - 1);
 
 	m_pTiles[Ny * m_Width + Nx].m_Index = id;
+	if(m_pPacked)
+		m_pPacked[Ny * m_Width + Nx].m_Index = id;
+	UpdateTileFlags(Ny * m_Width + Nx);
+	UpdateSolidDistance(Ny * m_Width + Nx);
 }
 
 void CCollision::SetDCollisionAt(float x, float y, int Type, int Flags, int Number)
@@ -1097,6 +1389,7 @@ void CCollision::SetDCollisionAt(float x, float y, int Type, int Flags, int Numb
 	m_pDoor[Ny * m_Width + Nx].m_Index = Type;
 	m_pDoor[Ny * m_Width + Nx].m_Flags = Flags;
 	m_pDoor[Ny * m_Width + Nx].m_Number = Number;
+	UpdateTileFlags(Ny * m_Width + Nx);
 }
 
 int CCollision::GetDTileIndex(int Index) const
@@ -1177,6 +1470,14 @@ int CCollision::IntersectNoLaser(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2
 				return GetCollisionAt(Pos.x, Pos.y);
 		}
 		Last = Pos;
+
+		// jump over the samples that can't hit anything
+		int Skip = SkippableRaySamples(Pos0, Pos1, d, Pos, id - 1 - i);
+		if(Skip > 0)
+		{
+			i += Skip;
+			Last = mix(Pos0, Pos1, (int)i / d);
+		}
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -1206,6 +1507,14 @@ int CCollision::IntersectNoLaserNW(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, ve
 				return GetFCollisionAt(Pos.x, Pos.y);
 		}
 		Last = Pos;
+
+		// jump over the samples that can't hit anything
+		int Skip = SkippableRaySamples(Pos0, Pos1, d, Pos, id - 1 - i);
+		if(Skip > 0)
+		{
+			i += Skip;
+			Last = mix(Pos0, Pos1, (float)i / d);
+		}
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -1250,7 +1559,7 @@ int CCollision::IsTimeCheckpoint(int Index) const
 	if(Index < 0)
 		return -1;
 
-	int z = m_pTiles[Index].m_Index;
+	int z = m_pPacked ? m_pPacked[Index].m_Index : m_pTiles[Index].m_Index;
 	if(z >= TILE_TIME_CHECKPOINT_FIRST && z <= TILE_TIME_CHECKPOINT_LAST)
 		return z - TILE_TIME_CHECKPOINT_FIRST;
 	return -1;
@@ -1261,7 +1570,7 @@ int CCollision::IsFTimeCheckpoint(int Index) const
 	if(Index < 0 || !m_pFront)
 		return -1;
 
-	int z = m_pFront[Index].m_Index;
+	int z = m_pPacked ? m_pPacked[Index].m_FIndex : m_pFront[Index].m_Index;
 	if(z >= TILE_TIME_CHECKPOINT_FIRST && z <= TILE_TIME_CHECKPOINT_LAST)
 		return z - TILE_TIME_CHECKPOINT_FIRST;
 	return -1;
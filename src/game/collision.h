@@ -6,8 +6,6 @@
 #include <base/vmath.h>
 #include <engine/shared/protocol.h>
 
-#include <list>
-
 enum
 {
 	CANTMOVE_LEFT = 1 << 0,
@@ -16,6 +14,18 @@ enum
 	CANTMOVE_DOWN = 1 << 3,
 };
 
+enum
+{
+	TILEFLAG_GAME = 1 << 0,
+	TILEFLAG_FRONT = 1 << 1,
+	TILEFLAG_TELE = 1 << 2,
+	TILEFLAG_SPEEDUP = 1 << 3,
+	TILEFLAG_DOOR = 1 << 4,
+	TILEFLAG_SWITCH = 1 << 5,
+	TILEFLAG_TUNE = 1 << 6,
+	TILEFLAG_STOPPER = 1 << 7, // stopper on a neighbouring tile
+};
+
 vec2 ClampVel(int MoveRestriction, vec2 Vel);
 
 typedef bool (*CALLBACK_SWITCHACTIVE)(int Number, void *pUser);
@@ -23,6 +33,13 @@ struct CAntibotMapData;
 
 class CCollision
 {
+public:
+	enum
+	{
+		MAX_MAP_INDICES = 128,
+	};
+
+private:
 	class CTile *m_pTiles;
 	int m_Width;
 	int m_Height;
@@ -73,10 +90,37 @@ public:
 	int Entity(int x, int y, int Layer) const;
 	int GetPureMapIndex(float x, float y) const;
 	int GetPureMapIndex(vec2 Pos) const { return GetPureMapIndex(Pos.x, Pos.y); }
-	std::list<int> GetMapIndices(vec2 PrevPos, vec2 Pos, unsigned MaxIndices = 0) const;
+	// writes the special tiles passed between PrevPos and Pos into pIndices, returns how many were written.
+	// With pSample, a walk that filled pIndices can be continued by calling again with the same positions,
+	// it starts at 0 and is set to -1 once all tiles were written.
+	int GetMapIndices(vec2 PrevPos, vec2 Pos, int *pIndices, int MaxIndices, int *pSample = nullptr) const;
+	// calls Fn(Index) for the special tiles passed between PrevPos and Pos in order, no matter how many,
+	// until it returns false. Returns how many tiles were visited.
+	template<typename F>
+	int WalkMapIndices(vec2 PrevPos, vec2 Pos, F &&Fn) const
+	{
+		int aIndices[MAX_MAP_INDICES];
+		int Visited = 0;
+		int Sample = 0;
+		while(Sample >= 0)
+		{
+			int NumIndices = GetMapIndices(PrevPos, Pos, aIndices, MAX_MAP_INDICES, &Sample);
+			for(int i = 0; i < NumIndices; i++)
+			{
+				Visited++;
+				if(!Fn(aIndices[i]))
+					return Visited;
+			}
+		}
+		return Visited;
+	}
 	int GetMapIndex(vec2 Pos) const;
-	bool TileExists(int Index) const;
+	bool TileExists(int Index) const { return Index >= 0 && m_pTileFlags[Index]; }
 	bool TileExistsNext(int Index) const;
+	// TILEFLAG_* categories of the special tiles at Index, cached at Init
+	int GetTileFlagsCached(int Index) const { return Index >= 0 ? m_pTileFlags[Index] : 0; }
+	// recomputes the TILEFLAG_* categories from the layers
+	int ComputeTileFlags(int Index) const;
 	vec2 GetPos(int Index) const;
 	int GetTileIndex(int Index) const;
 	int GetFTileIndex(int Index) const;
@@ -123,6 +167,40 @@ private:
 	class CSwitchTile *m_pSwitch;
 	class CTuneTile *m_pTune;
 	class CDoorTile *m_pDoor;
+
+	// the fields of the static layers read on the hot paths, interleaved so
+	// that a lookup touches a single cache line
+	struct CPackedTile
+	{
+		unsigned char m_Index;
+		unsigned char m_Flags;
+		unsigned char m_FIndex;
+		unsigned char m_FFlags;
+		unsigned char m_TeleType;
+		unsigned char m_TeleNumber;
+		unsigned char m_SwitchType;
+		unsigned char m_SwitchNumber;
+		unsigned char m_SwitchDelay;
+		unsigned char m_SpeedupForce;
+		unsigned char m_SpeedupMaxSpeed;
+		unsigned char m_TuneType;
+		unsigned char m_TuneNumber;
+		short m_SpeedupAngle;
+	};
+	CPackedTile *m_pPacked;
+	unsigned char *m_pTileFlags;
+	// chebyshev distance in tiles to the closest tile the IntersectLine family reacts to
+	unsigned char *m_pSolidDistance;
+
+	void UpdateTileFlags(int Index);
+	void InitPacked();
+	int TeleNumber(int Index, int Type) const;
+	bool IsRayBlocker(int Index) const;
+	void InitSolidDistance();
+	void UpdateSolidDistance(int Index);
+	int SkippableRaySamples(vec2 Pos0, vec2 Pos1, float NumSamples, vec2 Pos, int MaxSkip) const;
+	int SampleMapIndex(vec2 PrevPos, vec2 Pos, float Distance, int Sample) const;
+	int NextMapIndexSample(vec2 PrevPos, vec2 Pos, float Distance, int Sample, int Current, int End) const;
 };
 
 void ThroughOffset(vec2 Pos0, vec2 Pos1, int *pOffsetX, int *pOffsetY);
@@ -8,6 +8,8 @@
 
 #include <engine/shared/config.h>
 
+#include <algorithm>
+
 const char *CTuningParams::ms_apNames[] =
 	{
 #define MACRO_TUNING_PARAM(Name, ScriptName, Value, Description) #ScriptName,
@@ -297,10 +299,14 @@ void CCharacterCore::Tick(bool UseInput, bool DoDeferredTick)
 		if(!this->m_HookHitDisabled && m_pWorld && m_Tuning.m_PlayerHooking)
 		{
 			float Distance = 0.0f;
-			for(int i = 0; i < MAX_CLIENTS; i++)
+			// only characters close to the hook segment can be grabbed
+			int aCandidates[MAX_CLIENTS];
+			int NumCandidates = m_pWorld->FindCharacters(m_HookPos, distance(m_HookPos, NewPos) + PhysicalSize() + 2.0f, this, -1, aCandidates);
+			for(int c = 0; c < NumCandidates; c++)
 			{
+				int i = aCandidates[c];
 				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
-				if(!pCharCore || pCharCore == this || (!(m_Super || pCharCore->m_Super) && ((m_Id != -1 && !m_pTeams->CanCollide(i, m_Id)) || pCharCore->m_Solo || m_Solo)))
+				if(!(m_Super || pCharCore->m_Super) && ((m_Id != -1 && !m_pTeams->CanCollide(i, m_Id)) || pCharCore->m_Solo || m_Solo))
 					continue;
 
 				vec2 ClosestPoint;
@@ -413,17 +419,16 @@ void CCharacterCore::TickDeferred()
 {
 	if(m_pWorld)
 	{
-		for(int i = 0; i < MAX_CLIENTS; i++)
+		// player collision only reaches PhysicalSize() * 1.25f, the hooked player is dragged from any distance
+		int aCandidates[MAX_CLIENTS];
+		int NumCandidates = m_pWorld->FindCharacters(m_Pos, PhysicalSize() * 1.25f, this, m_HookedPlayer, aCandidates);
+		for(int c = 0; c < NumCandidates; c++)
 		{
+			int i = aCandidates[c];
 			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
-			if(!pCharCore)
-				continue;
 
-			// player *p = (player*)ent;
-			// if(pCharCore == this) // || !(p->flags&FLAG_ALIVE)
-
-			if(pCharCore == this || (m_Id != -1 && !m_pTeams->CanCollide(m_Id, i)))
-				continue; // make sure that we don't nudge our self
+			if(m_Id != -1 && !m_pTeams->CanCollide(m_Id, i))
+				continue;
 
 			if(!(m_Super || pCharCore->m_Super) && (m_Solo || pCharCore->m_Solo))
 				continue;
@@ -515,15 +520,17 @@ void CCharacterCore::Move()
 		{
 			int End = Distance + 1;
 			vec2 LastPos = m_Pos;
+			// the samples stay on the segment, so farther characters can't be touched
+			int aCandidates[MAX_CLIENTS];
+			int NumCandidates = m_pWorld->FindCharacters(m_Pos, Distance + PhysicalSize(), this, -1, aCandidates);
 			for(int i = 0; i < End; i++)
 			{
 				float a = i / Distance;
 				vec2 Pos = mix(m_Pos, NewPos, a);
-				for(int p = 0; p < MAX_CLIENTS; p++)
+				for(int c = 0; c < NumCandidates; c++)
 				{
+					int p = aCandidates[c];
 					CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
-					if(!pCharCore || pCharCore == this)
-						continue;
 					if((!(pCharCore->m_Super || m_Super) && (m_Solo || pCharCore->m_Solo || pCharCore->m_CollisionDisabled || (m_Id != -1 && !m_pTeams->CanCollide(m_Id, p)))))
 						continue;
 					float D = distance(Pos, pCharCore->m_Pos);
@@ -688,6 +695,125 @@ bool CCharacterCore::IsSwitchActiveCb(int Number, void *pUser)
 	return false;
 }
 
+int CWorldCore::FindCharacters(vec2 Pos, float Radius, const CCharacterCore *pExclude, int Include, int *pIds) const
+{
+	// one pixel of slack keeps the filter conservative against float rounding
+	const float MaxDistance = Radius + 1.0f;
+	int Team = BROADPHASE_ANY_TEAM;
+	if(m_BroadphaseValid && pExclude && pExclude->m_Id >= 0 && pExclude->m_Id < MAX_CLIENTS && m_apCharacters[pExclude->m_Id] == pExclude)
+		Team = BroadphaseTeam(pExclude->m_Id);
+
+	int NumIds = 0;
+	if(Team == BROADPHASE_ANY_TEAM)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			const CCharacterCore *pCharCore = m_apCharacters[i];
+			if(!pCharCore || pCharCore == pExclude)
+				continue;
+			vec2 Delta = pCharCore->m_Pos - Pos;
+			if(i == Include || (absolute(Delta.x) <= MaxDistance && absolute(Delta.y) <= MaxDistance && length(Delta) <= MaxDistance))
+				pIds[NumIds++] = i;
+		}
+		return NumIds;
+	}
+
+	// the own team and the characters colliding with everyone, each sorted by x
+	bool aFound[MAX_CLIENTS] = {false};
+	for(int SearchTeam : {(int)BROADPHASE_ANY_TEAM, Team})
+	{
+		CBroadphaseEntry First = {SearchTeam, Pos.x - MaxDistance, -1};
+		const CBroadphaseEntry *pEnd = m_aBroadphase + m_NumBroadphase;
+		for(const CBroadphaseEntry *pEntry = std::lower_bound(m_aBroadphase, pEnd, First); pEntry < pEnd && pEntry->m_Team == SearchTeam && pEntry->m_X <= Pos.x + MaxDistance; pEntry++)
+		{
+			const CCharacterCore *pCharCore = m_apCharacters[pEntry->m_ClientID];
+			if(!pCharCore || pCharCore == pExclude)
+				continue;
+			vec2 Delta = pCharCore->m_Pos - Pos;
+			if(absolute(Delta.y) <= MaxDistance && length(Delta) <= MaxDistance)
+				aFound[pEntry->m_ClientID] = true;
+		}
+	}
+	if(Include >= 0 && m_apCharacters[Include] && m_apCharacters[Include] != pExclude)
+		aFound[Include] = true;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		if(aFound[i])
+			pIds[NumIds++] = i;
+	return NumIds;
+}
+
+int CWorldCore::BroadphaseTeam(int ClientID) const
+{
+	const CCharacterCore *pCharCore = m_apCharacters[ClientID];
+	if(pCharCore->m_Super || !pCharCore->m_pTeams)
+		return BROADPHASE_ANY_TEAM;
+	int Team = pCharCore->m_pTeams->Team(ClientID);
+	if(Team == (pCharCore->m_pTeams->m_IsDDRace16 ? VANILLA_TEAM_SUPER : TEAM_SUPER))
+		return BROADPHASE_ANY_TEAM;
+	return Team;
+}
+
+void CWorldCore::BuildBroadphase()
+{
+	m_NumBroadphase = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aBroadphaseSlot[i] = -1;
+		if(m_apCharacters[i])
+			m_aBroadphase[m_NumBroadphase++] = {BroadphaseTeam(i), m_apCharacters[i]->m_Pos.x, i};
+	}
+	std::sort(m_aBroadphase, m_aBroadphase + m_NumBroadphase);
+	for(int Slot = 0; Slot < m_NumBroadphase; Slot++)
+		m_aBroadphaseSlot[m_aBroadphase[Slot].m_ClientID] = Slot;
+	m_BroadphaseValid = true;
+}
+
+void CWorldCore::SwapBroadphase(int Slot1, int Slot2)
+{
+	std::swap(m_aBroadphase[Slot1], m_aBroadphase[Slot2]);
+	m_aBroadphaseSlot[m_aBroadphase[Slot1].m_ClientID] = Slot1;
+	m_aBroadphaseSlot[m_aBroadphase[Slot2].m_ClientID] = Slot2;
+}
+
+void CWorldCore::UpdateBroadphase(int ClientID)
+{
+	if(!m_BroadphaseValid)
+		return;
+
+	int Slot = m_aBroadphaseSlot[ClientID];
+	if(!m_apCharacters[ClientID])
+	{
+		if(Slot < 0)
+			return;
+		for(; Slot + 1 < m_NumBroadphase; Slot++)
+			SwapBroadphase(Slot, Slot + 1);
+		m_aBroadphaseSlot[ClientID] = -1;
+		m_NumBroadphase--;
+		return;
+	}
+
+	if(Slot < 0)
+	{
+		Slot = m_NumBroadphase++;
+		m_aBroadphaseSlot[ClientID] = Slot;
+		m_aBroadphase[Slot].m_ClientID = ClientID;
+	}
+	m_aBroadphase[Slot].m_Team = BroadphaseTeam(ClientID);
+	m_aBroadphase[Slot].m_X = m_apCharacters[ClientID]->m_Pos.x;
+
+	// characters move only a bit per tick, so this is mostly a swap or two
+	for(; Slot > 0 && m_aBroadphase[Slot] < m_aBroadphase[Slot - 1]; Slot--)
+		SwapBroadphase(Slot, Slot - 1);
+	for(; Slot + 1 < m_NumBroadphase && m_aBroadphase[Slot + 1] < m_aBroadphase[Slot]; Slot++)
+		SwapBroadphase(Slot, Slot + 1);
+}
+
+void CWorldCore::ClearBroadphase()
+{
+	m_BroadphaseValid = false;
+	m_NumBroadphase = 0;
+}
+
 void CWorldCore::InitSwitchers(int HighestSwitchNumber)
 {
 	if(HighestSwitchNumber > 0)
@@ -706,4 +832,105 @@ void CWorldCore::InitSwitchers(int HighestSwitchNumber)
 			Switcher.m_aLastUpdateTick[j] = 0;
 		}
 	}
+	m_SwitchTimers.Clear();
+}
+
+void CWorldCore::ScheduleSwitch(int Number, int Team)
+{
+	const SSwitchers &Switcher = m_vSwitchers[Number];
+	if(Switcher.m_aType[Team] == TILE_SWITCHTIMEDOPEN || Switcher.m_aType[Team] == TILE_SWITCHTIMEDCLOSE)
+		m_SwitchTimers.Schedule(Number, Team, Switcher.m_aEndTick[Team]);
+}
+
+void CSwitchTimers::Clear()
+{
+	m_vvSlots.clear();
+	m_NumTimers = 0;
+	m_LastTick = -1;
+}
+
+void CSwitchTimers::Insert(const CTimer &Timer)
+{
+	// timers that are already due go into the next slot that gets visited
+	m_vvSlots[maximum(Timer.m_EndTick, m_LastTick + 1) % NUM_SLOTS].push_back(Timer);
+	m_NumTimers++;
+}
+
+void CSwitchTimers::Schedule(int Number, int Team, int EndTick)
+{
+	if(m_vvSlots.empty())
+		m_vvSlots.resize(NUM_SLOTS);
+	// the client schedules the switches again with every snapshot
+	for(const auto &Timer : m_vvSlots[maximum(EndTick, m_LastTick + 1) % NUM_SLOTS])
+		if(Timer.m_EndTick == EndTick && Timer.m_Number == Number && Timer.m_Team == Team)
+			return;
+	Insert({EndTick, Number, Team});
+}
+
+void CSwitchTimers::Expire(std::vector<SSwitchers> &vSwitchers, std::vector<CTimer> &vSlot, int Tick)
+{
+	for(size_t i = 0; i < vSlot.size();)
+	{
+		const CTimer Timer = vSlot[i];
+		if(Timer.m_EndTick > Tick)
+		{
+			i++;
+			continue;
+		}
+		vSlot[i] = vSlot.back();
+		vSlot.pop_back();
+		m_NumTimers--;
+
+		// the switch may have been set again since, the timer only fires
+		// if the state still asks for it
+		if(Timer.m_Number >= (int)vSwitchers.size())
+			continue;
+		SSwitchers &Switcher = vSwitchers[Timer.m_Number];
+		const int Team = Timer.m_Team;
+		if(Switcher.m_aEndTick[Team] > Tick)
+			continue;
+		if(Switcher.m_aType[Team] == TILE_SWITCHTIMEDOPEN)
+		{
+			Switcher.m_aStatus[Team] = false;
+			Switcher.m_aEndTick[Team] = 0;
+			Switcher.m_aType[Team] = TILE_SWITCHCLOSE;
+		}
+		else if(Switcher.m_aType[Team] == TILE_SWITCHTIMEDCLOSE)
+		{
+			Switcher.m_aStatus[Team] = true;
+			Switcher.m_aEndTick[Team] = 0;
+			Switcher.m_aType[Team] = TILE_SWITCHOPEN;
+		}
+	}
+}
+
+void CSwitchTimers::Update(std::vector<SSwitchers> &vSwitchers, int Tick)
+{
+	if(m_NumTimers == 0)
+	{
+		m_LastTick = Tick;
+		return;
+	}
+
+	if(m_LastTick < 0 || Tick < m_LastTick || Tick - m_LastTick >= NUM_SLOTS)
+	{
+		// the tick jumped (e.g. the prediction restarted from a snapshot),
+		// look at every timer and put the remaining ones into their slots
+		std::vector<CTimer> vRemaining;
+		for(auto &vSlot : m_vvSlots)
+		{
+			Expire(vSwitchers, vSlot, Tick);
+			vRemaining.insert(vRemaining.end(), vSlot.begin(), vSlot.end());
+			vSlot.clear();
+		}
+		m_LastTick = Tick;
+		m_NumTimers = 0;
+		for(const auto &Timer : vRemaining)
+			Insert(Timer);
+		return;
+	}
+
+	for(int t = m_LastTick + 1; t <= Tick; t++)
+		Expire(vSwitchers, m_vvSlots[t % NUM_SLOTS], Tick);
+	m_LastTick = Tick;
 }
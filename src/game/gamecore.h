@@ -189,6 +189,38 @@ struct SSwitchers
 	int m_aLastUpdateTick[MAX_CLIENTS];
 };
 
+// Timer wheel for the timed switches, so that a tick only has to look at the
+// switches that end around it instead of every switcher of every team.
+class CSwitchTimers
+{
+	enum
+	{
+		NUM_SLOTS = 256,
+	};
+
+	struct CTimer
+	{
+		int m_EndTick;
+		int m_Number;
+		int m_Team;
+	};
+
+	// allocated on the first timer, temporary worlds never get one
+	std::vector<std::vector<CTimer>> m_vvSlots;
+	int m_NumTimers = 0;
+	int m_LastTick = -1;
+
+	void Insert(const CTimer &Timer);
+	void Expire(std::vector<SSwitchers> &vSwitchers, std::vector<CTimer> &vSlot, int Tick);
+
+public:
+	void Clear();
+	void Schedule(int Number, int Team, int EndTick);
+	// toggles the timed switches whose end tick is at or before Tick back
+	void Update(std::vector<SSwitchers> &vSwitchers, int Tick);
+	int NumTimers() const { return m_NumTimers; }
+};
+
 class CWorldCore
 {
 public:
@@ -196,6 +228,7 @@ public:
 	{
 		mem_zero(m_apCharacters, sizeof(m_apCharacters));
 		m_pPrng = nullptr;
+		ClearBroadphase();
 	}
 
 	int RandomOr0(int BelowThis)
@@ -214,13 +247,62 @@ public:
 	class CCharacterCore *m_apCharacters[MAX_CLIENTS];
 	CPrng *m_pPrng;
 
+	// Broadphase for player interactions: writes the ids of the characters
+	// other than pExclude that are within Radius of Pos into pIds, in client
+	// id order. Include is added regardless of its distance (-1 for none).
+	// Between BuildBroadphase() and ClearBroadphase() only the characters
+	// that can collide with pExclude's team are looked at, otherwise all.
+	int FindCharacters(vec2 Pos, float Radius, const class CCharacterCore *pExclude, int Include, int *pIds) const;
+
+	// Sorts the characters by team and x position. The world builds it at
+	// the start of its tick and clears it at the end, in between every
+	// change to a character's position, team or slot has to be followed by
+	// UpdateBroadphase() for that character.
+	void BuildBroadphase();
+	void UpdateBroadphase(int ClientID);
+	void ClearBroadphase();
+
 	void InitSwitchers(int HighestSwitchNumber);
+	// has to be called whenever a switch of the team gets a timed type or a
+	// new end tick, otherwise UpdateSwitchers won't toggle it back
+	void ScheduleSwitch(int Number, int Team);
+	void UpdateSwitchers(int Tick) { m_SwitchTimers.Update(m_vSwitchers, Tick); }
 	std::vector<SSwitchers> m_vSwitchers;
+	CSwitchTimers m_SwitchTimers;
+
+private:
+	enum
+	{
+		// characters that collide with every team: super, or without teams
+		BROADPHASE_ANY_TEAM = -1,
+	};
+
+	struct CBroadphaseEntry
+	{
+		int m_Team;
+		float m_X;
+		int m_ClientID;
+
+		bool operator<(const CBroadphaseEntry &Other) const
+		{
+			return m_Team < Other.m_Team || (m_Team == Other.m_Team && m_X < Other.m_X);
+		}
+	};
+
+	int BroadphaseTeam(int ClientID) const;
+	void SwapBroadphase(int Slot1, int Slot2);
+
+	bool m_BroadphaseValid;
+	int m_NumBroadphase;
+	CBroadphaseEntry m_aBroadphase[MAX_CLIENTS];
+	// position of each client in m_aBroadphase, -1 if it isn't in there
+	int m_aBroadphaseSlot[MAX_CLIENTS];
 };
 
 class CCharacterCore
 {
 	friend class CCharacter;
+	friend class CWorldCore;
 	CWorldCore *m_pWorld = nullptr;
 	CCollision *m_pCollision;
 	std::map<int, std::vector<vec2>> *m_pTeleOuts;
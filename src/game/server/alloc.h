@@ -3,8 +3,11 @@
 #ifndef GAME_SERVER_ALLOC_H
 #define GAME_SERVER_ALLOC_H
 
+#include <cstddef>
 #include <new>
+#include <vector>
 
+#include <base/math.h>
 #include <base/system.h>
 #ifndef __has_feature
 #define __has_feature(x) 0
@@ -41,6 +44,99 @@ public: \
 \
 private:
 
+// Slab allocator for entity types that are created and destroyed all the
+// time. Objects are carved out of slabs of SlabSize slots that are never
+// given back, freed slots are reused before a new slab is allocated.
+class CSlabPool
+{
+	const char *m_pName;
+	size_t m_SlotSize;
+	int m_SlabSize;
+	std::vector<char *> m_vpSlabs;
+	std::vector<void *> m_vpFree;
+	int m_NumLive = 0;
+	int m_PeakLive = 0;
+	CSlabPool *m_pNext;
+
+	static inline CSlabPool *ms_pFirst = nullptr;
+
+public:
+	CSlabPool(const char *pName, size_t ObjectSize, int SlabSize) :
+		m_pName(pName),
+		m_SlotSize((ObjectSize + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1)),
+		m_SlabSize(SlabSize),
+		m_pNext(ms_pFirst)
+	{
+		ms_pFirst = this;
+	}
+
+	~CSlabPool()
+	{
+		for(char *pSlab : m_vpSlabs)
+		{
+			ASAN_UNPOISON_MEMORY_REGION(pSlab, m_SlotSize * m_SlabSize);
+			free(pSlab);
+		}
+	}
+
+	void *Allocate(size_t Size)
+	{
+		dbg_assert(Size <= m_SlotSize, "size error");
+		if(m_vpFree.empty())
+		{
+			char *pSlab = static_cast<char *>(malloc(m_SlotSize * m_SlabSize));
+			ASAN_POISON_MEMORY_REGION(pSlab, m_SlotSize * m_SlabSize);
+			m_vpSlabs.push_back(pSlab);
+			// hand out the slots in address order
+			for(int i = m_SlabSize - 1; i >= 0; i--)
+				m_vpFree.push_back(pSlab + i * m_SlotSize);
+		}
+		void *pSlot = m_vpFree.back();
+		m_vpFree.pop_back();
+		ASAN_UNPOISON_MEMORY_REGION(pSlot, m_SlotSize);
+		mem_zero(pSlot, m_SlotSize);
+		m_NumLive++;
+		m_PeakLive = maximum(m_PeakLive, m_NumLive);
+		return pSlot;
+	}
+
+	void Free(void *pSlot)
+	{
+		if(!pSlot)
+			return;
+		dbg_assert(m_NumLive > 0, "not used");
+		ASAN_POISON_MEMORY_REGION(pSlot, m_SlotSize);
+		m_vpFree.push_back(pSlot);
+		m_NumLive--;
+	}
+
+	const char *Name() const { return m_pName; }
+	int NumLive() const { return m_NumLive; }
+	int PeakLive() const { return m_PeakLive; }
+	int Capacity() const { return m_vpSlabs.size() * m_SlabSize; }
+
+	static const CSlabPool *First() { return ms_pFirst; }
+	const CSlabPool *Next() const { return m_pNext; }
+};
+
+#define MACRO_ALLOC_SLAB() \
+public: \
+	void *operator new(size_t Size); \
+	void operator delete(void *pPtr); \
+\
+private:
+
+#define MACRO_ALLOC_SLAB_IMPL(POOLTYPE, SlabSize) \
+	static CSlabPool gs_SlabPool##POOLTYPE(#POOLTYPE, sizeof(POOLTYPE), SlabSize); \
+	void *POOLTYPE::operator new(size_t Size) \
+	{ \
+		return gs_SlabPool##POOLTYPE.Allocate(Size); \
+	} \
+	void POOLTYPE::operator delete(void *pPtr) \
+	{ \
+		gs_SlabPool##POOLTYPE.Free(pPtr); \
+	}
+
 #define MACRO_ALLOC_POOL_ID() \
 public: \
 	void *operator new(size_t Size, int id); \
@@ -825,6 +825,17 @@ void CGameContext::ConDumpAntibot(IConsole::IResult *pResult, void *pUserData)
 	pSelf->Antibot()->Dump();
 }
 
+void CGameContext::ConDumpEntityPools(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	for(const CSlabPool *pPool = CSlabPool::First(); pPool; pPool = pPool->Next())
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%s: live=%d peak=%d capacity=%d", pPool->Name(), pPool->NumLive(), pPool->PeakLive(), pPool->Capacity());
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "pools", aBuf);
+	}
+}
+
 void CGameContext::ConDumpLog(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *)pUserData;
@@ -9,8 +9,10 @@
 #include "aura.h"
 #include "character.h"
 
+MACRO_ALLOC_SLAB_IMPL(CAura, 64)
+
 CAura::CAura(CGameWorld *pGameWorld, int Owner, int Num, int Type, bool Changing) :
-	CEntity(pGameWorld, CGameWorld::ENTTYPE_PROJECTILE)
+	CEntity(pGameWorld, CGameWorld::ENTTYPE_COSMETIC)
 {
 	CPlayer *pOwner = GameServer()->m_apPlayers[Owner];
 	if(!pOwner || !pOwner->GetCharacter())
@@ -7,6 +7,8 @@
 
 class CAura : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	enum
 	{
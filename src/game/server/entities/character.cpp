@@ -79,6 +79,7 @@ bool CCharacter::Spawn(CPlayer *pPlayer, vec2 Pos)
 	m_Core.m_Pos = m_Pos;
 	m_Core.m_Id = m_pPlayer->GetCID();
 	GameServer()->m_World.m_Core.m_apCharacters[m_pPlayer->GetCID()] = &m_Core;
+	GameServer()->m_World.m_Core.UpdateBroadphase(m_pPlayer->GetCID());
 
 	m_ReckoningTick = 0;
 	m_SendCore = CCharacterCore();
@@ -105,6 +106,7 @@ bool CCharacter::Spawn(CPlayer *pPlayer, vec2 Pos)
 void CCharacter::Destroy()
 {
 	GameServer()->m_World.m_Core.m_apCharacters[m_pPlayer->GetCID()] = 0;
+	GameServer()->m_World.m_Core.UpdateBroadphase(m_pPlayer->GetCID());
 	m_Alive = false;
 	SetSolo(false);
 }
@@ -786,6 +788,9 @@ void CCharacter::Tick()
 	m_PrevInput = m_Input;
 
 	m_PrevPos = m_Core.m_Pos;
+
+	// tiles and weapons may have teleported us
+	GameWorld()->m_Core.UpdateBroadphase(m_pPlayer->GetCID());
 }
 
 void CCharacter::TickDeferred()
@@ -811,6 +816,7 @@ void CCharacter::TickDeferred()
 	m_Core.Quantize();
 	bool StuckAfterQuant = Collision()->TestBox(m_Core.m_Pos, CCharacterCore::PhysicalSizeVec2());
 	m_Pos = m_Core.m_Pos;
+	GameWorld()->m_Core.UpdateBroadphase(m_pPlayer->GetCID());
 
 	if(!StuckBefore && (StuckAfterMove || StuckAfterQuant))
 	{
@@ -951,6 +957,7 @@ void CCharacter::Die(int Killer, int Weapon)
 
 	GameServer()->m_World.RemoveEntity(this);
 	GameServer()->m_World.m_Core.m_apCharacters[m_pPlayer->GetCID()] = 0;
+	GameServer()->m_World.m_Core.UpdateBroadphase(m_pPlayer->GetCID());
 	GameServer()->CreateDeath(m_Pos, m_pPlayer->GetCID(), TeamMask());
 	Teams()->OnCharacterDeath(GetPlayer()->GetCID(), Weapon);
 }
@@ -1645,6 +1652,7 @@ void CCharacter::HandleTiles(int Index)
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aEndTick[Team()] = Server()->Tick() + 1 + Collision()->GetSwitchDelay(MapIndex) * Server()->TickSpeed();
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aType[Team()] = TILE_SWITCHTIMEDOPEN;
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aLastUpdateTick[Team()] = Server()->Tick();
+		GameWorld()->m_Core.ScheduleSwitch(Collision()->GetSwitchNumber(MapIndex), Team());
 	}
 	else if(Collision()->GetSwitchType(MapIndex) == TILE_SWITCHTIMEDCLOSE && Team() != TEAM_SUPER && Collision()->GetSwitchNumber(MapIndex) > 0)
 	{
@@ -1652,6 +1660,7 @@ void CCharacter::HandleTiles(int Index)
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aEndTick[Team()] = Server()->Tick() + 1 + Collision()->GetSwitchDelay(MapIndex) * Server()->TickSpeed();
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aType[Team()] = TILE_SWITCHTIMEDCLOSE;
 		Switchers()[Collision()->GetSwitchNumber(MapIndex)].m_aLastUpdateTick[Team()] = Server()->Tick();
+		GameWorld()->m_Core.ScheduleSwitch(Collision()->GetSwitchNumber(MapIndex), Team());
 	}
 	else if(Collision()->GetSwitchType(MapIndex) == TILE_SWITCHCLOSE && Team() != TEAM_SUPER && Collision()->GetSwitchNumber(MapIndex) > 0)
 	{
@@ -2115,17 +2124,13 @@ void CCharacter::DDRacePostCoreTick()
 		return;
 
 	// handle Anti-Skip tiles
-	std::list<int> Indices = Collision()->GetMapIndices(m_PrevPos, m_Pos);
-	if(!Indices.empty())
-	{
-		for(int &Index : Indices)
-		{
-			HandleTiles(Index);
-			if(!m_Alive)
-				return;
-		}
-	}
-	else
+	const int NumIndices = Collision()->WalkMapIndices(m_PrevPos, m_Pos, [&](int Index) {
+		HandleTiles(Index);
+		return m_Alive;
+	});
+	if(!m_Alive)
+		return;
+	if(!NumIndices)
 	{
 		HandleTiles(CurrentIndex);
 		if(!m_Alive)
@@ -2241,6 +2246,7 @@ void CCharacter::Pause(bool Pause)
 	if(Pause)
 	{
 		GameServer()->m_World.m_Core.m_apCharacters[m_pPlayer->GetCID()] = 0;
+		GameServer()->m_World.m_Core.UpdateBroadphase(m_pPlayer->GetCID());
 		GameServer()->m_World.RemoveEntity(this);
 
 		if(m_Core.m_HookedPlayer != -1) // Keeping hook would allow cheats
@@ -2253,6 +2259,7 @@ void CCharacter::Pause(bool Pause)
 	{
 		m_Core.m_Vel = vec2(0, 0);
 		GameServer()->m_World.m_Core.m_apCharacters[m_pPlayer->GetCID()] = &m_Core;
+		GameServer()->m_World.m_Core.UpdateBroadphase(m_pPlayer->GetCID());
 		GameServer()->m_World.InsertEntity(this);
 	}
 }
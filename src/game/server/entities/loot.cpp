@@ -8,6 +8,8 @@
 #include "character.h"
 #include "loot.h"
 
+MACRO_ALLOC_SLAB_IMPL(CLoot, 64)
+
 CLoot::CLoot(CGameWorld *pGameWorld, int Owner, const char *OwnerName, int ResponsibleTeam, vec2 Pos, int LootType, bool DotsEffect, bool Guided) :
 	CEntity(pGameWorld, CGameWorld::ENTTYPE_PICKUP)
 {
@@ -7,6 +7,8 @@
 
 class CLoot : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	enum
 	{
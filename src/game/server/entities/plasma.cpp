@@ -9,6 +9,8 @@
 
 #include <game/server/gamecontext.h>
 
+MACRO_ALLOC_SLAB_IMPL(CPlasma, 64)
+
 const float PLASMA_ACCEL = 1.1f;
 
 CPlasma::CPlasma(CGameWorld *pGameWorld, vec2 Pos, vec2 Dir, bool Freeze,
@@ -22,6 +22,8 @@
  */
 class CPlasma : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 	vec2 m_Core;
 	int m_Freeze;
 	bool m_Explosive;
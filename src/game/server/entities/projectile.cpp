@@ -11,6 +11,8 @@
 #include <game/server/gamecontext.h>
 #include <game/server/gamemodes/DDRace.h>
 
+MACRO_ALLOC_SLAB_IMPL(CProjectile, 256)
+
 CProjectile::CProjectile(
 	CGameWorld *pGameWorld,
 	int Type,
@@ -100,7 +102,7 @@ void CProjectile::Reset()
 	m_MarkedForDestroy = true;
 }
 
-vec2 CProjectile::GetPos(float Time)
+void CProjectile::GetTuning(float *pCurvature, float *pSpeed)
 {
 	float Curvature = 0;
 	float Speed = 0;
@@ -149,18 +151,66 @@ vec2 CProjectile::GetPos(float Time)
 		break;
 	}
 
+	*pCurvature = Curvature;
+	*pSpeed = Speed;
+}
+
+vec2 CProjectile::GetPos(float Time)
+{
+	float Curvature, Speed;
+	GetTuning(&Curvature, &Speed);
 	return CalcPos(m_Pos, m_Direction, Curvature, Speed, Time);
 }
 
-void CProjectile::Tick()
+void CProjectile::MoveAll(CGameWorld *pGameWorld)
 {
+	CProjectileMoves &Moves = pGameWorld->m_ProjectileMoves;
+	const int Tick = pGameWorld->Server()->Tick();
+	const float TickSpeed = (float)pGameWorld->Server()->TickSpeed();
+	Moves.m_Tick = Tick;
+	Moves.Clear();
+
+	// gather, the tuning lookup is the only part that needs the entity. Stars,
+	// auras and trails are ENTTYPE_COSMETIC, so these are all CProjectile.
+	for(auto *pProj = static_cast<CProjectile *>(pGameWorld->FindFirst(CGameWorld::ENTTYPE_PROJECTILE)); pProj; pProj = static_cast<CProjectile *>(pProj->TypeNext()))
+	{
+		float Curvature, Speed;
+		pProj->GetTuning(&Curvature, &Speed);
+		pProj->m_MoveIndex = Moves.Add(pProj, pProj->m_Pos, pProj->m_Direction, Curvature, Speed, (Tick - pProj->m_StartTick - 1) / TickSpeed, (Tick - pProj->m_StartTick) / TickSpeed);
+	}
+
+	Moves.Integrate(pGameWorld->GameServer()->Collision());
+}
+
+void CProjectile::Move(vec2 *pPrevPos, vec2 *pCurPos, vec2 *pColPos, vec2 *pNewPos, int *pCollide)
+{
+	const CProjectileMoves &Moves = GameWorld()->m_ProjectileMoves;
+	if(Moves.m_Tick == Server()->Tick() && m_MoveIndex >= 0 && m_MoveIndex < (int)Moves.m_vpProjectiles.size() && Moves.m_vpProjectiles[m_MoveIndex] == this)
+	{
+		*pPrevPos = Moves.m_vPrevPos[m_MoveIndex];
+		*pCurPos = Moves.m_vCurPos[m_MoveIndex];
+		*pColPos = Moves.m_vColPos[m_MoveIndex];
+		*pNewPos = Moves.m_vNewPos[m_MoveIndex];
+		*pCollide = Moves.m_vCollide[m_MoveIndex];
+		m_MoveIndex = -1;
+		return;
+	}
+
 	float Pt = (Server()->Tick() - m_StartTick - 1) / (float)Server()->TickSpeed();
 	float Ct = (Server()->Tick() - m_StartTick) / (float)Server()->TickSpeed();
-	vec2 PrevPos = GetPos(Pt);
-	vec2 CurPos = GetPos(Ct);
+	float Curvature, Speed;
+	GetTuning(&Curvature, &Speed);
+	*pCollide = CProjectileMoves::CalcMove(GameServer()->Collision(), m_Pos, m_Direction, Curvature, Speed, Pt, Ct, pPrevPos, pCurPos, pColPos, pNewPos);
+}
+
+void CProjectile::Tick()
+{
+	vec2 PrevPos;
+	vec2 CurPos;
 	vec2 ColPos;
 	vec2 NewPos;
-	int Collide = GameServer()->Collision()->IntersectLine(PrevPos, CurPos, &ColPos, &NewPos);
+	int Collide;
+	Move(&PrevPos, &CurPos, &ColPos, &NewPos, &Collide);
 	CCharacter *pOwnerChar = 0;
 
 	if(m_Owner >= 0)
@@ -7,6 +7,8 @@
 
 class CProjectile : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CProjectile(
 		CGameWorld *pGameWorld,
@@ -31,11 +33,18 @@ public:
 	virtual void Snap(int SnappingClient) override;
 	virtual void SwapClients(int Client1, int Client2) override;
 
+	// computes where all projectiles of the world move this tick, before the
+	// first of them ticks
+	static void MoveAll(CGameWorld *pGameWorld);
+
 	// OpenGores
 	bool TryToTeleportOwner(int Owner, int Type) override;
 	void TeleportOwnerToProjectile() override;
 
 private:
+	void GetTuning(float *pCurvature, float *pSpeed);
+	void Move(vec2 *pPrevPos, vec2 *pCurPos, vec2 *pColPos, vec2 *pNewPos, int *pCollide);
+
 	vec2 m_Direction;
 	int m_LifeSpan;
 	int m_Owner;
@@ -52,6 +61,8 @@ private:
 	bool m_Freeze;
 	int m_TuneZone;
 	bool m_BelongsToPracticeTeam;
+	// entry in CGameWorld::m_ProjectileMoves, -1 if not moved by MoveAll
+	int m_MoveIndex = -1;
 
 public:
 	void SetBouncing(int Value);
@@ -12,8 +12,10 @@
 #include "character.h"
 #include "star.h"
 
+MACRO_ALLOC_SLAB_IMPL(CStar, 64)
+
 CStar::CStar(CGameWorld *pGameWorld, int Owner) :
-	CEntity(pGameWorld, CGameWorld::ENTTYPE_PROJECTILE)
+	CEntity(pGameWorld, CGameWorld::ENTTYPE_COSMETIC)
 {
 	CPlayer *pOwner = GameServer()->m_apPlayers[Owner];
 	if(!pOwner || !pOwner->GetCharacter())
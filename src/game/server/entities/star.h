@@ -10,6 +10,8 @@
 
 class CStar : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CStar(CGameWorld *pGameWorld, int Owner);
 
@@ -9,8 +9,10 @@
 #include "character.h"
 #include "trail.h"
 
+MACRO_ALLOC_SLAB_IMPL(CTrail, 64)
+
 CTrail::CTrail(CGameWorld *pGameWorld, int Owner) :
-	CEntity(pGameWorld, CGameWorld::ENTTYPE_PROJECTILE)
+	CEntity(pGameWorld, CGameWorld::ENTTYPE_COSMETIC)
 {
 	CPlayer *pOwner = GameServer()->m_apPlayers[Owner];
 	if(!pOwner || !pOwner->GetCharacter())
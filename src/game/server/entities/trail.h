@@ -7,6 +7,8 @@
 
 class CTrail : public CEntity
 {
+	MACRO_ALLOC_SLAB()
+
 public:
 	CTrail(CGameWorld *pGameWorld, int Owner);
 	~CTrail();
@@ -20,8 +20,7 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, vec2 Pos, int ProximityRad
 	m_MarkedForDestroy = false;
 	m_ID = Server()->SnapNewID();
 
-	m_pPrevTypeEntity = 0;
-	m_pNextTypeEntity = 0;
+	m_WorldIndex = -1;
 }
 
 CEntity::~CEntity()
@@ -21,8 +21,8 @@ class CEntity
 
 private:
 	friend CGameWorld; // entity list handling
-	CEntity *m_pPrevTypeEntity;
-	CEntity *m_pNextTypeEntity;
+	// slot in the entity array of the world, -1 if not inserted
+	int m_WorldIndex;
 
 	/* Identity */
 	CGameWorld *m_pGameWorld;
@@ -66,8 +66,8 @@ public: // TODO: Maybe make protected
 	CCollision *Collision() { return m_pCCollision; }
 
 	/* Getters */
-	CEntity *TypeNext() { return m_pNextTypeEntity; }
-	CEntity *TypePrev() { return m_pPrevTypeEntity; }
+	CEntity *TypeNext() { return m_pGameWorld->NextEntity(this); }
+	CEntity *TypePrev() { return m_pGameWorld->PrevEntity(this); }
 	const vec2 &GetPos() const { return m_Pos; }
 	float GetProximityRadius() const { return m_ProximityRadius; }
 
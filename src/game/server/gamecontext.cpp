@@ -17,6 +17,7 @@
 #include <engine/shared/json.h>
 #include <engine/shared/linereader.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/metrics.h>
 #include <engine/storage.h>
 
 #include <game/collision.h>
@@ -158,7 +159,7 @@ void CGameContext::Clear()
 void CGameContext::TeeHistorianWrite(const void *pData, int DataSize, void *pUser)
 {
 	CGameContext *pSelf = (CGameContext *)pUser;
-	aio_write(pSelf->m_pTeeHistorianFile, pData, DataSize);
+	pSelf->m_TeeHistorianFile.Write(pData, DataSize);
 }
 
 void CGameContext::CommandCallback(int ClientID, int FlagMask, const char *pCmd, IConsole::IResult *pResult, void *pUser)
@@ -844,7 +845,7 @@ void CGameContext::OnTick()
 
 	if(m_TeeHistorianActive)
 	{
-		int Error = aio_error(m_pTeeHistorianFile);
+		int Error = m_TeeHistorianFile.Error();
 		if(Error)
 		{
 			dbg_msg("teehistorian", "error writing to file, err=%d", Error);
@@ -856,6 +857,7 @@ void CGameContext::OnTick()
 			m_TeeHistorian.EndInputs();
 			m_TeeHistorian.EndTick();
 		}
+		m_TeeHistorianFile.MarkTick(Server()->Tick());
 		m_TeeHistorian.BeginTick(Server()->Tick());
 		m_TeeHistorian.BeginPlayers();
 	}
@@ -936,7 +938,7 @@ void CGameContext::OnTick()
 						continue;
 
 					// connecting clients with spoofed ips can clog slots without being ingame
-					if(((CServer *)Server())->m_aClients[i].m_State != CServer::CClient::STATE_INGAME)
+					if(!Server()->ClientIngame(i))
 						continue;
 
 					// don't count votes by blacklisted clients
@@ -1088,23 +1090,12 @@ void CGameContext::OnTick()
 			SendChat(-1, CGameContext::CHAT_ALL, pLine);
 	}
 
-	for(auto &Switcher : Switchers())
+	m_World.m_Core.UpdateSwitchers(Server()->Tick());
+
+	if(Server()->Tick() % Server()->TickSpeed() == 0)
 	{
-		for(int j = 0; j < MAX_CLIENTS; ++j)
-		{
-			if(Switcher.m_aEndTick[j] <= Server()->Tick() && Switcher.m_aType[j] == TILE_SWITCHTIMEDOPEN)
-			{
-				Switcher.m_aStatus[j] = false;
-				Switcher.m_aEndTick[j] = 0;
-				Switcher.m_aType[j] = TILE_SWITCHCLOSE;
-			}
-			else if(Switcher.m_aEndTick[j] <= Server()->Tick() && Switcher.m_aType[j] == TILE_SWITCHTIMEDCLOSE)
-			{
-				Switcher.m_aStatus[j] = true;
-				Switcher.m_aEndTick[j] = 0;
-				Switcher.m_aType[j] = TILE_SWITCHOPEN;
-			}
-		}
+		for(int i = 0; i < CGameWorld::NUM_ENTTYPES; i++)
+			m_apMetricEntities[i]->Set(m_World.NumEntities(i));
 	}
 
 	if(m_SqlRandomMapResult != nullptr && m_SqlRandomMapResult->m_Completed)
@@ -3266,6 +3257,7 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("add_map_votes", "", CFGFLAG_SERVER, ConAddMapVotes, this, "Automatically adds voting options for all maps");
 	Console()->Register("vote", "r['yes'|'no']", CFGFLAG_SERVER, ConVote, this, "Force a vote to yes/no");
 	Console()->Register("dump_antibot", "", CFGFLAG_SERVER, ConDumpAntibot, this, "Dumps the antibot status");
+	Console()->Register("dump_entity_pools", "", CFGFLAG_SERVER, ConDumpEntityPools, this, "Dumps the live and peak entity counts of the slab pools");
 
 	Console()->Chain("sv_motd", ConchainSpecialMotdupdate, this);
 
@@ -3287,6 +3279,15 @@ void CGameContext::OnInit()
 	m_World.SetGameServer(this);
 	m_Events.SetGameServer(this);
 
+	static const char *const s_apEntityTypes[] = {"projectile", "cosmetic", "laser", "pickup", "flag", "character"};
+	static_assert(std::size(s_apEntityTypes) == CGameWorld::NUM_ENTTYPES, "missing entity type name");
+	for(int i = 0; i < CGameWorld::NUM_ENTTYPES; i++)
+	{
+		char aLabels[32];
+		str_format(aLabels, sizeof(aLabels), "type=\"%s\"", s_apEntityTypes[i]);
+		m_apMetricEntities[i] = Server()->Metrics()->Gauge("ddnet_entities", "Number of game world entities by type", aLabels);
+	}
+
 	m_GameUuid = RandomUuid();
 	Console()->SetTeeHistorianCommandCallback(CommandCallback, this);
 
@@ -3405,21 +3406,18 @@ void CGameContext::OnInit()
 		char aGameUuid[UUID_MAXSTRSIZE];
 		FormatUuid(m_GameUuid, aGameUuid, sizeof(aGameUuid));
 
-		char aFilename[IO_MAX_PATH_LENGTH];
-		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian", aGameUuid);
+		char aBasename[IO_MAX_PATH_LENGTH];
+		str_format(aBasename, sizeof(aBasename), "teehistorian/%s", aGameUuid);
 
-		IOHANDLE THFile = Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
-		if(!THFile)
+		const int64_t RotateSize = (int64_t)g_Config.m_SvTeeHistorianRotateSize * 1024 * 1024;
+		const int RotateTicks = g_Config.m_SvTeeHistorianRotateTime * 60 * SERVER_TICK_SPEED;
+		// at least one compressed frame and index line every ten seconds
+		const int FrameTicks = 10 * SERVER_TICK_SPEED;
+		if(!m_TeeHistorianFile.Open(Storage(), aBasename, g_Config.m_SvTeeHistorianCompress, RotateSize, RotateTicks, FrameTicks))
 		{
-			dbg_msg("teehistorian", "failed to open '%s'", aFilename);
 			Server()->SetErrorShutdown("teehistorian open error");
 			return;
 		}
-		else
-		{
-			dbg_msg("teehistorian", "recording to '%s'", aFilename);
-		}
-		m_pTeeHistorianFile = aio_new(THFile);
 
 		char aVersion[128];
 		if(GIT_SHORTREV_HASH)
@@ -3449,6 +3447,8 @@ void CGameContext::OnInit()
 		GameInfo.m_MapSha256 = MapSha256;
 		GameInfo.m_MapCrc = MapCrc;
 
+		GameInfo.m_Version = g_Config.m_SvTeeHistorianVersion;
+
 		m_TeeHistorian.Reset(&GameInfo, TeeHistorianWrite, this);
 
 		for(int i = 0; i < MAX_CLIENTS; i++)
@@ -3463,7 +3463,7 @@ void CGameContext::OnInit()
 
 	if(!m_pScore)
 	{
-		m_pScore = new CScore(this, ((CServer *)Server())->DbPool());
+		m_pScore = new CScore(this, Server()->DbPool());
 	}
 
 	// create all entities from the game layer
@@ -3726,15 +3726,13 @@ void CGameContext::OnShutdown()
 	if(m_TeeHistorianActive)
 	{
 		m_TeeHistorian.Finish();
-		aio_close(m_pTeeHistorianFile);
-		aio_wait(m_pTeeHistorianFile);
-		int Error = aio_error(m_pTeeHistorianFile);
+		m_TeeHistorianFile.Close();
+		int Error = m_TeeHistorianFile.Error();
 		if(Error)
 		{
 			dbg_msg("teehistorian", "error closing file, err=%d", Error);
 			Server()->SetErrorShutdown("teehistorian close error");
 		}
-		aio_free(m_pTeeHistorianFile);
 	}
 
 	DeleteTempfile();
@@ -15,6 +15,7 @@
 #include "game/generated/protocol.h"
 #include "gameworld.h"
 #include "teehistorian.h"
+#include "teehistorian_file.h"
 
 #include <memory>
 #include <string>
@@ -77,7 +78,7 @@ class CGameContext : public IGameServer
 
 	bool m_TeeHistorianActive;
 	CTeeHistorian m_TeeHistorian;
-	ASYNCIO *m_pTeeHistorianFile;
+	CTeeHistorianFileWriter m_TeeHistorianFile;
 	CUuid m_GameUuid;
 	CMapBugs m_MapBugs;
 	CPrng m_Prng;
@@ -116,6 +117,7 @@ class CGameContext : public IGameServer
 	static void ConVoteNo(IConsole::IResult *pResult, void *pUserData);
 	static void ConDrySave(IConsole::IResult *pResult, void *pUserData);
 	static void ConDumpAntibot(IConsole::IResult *pResult, void *pUserData);
+	static void ConDumpEntityPools(IConsole::IResult *pResult, void *pUserData);
 	static void ConchainSpecialMotdupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConDumpLog(IConsole::IResult *pResult, void *pUserData);
 
@@ -141,6 +143,8 @@ public:
 	IAntibot *Antibot() { return m_pAntibot; }
 	CTeeHistorian *TeeHistorian() { return &m_TeeHistorian; }
 	bool TeeHistorianActive() const { return m_TeeHistorianActive; }
+	// replays seed it like the recorded game
+	void SeedPrng(uint64_t aSeed[2]) { m_Prng.Seed(aSeed); }
 
 	CGameContext();
 	CGameContext(int Reset);
@@ -160,6 +164,8 @@ public:
 
 	IGameController *m_pController;
 	CGameWorld m_World;
+	// entities per type, updated once per second
+	class CMetricGauge *m_apMetricEntities[CGameWorld::NUM_ENTTYPES];
 
 	// helper functions
 	class CCharacter *GetPlayerChar(int ClientID);
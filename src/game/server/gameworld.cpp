@@ -3,6 +3,7 @@
 
 #include "gameworld.h"
 #include "entities/character.h"
+#include "entities/projectile.h"
 #include "entity.h"
 #include "gamecontext.h"
 #include "gamecontroller.h"
@@ -24,16 +25,17 @@ CGameWorld::CGameWorld()
 
 	m_Paused = false;
 	m_ResetRequested = false;
-	for(auto &pFirstEntityType : m_apFirstEntityTypes)
-		pFirstEntityType = 0;
+	for(bool &Holes : m_aHoles)
+		Holes = false;
 }
 
 CGameWorld::~CGameWorld()
 {
 	// delete all entities
-	for(auto &pFirstEntityType : m_apFirstEntityTypes)
-		while(pFirstEntityType)
-			delete pFirstEntityType;
+	for(auto &vpEntities : m_avpEntities)
+		for(int i = (int)vpEntities.size() - 1; i >= 0; i--)
+			if(vpEntities[i])
+				delete vpEntities[i];
 }
 
 void CGameWorld::SetGameServer(CGameContext *pGameServer)
@@ -43,9 +45,44 @@ void CGameWorld::SetGameServer(CGameContext *pGameServer)
 	m_pServer = m_pGameServer->Server();
 }
 
+int CGameWorld::NumEntities(int Type) const
+{
+	int Num = 0;
+	for(const CEntity *pEnt : m_avpEntities[Type])
+		Num += pEnt != nullptr;
+	return Num;
+}
+
 CEntity *CGameWorld::FindFirst(int Type)
 {
-	return Type < 0 || Type >= NUM_ENTTYPES ? 0 : m_apFirstEntityTypes[Type];
+	if(Type < 0 || Type >= NUM_ENTTYPES)
+		return 0;
+	for(int i = (int)m_avpEntities[Type].size() - 1; i >= 0; i--)
+		if(m_avpEntities[Type][i])
+			return m_avpEntities[Type][i];
+	return 0;
+}
+
+CEntity *CGameWorld::NextEntity(const CEntity *pEnt) const
+{
+	if(pEnt->m_WorldIndex < 0)
+		return 0;
+	const std::vector<CEntity *> &vpEntities = m_avpEntities[pEnt->m_ObjType];
+	for(int i = pEnt->m_WorldIndex - 1; i >= 0; i--)
+		if(vpEntities[i])
+			return vpEntities[i];
+	return 0;
+}
+
+CEntity *CGameWorld::PrevEntity(const CEntity *pEnt) const
+{
+	if(pEnt->m_WorldIndex < 0)
+		return 0;
+	const std::vector<CEntity *> &vpEntities = m_avpEntities[pEnt->m_ObjType];
+	for(int i = pEnt->m_WorldIndex + 1; i < (int)vpEntities.size(); i++)
+		if(vpEntities[i])
+			return vpEntities[i];
+	return 0;
 }
 
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
@@ -54,9 +91,11 @@ int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max,
 		return 0;
 
 	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+	const std::vector<CEntity *> &vpEntities = m_avpEntities[Type];
+	for(int i = (int)vpEntities.size() - 1; i >= 0; i--)
 	{
-		if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
+		CEntity *pEnt = vpEntities[i];
+		if(pEnt && distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
 		{
 			if(ppEnts)
 				ppEnts[Num] = pEnt;
@@ -72,74 +111,75 @@ int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max,
 void CGameWorld::InsertEntity(CEntity *pEnt)
 {
 #ifdef CONF_DEBUG
-	for(CEntity *pCur = m_apFirstEntityTypes[pEnt->m_ObjType]; pCur; pCur = pCur->m_pNextTypeEntity)
-		dbg_assert(pCur != pEnt, "err");
+	dbg_assert(pEnt->m_WorldIndex < 0, "err");
 #endif
+	if(pEnt->m_WorldIndex >= 0)
+		return;
 
 	// insert it
-	if(m_apFirstEntityTypes[pEnt->m_ObjType])
-		m_apFirstEntityTypes[pEnt->m_ObjType]->m_pPrevTypeEntity = pEnt;
-	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
-	pEnt->m_pPrevTypeEntity = 0x0;
-	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+	pEnt->m_WorldIndex = m_avpEntities[pEnt->m_ObjType].size();
+	m_avpEntities[pEnt->m_ObjType].push_back(pEnt);
 }
 
 void CGameWorld::RemoveEntity(CEntity *pEnt)
 {
 	// not in the list
-	if(!pEnt->m_pNextTypeEntity && !pEnt->m_pPrevTypeEntity && m_apFirstEntityTypes[pEnt->m_ObjType] != pEnt)
+	if(pEnt->m_WorldIndex < 0)
 		return;
 
-	// remove
-	if(pEnt->m_pPrevTypeEntity)
-		pEnt->m_pPrevTypeEntity->m_pNextTypeEntity = pEnt->m_pNextTypeEntity;
-	else
-		m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt->m_pNextTypeEntity;
-	if(pEnt->m_pNextTypeEntity)
-		pEnt->m_pNextTypeEntity->m_pPrevTypeEntity = pEnt->m_pPrevTypeEntity;
-
-	// keep list traversing valid
-	if(m_pNextTraverseEntity == pEnt)
-		m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+	// leave a hole, iterations over the type might be running
+	m_avpEntities[pEnt->m_ObjType][pEnt->m_WorldIndex] = 0;
+	m_aHoles[pEnt->m_ObjType] = true;
+	pEnt->m_WorldIndex = -1;
+}
 
-	pEnt->m_pNextTypeEntity = 0;
-	pEnt->m_pPrevTypeEntity = 0;
+void CGameWorld::CompactEntities()
+{
+	for(int Type = 0; Type < NUM_ENTTYPES; Type++)
+	{
+		if(!m_aHoles[Type])
+			continue;
+		std::vector<CEntity *> &vpEntities = m_avpEntities[Type];
+		int Num = 0;
+		for(CEntity *pEnt : vpEntities)
+		{
+			if(!pEnt)
+				continue;
+			pEnt->m_WorldIndex = Num;
+			vpEntities[Num++] = pEnt;
+		}
+		vpEntities.resize(Num);
+		m_aHoles[Type] = false;
+	}
 }
 
 //
 void CGameWorld::Snap(int SnappingClient)
 {
-	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt;)
-	{
-		m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-		pEnt->Snap(SnappingClient);
-		pEnt = m_pNextTraverseEntity;
-	}
+	const std::vector<CEntity *> &vpCharacters = m_avpEntities[ENTTYPE_CHARACTER];
+	for(int j = (int)vpCharacters.size() - 1; j >= 0; j--)
+		if(vpCharacters[j])
+			vpCharacters[j]->Snap(SnappingClient);
 
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 	{
 		if(i == ENTTYPE_CHARACTER)
 			continue;
 
-		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt;)
-		{
-			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			pEnt->Snap(SnappingClient);
-			pEnt = m_pNextTraverseEntity;
-		}
+		const std::vector<CEntity *> &vpEntities = m_avpEntities[i];
+		for(int j = (int)vpEntities.size() - 1; j >= 0; j--)
+			if(vpEntities[j])
+				vpEntities[j]->Snap(SnappingClient);
 	}
 }
 
 void CGameWorld::Reset()
 {
 	// reset all entities
-	for(auto *pEnt : m_apFirstEntityTypes)
-		for(; pEnt;)
-		{
-			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			pEnt->Reset();
-			pEnt = m_pNextTraverseEntity;
-		}
+	for(auto &vpEntities : m_avpEntities)
+		for(int j = (int)vpEntities.size() - 1; j >= 0; j--)
+			if(vpEntities[j])
+				vpEntities[j]->Reset();
 	RemoveEntities();
 
 	GameServer()->m_pController->OnReset();
@@ -153,17 +193,18 @@ void CGameWorld::Reset()
 void CGameWorld::RemoveEntities()
 {
 	// destroy objects marked for destruction
-	for(auto *pEnt : m_apFirstEntityTypes)
-		for(; pEnt;)
+	for(auto &vpEntities : m_avpEntities)
+		for(int j = (int)vpEntities.size() - 1; j >= 0; j--)
 		{
-			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			if(pEnt->m_MarkedForDestroy)
+			CEntity *pEnt = vpEntities[j];
+			if(pEnt && pEnt->m_MarkedForDestroy)
 			{
 				RemoveEntity(pEnt);
 				pEnt->Destroy();
 			}
-			pEnt = m_pNextTraverseEntity;
 		}
+
+	CompactEntities();
 }
 
 bool distCompare(std::pair<float, int> a, std::pair<float, int> b)
@@ -270,49 +311,43 @@ void CGameWorld::Tick()
 		if(GameServer()->m_pController->IsForceBalanced())
 			GameServer()->SendChat(-1, CGameContext::CHAT_ALL, "Teams have been balanced");
 
+		m_Core.BuildBroadphase();
+
 		// update all objects
 		for(int i = 0; i < NUM_ENTTYPES; i++)
 		{
 			// It's important to call PreTick() and Tick() after each other.
 			// If we call PreTick() before, and Tick() after other entities have been processed, it causes physics changes such as a stronger shotgun or grenade.
+			std::vector<CEntity *> &vpEntities = m_avpEntities[i];
 			if(g_Config.m_SvNoWeakHook && i == ENTTYPE_CHARACTER)
 			{
-				auto *pEnt = m_apFirstEntityTypes[i];
-				for(; pEnt;)
-				{
-					m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-					((CCharacter *)pEnt)->PreTick();
-					pEnt = m_pNextTraverseEntity;
-				}
+				for(int j = (int)vpEntities.size() - 1; j >= 0; j--)
+					if(vpEntities[j])
+						((CCharacter *)vpEntities[j])->PreTick();
 			}
 
-			auto *pEnt = m_apFirstEntityTypes[i];
-			for(; pEnt;)
-			{
-				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-				pEnt->Tick();
-				pEnt = m_pNextTraverseEntity;
-			}
+			if(i == ENTTYPE_PROJECTILE)
+				CProjectile::MoveAll(this);
+
+			for(int j = (int)vpEntities.size() - 1; j >= 0; j--)
+				if(vpEntities[j])
+					vpEntities[j]->Tick();
 		}
 
-		for(auto *pEnt : m_apFirstEntityTypes)
-			for(; pEnt;)
-			{
-				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-				pEnt->TickDeferred();
-				pEnt = m_pNextTraverseEntity;
-			}
+		for(auto &vpEntities : m_avpEntities)
+			for(int j = (int)vpEntities.size() - 1; j >= 0; j--)
+				if(vpEntities[j])
+					vpEntities[j]->TickDeferred();
+
+		m_Core.ClearBroadphase();
 	}
 	else
 	{
 		// update all objects
-		for(auto *pEnt : m_apFirstEntityTypes)
-			for(; pEnt;)
-			{
-				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-				pEnt->TickPaused();
-				pEnt = m_pNextTraverseEntity;
-			}
+		for(auto &vpEntities : m_avpEntities)
+			for(int j = (int)vpEntities.size() - 1; j >= 0; j--)
+				if(vpEntities[j])
+					vpEntities[j]->TickPaused();
 	}
 
 	RemoveEntities();
@@ -331,13 +366,10 @@ void CGameWorld::Tick()
 void CGameWorld::SwapClients(int Client1, int Client2)
 {
 	// update all objects
-	for(auto *pEnt : m_apFirstEntityTypes)
-		for(; pEnt;)
-		{
-			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			pEnt->SwapClients(Client1, Client2);
-			pEnt = m_pNextTraverseEntity;
-		}
+	for(auto &vpEntities : m_avpEntities)
+		for(int j = (int)vpEntities.size() - 1; j >= 0; j--)
+			if(vpEntities[j])
+				vpEntities[j]->SwapClients(Client1, Client2);
 }
 
 // TODO: should be more general
@@ -447,21 +479,14 @@ void CGameWorld::ReleaseHooked(int ClientID)
 // OpenGores
 bool CGameWorld::CheckForProjectileTeleport(int Owner, int Type)
 {
-	for(auto *pEnt : m_apFirstEntityTypes)
-		for(; pEnt;)
+	const std::vector<CEntity *> &vpProjectiles = m_avpEntities[ENTTYPE_PROJECTILE];
+	for(int j = (int)vpProjectiles.size() - 1; j >= 0; j--)
+	{
+		if(vpProjectiles[j] && vpProjectiles[j]->TryToTeleportOwner(Owner, Type))
 		{
-			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-
-			if(pEnt->m_ObjType == ENTTYPE_PROJECTILE)
-			{
-				if(pEnt->TryToTeleportOwner(Owner, Type))
-				{
-					return true;
-				}
-			}
-
-			pEnt = m_pNextTraverseEntity;
+			return true;
 		}
+	}
 
 	return false;
 }
\ No newline at end of file
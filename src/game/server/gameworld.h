@@ -5,7 +5,10 @@
 
 #include <game/gamecore.h>
 
+#include "projectile_moves.h"
+
 #include <list>
+#include <vector>
 
 class CEntity;
 class CCharacter;
@@ -21,6 +24,8 @@ public:
 	enum
 	{
 		ENTTYPE_PROJECTILE = 0,
+		// stars, auras and trails, kept apart from CProjectile for MoveAll
+		ENTTYPE_COSMETIC,
 		ENTTYPE_LASER,
 		ENTTYPE_PICKUP,
 		ENTTYPE_FLAG,
@@ -32,8 +37,14 @@ private:
 	void Reset();
 	void RemoveEntities();
 
-	CEntity *m_pNextTraverseEntity = nullptr;
-	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
+	// Entities per type, oldest first. Iteration goes from the back so that
+	// new entities come first and the ones inserted while iterating are
+	// skipped. Removed entities leave a null slot behind that is compacted
+	// away in RemoveEntities, so indices stay valid during a tick.
+	std::vector<CEntity *> m_avpEntities[NUM_ENTTYPES];
+	bool m_aHoles[NUM_ENTTYPES];
+
+	void CompactEntities();
 
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
@@ -50,12 +61,18 @@ public:
 	bool m_Paused;
 	CWorldCore m_Core;
 
+	CProjectileMoves m_ProjectileMoves;
+
 	CGameWorld();
 	~CGameWorld();
 
 	void SetGameServer(CGameContext *pGameServer);
 
 	CEntity *FindFirst(int Type);
+	// iteration in the order of FindFirst, used by CEntity::TypeNext/TypePrev
+	CEntity *NextEntity(const CEntity *pEnt) const;
+	CEntity *PrevEntity(const CEntity *pEnt) const;
+	int NumEntities(int Type) const;
 
 	/*
 		Function: FindEntities
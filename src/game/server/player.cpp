@@ -984,25 +984,26 @@ void CPlayer::ProcessScoreResult(CScorePlayerResult &Result)
 	{
 		switch(Result.m_MessageKind)
 		{
+		// The lines are only rendered here. None of the chat messages is
+		// flushed, so all lines of a result end up in the same packet.
 		case CScorePlayerResult::DIRECT:
-			for(auto &aMessage : Result.m_Data.m_aaMessages)
+			for(int i = 0; i < Result.m_Messages.Num(); i++)
 			{
-				if(aMessage[0] == 0)
-					break;
+				char aMessage[512];
+				Result.m_Messages.Render(i, aMessage, sizeof(aMessage));
 				GameServer()->SendChatTarget(m_ClientID, aMessage);
 			}
 			break;
 		case CScorePlayerResult::ALL:
 		{
 			bool PrimaryMessage = true;
-			for(auto &aMessage : Result.m_Data.m_aaMessages)
+			for(int i = 0; i < Result.m_Messages.Num(); i++)
 			{
-				if(aMessage[0] == 0)
-					break;
-
 				if(GameServer()->ProcessSpamProtection(m_ClientID) && PrimaryMessage)
 					break;
 
+				char aMessage[512];
+				Result.m_Messages.Render(i, aMessage, sizeof(aMessage));
 				GameServer()->SendChat(-1, CGameContext::CHAT_ALL, aMessage, -1);
 				PrimaryMessage = false;
 			}
@@ -0,0 +1,55 @@
+#include "projectile_moves.h"
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+
+void CProjectileMoves::Clear()
+{
+	m_vpProjectiles.clear();
+	m_vPos.clear();
+	m_vDirection.clear();
+	m_vCurvature.clear();
+	m_vSpeed.clear();
+	m_vPrevTime.clear();
+	m_vCurTime.clear();
+}
+
+int CProjectileMoves::Add(const CEntity *pProjectile, vec2 Pos, vec2 Direction, float Curvature, float Speed, float PrevTime, float CurTime)
+{
+	m_vpProjectiles.push_back(pProjectile);
+	m_vPos.push_back(Pos);
+	m_vDirection.push_back(Direction);
+	m_vCurvature.push_back(Curvature);
+	m_vSpeed.push_back(Speed);
+	m_vPrevTime.push_back(PrevTime);
+	m_vCurTime.push_back(CurTime);
+	return m_vpProjectiles.size() - 1;
+}
+
+void CProjectileMoves::Integrate(const CCollision *pCollision)
+{
+	// same math as CalcMove in a loop the compiler can vectorize
+	const int Num = m_vPos.size();
+	m_vPrevPos.resize(Num);
+	m_vCurPos.resize(Num);
+	m_vColPos.resize(Num);
+	m_vNewPos.resize(Num);
+	m_vCollide.resize(Num);
+	for(int i = 0; i < Num; i++)
+	{
+		m_vPrevPos[i] = CalcPos(m_vPos[i], m_vDirection[i], m_vCurvature[i], m_vSpeed[i], m_vPrevTime[i]);
+		m_vCurPos[i] = CalcPos(m_vPos[i], m_vDirection[i], m_vCurvature[i], m_vSpeed[i], m_vCurTime[i]);
+	}
+
+	// projectile ticks don't change the map, so the collision can be
+	// checked for all of them before the first one ticks
+	for(int i = 0; i < Num; i++)
+		m_vCollide[i] = pCollision->IntersectLine(m_vPrevPos[i], m_vCurPos[i], &m_vColPos[i], &m_vNewPos[i]);
+}
+
+int CProjectileMoves::CalcMove(const CCollision *pCollision, vec2 Pos, vec2 Direction, float Curvature, float Speed, float PrevTime, float CurTime, vec2 *pPrevPos, vec2 *pCurPos, vec2 *pColPos, vec2 *pNewPos)
+{
+	*pPrevPos = CalcPos(Pos, Direction, Curvature, Speed, PrevTime);
+	*pCurPos = CalcPos(Pos, Direction, Curvature, Speed, CurTime);
+	return pCollision->IntersectLine(*pPrevPos, *pCurPos, pColPos, pNewPos);
+}
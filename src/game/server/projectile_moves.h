@@ -0,0 +1,41 @@
+#ifndef GAME_SERVER_PROJECTILE_MOVES_H
+#define GAME_SERVER_PROJECTILE_MOVES_H
+
+#include <base/vmath.h>
+
+#include <vector>
+
+class CCollision;
+class CEntity;
+
+// Movement of all projectiles, computed in one pass over flat arrays
+// right before they tick (see CProjectile::MoveAll)
+class CProjectileMoves
+{
+public:
+	int m_Tick = -1;
+	std::vector<const CEntity *> m_vpProjectiles;
+	std::vector<vec2> m_vPos;
+	std::vector<vec2> m_vDirection;
+	std::vector<float> m_vCurvature;
+	std::vector<float> m_vSpeed;
+	std::vector<float> m_vPrevTime;
+	std::vector<float> m_vCurTime;
+	std::vector<vec2> m_vPrevPos;
+	std::vector<vec2> m_vCurPos;
+	std::vector<vec2> m_vColPos;
+	std::vector<vec2> m_vNewPos;
+	std::vector<int> m_vCollide;
+
+	// Clears the gathered projectiles.
+	void Clear();
+	// Adds a projectile, returns its index.
+	int Add(const CEntity *pProjectile, vec2 Pos, vec2 Direction, float Curvature, float Speed, float PrevTime, float CurTime);
+	// Computes the positions and collisions of all gathered projectiles.
+	void Integrate(const CCollision *pCollision);
+
+	// The same for a single projectile, returns the collision.
+	static int CalcMove(const CCollision *pCollision, vec2 Pos, vec2 Direction, float Curvature, float Speed, float PrevTime, float CurTime, vec2 *pPrevPos, vec2 *pCurPos, vec2 *pColPos, vec2 *pNewPos);
+};
+
+#endif // GAME_SERVER_PROJECTILE_MOVES_H
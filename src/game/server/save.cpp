@@ -1,15 +1,11 @@
 #include "save.h"
 
-#include <cstdio>
-
 #include "entities/character.h"
 #include "gamemodes/DDRace.h"
 #include "player.h"
 #include "teams.h"
 #include <engine/shared/config.h>
 
-CSaveTee::CSaveTee() = default;
-
 void CSaveTee::Save(CCharacter *pChr)
 {
 	m_ClientID = pChr->m_pPlayer->GetCID();
@@ -223,223 +219,11 @@ void CSaveTee::Load(CCharacter *pChr, int Team, bool IsSwap)
 	}
 }
 
-char *CSaveTee::GetString(const CSaveTeam *pTeam)
-{
-	int HookedPlayer = -1;
-	if(m_HookedPlayer != -1)
-	{
-		for(int n = 0; n < pTeam->GetMembersCount(); n++)
-		{
-			if(m_HookedPlayer == pTeam->m_pSavedTees[n].GetClientID())
-			{
-				HookedPlayer = n;
-				break;
-			}
-		}
-	}
-
-	str_format(m_aString, sizeof(m_aString),
-		"%s\t%d\t%d\t%d\t%d\t%d\t"
-		// weapons
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t"
-		// tee stats
-		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_EndlessJump
-		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_DDRaceState
-		"%d\t%d\t%d\t%d\t" // m_Pos.x
-		"%d\t%d\t" // m_TeleCheckpoint
-		"%d\t%d\t%f\t%f\t" // m_CorePos.x
-		"%d\t%d\t%d\t%d\t" // m_ActiveWeapon
-		"%d\t%d\t%f\t%f\t" // m_HookPos.x
-		"%d\t%d\t%d\t%d\t" // m_HookTeleBase.x
-		// time checkpoints
-		"%d\t%d\t%d\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%d\t" // m_NotEligibleForFinish
-		"%d\t%d\t%d\t" // tele weapons
-		"%s\t" // m_aGameUuid
-		"%d\t%d\t" // m_HookedPlayer, m_NewHook
-		"%d\t%d\t%d\t%d\t" // input stuff
-		"%d\t" // m_ReloadTimer
-		"%d\t" // m_TeeStarted
-		"%d", // m_LiveFreeze
-		m_aName, m_Alive, m_Paused, m_NeededFaketuning, m_TeeFinished, m_IsSolo,
-		// weapons
-		m_aWeapons[0].m_AmmoRegenStart, m_aWeapons[0].m_Ammo, m_aWeapons[0].m_Ammocost, m_aWeapons[0].m_Got,
-		m_aWeapons[1].m_AmmoRegenStart, m_aWeapons[1].m_Ammo, m_aWeapons[1].m_Ammocost, m_aWeapons[1].m_Got,
-		m_aWeapons[2].m_AmmoRegenStart, m_aWeapons[2].m_Ammo, m_aWeapons[2].m_Ammocost, m_aWeapons[2].m_Got,
-		m_aWeapons[3].m_AmmoRegenStart, m_aWeapons[3].m_Ammo, m_aWeapons[3].m_Ammocost, m_aWeapons[3].m_Got,
-		m_aWeapons[4].m_AmmoRegenStart, m_aWeapons[4].m_Ammo, m_aWeapons[4].m_Ammocost, m_aWeapons[4].m_Got,
-		m_aWeapons[5].m_AmmoRegenStart, m_aWeapons[5].m_Ammo, m_aWeapons[5].m_Ammocost, m_aWeapons[5].m_Got,
-		m_LastWeapon, m_QueuedWeapon,
-		// tee states
-		m_EndlessJump, m_Jetpack, m_NinjaJetpack, m_FreezeTime, m_FreezeStart, m_DeepFrozen, m_EndlessHook,
-		m_DDRaceState, m_HitDisabledFlags, m_CollisionEnabled, m_TuneZone, m_TuneZoneOld, m_HookHitEnabled, m_Time,
-		(int)m_Pos.x, (int)m_Pos.y, (int)m_PrevPos.x, (int)m_PrevPos.y,
-		m_TeleCheckpoint, m_LastPenalty,
-		(int)m_CorePos.x, (int)m_CorePos.y, m_Vel.x, m_Vel.y,
-		m_ActiveWeapon, m_Jumped, m_JumpedTotal, m_Jumps,
-		(int)m_HookPos.x, (int)m_HookPos.y, m_HookDir.x, m_HookDir.y,
-		(int)m_HookTeleBase.x, (int)m_HookTeleBase.y, m_HookTick, m_HookState,
-		// time checkpoints
-		m_TimeCpBroadcastEndTime, m_LastTimeCp, m_LastTimeCpBroadcasted,
-		m_aCurrentTimeCp[0], m_aCurrentTimeCp[1], m_aCurrentTimeCp[2], m_aCurrentTimeCp[3], m_aCurrentTimeCp[4],
-		m_aCurrentTimeCp[5], m_aCurrentTimeCp[6], m_aCurrentTimeCp[7], m_aCurrentTimeCp[8], m_aCurrentTimeCp[9],
-		m_aCurrentTimeCp[10], m_aCurrentTimeCp[11], m_aCurrentTimeCp[12], m_aCurrentTimeCp[13], m_aCurrentTimeCp[14],
-		m_aCurrentTimeCp[15], m_aCurrentTimeCp[16], m_aCurrentTimeCp[17], m_aCurrentTimeCp[18], m_aCurrentTimeCp[19],
-		m_aCurrentTimeCp[20], m_aCurrentTimeCp[21], m_aCurrentTimeCp[22], m_aCurrentTimeCp[23], m_aCurrentTimeCp[24],
-		m_NotEligibleForFinish,
-		m_HasTelegunGun, m_HasTelegunLaser, m_HasTelegunGrenade,
-		m_aGameUuid,
-		HookedPlayer, m_NewHook,
-		m_InputDirection, m_InputJump, m_InputFire, m_InputHook,
-		m_ReloadTimer,
-		m_TeeStarted,
-		m_LiveFrozen);
-	return m_aString;
-}
-
-int CSaveTee::FromString(const char *pString)
-{
-	int Num;
-	Num = sscanf(pString,
-		"%[^\t]\t%d\t%d\t%d\t%d\t%d\t"
-		// weapons
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t%d\t%d\t"
-		"%d\t%d\t"
-		// tee states
-		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_EndlessJump
-		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_DDRaceState
-		"%f\t%f\t%f\t%f\t" // m_Pos.x
-		"%d\t%d\t" // m_TeleCheckpoint
-		"%f\t%f\t%f\t%f\t" // m_CorePos.x
-		"%d\t%d\t%d\t%d\t" // m_ActiveWeapon
-		"%f\t%f\t%f\t%f\t" // m_HookPos.x
-		"%f\t%f\t%d\t%d\t" // m_HookTeleBase.x
-		// time checkpoints
-		"%d\t%d\t%d\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%f\t%f\t%f\t%f\t%f\t"
-		"%d\t" // m_NotEligibleForFinish
-		"%d\t%d\t%d\t" // tele weapons
-		"%36s\t" // m_aGameUuid
-		"%d\t%d\t" // m_HookedPlayer, m_NewHook
-		"%d\t%d\t%d\t%d\t" // input stuff
-		"%d\t" // m_ReloadTimer
-		"%d\t" // m_TeeStarted
-		"%d", // m_LiveFreeze
-		m_aName, &m_Alive, &m_Paused, &m_NeededFaketuning, &m_TeeFinished, &m_IsSolo,
-		// weapons
-		&m_aWeapons[0].m_AmmoRegenStart, &m_aWeapons[0].m_Ammo, &m_aWeapons[0].m_Ammocost, &m_aWeapons[0].m_Got,
-		&m_aWeapons[1].m_AmmoRegenStart, &m_aWeapons[1].m_Ammo, &m_aWeapons[1].m_Ammocost, &m_aWeapons[1].m_Got,
-		&m_aWeapons[2].m_AmmoRegenStart, &m_aWeapons[2].m_Ammo, &m_aWeapons[2].m_Ammocost, &m_aWeapons[2].m_Got,
-		&m_aWeapons[3].m_AmmoRegenStart, &m_aWeapons[3].m_Ammo, &m_aWeapons[3].m_Ammocost, &m_aWeapons[3].m_Got,
-		&m_aWeapons[4].m_AmmoRegenStart, &m_aWeapons[4].m_Ammo, &m_aWeapons[4].m_Ammocost, &m_aWeapons[4].m_Got,
-		&m_aWeapons[5].m_AmmoRegenStart, &m_aWeapons[5].m_Ammo, &m_aWeapons[5].m_Ammocost, &m_aWeapons[5].m_Got,
-		&m_LastWeapon, &m_QueuedWeapon,
-		// tee states
-		&m_EndlessJump, &m_Jetpack, &m_NinjaJetpack, &m_FreezeTime, &m_FreezeStart, &m_DeepFrozen, &m_EndlessHook,
-		&m_DDRaceState, &m_HitDisabledFlags, &m_CollisionEnabled, &m_TuneZone, &m_TuneZoneOld, &m_HookHitEnabled, &m_Time,
-		&m_Pos.x, &m_Pos.y, &m_PrevPos.x, &m_PrevPos.y,
-		&m_TeleCheckpoint, &m_LastPenalty,
-		&m_CorePos.x, &m_CorePos.y, &m_Vel.x, &m_Vel.y,
-		&m_ActiveWeapon, &m_Jumped, &m_JumpedTotal, &m_Jumps,
-		&m_HookPos.x, &m_HookPos.y, &m_HookDir.x, &m_HookDir.y,
-		&m_HookTeleBase.x, &m_HookTeleBase.y, &m_HookTick, &m_HookState,
-		// time checkpoints
-		&m_TimeCpBroadcastEndTime, &m_LastTimeCp, &m_LastTimeCpBroadcasted,
-		&m_aCurrentTimeCp[0], &m_aCurrentTimeCp[1], &m_aCurrentTimeCp[2], &m_aCurrentTimeCp[3], &m_aCurrentTimeCp[4],
-		&m_aCurrentTimeCp[5], &m_aCurrentTimeCp[6], &m_aCurrentTimeCp[7], &m_aCurrentTimeCp[8], &m_aCurrentTimeCp[9],
-		&m_aCurrentTimeCp[10], &m_aCurrentTimeCp[11], &m_aCurrentTimeCp[12], &m_aCurrentTimeCp[13], &m_aCurrentTimeCp[14],
-		&m_aCurrentTimeCp[15], &m_aCurrentTimeCp[16], &m_aCurrentTimeCp[17], &m_aCurrentTimeCp[18], &m_aCurrentTimeCp[19],
-		&m_aCurrentTimeCp[20], &m_aCurrentTimeCp[21], &m_aCurrentTimeCp[22], &m_aCurrentTimeCp[23], &m_aCurrentTimeCp[24],
-		&m_NotEligibleForFinish,
-		&m_HasTelegunGun, &m_HasTelegunLaser, &m_HasTelegunGrenade,
-		m_aGameUuid,
-		&m_HookedPlayer, &m_NewHook,
-		&m_InputDirection, &m_InputJump, &m_InputFire, &m_InputHook,
-		&m_ReloadTimer,
-		&m_TeeStarted,
-		&m_LiveFrozen);
-	switch(Num) // Don't forget to update this when you save / load more / less.
-	{
-	case 96:
-		m_NotEligibleForFinish = false;
-		[[fallthrough]];
-	case 97:
-		m_HasTelegunGrenade = 0;
-		m_HasTelegunLaser = 0;
-		m_HasTelegunGun = 0;
-		FormatUuid(CalculateUuid("game-uuid-nonexistent@ddnet.tw"), m_aGameUuid, sizeof(m_aGameUuid));
-		[[fallthrough]];
-	case 101:
-		m_HookedPlayer = -1;
-		m_NewHook = false;
-		if(m_HookState == HOOK_GRABBED)
-			m_HookState = HOOK_FLYING;
-		m_InputDirection = 0;
-		m_InputJump = 0;
-		m_InputFire = 0;
-		m_InputHook = 0;
-		m_ReloadTimer = 0;
-		[[fallthrough]];
-	case 108:
-		m_TeeStarted = true;
-		[[fallthrough]];
-	case 109:
-		m_LiveFrozen = false;
-		[[fallthrough]];
-	case 110:
-		return 0;
-	default:
-		dbg_msg("load", "failed to load tee-string");
-		dbg_msg("load", "loaded %d vars", Num);
-		return Num + 1; // never 0 here
-	}
-}
-
-void CSaveTee::LoadHookedPlayer(const CSaveTeam *pTeam)
-{
-	if(m_HookedPlayer == -1)
-		return;
-	m_HookedPlayer = pTeam->m_pSavedTees[m_HookedPlayer].GetClientID();
-}
-
 bool CSaveTee::IsHooking() const
 {
 	return m_HookState == HOOK_GRABBED || m_HookState == HOOK_FLYING;
 }
 
-CSaveTeam::CSaveTeam(IGameController *pController)
-{
-	m_pController = pController;
-	m_pSwitchers = 0;
-	m_pSavedTees = 0;
-}
-
-CSaveTeam::~CSaveTeam()
-{
-	delete[] m_pSwitchers;
-	delete[] m_pSavedTees;
-}
-
 int CSaveTeam::Save(int Team)
 {
 	if(g_Config.m_SvTeam == SV_TEAM_FORCED_SOLO || (Team > 0 && Team < MAX_CLIENTS))
@@ -549,6 +333,7 @@ void CSaveTeam::Load(int Team, bool KeepCurrentWeakStrong)
 			if(m_pSwitchers[i].m_EndTime)
 				m_pController->GameServer()->Switchers()[i].m_aEndTick[Team] = m_pController->Server()->Tick() - m_pSwitchers[i].m_EndTime;
 			m_pController->GameServer()->Switchers()[i].m_aType[Team] = m_pSwitchers[i].m_Type;
+			m_pController->GameServer()->m_World.m_Core.ScheduleSwitch(i, Team);
 		}
 	}
 }
@@ -564,184 +349,6 @@ CCharacter *CSaveTeam::MatchCharacter(int ClientID, int SaveID, bool KeepCurrent
 	return m_pController->GameServer()->m_apPlayers[ClientID]->ForceSpawn(m_pSavedTees[SaveID].GetPos());
 }
 
-char *CSaveTeam::GetString()
-{
-	str_format(m_aString, sizeof(m_aString), "%d\t%d\t%d\t%d\t%d", m_TeamState, m_MembersCount, m_HighestSwitchNumber, m_TeamLocked, m_Practice);
-
-	for(int i = 0; i < m_MembersCount; i++)
-	{
-		char aBuf[1024];
-		str_format(aBuf, sizeof(aBuf), "\n%s", m_pSavedTees[i].GetString(this));
-		str_append(m_aString, aBuf, sizeof(m_aString));
-	}
-
-	if(m_pSwitchers && m_HighestSwitchNumber)
-	{
-		for(int i = 1; i < m_HighestSwitchNumber + 1; i++)
-		{
-			char aBuf[64];
-			str_format(aBuf, sizeof(aBuf), "\n%d\t%d\t%d", m_pSwitchers[i].m_Status, m_pSwitchers[i].m_EndTime, m_pSwitchers[i].m_Type);
-			str_append(m_aString, aBuf, sizeof(m_aString));
-		}
-	}
-
-	return m_aString;
-}
-
-int CSaveTeam::FromString(const char *pString)
-{
-	char aTeamStats[MAX_CLIENTS];
-	char aSwitcher[64];
-	char aSaveTee[1024];
-
-	char *pCopyPos;
-	unsigned int Pos = 0;
-	unsigned int LastPos = 0;
-	unsigned int StrSize;
-
-	str_copy(m_aString, pString, sizeof(m_aString));
-
-	while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
-		Pos++;
-
-	pCopyPos = m_aString + LastPos;
-	StrSize = Pos - LastPos + 1;
-	if(m_aString[Pos] == '\n')
-	{
-		Pos++; // skip \n
-		LastPos = Pos;
-	}
-
-	if(StrSize <= 0)
-	{
-		dbg_msg("load", "savegame: wrong format (couldn't load teamstats)");
-		return 1;
-	}
-
-	if(StrSize < sizeof(aTeamStats))
-	{
-		str_copy(aTeamStats, pCopyPos, StrSize);
-		int Num = sscanf(aTeamStats, "%d\t%d\t%d\t%d\t%d", &m_TeamState, &m_MembersCount, &m_HighestSwitchNumber, &m_TeamLocked, &m_Practice);
-		switch(Num) // Don't forget to update this when you save / load more / less.
-		{
-		case 4:
-			m_Practice = false;
-			[[fallthrough]];
-		case 5:
-			break;
-		default:
-			dbg_msg("load", "failed to load teamstats");
-			dbg_msg("load", "loaded %d vars", Num);
-			return Num + 1; // never 0 here
-		}
-	}
-	else
-	{
-		dbg_msg("load", "savegame: wrong format (couldn't load teamstats, too big)");
-		return 1;
-	}
-
-	if(m_pSavedTees)
-	{
-		delete[] m_pSavedTees;
-		m_pSavedTees = 0;
-	}
-
-	if(m_MembersCount > 64)
-	{
-		dbg_msg("load", "savegame: team has too many players");
-		return 1;
-	}
-	else if(m_MembersCount)
-	{
-		m_pSavedTees = new CSaveTee[m_MembersCount];
-	}
-
-	for(int n = 0; n < m_MembersCount; n++)
-	{
-		while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
-			Pos++;
-
-		pCopyPos = m_aString + LastPos;
-		StrSize = Pos - LastPos + 1;
-		if(m_aString[Pos] == '\n')
-		{
-			Pos++; // skip \n
-			LastPos = Pos;
-		}
-
-		if(StrSize <= 0)
-		{
-			dbg_msg("load", "savegame: wrong format (couldn't load tee)");
-			return 1;
-		}
-
-		if(StrSize < sizeof(aSaveTee))
-		{
-			str_copy(aSaveTee, pCopyPos, StrSize);
-			int Num = m_pSavedTees[n].FromString(aSaveTee);
-			if(Num)
-			{
-				dbg_msg("load", "failed to load tee");
-				dbg_msg("load", "loaded %d vars", Num - 1);
-				return 1;
-			}
-		}
-		else
-		{
-			dbg_msg("load", "savegame: wrong format (couldn't load tee, too big)");
-			return 1;
-		}
-	}
-
-	if(m_pSwitchers)
-	{
-		delete[] m_pSwitchers;
-		m_pSwitchers = 0;
-	}
-
-	if(m_HighestSwitchNumber)
-		m_pSwitchers = new SSimpleSwitchers[m_HighestSwitchNumber + 1];
-
-	for(int n = 1; n < m_HighestSwitchNumber + 1; n++)
-	{
-		while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
-			Pos++;
-
-		pCopyPos = m_aString + LastPos;
-		StrSize = Pos - LastPos + 1;
-		if(m_aString[Pos] == '\n')
-		{
-			Pos++; // skip \n
-			LastPos = Pos;
-		}
-
-		if(StrSize <= 0)
-		{
-			dbg_msg("load", "savegame: wrong format (couldn't load switcher)");
-			return 1;
-		}
-
-		if(StrSize < sizeof(aSwitcher))
-		{
-			str_copy(aSwitcher, pCopyPos, StrSize);
-			int Num = sscanf(aSwitcher, "%d\t%d\t%d", &(m_pSwitchers[n].m_Status), &(m_pSwitchers[n].m_EndTime), &(m_pSwitchers[n].m_Type));
-			if(Num != 3)
-			{
-				dbg_msg("load", "failed to load switcher");
-				dbg_msg("load", "loaded %d vars", Num - 1);
-			}
-		}
-		else
-		{
-			dbg_msg("load", "savegame: wrong format (couldn't load switcher, too big)");
-			return 1;
-		}
-	}
-
-	return 0;
-}
-
 bool CSaveTeam::MatchPlayers(const char (*paNames)[MAX_NAME_LENGTH], const int *pClientID, int NumPlayer, char *pMessage, int MessageLen)
 {
 	if(NumPlayer > m_MembersCount)
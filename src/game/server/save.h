@@ -10,6 +10,8 @@ class IGameController;
 class CGameContext;
 class CCharacter;
 class CSaveTeam;
+class CSavePacker;
+class CSaveUnpacker;
 
 class CSaveTee
 {
@@ -20,6 +22,9 @@ public:
 	void Load(CCharacter *pchr, int Team, bool IsSwap = false);
 	char *GetString(const CSaveTeam *pTeam);
 	int FromString(const char *pString);
+	// binary save format, the name is stored separately
+	void Pack(CSavePacker *pPacker, const CSaveTeam *pTeam, vec2 Origin) const;
+	bool Unpack(CSaveUnpacker *pUnpacker, const char *pName, vec2 Origin);
 	void LoadHookedPlayer(const CSaveTeam *pTeam);
 	bool IsHooking() const;
 	vec2 GetPos() const { return m_Pos; }
@@ -37,6 +42,8 @@ public:
 	};
 
 private:
+	int HookedPlayerIndex(const CSaveTeam *pTeam) const;
+
 	int m_ClientID;
 
 	char m_aString[2048];
@@ -140,6 +147,9 @@ public:
 
 private:
 	CCharacter *MatchCharacter(int ClientID, int SaveID, bool KeepCurrentCharacter);
+	// returns nullptr if the save doesn't fit into m_aString
+	char *GetBinaryString();
+	int FromBinaryString(const char *pString);
 
 	IGameController *m_pController;
 
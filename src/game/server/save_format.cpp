@@ -0,0 +1,825 @@
+#include "save.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <engine/shared/compression.h>
+#include <engine/shared/config.h>
+#include <engine/shared/uuid_manager.h>
+#include <game/gamecore.h>
+
+#include <zlib.h>
+
+// The binary save format starts with this prefix, followed by the names of
+// all tees (each followed by a tab, so that the saves of a player can still be
+// found with `Savegame LIKE 'B1%\tname\t%'`) and a newline. The rest is the
+// base64 encoded payload: a flag byte, followed by the (zlib compressed)
+// variable int packed team, tee and switcher states.
+static const char s_aSaveBinaryPrefix[] = "B1\t";
+
+enum
+{
+	SAVE_BINARY_COMPRESSED = 1,
+
+	// switch numbers are a byte in the map
+	SAVE_MAX_SWITCH_NUMBER = 255,
+};
+
+class CSavePacker
+{
+public:
+	void AddInt(int Value)
+	{
+		unsigned char aBuf[CVariableInt::MAX_BYTES_PACKED];
+		unsigned char *pEnd = CVariableInt::Pack(aBuf, Value, sizeof(aBuf));
+		m_vData.insert(m_vData.end(), aBuf, pEnd);
+	}
+	void AddFloat(float Value)
+	{
+		int Bits;
+		mem_copy(&Bits, &Value, sizeof(Bits));
+		AddInt(Bits);
+	}
+	// positions are stored as integers like in the text format, relative to
+	// a nearby position
+	void AddPos(vec2 Pos, vec2 Origin)
+	{
+		AddInt((int)Pos.x - (int)Origin.x);
+		AddInt((int)Pos.y - (int)Origin.y);
+	}
+	void AddString(const char *pStr)
+	{
+		m_vData.insert(m_vData.end(), pStr, pStr + str_length(pStr) + 1);
+	}
+
+	std::vector<unsigned char> m_vData;
+};
+
+class CSaveUnpacker
+{
+public:
+	CSaveUnpacker(const unsigned char *pData, int Size) :
+		m_pCurrent(pData), m_pEnd(pData + Size) {}
+
+	int GetInt()
+	{
+		int Value = 0;
+		if(m_pCurrent >= m_pEnd)
+		{
+			m_Error = true;
+			return 0;
+		}
+		m_pCurrent = CVariableInt::Unpack(m_pCurrent, &Value, m_pEnd - m_pCurrent);
+		if(!m_pCurrent)
+		{
+			m_pCurrent = m_pEnd;
+			m_Error = true;
+		}
+		return Value;
+	}
+	float GetFloat()
+	{
+		int Bits = GetInt();
+		float Value;
+		mem_copy(&Value, &Bits, sizeof(Value));
+		return Value;
+	}
+	vec2 GetPos(vec2 Origin)
+	{
+		int x = (int)Origin.x + GetInt();
+		int y = (int)Origin.y + GetInt();
+		return vec2(x, y);
+	}
+	void GetString(char *pBuf, int BufferSize)
+	{
+		const unsigned char *pEnd = m_pCurrent;
+		while(pEnd < m_pEnd && *pEnd)
+			pEnd++;
+		if(pEnd == m_pEnd)
+		{
+			m_pCurrent = m_pEnd;
+			m_Error = true;
+			pBuf[0] = '\0';
+			return;
+		}
+		str_copy(pBuf, (const char *)m_pCurrent, BufferSize);
+		m_pCurrent = pEnd + 1;
+	}
+	bool Error() const { return m_Error; }
+
+private:
+	const unsigned char *m_pCurrent;
+	const unsigned char *m_pEnd;
+	bool m_Error = false;
+};
+
+static const char s_aBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int Base64Value(char c)
+{
+	if(c >= 'A' && c <= 'Z')
+		return c - 'A';
+	if(c >= 'a' && c <= 'z')
+		return c - 'a' + 26;
+	if(c >= '0' && c <= '9')
+		return c - '0' + 52;
+	if(c == '+')
+		return 62;
+	if(c == '/')
+		return 63;
+	return -1;
+}
+
+// returns false if the output buffer is too small
+static bool Base64Encode(const unsigned char *pData, int Size, char *pOut, int OutSize)
+{
+	if((Size + 2) / 3 * 4 + 1 > OutSize)
+		return false;
+	for(int i = 0; i < Size; i += 3)
+	{
+		unsigned Triple = pData[i] << 16;
+		if(i + 1 < Size)
+			Triple |= pData[i + 1] << 8;
+		if(i + 2 < Size)
+			Triple |= pData[i + 2];
+		*pOut++ = s_aBase64[(Triple >> 18) & 63];
+		*pOut++ = s_aBase64[(Triple >> 12) & 63];
+		*pOut++ = i + 1 < Size ? s_aBase64[(Triple >> 6) & 63] : '=';
+		*pOut++ = i + 2 < Size ? s_aBase64[Triple & 63] : '=';
+	}
+	*pOut = '\0';
+	return true;
+}
+
+// returns false on invalid input
+static bool Base64Decode(const char *pStr, std::vector<unsigned char> *pvOut)
+{
+	unsigned Bits = 0;
+	int NumBits = 0;
+	for(; *pStr && *pStr != '='; pStr++)
+	{
+		int Value = Base64Value(*pStr);
+		if(Value < 0)
+			return false;
+		Bits = (Bits << 6) | Value;
+		NumBits += 6;
+		if(NumBits >= 8)
+		{
+			NumBits -= 8;
+			pvOut->push_back((Bits >> NumBits) & 0xff);
+		}
+	}
+	return true;
+}
+
+CSaveTee::CSaveTee() = default;
+
+int CSaveTee::HookedPlayerIndex(const CSaveTeam *pTeam) const
+{
+	if(m_HookedPlayer != -1)
+	{
+		for(int n = 0; n < pTeam->GetMembersCount(); n++)
+		{
+			if(m_HookedPlayer == pTeam->m_pSavedTees[n].GetClientID())
+				return n;
+		}
+	}
+	return -1;
+}
+
+char *CSaveTee::GetString(const CSaveTeam *pTeam)
+{
+	int HookedPlayer = HookedPlayerIndex(pTeam);
+
+	str_format(m_aString, sizeof(m_aString),
+		"%s\t%d\t%d\t%d\t%d\t%d\t"
+		// weapons
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t"
+		// tee stats
+		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_EndlessJump
+		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_DDRaceState
+		"%d\t%d\t%d\t%d\t" // m_Pos.x
+		"%d\t%d\t" // m_TeleCheckpoint
+		"%d\t%d\t%f\t%f\t" // m_CorePos.x
+		"%d\t%d\t%d\t%d\t" // m_ActiveWeapon
+		"%d\t%d\t%f\t%f\t" // m_HookPos.x
+		"%d\t%d\t%d\t%d\t" // m_HookTeleBase.x
+		// time checkpoints
+		"%d\t%d\t%d\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%d\t" // m_NotEligibleForFinish
+		"%d\t%d\t%d\t" // tele weapons
+		"%s\t" // m_aGameUuid
+		"%d\t%d\t" // m_HookedPlayer, m_NewHook
+		"%d\t%d\t%d\t%d\t" // input stuff
+		"%d\t" // m_ReloadTimer
+		"%d\t" // m_TeeStarted
+		"%d", // m_LiveFreeze
+		m_aName, m_Alive, m_Paused, m_NeededFaketuning, m_TeeFinished, m_IsSolo,
+		// weapons
+		m_aWeapons[0].m_AmmoRegenStart, m_aWeapons[0].m_Ammo, m_aWeapons[0].m_Ammocost, m_aWeapons[0].m_Got,
+		m_aWeapons[1].m_AmmoRegenStart, m_aWeapons[1].m_Ammo, m_aWeapons[1].m_Ammocost, m_aWeapons[1].m_Got,
+		m_aWeapons[2].m_AmmoRegenStart, m_aWeapons[2].m_Ammo, m_aWeapons[2].m_Ammocost, m_aWeapons[2].m_Got,
+		m_aWeapons[3].m_AmmoRegenStart, m_aWeapons[3].m_Ammo, m_aWeapons[3].m_Ammocost, m_aWeapons[3].m_Got,
+		m_aWeapons[4].m_AmmoRegenStart, m_aWeapons[4].m_Ammo, m_aWeapons[4].m_Ammocost, m_aWeapons[4].m_Got,
+		m_aWeapons[5].m_AmmoRegenStart, m_aWeapons[5].m_Ammo, m_aWeapons[5].m_Ammocost, m_aWeapons[5].m_Got,
+		m_LastWeapon, m_QueuedWeapon,
+		// tee states
+		m_EndlessJump, m_Jetpack, m_NinjaJetpack, m_FreezeTime, m_FreezeStart, m_DeepFrozen, m_EndlessHook,
+		m_DDRaceState, m_HitDisabledFlags, m_CollisionEnabled, m_TuneZone, m_TuneZoneOld, m_HookHitEnabled, m_Time,
+		(int)m_Pos.x, (int)m_Pos.y, (int)m_PrevPos.x, (int)m_PrevPos.y,
+		m_TeleCheckpoint, m_LastPenalty,
+		(int)m_CorePos.x, (int)m_CorePos.y, m_Vel.x, m_Vel.y,
+		m_ActiveWeapon, m_Jumped, m_JumpedTotal, m_Jumps,
+		(int)m_HookPos.x, (int)m_HookPos.y, m_HookDir.x, m_HookDir.y,
+		(int)m_HookTeleBase.x, (int)m_HookTeleBase.y, m_HookTick, m_HookState,
+		// time checkpoints
+		m_TimeCpBroadcastEndTime, m_LastTimeCp, m_LastTimeCpBroadcasted,
+		m_aCurrentTimeCp[0], m_aCurrentTimeCp[1], m_aCurrentTimeCp[2], m_aCurrentTimeCp[3], m_aCurrentTimeCp[4],
+		m_aCurrentTimeCp[5], m_aCurrentTimeCp[6], m_aCurrentTimeCp[7], m_aCurrentTimeCp[8], m_aCurrentTimeCp[9],
+		m_aCurrentTimeCp[10], m_aCurrentTimeCp[11], m_aCurrentTimeCp[12], m_aCurrentTimeCp[13], m_aCurrentTimeCp[14],
+		m_aCurrentTimeCp[15], m_aCurrentTimeCp[16], m_aCurrentTimeCp[17], m_aCurrentTimeCp[18], m_aCurrentTimeCp[19],
+		m_aCurrentTimeCp[20], m_aCurrentTimeCp[21], m_aCurrentTimeCp[22], m_aCurrentTimeCp[23], m_aCurrentTimeCp[24],
+		m_NotEligibleForFinish,
+		m_HasTelegunGun, m_HasTelegunLaser, m_HasTelegunGrenade,
+		m_aGameUuid,
+		HookedPlayer, m_NewHook,
+		m_InputDirection, m_InputJump, m_InputFire, m_InputHook,
+		m_ReloadTimer,
+		m_TeeStarted,
+		m_LiveFrozen);
+	return m_aString;
+}
+
+int CSaveTee::FromString(const char *pString)
+{
+	int Num;
+	Num = sscanf(pString,
+		"%[^\t]\t%d\t%d\t%d\t%d\t%d\t"
+		// weapons
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t%d\t%d\t"
+		"%d\t%d\t"
+		// tee states
+		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_EndlessJump
+		"%d\t%d\t%d\t%d\t%d\t%d\t%d\t" // m_DDRaceState
+		"%f\t%f\t%f\t%f\t" // m_Pos.x
+		"%d\t%d\t" // m_TeleCheckpoint
+		"%f\t%f\t%f\t%f\t" // m_CorePos.x
+		"%d\t%d\t%d\t%d\t" // m_ActiveWeapon
+		"%f\t%f\t%f\t%f\t" // m_HookPos.x
+		"%f\t%f\t%d\t%d\t" // m_HookTeleBase.x
+		// time checkpoints
+		"%d\t%d\t%d\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%f\t%f\t%f\t%f\t%f\t"
+		"%d\t" // m_NotEligibleForFinish
+		"%d\t%d\t%d\t" // tele weapons
+		"%36s\t" // m_aGameUuid
+		"%d\t%d\t" // m_HookedPlayer, m_NewHook
+		"%d\t%d\t%d\t%d\t" // input stuff
+		"%d\t" // m_ReloadTimer
+		"%d\t" // m_TeeStarted
+		"%d", // m_LiveFreeze
+		m_aName, &m_Alive, &m_Paused, &m_NeededFaketuning, &m_TeeFinished, &m_IsSolo,
+		// weapons
+		&m_aWeapons[0].m_AmmoRegenStart, &m_aWeapons[0].m_Ammo, &m_aWeapons[0].m_Ammocost, &m_aWeapons[0].m_Got,
+		&m_aWeapons[1].m_AmmoRegenStart, &m_aWeapons[1].m_Ammo, &m_aWeapons[1].m_Ammocost, &m_aWeapons[1].m_Got,
+		&m_aWeapons[2].m_AmmoRegenStart, &m_aWeapons[2].m_Ammo, &m_aWeapons[2].m_Ammocost, &m_aWeapons[2].m_Got,
+		&m_aWeapons[3].m_AmmoRegenStart, &m_aWeapons[3].m_Ammo, &m_aWeapons[3].m_Ammocost, &m_aWeapons[3].m_Got,
+		&m_aWeapons[4].m_AmmoRegenStart, &m_aWeapons[4].m_Ammo, &m_aWeapons[4].m_Ammocost, &m_aWeapons[4].m_Got,
+		&m_aWeapons[5].m_AmmoRegenStart, &m_aWeapons[5].m_Ammo, &m_aWeapons[5].m_Ammocost, &m_aWeapons[5].m_Got,
+		&m_LastWeapon, &m_QueuedWeapon,
+		// tee states
+		&m_EndlessJump, &m_Jetpack, &m_NinjaJetpack, &m_FreezeTime, &m_FreezeStart, &m_DeepFrozen, &m_EndlessHook,
+		&m_DDRaceState, &m_HitDisabledFlags, &m_CollisionEnabled, &m_TuneZone, &m_TuneZoneOld, &m_HookHitEnabled, &m_Time,
+		&m_Pos.x, &m_Pos.y, &m_PrevPos.x, &m_PrevPos.y,
+		&m_TeleCheckpoint, &m_LastPenalty,
+		&m_CorePos.x, &m_CorePos.y, &m_Vel.x, &m_Vel.y,
+		&m_ActiveWeapon, &m_Jumped, &m_JumpedTotal, &m_Jumps,
+		&m_HookPos.x, &m_HookPos.y, &m_HookDir.x, &m_HookDir.y,
+		&m_HookTeleBase.x, &m_HookTeleBase.y, &m_HookTick, &m_HookState,
+		// time checkpoints
+		&m_TimeCpBroadcastEndTime, &m_LastTimeCp, &m_LastTimeCpBroadcasted,
+		&m_aCurrentTimeCp[0], &m_aCurrentTimeCp[1], &m_aCurrentTimeCp[2], &m_aCurrentTimeCp[3], &m_aCurrentTimeCp[4],
+		&m_aCurrentTimeCp[5], &m_aCurrentTimeCp[6], &m_aCurrentTimeCp[7], &m_aCurrentTimeCp[8], &m_aCurrentTimeCp[9],
+		&m_aCurrentTimeCp[10], &m_aCurrentTimeCp[11], &m_aCurrentTimeCp[12], &m_aCurrentTimeCp[13], &m_aCurrentTimeCp[14],
+		&m_aCurrentTimeCp[15], &m_aCurrentTimeCp[16], &m_aCurrentTimeCp[17], &m_aCurrentTimeCp[18], &m_aCurrentTimeCp[19],
+		&m_aCurrentTimeCp[20], &m_aCurrentTimeCp[21], &m_aCurrentTimeCp[22], &m_aCurrentTimeCp[23], &m_aCurrentTimeCp[24],
+		&m_NotEligibleForFinish,
+		&m_HasTelegunGun, &m_HasTelegunLaser, &m_HasTelegunGrenade,
+		m_aGameUuid,
+		&m_HookedPlayer, &m_NewHook,
+		&m_InputDirection, &m_InputJump, &m_InputFire, &m_InputHook,
+		&m_ReloadTimer,
+		&m_TeeStarted,
+		&m_LiveFrozen);
+	switch(Num) // Don't forget to update this when you save / load more / less.
+	{
+	case 96:
+		m_NotEligibleForFinish = false;
+		[[fallthrough]];
+	case 97:
+		m_HasTelegunGrenade = 0;
+		m_HasTelegunLaser = 0;
+		m_HasTelegunGun = 0;
+		FormatUuid(CalculateUuid("game-uuid-nonexistent@ddnet.tw"), m_aGameUuid, sizeof(m_aGameUuid));
+		[[fallthrough]];
+	case 101:
+		m_HookedPlayer = -1;
+		m_NewHook = false;
+		if(m_HookState == HOOK_GRABBED)
+			m_HookState = HOOK_FLYING;
+		m_InputDirection = 0;
+		m_InputJump = 0;
+		m_InputFire = 0;
+		m_InputHook = 0;
+		m_ReloadTimer = 0;
+		[[fallthrough]];
+	case 108:
+		m_TeeStarted = true;
+		[[fallthrough]];
+	case 109:
+		m_LiveFrozen = false;
+		[[fallthrough]];
+	case 110:
+		return 0;
+	default:
+		dbg_msg("load", "failed to load tee-string");
+		dbg_msg("load", "loaded %d vars", Num);
+		return maximum(Num, 0) + 1; // never 0 here, also not for empty strings
+	}
+}
+
+void CSaveTee::Pack(CSavePacker *pPacker, const CSaveTeam *pTeam, vec2 Origin) const
+{
+	const int aInts[] = {
+		m_Alive, m_Paused, m_NeededFaketuning, m_TeeFinished, m_IsSolo,
+		m_LastWeapon, m_QueuedWeapon,
+		m_EndlessJump, m_Jetpack, m_NinjaJetpack, m_FreezeTime, m_FreezeStart, m_DeepFrozen, m_EndlessHook,
+		m_DDRaceState, m_HitDisabledFlags, m_CollisionEnabled, m_TuneZone, m_TuneZoneOld, m_HookHitEnabled, m_Time,
+		m_TeleCheckpoint, m_LastPenalty,
+		m_ActiveWeapon, m_Jumped, m_JumpedTotal, m_Jumps,
+		m_HookTick, m_HookState,
+		m_TimeCpBroadcastEndTime, m_LastTimeCp, m_LastTimeCpBroadcasted,
+		m_NotEligibleForFinish,
+		m_HasTelegunGun, m_HasTelegunLaser, m_HasTelegunGrenade,
+		HookedPlayerIndex(pTeam), m_NewHook,
+		m_InputDirection, m_InputJump, m_InputFire, m_InputHook,
+		m_ReloadTimer,
+		m_TeeStarted,
+		m_LiveFrozen};
+	for(int Value : aInts)
+		pPacker->AddInt(Value);
+	for(const auto &Weapon : m_aWeapons)
+	{
+		pPacker->AddInt(Weapon.m_AmmoRegenStart);
+		pPacker->AddInt(Weapon.m_Ammo);
+		pPacker->AddInt(Weapon.m_Ammocost);
+		pPacker->AddInt(Weapon.m_Got);
+	}
+
+	// the other positions are close to the tee
+	pPacker->AddPos(m_Pos, Origin);
+	pPacker->AddPos(m_PrevPos, m_Pos);
+	pPacker->AddPos(m_CorePos, m_Pos);
+	pPacker->AddPos(m_HookPos, m_CorePos);
+	pPacker->AddPos(m_HookTeleBase, m_CorePos);
+
+	pPacker->AddFloat(m_Vel.x);
+	pPacker->AddFloat(m_Vel.y);
+	pPacker->AddFloat(m_HookDir.x);
+	pPacker->AddFloat(m_HookDir.y);
+	for(float TimeCp : m_aCurrentTimeCp)
+		pPacker->AddFloat(TimeCp);
+	pPacker->AddString(m_aGameUuid);
+}
+
+bool CSaveTee::Unpack(CSaveUnpacker *pUnpacker, const char *pName, vec2 Origin)
+{
+	str_copy(m_aName, pName, sizeof(m_aName));
+	int *apInts[] = {
+		&m_Alive, &m_Paused, &m_NeededFaketuning, &m_TeeFinished, &m_IsSolo,
+		&m_LastWeapon, &m_QueuedWeapon,
+		&m_EndlessJump, &m_Jetpack, &m_NinjaJetpack, &m_FreezeTime, &m_FreezeStart, &m_DeepFrozen, &m_EndlessHook,
+		&m_DDRaceState, &m_HitDisabledFlags, &m_CollisionEnabled, &m_TuneZone, &m_TuneZoneOld, &m_HookHitEnabled, &m_Time,
+		&m_TeleCheckpoint, &m_LastPenalty,
+		&m_ActiveWeapon, &m_Jumped, &m_JumpedTotal, &m_Jumps,
+		&m_HookTick, &m_HookState,
+		&m_TimeCpBroadcastEndTime, &m_LastTimeCp, &m_LastTimeCpBroadcasted,
+		&m_NotEligibleForFinish,
+		&m_HasTelegunGun, &m_HasTelegunLaser, &m_HasTelegunGrenade,
+		&m_HookedPlayer, &m_NewHook,
+		&m_InputDirection, &m_InputJump, &m_InputFire, &m_InputHook,
+		&m_ReloadTimer,
+		&m_TeeStarted,
+		&m_LiveFrozen};
+	for(int *pValue : apInts)
+		*pValue = pUnpacker->GetInt();
+	for(auto &Weapon : m_aWeapons)
+	{
+		Weapon.m_AmmoRegenStart = pUnpacker->GetInt();
+		Weapon.m_Ammo = pUnpacker->GetInt();
+		Weapon.m_Ammocost = pUnpacker->GetInt();
+		Weapon.m_Got = pUnpacker->GetInt();
+	}
+
+	m_Pos = pUnpacker->GetPos(Origin);
+	m_PrevPos = pUnpacker->GetPos(m_Pos);
+	m_CorePos = pUnpacker->GetPos(m_Pos);
+	m_HookPos = pUnpacker->GetPos(m_CorePos);
+	m_HookTeleBase = pUnpacker->GetPos(m_CorePos);
+
+	m_Vel.x = pUnpacker->GetFloat();
+	m_Vel.y = pUnpacker->GetFloat();
+	m_HookDir.x = pUnpacker->GetFloat();
+	m_HookDir.y = pUnpacker->GetFloat();
+	for(float &TimeCp : m_aCurrentTimeCp)
+		TimeCp = pUnpacker->GetFloat();
+	pUnpacker->GetString(m_aGameUuid, sizeof(m_aGameUuid));
+	return !pUnpacker->Error();
+}
+
+void CSaveTee::LoadHookedPlayer(const CSaveTeam *pTeam)
+{
+	if(m_HookedPlayer == -1)
+		return;
+	m_HookedPlayer = pTeam->m_pSavedTees[m_HookedPlayer].GetClientID();
+}
+
+CSaveTeam::CSaveTeam(IGameController *pController)
+{
+	m_pController = pController;
+	m_pSwitchers = 0;
+	m_pSavedTees = 0;
+}
+
+CSaveTeam::~CSaveTeam()
+{
+	delete[] m_pSwitchers;
+	delete[] m_pSavedTees;
+}
+
+char *CSaveTeam::GetString()
+{
+	if(g_Config.m_SvSaveBinary)
+	{
+		char *pString = GetBinaryString();
+		if(pString)
+			return pString;
+		dbg_msg("save", "binary savegame too big, falling back to the text format");
+	}
+
+	str_format(m_aString, sizeof(m_aString), "%d\t%d\t%d\t%d\t%d", m_TeamState, m_MembersCount, m_HighestSwitchNumber, m_TeamLocked, m_Practice);
+
+	for(int i = 0; i < m_MembersCount; i++)
+	{
+		char aBuf[1024];
+		str_format(aBuf, sizeof(aBuf), "\n%s", m_pSavedTees[i].GetString(this));
+		str_append(m_aString, aBuf, sizeof(m_aString));
+	}
+
+	if(m_pSwitchers && m_HighestSwitchNumber)
+	{
+		for(int i = 1; i < m_HighestSwitchNumber + 1; i++)
+		{
+			char aBuf[64];
+			str_format(aBuf, sizeof(aBuf), "\n%d\t%d\t%d", m_pSwitchers[i].m_Status, m_pSwitchers[i].m_EndTime, m_pSwitchers[i].m_Type);
+			str_append(m_aString, aBuf, sizeof(m_aString));
+		}
+	}
+
+	return m_aString;
+}
+
+char *CSaveTeam::GetBinaryString()
+{
+	str_copy(m_aString, s_aSaveBinaryPrefix, sizeof(m_aString));
+	for(int i = 0; i < m_MembersCount; i++)
+	{
+		str_append(m_aString, m_pSavedTees[i].GetName(), sizeof(m_aString));
+		str_append(m_aString, "\t", sizeof(m_aString));
+	}
+	str_append(m_aString, "\n", sizeof(m_aString));
+
+	CSavePacker Packer;
+	Packer.AddInt(m_TeamState);
+	Packer.AddInt(m_MembersCount);
+	Packer.AddInt(m_HighestSwitchNumber);
+	Packer.AddInt(m_TeamLocked);
+	Packer.AddInt(m_Practice);
+	vec2 Origin(0, 0);
+	for(int i = 0; i < m_MembersCount; i++)
+	{
+		// tees of a team are usually close to each other
+		m_pSavedTees[i].Pack(&Packer, this, Origin);
+		Origin = m_pSavedTees[i].GetPos();
+	}
+	if(m_pSwitchers && m_HighestSwitchNumber)
+	{
+		for(int i = 1; i < m_HighestSwitchNumber + 1; i++)
+		{
+			Packer.AddInt(m_pSwitchers[i].m_Status);
+			Packer.AddInt(m_pSwitchers[i].m_EndTime);
+			Packer.AddInt(m_pSwitchers[i].m_Type);
+		}
+	}
+
+	std::vector<unsigned char> vPayload(1 + CVariableInt::MAX_BYTES_PACKED + compressBound(Packer.m_vData.size()));
+	uLongf CompressedSize = vPayload.size() - 1 - CVariableInt::MAX_BYTES_PACKED;
+	unsigned char *pSizeEnd = CVariableInt::Pack(&vPayload[1], Packer.m_vData.size(), CVariableInt::MAX_BYTES_PACKED);
+	if(compress2(pSizeEnd, &CompressedSize, Packer.m_vData.data(), Packer.m_vData.size(), Z_BEST_COMPRESSION) == Z_OK &&
+		(pSizeEnd - vPayload.data()) + CompressedSize < 1 + Packer.m_vData.size())
+	{
+		vPayload[0] = SAVE_BINARY_COMPRESSED;
+		vPayload.resize((pSizeEnd - vPayload.data()) + CompressedSize);
+	}
+	else
+	{
+		vPayload[0] = 0;
+		vPayload.resize(1);
+		vPayload.insert(vPayload.end(), Packer.m_vData.begin(), Packer.m_vData.end());
+	}
+
+	int Length = str_length(m_aString);
+	if(!Base64Encode(vPayload.data(), vPayload.size(), m_aString + Length, sizeof(m_aString) - Length))
+		return nullptr;
+	return m_aString;
+}
+
+int CSaveTeam::FromBinaryString(const char *pString)
+{
+	pString += str_length(s_aSaveBinaryPrefix);
+	const char *pPayload = str_find(pString, "\n");
+	if(!pPayload)
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't find binary payload)");
+		return 1;
+	}
+
+	// names of the tees
+	std::vector<std::string> vNames;
+	while(pString < pPayload)
+	{
+		const char *pEnd = str_find(pString, "\t");
+		if(!pEnd || pEnd > pPayload)
+			break;
+		vNames.emplace_back(pString, pEnd - pString);
+		pString = pEnd + 1;
+	}
+
+	std::vector<unsigned char> vPayload;
+	if(!Base64Decode(pPayload + 1, &vPayload) || vPayload.empty())
+	{
+		dbg_msg("load", "savegame: wrong format (invalid binary payload)");
+		return 1;
+	}
+	std::vector<unsigned char> vData;
+	if(vPayload[0] & SAVE_BINARY_COMPRESSED)
+	{
+		int Size;
+		const unsigned char *pCompressed = CVariableInt::Unpack(&vPayload[1], &Size, vPayload.size() - 1);
+		if(!pCompressed || Size < 0 || Size > (int)sizeof(m_aString) * 4)
+		{
+			dbg_msg("load", "savegame: wrong format (invalid binary payload size)");
+			return 1;
+		}
+		vData.resize(Size);
+		uLongf DataSize = Size;
+		if(uncompress(vData.data(), &DataSize, pCompressed, vPayload.size() - (pCompressed - vPayload.data())) != Z_OK || DataSize != (uLongf)Size)
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't decompress binary payload)");
+			return 1;
+		}
+	}
+	else
+	{
+		vData.assign(vPayload.begin() + 1, vPayload.end());
+	}
+
+	CSaveUnpacker Unpacker(vData.data(), vData.size());
+	m_TeamState = Unpacker.GetInt();
+	m_MembersCount = Unpacker.GetInt();
+	m_HighestSwitchNumber = Unpacker.GetInt();
+	m_TeamLocked = Unpacker.GetInt();
+	m_Practice = Unpacker.GetInt();
+	if(Unpacker.Error() || m_MembersCount < 0 || m_MembersCount != (int)vNames.size() || m_HighestSwitchNumber < 0 || m_HighestSwitchNumber > SAVE_MAX_SWITCH_NUMBER)
+	{
+		dbg_msg("load", "failed to load teamstats");
+		return 1;
+	}
+	if(m_MembersCount > 64)
+	{
+		dbg_msg("load", "savegame: team has too many players");
+		return 1;
+	}
+
+	delete[] m_pSavedTees;
+	m_pSavedTees = m_MembersCount ? new CSaveTee[m_MembersCount] : nullptr;
+	vec2 Origin(0, 0);
+	for(int n = 0; n < m_MembersCount; n++)
+	{
+		if(!m_pSavedTees[n].Unpack(&Unpacker, vNames[n].c_str(), Origin))
+		{
+			dbg_msg("load", "failed to load tee");
+			return 1;
+		}
+		Origin = m_pSavedTees[n].GetPos();
+	}
+
+	delete[] m_pSwitchers;
+	m_pSwitchers = m_HighestSwitchNumber ? new SSimpleSwitchers[m_HighestSwitchNumber + 1] : nullptr;
+	for(int n = 1; n < m_HighestSwitchNumber + 1; n++)
+	{
+		m_pSwitchers[n].m_Status = Unpacker.GetInt();
+		m_pSwitchers[n].m_EndTime = Unpacker.GetInt();
+		m_pSwitchers[n].m_Type = Unpacker.GetInt();
+	}
+	if(Unpacker.Error())
+	{
+		dbg_msg("load", "failed to load switcher");
+		return 1;
+	}
+	return 0;
+}
+
+int CSaveTeam::FromString(const char *pString)
+{
+	if(str_startswith(pString, s_aSaveBinaryPrefix))
+		return FromBinaryString(pString);
+
+	char aTeamStats[MAX_CLIENTS];
+	char aSwitcher[64];
+	char aSaveTee[1024];
+
+	char *pCopyPos;
+	unsigned int Pos = 0;
+	unsigned int LastPos = 0;
+	unsigned int StrSize;
+
+	str_copy(m_aString, pString, sizeof(m_aString));
+
+	while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
+		Pos++;
+
+	pCopyPos = m_aString + LastPos;
+	StrSize = Pos - LastPos + 1;
+	if(m_aString[Pos] == '\n')
+	{
+		Pos++; // skip \n
+		LastPos = Pos;
+	}
+
+	if(StrSize <= 0)
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load teamstats)");
+		return 1;
+	}
+
+	if(StrSize < sizeof(aTeamStats))
+	{
+		str_copy(aTeamStats, pCopyPos, StrSize);
+		int Num = sscanf(aTeamStats, "%d\t%d\t%d\t%d\t%d", &m_TeamState, &m_MembersCount, &m_HighestSwitchNumber, &m_TeamLocked, &m_Practice);
+		switch(Num) // Don't forget to update this when you save / load more / less.
+		{
+		case 4:
+			m_Practice = false;
+			[[fallthrough]];
+		case 5:
+			break;
+		default:
+			dbg_msg("load", "failed to load teamstats");
+			dbg_msg("load", "loaded %d vars", Num);
+			return maximum(Num, 0) + 1; // never 0 here, also not for empty strings
+		}
+	}
+	else
+	{
+		dbg_msg("load", "savegame: wrong format (couldn't load teamstats, too big)");
+		return 1;
+	}
+
+	if(m_HighestSwitchNumber < 0 || m_HighestSwitchNumber > SAVE_MAX_SWITCH_NUMBER)
+	{
+		dbg_msg("load", "savegame: wrong format (invalid switch number)");
+		return 1;
+	}
+
+	if(m_pSavedTees)
+	{
+		delete[] m_pSavedTees;
+		m_pSavedTees = 0;
+	}
+
+	if(m_MembersCount > 64)
+	{
+		dbg_msg("load", "savegame: team has too many players");
+		return 1;
+	}
+	else if(m_MembersCount)
+	{
+		m_pSavedTees = new CSaveTee[m_MembersCount];
+	}
+
+	for(int n = 0; n < m_MembersCount; n++)
+	{
+		while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
+			Pos++;
+
+		pCopyPos = m_aString + LastPos;
+		StrSize = Pos - LastPos + 1;
+		if(m_aString[Pos] == '\n')
+		{
+			Pos++; // skip \n
+			LastPos = Pos;
+		}
+
+		if(StrSize <= 0)
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load tee)");
+			return 1;
+		}
+
+		if(StrSize < sizeof(aSaveTee))
+		{
+			str_copy(aSaveTee, pCopyPos, StrSize);
+			int Num = m_pSavedTees[n].FromString(aSaveTee);
+			if(Num)
+			{
+				dbg_msg("load", "failed to load tee");
+				dbg_msg("load", "loaded %d vars", Num - 1);
+				return 1;
+			}
+		}
+		else
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load tee, too big)");
+			return 1;
+		}
+	}
+
+	if(m_pSwitchers)
+	{
+		delete[] m_pSwitchers;
+		m_pSwitchers = 0;
+	}
+
+	if(m_HighestSwitchNumber)
+		m_pSwitchers = new SSimpleSwitchers[m_HighestSwitchNumber + 1];
+
+	for(int n = 1; n < m_HighestSwitchNumber + 1; n++)
+	{
+		while(m_aString[Pos] != '\n' && Pos < sizeof(m_aString) && m_aString[Pos]) // find next \n or \0
+			Pos++;
+
+		pCopyPos = m_aString + LastPos;
+		StrSize = Pos - LastPos + 1;
+		if(m_aString[Pos] == '\n')
+		{
+			Pos++; // skip \n
+			LastPos = Pos;
+		}
+
+		if(StrSize <= 0)
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load switcher)");
+			return 1;
+		}
+
+		if(StrSize < sizeof(aSwitcher))
+		{
+			str_copy(aSwitcher, pCopyPos, StrSize);
+			int Num = sscanf(aSwitcher, "%d\t%d\t%d", &(m_pSwitchers[n].m_Status), &(m_pSwitchers[n].m_EndTime), &(m_pSwitchers[n].m_Type));
+			if(Num != 3)
+			{
+				dbg_msg("load", "failed to load switcher");
+				dbg_msg("load", "loaded %d vars", Num - 1);
+			}
+		}
+		else
+		{
+			dbg_msg("load", "savegame: wrong format (couldn't load switcher, too big)");
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -111,6 +111,10 @@ CScore::CScore(CGameContext *pGameServer, CDbConnectionPool *pPool) :
 	}
 
 	m_pPool->Execute(CScoreWorker::Init, std::move(Tmp), "load best time");
+
+	m_pPool->RegisterSpill("save score", CScoreWorker::SaveScore, CSqlScoreData::Unspill);
+	m_pPool->RegisterSpill("save team score", CScoreWorker::SaveTeamScore, CSqlTeamScoreData::Unspill);
+	m_pPool->ReplaySpill();
 }
 
 void CScore::LoadPlayerData(int ClientID, const char *pName)
@@ -5,6 +5,7 @@
 #include <engine/server/databases/connection_pool.h>
 #include <engine/server/sql_string_helpers.h>
 #include <engine/shared/config.h>
+#include <engine/shared/packer.h>
 
 #include <cmath>
 
@@ -14,6 +15,114 @@ static const CUuid UUID_NO_SAVE_ID =
 	{{0x6b, 0x40, 0x7e, 0x81, 0x8b, 0x77, 0x3e, 0x04,
 		0xa2, 0x07, 0x8d, 0xa1, 0x7f, 0x37, 0xd0, 0x00}};
 
+CScoreMessages &CScoreMessages::Line(const char *pFormat)
+{
+	m_vLines.push_back({pFormat, (int)m_vFields.size()});
+	return *this;
+}
+
+CScoreMessages &CScoreMessages::Int(int Value)
+{
+	m_vFields.push_back(FIELD_INT);
+	m_vFields.insert(m_vFields.end(), (const char *)&Value, (const char *)&Value + sizeof(Value));
+	return *this;
+}
+
+CScoreMessages &CScoreMessages::Time(float Time)
+{
+	m_vFields.push_back(FIELD_TIME);
+	m_vFields.insert(m_vFields.end(), (const char *)&Time, (const char *)&Time + sizeof(Time));
+	return *this;
+}
+
+CScoreMessages &CScoreMessages::Str(const char *pStr)
+{
+	m_vFields.push_back(FIELD_STR);
+	m_vFields.insert(m_vFields.end(), pStr, pStr + str_length(pStr) + 1);
+	return *this;
+}
+
+void CScoreMessages::Clear()
+{
+	m_vLines.clear();
+	m_vFields.clear();
+}
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+void CScoreMessages::Render(int Line, char *pBuf, int BufferSize) const
+{
+	dbg_assert(0 <= Line && Line < Num(), "score message line out of range");
+	const char *pFormat = m_vLines[Line].m_pFormat;
+	const char *pField = m_vFields.data() + m_vLines[Line].m_FieldsOffset;
+	const char *pFieldsEnd = m_vFields.data() + m_vFields.size();
+
+	pBuf[0] = '\0';
+	int Length = 0;
+	char aValue[512];
+	while(*pFormat && Length < BufferSize - 1)
+	{
+		if(*pFormat != '%')
+		{
+			pBuf[Length++] = *pFormat++;
+			continue;
+		}
+		if(pFormat[1] == '%')
+		{
+			pBuf[Length++] = '%';
+			pFormat += 2;
+			continue;
+		}
+
+		// copy the conversion specification, e.g. "%02d", to apply it to the field
+		char aSpec[16];
+		int SpecLength = 0;
+		aSpec[SpecLength++] = *pFormat++;
+		while(*pFormat && *pFormat != 'd' && *pFormat != 's' && SpecLength < (int)sizeof(aSpec) - 2)
+			aSpec[SpecLength++] = *pFormat++;
+		dbg_assert(*pFormat == 'd' || *pFormat == 's', "unsupported conversion in score message");
+		aSpec[SpecLength++] = *pFormat++;
+		aSpec[SpecLength] = '\0';
+
+		dbg_assert(pField < pFieldsEnd, "missing field for score message");
+		switch(*pField++)
+		{
+		case FIELD_INT:
+		{
+			int Value;
+			mem_copy(&Value, pField, sizeof(Value));
+			pField += sizeof(Value);
+			str_format(aValue, sizeof(aValue), aSpec, Value);
+			break;
+		}
+		case FIELD_TIME:
+		{
+			float Time;
+			mem_copy(&Time, pField, sizeof(Time));
+			pField += sizeof(Time);
+			char aTime[32];
+			str_time_float(Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
+			str_format(aValue, sizeof(aValue), aSpec, aTime);
+			break;
+		}
+		case FIELD_STR:
+			str_format(aValue, sizeof(aValue), aSpec, pField);
+			pField += str_length(pField) + 1;
+			break;
+		default:
+			dbg_assert(false, "invalid score message field");
+		}
+		str_copy(pBuf + Length, aValue, BufferSize - Length);
+		Length += str_length(pBuf + Length);
+	}
+	pBuf[Length] = '\0';
+}
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
 CScorePlayerResult::CScorePlayerResult()
 {
 	SetVariant(Variant::DIRECT);
@@ -22,12 +131,11 @@ CScorePlayerResult::CScorePlayerResult()
 void CScorePlayerResult::SetVariant(Variant v)
 {
 	m_MessageKind = v;
+	m_Messages.Clear();
 	switch(v)
 	{
 	case DIRECT:
 	case ALL:
-		for(auto &aMessage : m_Data.m_aaMessages)
-			aMessage[0] = 0;
 		break;
 	case BROADCAST:
 		m_Data.m_aBroadcast[0] = 0;
@@ -72,6 +180,87 @@ void CScorePlayerResult::SetVariant(Variant v)
 	}
 }
 
+static void AddFloat(CPacker *pPacker, float Value)
+{
+	int Bits;
+	mem_copy(&Bits, &Value, sizeof(Bits));
+	pPacker->AddInt(Bits);
+}
+
+static float GetFloat(CUnpacker *pUnpacker)
+{
+	int Bits = pUnpacker->GetInt();
+	float Value;
+	mem_copy(&Value, &Bits, sizeof(Value));
+	return Value;
+}
+
+bool CSqlScoreData::Spill(CPacker *pPacker) const
+{
+	pPacker->AddString(m_aMap, sizeof(m_aMap));
+	pPacker->AddString(m_aGameUuid, sizeof(m_aGameUuid));
+	pPacker->AddString(m_aName, sizeof(m_aName));
+	pPacker->AddInt(m_ClientID);
+	AddFloat(pPacker, m_Time);
+	pPacker->AddString(m_aTimestamp, sizeof(m_aTimestamp));
+	for(float TimeCp : m_aCurrentTimeCp)
+		AddFloat(pPacker, TimeCp);
+	pPacker->AddString(m_aRequestingPlayer, sizeof(m_aRequestingPlayer));
+	return true;
+}
+
+std::unique_ptr<const ISqlData> CSqlScoreData::Unspill(CUnpacker *pUnpacker)
+{
+	auto pData = std::make_unique<CSqlScoreData>(std::make_shared<CScorePlayerResult>());
+	str_copy(pData->m_aMap, pUnpacker->GetString(0), sizeof(pData->m_aMap));
+	str_copy(pData->m_aGameUuid, pUnpacker->GetString(0), sizeof(pData->m_aGameUuid));
+	str_copy(pData->m_aName, pUnpacker->GetString(0), sizeof(pData->m_aName));
+	pData->m_ClientID = pUnpacker->GetInt();
+	pData->m_Time = GetFloat(pUnpacker);
+	str_copy(pData->m_aTimestamp, pUnpacker->GetString(0), sizeof(pData->m_aTimestamp));
+	for(float &TimeCp : pData->m_aCurrentTimeCp)
+		TimeCp = GetFloat(pUnpacker);
+	str_copy(pData->m_aRequestingPlayer, pUnpacker->GetString(0), sizeof(pData->m_aRequestingPlayer));
+	pData->m_Num = 0;
+	pData->m_Search = false;
+	if(pUnpacker->Error())
+		return nullptr;
+	return pData;
+}
+
+bool CSqlTeamScoreData::Spill(CPacker *pPacker) const
+{
+	pPacker->AddString(m_aGameUuid, sizeof(m_aGameUuid));
+	pPacker->AddString(m_aMap, sizeof(m_aMap));
+	AddFloat(pPacker, m_Time);
+	pPacker->AddString(m_aTimestamp, sizeof(m_aTimestamp));
+	pPacker->AddInt(m_Size);
+	for(unsigned int i = 0; i < m_Size; i++)
+		pPacker->AddString(m_aaNames[i], sizeof(m_aaNames[i]));
+	pPacker->AddRaw(&m_TeamrankUuid, sizeof(m_TeamrankUuid));
+	return true;
+}
+
+std::unique_ptr<const ISqlData> CSqlTeamScoreData::Unspill(CUnpacker *pUnpacker)
+{
+	auto pData = std::make_unique<CSqlTeamScoreData>();
+	str_copy(pData->m_aGameUuid, pUnpacker->GetString(0), sizeof(pData->m_aGameUuid));
+	str_copy(pData->m_aMap, pUnpacker->GetString(0), sizeof(pData->m_aMap));
+	pData->m_Time = GetFloat(pUnpacker);
+	str_copy(pData->m_aTimestamp, pUnpacker->GetString(0), sizeof(pData->m_aTimestamp));
+	int Size = pUnpacker->GetInt();
+	if(Size < 0 || Size > MAX_CLIENTS)
+		return nullptr;
+	pData->m_Size = Size;
+	for(int i = 0; i < Size; i++)
+		str_copy(pData->m_aaNames[i], pUnpacker->GetString(0), sizeof(pData->m_aaNames[i]));
+	const unsigned char *pUuid = pUnpacker->GetRaw(sizeof(pData->m_TeamrankUuid));
+	if(pUnpacker->Error())
+		return nullptr;
+	mem_copy(&pData->m_TeamrankUuid, pUuid, sizeof(pData->m_TeamrankUuid));
+	return pData;
+}
+
 CTeamrank::CTeamrank() :
 	m_NumNames(0)
 {
@@ -326,7 +515,6 @@ bool CScoreWorker::MapVote(IDbConnection *pSqlServer, const ISqlData *pGameData,
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
 
 	char aFuzzyMap[128];
 	str_copy(aFuzzyMap, pData->m_aName, sizeof(aFuzzyMap));
@@ -374,11 +562,11 @@ bool CScoreWorker::MapVote(IDbConnection *pSqlServer, const ISqlData *pGameData,
 	else
 	{
 		pResult->SetVariant(CScorePlayerResult::DIRECT);
-		str_format(paMessages[0], sizeof(paMessages[0]),
-			"No map like \"%s\" found. "
-			"Try adding a '%%' at the start if you don't know the first character. "
-			"Example: /map %%castle for \"Out of Castle\"",
-			pData->m_aName);
+		pResult->m_Messages.Line(
+					   "No map like \"%s\" found. "
+					   "Try adding a '%%' at the start if you don't know the first character. "
+					   "Example: /map %%castle for \"Out of Castle\"")
+			.Str(pData->m_aName);
 	}
 	return false;
 }
@@ -387,6 +575,7 @@ bool CScoreWorker::MapInfo(IDbConnection *pSqlServer, const ISqlData *pGameData,
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	char aFuzzyMap[128];
 	str_copy(aFuzzyMap, pData->m_aName, sizeof(aFuzzyMap));
@@ -484,27 +673,25 @@ bool CScoreWorker::MapInfo(IDbConnection *pSqlServer, const ISqlData *pGameData,
 		default: aStars[0] = '\0';
 		}
 
-		char aOwnFinishesString[40] = "\0";
+		pResult->m_Messages.Line(OwnTime > 0 ? "\"%s\" by %s on %s, %s, %d %s%s, %d %s by %d %s%s, your time: %s" : "\"%s\" by %s on %s, %s, %d %s%s, %d %s by %d %s%s")
+			.Str(aMap)
+			.Str(aMapper)
+			.Str(aServer)
+			.Str(aStars)
+			.Int(Points)
+			.Str(Points == 1 ? "point" : "points")
+			.Str(aReleasedString)
+			.Int(Finishes)
+			.Str(Finishes == 1 ? "finish" : "finishes")
+			.Int(Finishers)
+			.Str(Finishers == 1 ? "tee" : "tees")
+			.Str(aMedianString);
 		if(OwnTime > 0)
-		{
-			str_time_float(OwnTime, TIME_HOURS_CENTISECS, aBuf, sizeof(aBuf));
-			str_format(aOwnFinishesString, sizeof(aOwnFinishesString),
-				", your time: %s", aBuf);
-		}
-
-		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-			"\"%s\" by %s on %s, %s, %d %s%s, %d %s by %d %s%s%s",
-			aMap, aMapper, aServer, aStars,
-			Points, Points == 1 ? "point" : "points",
-			aReleasedString,
-			Finishes, Finishes == 1 ? "finish" : "finishes",
-			Finishers, Finishers == 1 ? "tee" : "tees",
-			aMedianString, aOwnFinishesString);
+			pResult->m_Messages.Time(OwnTime);
 	}
 	else
 	{
-		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-			"No map like \"%s\" found.", pData->m_aName);
+		pResult->m_Messages.Line("No map like \"%s\" found.").Str(pData->m_aName);
 	}
 	return false;
 }
@@ -513,7 +700,6 @@ bool CScoreWorker::SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameDat
 {
 	const CSqlScoreData *pData = dynamic_cast<const CSqlScoreData *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
 
 	char aBuf[1024];
 
@@ -606,9 +792,9 @@ bool CScoreWorker::SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameDat
 				{
 					return true;
 				}
-				str_format(paMessages[0], sizeof(paMessages[0]),
-					"You earned %d point%s for finishing this map!",
-					Points, Points == 1 ? "" : "s");
+				pResult->m_Messages.Line("You earned %d point%s for finishing this map!")
+					.Int(Points)
+					.Str(Points == 1 ? "" : "s");
 			}
 		}
 	}
@@ -633,9 +819,9 @@ bool CScoreWorker::SaveScore(IDbConnection *pSqlServer, const ISqlData *pGameDat
 			{
 				return true;
 			}
-			str_format(paMessages[0], sizeof(paMessages[0]),
-				"You earned %d season point%s for finishing this map!",
-				Points, Points == 1 ? "" : "s");
+			pResult->m_Messages.Line("You earned %d season point%s for finishing this map!")
+				.Int(Points)
+				.Str(Points == 1 ? "" : "s");
 		}
 	}
 
@@ -839,6 +1025,7 @@ bool CScoreWorker::ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	char aServerLike[16];
 	str_format(aServerLike, sizeof(aServerLike), "%%%s%%", pData->m_aServer);
@@ -903,11 +1090,9 @@ bool CScoreWorker::ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData
 		float Time = pSqlServer->GetFloat(2);
 		// CEIL and FLOOR are not supported in SQLite
 		int BetterThanPercent = std::floor(100.0f - 100.0f * pSqlServer->GetFloat(3));
-		str_time_float(Time, TIME_HOURS_CENTISECS, aBuf, sizeof(aBuf));
 		if(g_Config.m_SvHideScore)
 		{
-			str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-				"Your time: %s, better than %d%%", aBuf, BetterThanPercent);
+			pResult->m_Messages.Line("Your time: %s, better than %d%%").Time(Time).Int(BetterThanPercent);
 		}
 		else
 		{
@@ -915,26 +1100,29 @@ bool CScoreWorker::ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData
 
 			if(str_comp_nocase(pData->m_aRequestingPlayer, pData->m_aName) == 0)
 			{
-				str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-					"%s - %s - better than %d%%",
-					pData->m_aName, aBuf, BetterThanPercent);
+				pResult->m_Messages.Line("%s - %s - better than %d%%")
+					.Str(pData->m_aName)
+					.Time(Time)
+					.Int(BetterThanPercent);
 			}
 			else
 			{
-				str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-					"%s - %s - better than %d%% - requested by %s",
-					pData->m_aName, aBuf, BetterThanPercent, pData->m_aRequestingPlayer);
+				pResult->m_Messages.Line("%s - %s - better than %d%% - requested by %s")
+					.Str(pData->m_aName)
+					.Time(Time)
+					.Int(BetterThanPercent)
+					.Str(pData->m_aRequestingPlayer);
 			}
 
-			str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
-				"Global rank %d - %s %s",
-				Rank, pData->m_aServer, aRegionalRank);
+			pResult->m_Messages.Line("Global rank %d - %s %s")
+				.Int(Rank)
+				.Str(pData->m_aServer)
+				.Str(aRegionalRank);
 		}
 	}
 	else
 	{
-		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-			"%s is not ranked", pData->m_aName);
+		pResult->m_Messages.Line("%s is not ranked").Str(pData->m_aName);
 	}
 	return false;
 }
@@ -943,6 +1131,7 @@ bool CScoreWorker::ShowTeamRank(IDbConnection *pSqlServer, const ISqlData *pGame
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	// check sort method
 	char aBuf[2400];
@@ -980,7 +1169,6 @@ bool CScoreWorker::ShowTeamRank(IDbConnection *pSqlServer, const ISqlData *pGame
 	if(!End)
 	{
 		float Time = pSqlServer->GetFloat(3);
-		str_time_float(Time, TIME_HOURS_CENTISECS, aBuf, sizeof(aBuf));
 		int Rank = pSqlServer->GetInt(4);
 		// CEIL and FLOOR are not supported in SQLite
 		int BetterThanPercent = std::floor(100.0f - 100.0f * pSqlServer->GetFloat(5));
@@ -1003,21 +1191,22 @@ bool CScoreWorker::ShowTeamRank(IDbConnection *pSqlServer, const ISqlData *pGame
 
 		if(g_Config.m_SvHideScore)
 		{
-			str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-				"Your team time: %s, better than %d%%", aBuf, BetterThanPercent);
+			pResult->m_Messages.Line("Your team time: %s, better than %d%%").Time(Time).Int(BetterThanPercent);
 		}
 		else
 		{
 			pResult->m_MessageKind = CScorePlayerResult::ALL;
-			str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-				"%d. %s Team time: %s, better than %d%%, requested by %s",
-				Rank, aFormattedNames, aBuf, BetterThanPercent, pData->m_aRequestingPlayer);
+			pResult->m_Messages.Line("%d. %s Team time: %s, better than %d%%, requested by %s")
+				.Int(Rank)
+				.Str(aFormattedNames)
+				.Time(Time)
+				.Int(BetterThanPercent)
+				.Str(pData->m_aRequestingPlayer);
 		}
 	}
 	else
 	{
-		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-			"%s has no team ranks", pData->m_aName);
+		pResult->m_Messages.Line("%s has no team ranks").Str(pData->m_aName);
 	}
 	return false;
 }
@@ -1026,6 +1215,7 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	int LimitStart = maximum(abs(pData->m_Offset) - 1, 0);
 	const char *pOrder = pData->m_Offset >= 0 ? "ASC" : "DESC";
@@ -1058,11 +1248,8 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 	pSqlServer->BindInt(3, 5);
 
 	// show top
-	int Line = 0;
-	str_copy(pResult->m_Data.m_aaMessages[Line], "------------ Global Top ------------", sizeof(pResult->m_Data.m_aaMessages[Line]));
-	Line++;
+	pResult->m_Messages.Line("------------ Global Top ------------");
 
-	char aTime[32];
 	bool End = false;
 
 	while(!pSqlServer->Step(&End, pError, ErrorSize) && !End)
@@ -1070,12 +1257,8 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 		char aName[MAX_NAME_LENGTH];
 		pSqlServer->GetString(1, aName, sizeof(aName));
 		float Time = pSqlServer->GetFloat(2);
-		str_time_float(Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
 		int Rank = pSqlServer->GetInt(3);
-		str_format(pResult->m_Data.m_aaMessages[Line], sizeof(pResult->m_Data.m_aaMessages[Line]),
-			"%d. %s Time: %s", Rank, aName, aTime);
-
-		Line++;
+		pResult->m_Messages.Line("%d. %s Time: %s").Int(Rank).Str(aName).Time(Time);
 	}
 
 	char aServerLike[16];
@@ -1089,9 +1272,7 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 	pSqlServer->BindString(2, aServerLike);
 	pSqlServer->BindInt(3, 3);
 
-	str_format(pResult->m_Data.m_aaMessages[Line], sizeof(pResult->m_Data.m_aaMessages[Line]),
-		"------------ %s Top ------------", pData->m_aServer);
-	Line++;
+	pResult->m_Messages.Line("------------ %s Top ------------").Str(pData->m_aServer);
 
 	// show top
 	while(!pSqlServer->Step(&End, pError, ErrorSize) && !End)
@@ -1099,11 +1280,8 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 		char aName[MAX_NAME_LENGTH];
 		pSqlServer->GetString(1, aName, sizeof(aName));
 		float Time = pSqlServer->GetFloat(2);
-		str_time_float(Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
 		int Rank = pSqlServer->GetInt(3);
-		str_format(pResult->m_Data.m_aaMessages[Line], sizeof(pResult->m_Data.m_aaMessages[Line]),
-			"%d. %s Time: %s", Rank, aName, aTime);
-		Line++;
+		pResult->m_Messages.Line("%d. %s Time: %s").Int(Rank).Str(aName).Time(Time);
 	}
 
 	return !End;
@@ -1113,7 +1291,7 @@ bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGame
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	int LimitStart = maximum(abs(pData->m_Offset) - 1, 0);
 	const char *pOrder = pData->m_Offset >= 0 ? "ASC" : "DESC";
@@ -1145,8 +1323,7 @@ bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGame
 	pSqlServer->BindString(1, pData->m_aMap);
 
 	// show teamtop5
-	int Line = 0;
-	str_copy(paMessages[Line++], "------- Team Top 5 -------", sizeof(paMessages[Line]));
+	pResult->m_Messages.Line("------- Team Top 5 -------");
 
 	bool End;
 	if(pSqlServer->Step(&End, pError, ErrorSize))
@@ -1155,11 +1332,10 @@ bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGame
 	}
 	if(!End)
 	{
-		for(Line = 1; Line < 6; Line++) // print
+		for(int Line = 1; Line < 6; Line++) // print
 		{
 			bool Last = false;
 			float Time = pSqlServer->GetFloat(2);
-			str_time_float(Time, TIME_HOURS_CENTISECS, aBuf, sizeof(aBuf));
 			int Rank = pSqlServer->GetInt(3);
 			int TeamSize = pSqlServer->GetInt(4);
 
@@ -1182,17 +1358,15 @@ bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGame
 					break;
 				}
 			}
-			str_format(paMessages[Line], sizeof(paMessages[Line]), "%d. %s Team Time: %s",
-				Rank, aNames, aBuf);
+			pResult->m_Messages.Line("%d. %s Team Time: %s").Int(Rank).Str(aNames).Time(Time);
 			if(Last)
 			{
-				Line++;
 				break;
 			}
 		}
 	}
 
-	str_copy(paMessages[Line], "-------------------------------", sizeof(paMessages[Line]));
+	pResult->m_Messages.Line("-------------------------------");
 	return false;
 }
 
@@ -1200,7 +1374,7 @@ bool CScoreWorker::ShowPlayerTeamTop5(IDbConnection *pSqlServer, const ISqlData
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	int LimitStart = maximum(abs(pData->m_Offset) - 1, 0);
 	const char *pOrder = pData->m_Offset >= 0 ? "ASC" : "DESC";
@@ -1242,13 +1416,11 @@ bool CScoreWorker::ShowPlayerTeamTop5(IDbConnection *pSqlServer, const ISqlData
 	if(!End)
 	{
 		// show teamtop5
-		int Line = 0;
-		str_copy(paMessages[Line++], "------- Team Top 5 -------", sizeof(paMessages[Line]));
+		pResult->m_Messages.Line("------- Team Top 5 -------");
 
-		for(Line = 1; Line < 6; Line++) // print
+		for(int Line = 1; Line < 6; Line++) // print
 		{
 			float Time = pSqlServer->GetFloat(3);
-			str_time_float(Time, TIME_HOURS_CENTISECS, aBuf, sizeof(aBuf));
 			int Rank = pSqlServer->GetInt(4);
 			CTeamrank Teamrank;
 			bool Last;
@@ -1268,22 +1440,20 @@ bool CScoreWorker::ShowPlayerTeamTop5(IDbConnection *pSqlServer, const ISqlData
 					str_append(aFormattedNames, " & ", sizeof(aFormattedNames));
 			}
 
-			str_format(paMessages[Line], sizeof(paMessages[Line]), "%d. %s Team Time: %s",
-				Rank, aFormattedNames, aBuf);
+			pResult->m_Messages.Line("%d. %s Team Time: %s").Int(Rank).Str(aFormattedNames).Time(Time);
 			if(Last)
 			{
-				Line++;
 				break;
 			}
 		}
-		str_copy(paMessages[Line], "-------------------------------", sizeof(paMessages[Line]));
+		pResult->m_Messages.Line("-------------------------------");
 	}
 	else
 	{
 		if(pData->m_Offset == 0)
-			str_format(paMessages[0], sizeof(paMessages[0]), "%s has no team ranks", pData->m_aName);
+			pResult->m_Messages.Line("%s has no team ranks").Str(pData->m_aName);
 		else
-			str_format(paMessages[0], sizeof(paMessages[0]), "%s has no team ranks in the specified range", pData->m_aName);
+			pResult->m_Messages.Line("%s has no team ranks in the specified range").Str(pData->m_aName);
 	}
 	return false;
 }
@@ -1292,7 +1462,7 @@ bool CScoreWorker::ShowTimes(IDbConnection *pSqlServer, const ISqlData *pGameDat
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	int LimitStart = maximum(abs(pData->m_Offset) - 1, 0);
 	const char *pOrder = pData->m_Offset >= 0 ? "DESC" : "ASC";
@@ -1346,17 +1516,15 @@ bool CScoreWorker::ShowTimes(IDbConnection *pSqlServer, const ISqlData *pGameDat
 	}
 	if(End)
 	{
-		str_copy(paMessages[0], "There are no times in the specified range", sizeof(paMessages[0]));
+		pResult->m_Messages.Line("There are no times in the specified range");
 		return false;
 	}
 
-	str_copy(paMessages[0], "------------- Last Times -------------", sizeof(paMessages[0]));
-	int Line = 1;
+	pResult->m_Messages.Line("------------- Last Times -------------");
 
 	do
 	{
 		float Time = pSqlServer->GetFloat(1);
-		str_time_float(Time, TIME_HOURS_CENTISECS, aBuf, sizeof(aBuf));
 		int Ago = pSqlServer->GetInt(2);
 		int Stamp = pSqlServer->GetInt(3);
 		char aServer[5];
@@ -1371,11 +1539,9 @@ bool CScoreWorker::ShowTimes(IDbConnection *pSqlServer, const ISqlData *pGameDat
 		if(pData->m_aName[0] != '\0') // last 5 times of a player
 		{
 			if(Stamp == 0) // stamp is 00:00:00 cause it's an old entry from old times where there where no stamps yet
-				str_format(paMessages[Line], sizeof(paMessages[Line]),
-					"%s%s, don't know how long ago", aServerFormatted, aBuf);
+				pResult->m_Messages.Line("%s%s, don't know how long ago").Str(aServerFormatted).Time(Time);
 			else
-				str_format(paMessages[Line], sizeof(paMessages[Line]),
-					"%s%s ago, %s", aServerFormatted, aAgoString, aBuf);
+				pResult->m_Messages.Line("%s%s ago, %s").Str(aServerFormatted).Str(aAgoString).Time(Time);
 		}
 		else // last 5 times of the server
 		{
@@ -1383,22 +1549,19 @@ bool CScoreWorker::ShowTimes(IDbConnection *pSqlServer, const ISqlData *pGameDat
 			pSqlServer->GetString(5, aName, sizeof(aName));
 			if(Stamp == 0) // stamp is 00:00:00 cause it's an old entry from old times where there where no stamps yet
 			{
-				str_format(paMessages[Line], sizeof(paMessages[Line]),
-					"%s%s, %s, don't know when", aServerFormatted, aName, aBuf);
+				pResult->m_Messages.Line("%s%s, %s, don't know when").Str(aServerFormatted).Str(aName).Time(Time);
 			}
 			else
 			{
-				str_format(paMessages[Line], sizeof(paMessages[Line]),
-					"%s%s, %s ago, %s", aServerFormatted, aName, aAgoString, aBuf);
+				pResult->m_Messages.Line("%s%s, %s ago, %s").Str(aServerFormatted).Str(aName).Str(aAgoString).Time(Time);
 			}
 		}
-		Line++;
 	} while(!pSqlServer->Step(&End, pError, ErrorSize) && !End);
 	if(!End)
 	{
 		return true;
 	}
-	str_copy(paMessages[Line], "----------------------------------------------------", sizeof(paMessages[Line]));
+	pResult->m_Messages.Line("----------------------------------------------------");
 
 	return false;
 }
@@ -1407,7 +1570,7 @@ bool CScoreWorker::ShowPoints(IDbConnection *pSqlServer, const ISqlData *pGameDa
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	char aBuf[512];
 	str_format(aBuf, sizeof(aBuf),
@@ -1438,14 +1601,17 @@ bool CScoreWorker::ShowPoints(IDbConnection *pSqlServer, const ISqlData *pGameDa
 		char aName[MAX_NAME_LENGTH];
 		pSqlServer->GetString(4, aName, sizeof(aName));
 		pResult->m_MessageKind = CScorePlayerResult::ALL;
-		str_format(paMessages[0], sizeof(paMessages[0]),
-			"%d. %s Points: %d | Perm. Points: %d | Season Points: %d, requested by %s",
-			Rank, aName, Count + SeasonCount, Count, SeasonCount, pData->m_aRequestingPlayer);
+		pResult->m_Messages.Line("%d. %s Points: %d | Perm. Points: %d | Season Points: %d, requested by %s")
+			.Int(Rank)
+			.Str(aName)
+			.Int(Count + SeasonCount)
+			.Int(Count)
+			.Int(SeasonCount)
+			.Str(pData->m_aRequestingPlayer);
 	}
 	else
 	{
-		str_format(paMessages[0], sizeof(paMessages[0]),
-			"%s has not collected any points so far", pData->m_aName);
+		pResult->m_Messages.Line("%s has not collected any points so far").Str(pData->m_aName);
 	}
 	return false;
 }
@@ -1454,7 +1620,7 @@ bool CScoreWorker::ShowTopPoints(IDbConnection *pSqlServer, const ISqlData *pGam
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	int LimitStart = maximum(pData->m_Offset - 1, 0);
 
@@ -1476,10 +1642,9 @@ bool CScoreWorker::ShowTopPoints(IDbConnection *pSqlServer, const ISqlData *pGam
 	pSqlServer->BindInt(2, LimitStart);
 
 	// show top points
-	str_copy(paMessages[0], "-------- Top Points --------", sizeof(paMessages[0]));
+	pResult->m_Messages.Line("-------- Top Points --------");
 
 	bool End = false;
-	int Line = 1;
 	while(!pSqlServer->Step(&End, pError, ErrorSize) && !End)
 	{
 		int Rank = pSqlServer->GetInt(1);
@@ -1488,15 +1653,18 @@ bool CScoreWorker::ShowTopPoints(IDbConnection *pSqlServer, const ISqlData *pGam
 
 		char aName[MAX_NAME_LENGTH];
 		pSqlServer->GetString(4, aName, sizeof(aName));
-		str_format(paMessages[Line], sizeof(paMessages[Line]),
-			"%d. %s Points: %d - [P: %d | S: %d]", Rank, aName, Points + SeasonPoints, Points, SeasonPoints);
-		Line++;
+		pResult->m_Messages.Line("%d. %s Points: %d - [P: %d | S: %d]")
+			.Int(Rank)
+			.Str(aName)
+			.Int(Points + SeasonPoints)
+			.Int(Points)
+			.Int(SeasonPoints);
 	}
 	if(!End)
 	{
 		return true;
 	}
-	str_copy(paMessages[Line], "-------------------------------", sizeof(paMessages[Line]));
+	pResult->m_Messages.Line("-------------------------------");
 
 	return false;
 }
@@ -1894,14 +2062,16 @@ bool CScoreWorker::GetSaves(IDbConnection *pSqlServer, const ISqlData *pGameData
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
-	char aSaveLike[128] = "";
-	str_append(aSaveLike, "%\n", sizeof(aSaveLike));
-	sqlstr::EscapeLike(aSaveLike + str_length(aSaveLike),
-		pData->m_aRequestingPlayer,
-		sizeof(aSaveLike) - str_length(aSaveLike));
-	str_append(aSaveLike, "\t%", sizeof(aSaveLike));
+	// the text format has the name at the start of a line, the binary format
+	// lists the names in its first line, see save_format.cpp
+	char aName[MAX_NAME_LENGTH * 2];
+	sqlstr::EscapeLike(aName, pData->m_aRequestingPlayer, sizeof(aName));
+	char aSaveLike[128];
+	str_format(aSaveLike, sizeof(aSaveLike), "%%\n%s\t%%", aName);
+	char aBinarySaveLike[128];
+	str_format(aBinarySaveLike, sizeof(aBinarySaveLike), "B1%%\t%s\t%%", aName);
 
 	char aCurrentTimestamp[512];
 	pSqlServer->ToUnixTimestamp("CURRENT_TIMESTAMP", aCurrentTimestamp, sizeof(aCurrentTimestamp));
@@ -1912,7 +2082,7 @@ bool CScoreWorker::GetSaves(IDbConnection *pSqlServer, const ISqlData *pGameData
 	str_format(aBuf, sizeof(aBuf),
 		"SELECT COUNT(*) AS NumSaves, %s-%s AS Ago "
 		"FROM %s_saves "
-		"WHERE Map = ? AND Savegame LIKE ?",
+		"WHERE Map = ? AND (Savegame LIKE ? OR Savegame LIKE ?)",
 		aCurrentTimestamp, aMaxTimestamp,
 		pSqlServer->GetPrefix());
 	if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
@@ -1921,6 +2091,7 @@ bool CScoreWorker::GetSaves(IDbConnection *pSqlServer, const ISqlData *pGameData
 	}
 	pSqlServer->BindString(1, pData->m_aMap);
 	pSqlServer->BindString(2, aSaveLike);
+	pSqlServer->BindString(3, aBinarySaveLike);
 
 	bool End;
 	if(pSqlServer->Step(&End, pError, ErrorSize))
@@ -1939,11 +2110,12 @@ bool CScoreWorker::GetSaves(IDbConnection *pSqlServer, const ISqlData *pGameData
 			str_format(aLastSavedString, sizeof(aLastSavedString), ", last saved %s ago", aAgoString);
 		}
 
-		str_format(paMessages[0], sizeof(paMessages[0]),
-			"%s has %d save%s on %s%s",
-			pData->m_aRequestingPlayer,
-			NumSaves, NumSaves == 1 ? "" : "s",
-			pData->m_aMap, aLastSavedString);
+		pResult->m_Messages.Line("%s has %d save%s on %s%s")
+			.Str(pData->m_aRequestingPlayer)
+			.Int(NumSaves)
+			.Str(NumSaves == 1 ? "" : "s")
+			.Str(pData->m_aMap)
+			.Str(aLastSavedString);
 	}
 	return false;
 }
@@ -1953,7 +2125,7 @@ bool CScoreWorker::SendPowerInfoMessage(IDbConnection *pSqlServer, const ISqlDat
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	// powers
 	char aBuf[512];
@@ -1975,8 +2147,7 @@ bool CScoreWorker::SendPowerInfoMessage(IDbConnection *pSqlServer, const ISqlDat
 		return true;
 	}
 
-	str_format(paMessages[0], sizeof(paMessages[0]),
-		"Powers are visual effects given to players who have participated in and won events or who belong to staff.");
+	pResult->m_Messages.Line("Powers are visual effects given to players who have participated in and won events or who belong to staff.");
 
 	if(!End)
 	{
@@ -2007,13 +2178,11 @@ bool CScoreWorker::SendPowerInfoMessage(IDbConnection *pSqlServer, const ISqlDat
 			pSqlServer->GetInt(19) == 1 ? "guided-ninjasword, " : "",
 			pSqlServer->GetInt(20) == 1 ? "carry, " : "");
 
-		str_format(paMessages[1], sizeof(paMessages[1]),
-			"Powers you own: %s.", ownedPowers);
+		pResult->m_Messages.Line("Powers you own: %s.").Str(ownedPowers);
 	}
 	else
 	{
-		str_format(paMessages[1], sizeof(paMessages[1]),
-			"Powers you own: none.");
+		pResult->m_Messages.Line("Powers you own: none.");
 	}
 
 	return false;
@@ -2023,7 +2192,7 @@ bool CScoreWorker::ChangePlayerPowerStatus(IDbConnection *pSqlServer, const ISql
 {
 	const CSqlPlayerRequest *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
 	CScorePlayerResult *pResult = dynamic_cast<CScorePlayerResult *>(pGameData->m_pResult.get());
-	auto *paMessages = pResult->m_Data.m_aaMessages;
+	pResult->SetVariant(CScorePlayerResult::DIRECT);
 
 	char aBuf[512];
 	str_format(aBuf, sizeof(aBuf),
@@ -2047,8 +2216,7 @@ bool CScoreWorker::ChangePlayerPowerStatus(IDbConnection *pSqlServer, const ISql
 		// check if user have power
 		if(pSqlServer->GetInt(1) != 1)
 		{
-			str_format(paMessages[0], sizeof(paMessages[0]),
-				"You do not have permission to use this power!");
+			pResult->m_Messages.Line("You do not have permission to use this power!");
 
 			return false;
 		}
@@ -2076,8 +2244,7 @@ bool CScoreWorker::ChangePlayerPowerStatus(IDbConnection *pSqlServer, const ISql
 	}
 	else
 	{
-		str_format(paMessages[0], sizeof(paMessages[0]),
-			"You do not have permission to any power!");
+		pResult->m_Messages.Line("You do not have permission to any power!");
 	}
 
 	return false;
@@ -22,15 +22,53 @@ enum
 	TIMESTAMP_STR_LENGTH = 20, // 2019-04-02 19:38:36
 };
 
-struct CScorePlayerResult : ISqlResult
+// Chat lines of a score result. The worker thread only stores the format
+// string and the typed fields of each line, the lines get rendered on the
+// main thread when they are sent. The storage grows with the actual content
+// instead of reserving space for the longest possible result.
+//
+// Lines are only ever appended. A read request is retried on the next
+// database if it fails halfway, so the workers reset the result with
+// SetVariant before adding lines.
+class CScoreMessages
 {
-	CScorePlayerResult();
-
+public:
+	// Starts a new line. pFormat must be a string literal, it is only
+	// evaluated when rendering. Supported conversions are %d for Int, %s for
+	// Str and Time and %% for a literal percent sign.
+	CScoreMessages &Line(const char *pFormat);
+	CScoreMessages &Int(int Value);
+	// rendered with str_time_float and TIME_HOURS_CENTISECS
+	CScoreMessages &Time(float Time);
+	CScoreMessages &Str(const char *pStr);
+
+	void Clear();
+	int Num() const { return m_vLines.size(); }
+	void Render(int Line, char *pBuf, int BufferSize) const;
+
+private:
 	enum
 	{
-		MAX_MESSAGES = 10,
+		FIELD_INT,
+		FIELD_TIME,
+		FIELD_STR,
 	};
 
+	struct CLine
+	{
+		const char *m_pFormat;
+		int m_FieldsOffset;
+	};
+
+	std::vector<CLine> m_vLines;
+	// fields of all lines, each a type byte followed by the value
+	std::vector<char> m_vFields;
+};
+
+struct CScorePlayerResult : ISqlResult
+{
+	CScorePlayerResult();
+
 	enum Variant
 	{
 		DIRECT,
@@ -39,9 +77,10 @@ struct CScorePlayerResult : ISqlResult
 		MAP_VOTE,
 		PLAYER_INFO,
 	} m_MessageKind;
+	// DIRECT, ALL
+	CScoreMessages m_Messages;
 	union
 	{
-		char m_aaMessages[MAX_MESSAGES][512];
 		char m_aBroadcast[1024];
 		struct
 		{
@@ -189,6 +228,9 @@ struct CSqlScoreData : ISqlData
 
 	virtual ~CSqlScoreData(){};
 
+	bool Spill(CPacker *pPacker) const override;
+	static std::unique_ptr<const ISqlData> Unspill(CUnpacker *pUnpacker);
+
 	char m_aMap[MAX_MAP_LENGTH];
 	char m_aGameUuid[UUID_MAXSTRSIZE];
 	char m_aName[MAX_MAP_LENGTH];
@@ -234,6 +276,9 @@ struct CSqlTeamScoreData : ISqlData
 	{
 	}
 
+	bool Spill(CPacker *pPacker) const override;
+	static std::unique_ptr<const ISqlData> Unspill(CUnpacker *pUnpacker);
+
 	char m_aGameUuid[UUID_MAXSTRSIZE];
 	char m_aMap[MAX_MAP_LENGTH];
 	float m_Time;
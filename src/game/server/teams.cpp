@@ -400,6 +400,8 @@ void CGameTeams::SetForceCharacterTeam(int ClientID, int Team)
 	}
 
 	m_Core.Team(ClientID, Team);
+	// finishing teams are disbanded in the middle of the world tick
+	GameServer()->m_World.m_Core.UpdateBroadphase(ClientID);
 
 	if(OldTeam != Team)
 	{
@@ -7,29 +7,14 @@
 
 static const char TEEHISTORIAN_NAME[] = "teehistorian@ddnet.tw";
 static const CUuid TEEHISTORIAN_UUID = CalculateUuid(TEEHISTORIAN_NAME);
-static const char TEEHISTORIAN_VERSION[] = "2";
-static const char TEEHISTORIAN_VERSION_MINOR[] = "4";
+// minor versions of the version 2 and version 3 formats
+static const char TEEHISTORIAN_VERSION_MINOR_V2[] = "4";
+static const char TEEHISTORIAN_VERSION_MINOR_V3[] = "0";
 
 #define UUID(id, name) static const CUuid UUID_##id = CalculateUuid(name);
 #include <engine/shared/teehistorian_ex_chunks.h>
 #undef UUID
 
-enum
-{
-	TEEHISTORIAN_NONE,
-	TEEHISTORIAN_FINISH,
-	TEEHISTORIAN_TICK_SKIP,
-	TEEHISTORIAN_PLAYER_NEW,
-	TEEHISTORIAN_PLAYER_OLD,
-	TEEHISTORIAN_INPUT_DIFF,
-	TEEHISTORIAN_INPUT_NEW,
-	TEEHISTORIAN_MESSAGE,
-	TEEHISTORIAN_JOIN,
-	TEEHISTORIAN_DROP,
-	TEEHISTORIAN_CONSOLE_COMMAND,
-	TEEHISTORIAN_EX,
-};
-
 CTeeHistorian::CTeeHistorian()
 {
 	m_State = STATE_START;
@@ -41,18 +26,24 @@ void CTeeHistorian::Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCal
 {
 	dbg_assert(m_State == STATE_START || m_State == STATE_BEFORE_TICK, "invalid teehistorian state");
 
+	dbg_assert(pGameInfo->m_Version == VERSION_2 || pGameInfo->m_Version == VERSION_3, "invalid teehistorian version");
+
 	m_Debug = 0;
+	m_Version = pGameInfo->m_Version;
 
 	m_Tick = 0;
 	m_LastWrittenTick = 0;
 	// Tick 0 is implicit at the start, game starts as tick 1.
 	m_TickWritten = true;
 	m_MaxClientID = MAX_CLIENTS;
+	m_vDeferred.clear();
 
 	// `m_PrevMaxClientID` is initialized in `BeginPlayers`
 	for(auto &PrevPlayer : m_aPrevPlayers)
 	{
 		PrevPlayer.m_Alive = false;
+		PrevPlayer.m_DX = 0;
+		PrevPlayer.m_DY = 0;
 		// zero means no id
 		PrevPlayer.m_UniqueClientID = 0;
 		PrevPlayer.m_Team = 0;
@@ -73,10 +64,12 @@ void CTeeHistorian::WriteHeader(const CGameInfo *pGameInfo)
 {
 	Write(&TEEHISTORIAN_UUID, sizeof(TEEHISTORIAN_UUID));
 
+	char aVersion[16];
 	char aGameUuid[UUID_MAXSTRSIZE];
 	char aStartTime[128];
 	char aMapSha256[SHA256_MAXSTRSIZE];
 
+	str_format(aVersion, sizeof(aVersion), "%d", pGameInfo->m_Version);
 	FormatUuid(pGameInfo->m_GameUuid, aGameUuid, sizeof(aGameUuid));
 	str_timestamp_ex(pGameInfo->m_StartTime, aStartTime, sizeof(aStartTime), "%Y-%m-%dT%H:%M:%S%z");
 	sha256_str(pGameInfo->m_MapSha256, aMapSha256, sizeof(aMapSha256));
@@ -112,8 +105,8 @@ void CTeeHistorian::WriteHeader(const CGameInfo *pGameInfo)
 		"\"prng_description\":\"%s\","
 		"\"config\":{",
 		E(aCommentBuffer, TEEHISTORIAN_NAME),
-		TEEHISTORIAN_VERSION,
-		TEEHISTORIAN_VERSION_MINOR,
+		aVersion,
+		pGameInfo->m_Version == VERSION_2 ? TEEHISTORIAN_VERSION_MINOR_V2 : TEEHISTORIAN_VERSION_MINOR_V3,
 		aGameUuid,
 		E(aServerVersionBuffer, pGameInfo->m_pServerVersion),
 		E(aStartTimeBuffer, aStartTime),
@@ -233,6 +226,14 @@ void CTeeHistorian::BeginPlayers()
 	// by not overwriting m_MaxClientID during RecordPlayer
 	m_MaxClientID = -1;
 
+	if(m_Version >= VERSION_3)
+	{
+		for(auto &CurPlayer : m_aCurPlayers)
+		{
+			CurPlayer.m_Recorded = false;
+		}
+	}
+
 	m_State = STATE_PLAYERS;
 }
 
@@ -257,6 +258,16 @@ void CTeeHistorian::RecordPlayer(int ClientID, const CNetObj_CharacterCore *pCha
 {
 	dbg_assert(m_State == STATE_PLAYERS, "invalid teehistorian state");
 
+	if(m_Version >= VERSION_3)
+	{
+		CPlayerRecord *pCur = &m_aCurPlayers[ClientID];
+		pCur->m_Recorded = true;
+		pCur->m_Alive = true;
+		pCur->m_X = pChar->m_X;
+		pCur->m_Y = pChar->m_Y;
+		return;
+	}
+
 	CTeehistorianPlayer *pPrev = &m_aPrevPlayers[ClientID];
 	if(!pPrev->m_Alive || pPrev->m_X != pChar->m_X || pPrev->m_Y != pChar->m_Y)
 	{
@@ -300,6 +311,13 @@ void CTeeHistorian::RecordDeadPlayer(int ClientID)
 {
 	dbg_assert(m_State == STATE_PLAYERS, "invalid teehistorian state");
 
+	if(m_Version >= VERSION_3)
+	{
+		m_aCurPlayers[ClientID].m_Recorded = true;
+		m_aCurPlayers[ClientID].m_Alive = false;
+		return;
+	}
+
 	CTeehistorianPlayer *pPrev = &m_aPrevPlayers[ClientID];
 	if(pPrev->m_Alive)
 	{
@@ -362,14 +380,27 @@ void CTeeHistorian::RecordTeamPractice(int Team, bool Practice)
 	}
 }
 
+bool CTeeHistorian::Deferring() const
+{
+	// Saves, loads and console commands are recorded while the world ticks,
+	// before the player positions are known. In version 3 the PLAYERS record
+	// has to start the tick, so they are held back until EndPlayers.
+	return m_Version >= VERSION_3 && m_State == STATE_PLAYERS;
+}
+
 void CTeeHistorian::Write(const void *pData, int DataSize)
 {
+	if(Deferring())
+	{
+		m_vDeferred.insert(m_vDeferred.end(), (const unsigned char *)pData, (const unsigned char *)pData + DataSize);
+		return;
+	}
 	m_pfnWriteCallback(pData, DataSize, m_pWriteCallbackUserdata);
 }
 
 void CTeeHistorian::EnsureTickWritten()
 {
-	if(!m_TickWritten)
+	if(!m_TickWritten && !Deferring())
 	{
 		WriteTick();
 	}
@@ -393,11 +424,130 @@ void CTeeHistorian::WriteTick()
 	m_LastWrittenTick = m_Tick;
 }
 
+void CTeeHistorian::WritePlayers()
+{
+	// Players that keep their velocity (idle, frozen, falling at maximum
+	// speed) are predicted by the reader and don't appear in the record.
+	// If no player deviates from the prediction, the tick isn't written.
+	unsigned char aMask[(MAX_CLIENTS + 7) / 8] = {0};
+	unsigned char aKinds[(MAX_CLIENTS * 2 + 7) / 8] = {0};
+	int NumMaskBytes = 0;
+	int NumChanged = 0;
+
+	CPacker Payload;
+	Payload.Reset();
+	for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+	{
+		CTeehistorianPlayer *pPrev = &m_aPrevPlayers[ClientID];
+		const CPlayerRecord *pCur = &m_aCurPlayers[ClientID];
+		if(!pCur->m_Recorded || (pCur->m_Alive && pPrev->m_Alive && pCur->m_X - pPrev->m_X == pPrev->m_DX && pCur->m_Y - pPrev->m_Y == pPrev->m_DY))
+		{
+			// the same as the reader's prediction
+			if(pPrev->m_Alive)
+			{
+				pPrev->m_X += pPrev->m_DX;
+				pPrev->m_Y += pPrev->m_DY;
+			}
+			continue;
+		}
+		if(!pCur->m_Alive && !pPrev->m_Alive)
+		{
+			continue;
+		}
+
+		int Kind;
+		if(!pCur->m_Alive)
+		{
+			Kind = TEEHISTORIAN_PLAYERS_OLD;
+			if(m_Debug)
+			{
+				dbg_msg("teehistorian", "old cid=%d", ClientID);
+			}
+		}
+		else if(!pPrev->m_Alive)
+		{
+			Kind = TEEHISTORIAN_PLAYERS_NEW;
+			Payload.AddInt(pCur->m_X);
+			Payload.AddInt(pCur->m_Y);
+			pPrev->m_DX = 0;
+			pPrev->m_DY = 0;
+			if(m_Debug)
+			{
+				dbg_msg("teehistorian", "new cid=%d x=%d y=%d", ClientID, pCur->m_X, pCur->m_Y);
+			}
+		}
+		else
+		{
+			const int DX = pCur->m_X - pPrev->m_X;
+			const int DY = pCur->m_Y - pPrev->m_Y;
+			if(DX == pPrev->m_DX)
+			{
+				Kind = TEEHISTORIAN_PLAYERS_ACCEL_Y;
+			}
+			else
+			{
+				Kind = TEEHISTORIAN_PLAYERS_ACCEL;
+				Payload.AddInt(DX - pPrev->m_DX);
+			}
+			Payload.AddInt(DY - pPrev->m_DY);
+			if(m_Debug)
+			{
+				dbg_msg("teehistorian", "accel cid=%d ddx=%d ddy=%d", ClientID, DX - pPrev->m_DX, DY - pPrev->m_DY);
+			}
+			pPrev->m_DX = DX;
+			pPrev->m_DY = DY;
+		}
+		pPrev->m_Alive = pCur->m_Alive;
+		pPrev->m_X = pCur->m_X;
+		pPrev->m_Y = pCur->m_Y;
+
+		aMask[ClientID / 8] |= 1 << (ClientID % 8);
+		aKinds[NumChanged / 4] |= Kind << (NumChanged % 4 * 2);
+		NumMaskBytes = ClientID / 8 + 1;
+		NumChanged++;
+	}
+
+	if(NumChanged == 0)
+	{
+		return;
+	}
+
+	// The players record starts a new tick unless it directly follows a
+	// TICK_SKIP, nothing else may be written before it.
+	dbg_assert(!m_TickWritten, "teehistorian data recorded before the players");
+	if(m_LastWrittenTick + 1 != m_Tick)
+	{
+		WriteTick();
+	}
+	m_TickWritten = true;
+	m_LastWrittenTick = m_Tick;
+
+	CPacker Buffer;
+	Buffer.Reset();
+	Buffer.AddInt(-TEEHISTORIAN_PLAYERS);
+	Buffer.AddInt(NumMaskBytes);
+	Buffer.AddRaw(aMask, NumMaskBytes);
+	Buffer.AddRaw(aKinds, (NumChanged * 2 + 7) / 8);
+	Buffer.AddRaw(Payload.Data(), Payload.Size());
+	Write(Buffer.Data(), Buffer.Size());
+}
+
 void CTeeHistorian::EndPlayers()
 {
 	dbg_assert(m_State == STATE_PLAYERS, "invalid teehistorian state");
 
 	m_State = STATE_BEFORE_INPUTS;
+
+	if(m_Version >= VERSION_3)
+	{
+		WritePlayers();
+	}
+	if(!m_vDeferred.empty())
+	{
+		EnsureTickWritten();
+		Write(m_vDeferred.data(), m_vDeferred.size());
+		m_vDeferred.clear();
+	}
 }
 
 void CTeeHistorian::BeginInputs()
@@ -422,8 +572,38 @@ void CTeeHistorian::RecordPlayerInput(int ClientID, uint32_t UniqueClientID, con
 		EnsureTickWritten();
 		Buffer.Reset();
 
-		Buffer.AddInt(-TEEHISTORIAN_INPUT_DIFF);
 		CSnapshotDelta::DiffItem((int *)&pPrev->m_Input, (int *)pInput, (int *)&DiffInput, sizeof(DiffInput) / sizeof(int));
+		if(m_Version >= VERSION_3)
+		{
+			// only the fields that changed, selected by a bit mask
+			int Mask = 0;
+			for(int i = 0; i < (int)(sizeof(DiffInput) / sizeof(int)); i++)
+			{
+				if(((int *)&DiffInput)[i] != 0)
+				{
+					Mask |= 1 << i;
+				}
+			}
+			Buffer.AddInt(-TEEHISTORIAN_INPUT_DIFF_MASKED);
+			Buffer.AddInt(ClientID);
+			Buffer.AddInt(Mask);
+			for(int i = 0; i < (int)(sizeof(DiffInput) / sizeof(int)); i++)
+			{
+				if(Mask & (1 << i))
+				{
+					Buffer.AddInt(((int *)&DiffInput)[i]);
+				}
+			}
+			if(m_Debug)
+			{
+				dbg_msg("teehistorian", "diff_input_masked cid=%d mask=%d", ClientID, Mask);
+			}
+			pPrev->m_Input = *pInput;
+			Write(Buffer.Data(), Buffer.Size());
+			return;
+		}
+
+		Buffer.AddInt(-TEEHISTORIAN_INPUT_DIFF);
 		if(m_Debug)
 		{
 			const int *pData = (const int *)&DiffInput;
@@ -7,11 +7,41 @@
 #include <game/generated/protocol.h>
 
 #include <time.h>
+#include <vector>
 
 class CConfig;
 class CTuningParams;
 class CUuidManager;
 
+// record types, written negated as the first int of a record
+enum
+{
+	TEEHISTORIAN_NONE,
+	TEEHISTORIAN_FINISH,
+	TEEHISTORIAN_TICK_SKIP,
+	TEEHISTORIAN_PLAYER_NEW,
+	TEEHISTORIAN_PLAYER_OLD,
+	TEEHISTORIAN_INPUT_DIFF,
+	TEEHISTORIAN_INPUT_NEW,
+	TEEHISTORIAN_MESSAGE,
+	TEEHISTORIAN_JOIN,
+	TEEHISTORIAN_DROP,
+	TEEHISTORIAN_CONSOLE_COMMAND,
+	TEEHISTORIAN_EX,
+	TEEHISTORIAN_PLAYERS,
+	TEEHISTORIAN_INPUT_DIFF_MASKED,
+};
+
+// 2 bit kinds of the players in a TEEHISTORIAN_PLAYERS record
+enum
+{
+	TEEHISTORIAN_PLAYERS_NEW,
+	TEEHISTORIAN_PLAYERS_OLD,
+	TEEHISTORIAN_PLAYERS_ACCEL,
+	// falling and jumping only change the vertical velocity
+	TEEHISTORIAN_PLAYERS_ACCEL_Y,
+};
+
 class CTeeHistorian
 {
 public:
@@ -36,6 +66,8 @@ public:
 		CConfig *m_pConfig;
 		CTuningParams *m_pTuning;
 		CUuidManager *m_pUuids;
+
+		int m_Version;
 	};
 
 	enum
@@ -44,6 +76,15 @@ public:
 		PROTOCOL_7,
 	};
 
+	enum
+	{
+		// player positions and input diffs as separate records
+		VERSION_2 = 2,
+		// one bit-packed players record per tick, players that keep their
+		// velocity aren't written at all
+		VERSION_3,
+	};
+
 	CTeeHistorian();
 
 	void Reset(const CGameInfo *pGameInfo, WRITE_CALLBACK pfnWriteCallback, void *pUser);
@@ -90,7 +131,9 @@ private:
 	void WriteHeader(const CGameInfo *pGameInfo);
 	void WriteExtra(CUuid Uuid, const void *pData, int DataSize);
 	void EnsureTickWrittenPlayerData(int ClientID);
+	void WritePlayers();
 	void EnsureTickWritten();
+	bool Deferring() const;
 	void WriteTick();
 	void Write(const void *pData, int DataSize);
 
@@ -111,6 +154,9 @@ private:
 		bool m_Alive;
 		int m_X;
 		int m_Y;
+		// velocity of the last tick, only used by version 3
+		int m_DX;
+		int m_DY;
 
 		CNetObj_PlayerInput m_Input;
 		uint32_t m_UniqueClientID;
@@ -124,10 +170,20 @@ private:
 		bool m_Practice;
 	};
 
+	// player data of the current tick, written at the end of the players in version 3
+	struct CPlayerRecord
+	{
+		bool m_Recorded;
+		bool m_Alive;
+		int m_X;
+		int m_Y;
+	};
+
 	WRITE_CALLBACK m_pfnWriteCallback;
 	void *m_pWriteCallbackUserdata;
 
 	int m_State;
+	int m_Version;
 
 	int m_LastWrittenTick;
 	bool m_TickWritten;
@@ -135,7 +191,10 @@ private:
 	int m_PrevMaxClientID;
 	int m_MaxClientID;
 	CTeehistorianPlayer m_aPrevPlayers[MAX_CLIENTS];
+	CPlayerRecord m_aCurPlayers[MAX_CLIENTS];
 	CTeam m_aPrevTeams[MAX_CLIENTS];
+	// records of the players phase in version 3, written after the players
+	std::vector<unsigned char> m_vDeferred;
 };
 
 #endif // GAME_SERVER_TEEHISTORIAN_H
@@ -0,0 +1,317 @@
+#include "teehistorian_file.h"
+
+#include <engine/storage.h>
+
+static const unsigned char gs_aTeeHistorianFileMagic[8] = {'T', 'W', 'T', 'H', 'Z', 0, 0, 1};
+
+CTeeHistorianFileWriter::CTeeHistorianFileWriter()
+{
+	mem_zero(&m_Stream, sizeof(m_Stream));
+}
+
+CTeeHistorianFileWriter::~CTeeHistorianFileWriter()
+{
+	Close();
+}
+
+void CTeeHistorianFileWriter::FileName(char *pBuf, int BufSize, const char *pBasename, bool Compress, bool Rotate, int Index)
+{
+	if(Rotate)
+		str_format(pBuf, BufSize, "%s-%04d.teehistorian%s", pBasename, Index, Compress ? ".z" : "");
+	else
+		str_format(pBuf, BufSize, "%s.teehistorian%s", pBasename, Compress ? ".z" : "");
+}
+
+bool CTeeHistorianFileWriter::Open(IStorage *pStorage, const char *pBasename, bool Compress, int64_t RotateSize, int RotateTicks, int FrameTicks)
+{
+	dbg_assert(!m_Thread.joinable() && !m_File, "teehistorian file writer already open");
+	m_pStorage = pStorage;
+	str_copy(m_aBasename, pBasename);
+	m_Compress = Compress;
+	m_RotateSize = RotateSize;
+	m_RotateTicks = RotateTicks;
+	m_FrameTicks = FrameTicks;
+
+	m_Shutdown = false;
+	m_Error = 0;
+	m_NumFiles = 0;
+	m_StreamOffset = 0;
+	m_FrameOpen = false;
+	m_LastTick = -1;
+
+	if(!OpenNextFile())
+		return false;
+
+	if(m_Compress || m_RotateSize || m_RotateTicks)
+	{
+		char aFilename[IO_MAX_PATH_LENGTH];
+		str_format(aFilename, sizeof(aFilename), "%s.teehistorian.index", m_aBasename);
+		m_IndexFile = m_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!m_IndexFile)
+		{
+			dbg_msg("teehistorian", "failed to open '%s'", aFilename);
+			io_close(m_File);
+			m_File = nullptr;
+			return false;
+		}
+	}
+
+	if(m_Compress && deflateInit(&m_Stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+	{
+		dbg_msg("teehistorian", "failed to initialize compression");
+		io_close(m_File);
+		m_File = nullptr;
+		if(m_IndexFile)
+			io_close(m_IndexFile);
+		m_IndexFile = nullptr;
+		return false;
+	}
+
+	m_Thread = std::thread([this]() { Run(); });
+	return true;
+}
+
+void CTeeHistorianFileWriter::Close()
+{
+	if(!m_Thread.joinable())
+		return;
+	{
+		std::unique_lock<std::mutex> Lock(m_Lock);
+		m_Shutdown = true;
+	}
+	m_DataAdded.notify_one();
+	m_Thread.join();
+}
+
+void CTeeHistorianFileWriter::Write(const void *pData, int Size)
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	m_vPending.insert(m_vPending.end(), (const unsigned char *)pData, (const unsigned char *)pData + Size);
+}
+
+void CTeeHistorianFileWriter::MarkTick(int Tick)
+{
+	{
+		std::unique_lock<std::mutex> Lock(m_Lock);
+		m_vPendingTicks.emplace_back(m_vPending.size(), Tick);
+	}
+	// one wake-up per tick is enough, the data of a tick is written in one go
+	m_DataAdded.notify_one();
+}
+
+int CTeeHistorianFileWriter::Error()
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	return m_Error;
+}
+
+void CTeeHistorianFileWriter::SetError(int Error)
+{
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	if(!m_Error)
+		m_Error = Error;
+}
+
+void CTeeHistorianFileWriter::Run()
+{
+	std::vector<unsigned char> vData;
+	std::vector<std::pair<int, int>> vTicks;
+	std::unique_lock<std::mutex> Lock(m_Lock);
+	while(true)
+	{
+		m_DataAdded.wait(Lock, [this]() { return m_Shutdown || !m_vPendingTicks.empty(); });
+		std::swap(vData, m_vPending);
+		std::swap(vTicks, m_vPendingTicks);
+		const bool Shutdown = m_Shutdown;
+		Lock.unlock();
+
+		int Pos = 0;
+		for(const auto &[Offset, Tick] : vTicks)
+		{
+			WriteData(vData.data() + Pos, Offset - Pos);
+			Pos = Offset;
+			OnTick(Tick);
+		}
+		WriteData(vData.data() + Pos, (int)vData.size() - Pos);
+		vData.clear();
+		vTicks.clear();
+
+		if(Shutdown)
+			break;
+		Lock.lock();
+	}
+
+	EndFrame();
+	if(m_Compress)
+		deflateEnd(&m_Stream);
+	if(m_File && io_close(m_File))
+		SetError(1);
+	m_File = nullptr;
+	if(m_IndexFile && io_close(m_IndexFile))
+		SetError(1);
+	m_IndexFile = nullptr;
+}
+
+bool CTeeHistorianFileWriter::OpenNextFile()
+{
+	if(m_File && io_close(m_File))
+		SetError(1);
+
+	char aFilename[IO_MAX_PATH_LENGTH];
+	FileName(aFilename, sizeof(aFilename), m_aBasename, m_Compress, m_RotateSize || m_RotateTicks, m_NumFiles);
+	m_File = m_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!m_File)
+	{
+		dbg_msg("teehistorian", "failed to open '%s'", aFilename);
+		SetError(1);
+		return false;
+	}
+	dbg_msg("teehistorian", "recording to '%s'", aFilename);
+
+	m_NumFiles++;
+	m_FileSize = 0;
+	m_FileStartTick = -1;
+	if(m_Compress)
+	{
+		io_write(m_File, gs_aTeeHistorianFileMagic, sizeof(gs_aTeeHistorianFileMagic));
+		m_FileSize += sizeof(gs_aTeeHistorianFileMagic);
+	}
+	return true;
+}
+
+void CTeeHistorianFileWriter::BeginFrame(int Tick)
+{
+	m_FrameOpen = true;
+	m_FrameStartTick = Tick;
+	m_FrameSize = 0;
+	if(m_Compress)
+	{
+		deflateReset(&m_Stream);
+		m_vFrame.clear();
+	}
+	if(m_IndexFile)
+	{
+		char aLine[128];
+		str_format(aLine, sizeof(aLine), "%d %d %lld %lld", Tick, m_NumFiles - 1, (long long)m_FileSize, (long long)m_StreamOffset);
+		io_write(m_IndexFile, aLine, str_length(aLine));
+		io_write_newline(m_IndexFile);
+	}
+}
+
+void CTeeHistorianFileWriter::EndFrame()
+{
+	if(!m_FrameOpen)
+		return;
+	m_FrameOpen = false;
+
+	if(m_Compress && m_File)
+	{
+		Deflate(nullptr, 0, Z_FINISH);
+		unsigned char aHeader[8];
+		uint_to_bytes_be(aHeader, m_vFrame.size());
+		uint_to_bytes_be(aHeader + 4, m_FrameSize);
+		if(io_write(m_File, aHeader, sizeof(aHeader)) != sizeof(aHeader) ||
+			io_write(m_File, m_vFrame.data(), m_vFrame.size()) != m_vFrame.size())
+			SetError(1);
+		m_FileSize += sizeof(aHeader) + m_vFrame.size();
+	}
+	if(m_IndexFile)
+		io_flush(m_IndexFile);
+}
+
+void CTeeHistorianFileWriter::Deflate(const unsigned char *pData, int Size, int Flush)
+{
+	const int ChunkSize = 16 * 1024;
+	m_Stream.next_in = (Bytef *)pData;
+	m_Stream.avail_in = Size;
+	int Result;
+	do
+	{
+		const size_t Used = m_vFrame.size();
+		m_vFrame.resize(Used + ChunkSize);
+		m_Stream.next_out = m_vFrame.data() + Used;
+		m_Stream.avail_out = ChunkSize;
+		Result = deflate(&m_Stream, Flush);
+		m_vFrame.resize(Used + ChunkSize - m_Stream.avail_out);
+		if(Result == Z_STREAM_ERROR)
+		{
+			SetError(1);
+			return;
+		}
+	} while(m_Stream.avail_out == 0 || (Flush == Z_FINISH && Result != Z_STREAM_END));
+}
+
+void CTeeHistorianFileWriter::WriteData(const unsigned char *pData, int Size)
+{
+	if(Size <= 0 || !m_File)
+		return;
+	if(!m_FrameOpen)
+		BeginFrame(m_LastTick);
+
+	if(m_Compress)
+		Deflate(pData, Size, Z_NO_FLUSH);
+	else
+	{
+		if(io_write(m_File, pData, Size) != (unsigned)Size)
+			SetError(1);
+		m_FileSize += Size;
+	}
+	m_FrameSize += Size;
+	m_StreamOffset += Size;
+}
+
+void CTeeHistorianFileWriter::OnTick(int Tick)
+{
+	m_LastTick = Tick;
+	if(m_FileStartTick == -1)
+		m_FileStartTick = Tick;
+	const int64_t FileSize = m_FileSize + (m_FrameOpen ? (int64_t)m_vFrame.size() : 0);
+	if((m_RotateSize && FileSize >= m_RotateSize) || (m_RotateTicks && Tick - m_FileStartTick >= m_RotateTicks))
+	{
+		EndFrame();
+		if(!OpenNextFile())
+			return;
+		m_FileStartTick = Tick;
+	}
+	if(m_FrameOpen && (m_FrameSize >= FRAME_SIZE || Tick - m_FrameStartTick >= m_FrameTicks))
+		EndFrame();
+}
+
+bool CTeeHistorianFileWriter::ReadFile(IOHANDLE File, std::vector<unsigned char> *pvData)
+{
+	unsigned char aMagic[sizeof(gs_aTeeHistorianFileMagic)];
+	if(io_read(File, aMagic, sizeof(aMagic)) != sizeof(aMagic) || mem_comp(aMagic, gs_aTeeHistorianFileMagic, sizeof(aMagic)) != 0)
+	{
+		// not compressed
+		const long Length = io_length(File);
+		if(Length < 0)
+			return false;
+		const size_t Start = pvData->size();
+		pvData->resize(Start + Length);
+		io_seek(File, 0, IOSEEK_START);
+		return io_read(File, pvData->data() + Start, Length) == (unsigned)Length;
+	}
+
+	std::vector<unsigned char> vFrame;
+	while(true)
+	{
+		unsigned char aHeader[8];
+		const unsigned Read = io_read(File, aHeader, sizeof(aHeader));
+		if(Read == 0)
+			return true;
+		if(Read != sizeof(aHeader))
+			return false;
+
+		const unsigned FrameSize = bytes_be_to_uint(aHeader);
+		uLongf DataSize = bytes_be_to_uint(aHeader + 4);
+		vFrame.resize(FrameSize);
+		if(io_read(File, vFrame.data(), FrameSize) != FrameSize)
+			return false;
+
+		const size_t Start = pvData->size();
+		const uLongf ExpectedSize = DataSize;
+		pvData->resize(Start + DataSize);
+		if(uncompress(pvData->data() + Start, &DataSize, vFrame.data(), FrameSize) != Z_OK || DataSize != ExpectedSize)
+			return false;
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef GAME_SERVER_TEEHISTORIAN_FILE_H
+#define GAME_SERVER_TEEHISTORIAN_FILE_H
+
+#include <base/system.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+class IStorage;
+
+/*
+	Writes the teehistorian stream on its own thread, optionally compressed
+	and split into several files.
+
+	Compressed files start with the 8 byte magic "TWTHZ\0\0\1", followed
+	by frames of a 4 byte big endian compressed size, a 4 byte big endian
+	uncompressed size and a complete zlib stream. Frames start at tick
+	boundaries and can be decompressed on their own.
+
+	Files are rotated by size or by ticks, the decompressed files simply
+	continue each other. The sidecar index <basename>.teehistorian.index has
+	a line "<tick> <file> <offset> <stream offset>" for every frame, the
+	offset is in the file, the stream offset in the decompressed data of all
+	files together.
+*/
+class CTeeHistorianFileWriter
+{
+	IStorage *m_pStorage;
+	char m_aBasename[IO_MAX_PATH_LENGTH];
+	bool m_Compress;
+	int64_t m_RotateSize;
+	int m_RotateTicks;
+	int m_FrameTicks;
+
+	std::thread m_Thread;
+	std::mutex m_Lock;
+	std::condition_variable m_DataAdded;
+	// game thread side, swapped out by the writer thread
+	std::vector<unsigned char> m_vPending;
+	std::vector<std::pair<int, int>> m_vPendingTicks;
+	bool m_Shutdown = false;
+	int m_Error = 0;
+
+	// writer thread side
+	IOHANDLE m_File = nullptr;
+	IOHANDLE m_IndexFile = nullptr;
+	int m_NumFiles = 0;
+	int64_t m_FileSize = 0;
+	int m_FileStartTick = -1;
+	int64_t m_StreamOffset = 0;
+	bool m_FrameOpen = false;
+	int m_FrameStartTick = -1;
+	int m_FrameSize = 0;
+	std::vector<unsigned char> m_vFrame;
+	z_stream m_Stream;
+	int m_LastTick = -1;
+
+	void Run();
+	bool OpenNextFile();
+	void BeginFrame(int Tick);
+	void EndFrame();
+	void Deflate(const unsigned char *pData, int Size, int Flush);
+	void WriteData(const unsigned char *pData, int Size);
+	void OnTick(int Tick);
+	void SetError(int Error);
+
+public:
+	enum
+	{
+		FRAME_SIZE = 256 * 1024,
+	};
+
+	CTeeHistorianFileWriter();
+	~CTeeHistorianFileWriter();
+
+	// pBasename is without extension, RotateSize in bytes, 0 disables rotation by size or ticks
+	bool Open(IStorage *pStorage, const char *pBasename, bool Compress, int64_t RotateSize, int RotateTicks, int FrameTicks);
+	// writes everything that is queued and closes the files
+	void Close();
+
+	void Write(const void *pData, int Size);
+	// the following data belongs to this tick
+	void MarkTick(int Tick);
+
+	// non-zero if writing failed
+	int Error();
+	// only valid after closing
+	int NumFiles() const { return m_NumFiles; }
+	// returns the file name of the nth file of a recording
+	static void FileName(char *pBuf, int BufSize, const char *pBasename, bool Compress, bool Rotate, int Index);
+	// appends the decompressed contents of a teehistorian file, which can be compressed or not
+	static bool ReadFile(IOHANDLE File, std::vector<unsigned char> *pvData);
+};
+
+#endif
@@ -0,0 +1,352 @@
+#include "teehistorian_reader.h"
+#include "teehistorian.h"
+
+#include <engine/shared/json.h>
+
+static const CUuid TEEHISTORIAN_UUID = CalculateUuid("teehistorian@ddnet.tw");
+
+static CTeeHistorianReader::IListener s_NoListener;
+
+CTeeHistorianReader::CTeeHistorianReader()
+{
+	m_pListener = &s_NoListener;
+	m_pHeader = nullptr;
+	m_Version = 0;
+	m_aGameUuid[0] = '\0';
+	m_aMapName[0] = '\0';
+	m_aMapSha256[0] = '\0';
+	m_aError[0] = '\0';
+}
+
+CTeeHistorianReader::~CTeeHistorianReader()
+{
+	if(m_pHeader)
+		json_value_free(m_pHeader);
+}
+
+bool CTeeHistorianReader::SetError(const char *pError)
+{
+	if(!m_aError[0])
+		str_format(m_aError, sizeof(m_aError), "%s at tick %d", pError, m_Tick);
+	return false;
+}
+
+bool CTeeHistorianReader::Init(const unsigned char *pData, int Size)
+{
+	m_Tick = 0;
+	m_LastPlayerClientID = MAX_CLIENTS;
+	m_AfterTickSkip = false;
+	m_Finished = false;
+	m_aError[0] = '\0';
+	for(auto &Player : m_aPlayers)
+	{
+		mem_zero(&Player, sizeof(Player));
+	}
+
+	if(Size < (int)sizeof(TEEHISTORIAN_UUID) || mem_comp(pData, &TEEHISTORIAN_UUID, sizeof(TEEHISTORIAN_UUID)) != 0)
+		return SetError("not a teehistorian file");
+	const unsigned char *pJson = pData + sizeof(TEEHISTORIAN_UUID);
+	const unsigned char *pJsonEnd = pJson;
+	while(pJsonEnd < pData + Size && *pJsonEnd)
+		pJsonEnd++;
+	if(pJsonEnd == pData + Size)
+		return SetError("header not terminated");
+
+	if(m_pHeader)
+		json_value_free(m_pHeader);
+	m_pHeader = json_parse((const json_char *)pJson, pJsonEnd - pJson);
+	if(!m_pHeader || m_pHeader->type != json_object)
+		return SetError("invalid header");
+
+	const json_value *pVersion = json_object_get(m_pHeader, "version");
+	m_Version = pVersion->type == json_string ? str_toint(json_string_get(pVersion)) : 0;
+	if(m_Version != CTeeHistorian::VERSION_2 && m_Version != CTeeHistorian::VERSION_3)
+	{
+		char aError[64];
+		str_format(aError, sizeof(aError), "unsupported version %d", m_Version);
+		return SetError(aError);
+	}
+	const json_value *pGameUuid = json_object_get(m_pHeader, "game_uuid");
+	if(pGameUuid->type == json_string)
+		str_copy(m_aGameUuid, json_string_get(pGameUuid));
+	const json_value *pMapName = json_object_get(m_pHeader, "map_name");
+	if(pMapName->type == json_string)
+		str_copy(m_aMapName, json_string_get(pMapName));
+	const json_value *pMapSha256 = json_object_get(m_pHeader, "map_sha256");
+	if(pMapSha256->type == json_string)
+		str_copy(m_aMapSha256, json_string_get(pMapSha256));
+
+	const unsigned char *pRecords = pJsonEnd + 1;
+	m_Unpacker.Reset(pRecords, pData + Size - pRecords);
+	return true;
+}
+
+bool CTeeHistorianReader::MapSha256(SHA256_DIGEST *pSha256) const
+{
+	return m_aMapSha256[0] && sha256_from_str(pSha256, m_aMapSha256) == 0;
+}
+
+void CTeeHistorianReader::EndTicks(int NumTicks)
+{
+	for(int i = 0; i < NumTicks; i++)
+	{
+		m_pListener->OnTickEnd(m_Tick);
+		m_Tick++;
+		if(m_Version >= CTeeHistorian::VERSION_3)
+		{
+			for(auto &Player : m_aPlayers)
+			{
+				if(Player.m_Alive)
+				{
+					Player.m_X += Player.m_DX;
+					Player.m_Y += Player.m_DY;
+				}
+			}
+		}
+	}
+}
+
+void CTeeHistorianReader::PlayerRecord(int ClientID)
+{
+	// version 2 ticks are implicit as long as the client IDs ascend
+	if(ClientID <= m_LastPlayerClientID)
+		EndTicks(1);
+	m_LastPlayerClientID = ClientID;
+}
+
+bool CTeeHistorianReader::ReadPlayers()
+{
+	if(!m_AfterTickSkip)
+		EndTicks(1);
+
+	const int NumMaskBytes = m_Unpacker.GetInt();
+	if(NumMaskBytes < 0 || NumMaskBytes > (MAX_CLIENTS + 7) / 8)
+		return SetError("invalid players record");
+	const unsigned char *pMask = m_Unpacker.GetRaw(NumMaskBytes);
+	if(m_Unpacker.Error())
+		return SetError("truncated players record");
+
+	int NumChanged = 0;
+	for(int i = 0; i < NumMaskBytes; i++)
+	{
+		for(int Bits = pMask[i]; Bits; Bits &= Bits - 1)
+			NumChanged++;
+	}
+	const unsigned char *pKinds = m_Unpacker.GetRaw((NumChanged * 2 + 7) / 8);
+	if(m_Unpacker.Error())
+		return SetError("truncated players record");
+
+	int Changed = 0;
+	for(int ClientID = 0; ClientID < NumMaskBytes * 8; ClientID++)
+	{
+		if(!(pMask[ClientID / 8] & (1 << (ClientID % 8))))
+			continue;
+		if(ClientID >= MAX_CLIENTS)
+			return SetError("invalid client id");
+
+		CPlayer *pPlayer = &m_aPlayers[ClientID];
+		const int Kind = (pKinds[Changed / 4] >> (Changed % 4 * 2)) & 3;
+		Changed++;
+		switch(Kind)
+		{
+		case TEEHISTORIAN_PLAYERS_NEW:
+			pPlayer->m_Alive = true;
+			pPlayer->m_X = m_Unpacker.GetInt();
+			pPlayer->m_Y = m_Unpacker.GetInt();
+			pPlayer->m_DX = 0;
+			pPlayer->m_DY = 0;
+			break;
+		case TEEHISTORIAN_PLAYERS_OLD:
+			pPlayer->m_Alive = false;
+			break;
+		case TEEHISTORIAN_PLAYERS_ACCEL:
+		case TEEHISTORIAN_PLAYERS_ACCEL_Y:
+		{
+			// the prediction has already been applied
+			const int DDX = Kind == TEEHISTORIAN_PLAYERS_ACCEL ? m_Unpacker.GetInt() : 0;
+			const int DDY = m_Unpacker.GetInt();
+			pPlayer->m_DX += DDX;
+			pPlayer->m_DY += DDY;
+			pPlayer->m_X += DDX;
+			pPlayer->m_Y += DDY;
+			break;
+		}
+		}
+	}
+	if(m_Unpacker.Error())
+		return SetError("truncated players record");
+	return true;
+}
+
+bool CTeeHistorianReader::ReadInput(int Type)
+{
+	const int ClientID = m_Unpacker.GetInt();
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS)
+		return SetError("invalid client id");
+
+	CPlayer *pPlayer = &m_aPlayers[ClientID];
+	int *pInput = (int *)&pPlayer->m_Input;
+	const int NumInts = sizeof(pPlayer->m_Input) / sizeof(int);
+	if(Type == TEEHISTORIAN_INPUT_NEW)
+	{
+		for(int i = 0; i < NumInts; i++)
+			pInput[i] = m_Unpacker.GetInt();
+	}
+	else if(Type == TEEHISTORIAN_INPUT_DIFF)
+	{
+		for(int i = 0; i < NumInts; i++)
+			pInput[i] += m_Unpacker.GetInt();
+	}
+	else
+	{
+		const int Mask = m_Unpacker.GetInt();
+		for(int i = 0; i < NumInts; i++)
+		{
+			if(Mask & (1 << i))
+				pInput[i] += m_Unpacker.GetInt();
+		}
+	}
+	if(m_Unpacker.Error())
+		return SetError("truncated input record");
+
+	pPlayer->m_HasInput = true;
+	m_pListener->OnInput(ClientID, &pPlayer->m_Input);
+	return true;
+}
+
+bool CTeeHistorianReader::ReadRecord()
+{
+	if(m_Finished || m_aError[0])
+		return false;
+
+	const int Type = m_Unpacker.GetInt();
+	if(m_Unpacker.Error())
+	{
+		// the server didn't shut down cleanly, the last tick is still complete
+		EndTicks(1);
+		return SetError("missing finish record");
+	}
+
+	const bool AfterTickSkip = m_AfterTickSkip;
+	m_AfterTickSkip = false;
+
+	if(Type >= 0)
+	{
+		// version 2 position diff, the type is the client ID
+		if(Type >= MAX_CLIENTS)
+			return SetError("invalid client id");
+		PlayerRecord(Type);
+		CPlayer *pPlayer = &m_aPlayers[Type];
+		pPlayer->m_X += m_Unpacker.GetInt();
+		pPlayer->m_Y += m_Unpacker.GetInt();
+		if(m_Unpacker.Error())
+			return SetError("truncated player record");
+		return true;
+	}
+
+	switch(-Type)
+	{
+	case TEEHISTORIAN_FINISH:
+		EndTicks(1);
+		m_Finished = true;
+		return false;
+	case TEEHISTORIAN_TICK_SKIP:
+	{
+		const int Dt = m_Unpacker.GetInt();
+		if(m_Unpacker.Error() || Dt < 0)
+			return SetError("invalid tick skip");
+		EndTicks(Dt + 1);
+		m_LastPlayerClientID = -1;
+		m_AfterTickSkip = true;
+		return true;
+	}
+	case TEEHISTORIAN_PLAYER_NEW:
+	case TEEHISTORIAN_PLAYER_OLD:
+	{
+		const int ClientID = m_Unpacker.GetInt();
+		if(ClientID < 0 || ClientID >= MAX_CLIENTS)
+			return SetError("invalid client id");
+		PlayerRecord(ClientID);
+		CPlayer *pPlayer = &m_aPlayers[ClientID];
+		pPlayer->m_Alive = -Type == TEEHISTORIAN_PLAYER_NEW;
+		if(pPlayer->m_Alive)
+		{
+			pPlayer->m_X = m_Unpacker.GetInt();
+			pPlayer->m_Y = m_Unpacker.GetInt();
+		}
+		if(m_Unpacker.Error())
+			return SetError("truncated player record");
+		return true;
+	}
+	case TEEHISTORIAN_PLAYERS:
+		m_AfterTickSkip = AfterTickSkip;
+		if(!ReadPlayers())
+			return false;
+		m_AfterTickSkip = false;
+		return true;
+	case TEEHISTORIAN_INPUT_NEW:
+	case TEEHISTORIAN_INPUT_DIFF:
+	case TEEHISTORIAN_INPUT_DIFF_MASKED:
+		return ReadInput(-Type);
+	case TEEHISTORIAN_MESSAGE:
+	{
+		const int ClientID = m_Unpacker.GetInt();
+		const int MsgSize = m_Unpacker.GetInt();
+		const unsigned char *pMsg = m_Unpacker.GetRaw(MsgSize);
+		if(m_Unpacker.Error())
+			return SetError("truncated message record");
+		m_pListener->OnMessage(ClientID, pMsg, MsgSize);
+		return true;
+	}
+	case TEEHISTORIAN_JOIN:
+	{
+		const int ClientID = m_Unpacker.GetInt();
+		if(m_Unpacker.Error() || ClientID < 0 || ClientID >= MAX_CLIENTS)
+			return SetError("invalid join record");
+		m_pListener->OnJoin(ClientID);
+		return true;
+	}
+	case TEEHISTORIAN_DROP:
+	{
+		const int ClientID = m_Unpacker.GetInt();
+		const char *pReason = m_Unpacker.GetString(0);
+		if(m_Unpacker.Error() || ClientID < 0 || ClientID >= MAX_CLIENTS)
+			return SetError("invalid drop record");
+		// keep the input, the writer diffs against it if the same client
+		// comes back
+		m_aPlayers[ClientID].m_HasInput = false;
+		m_pListener->OnDrop(ClientID, pReason);
+		return true;
+	}
+	case TEEHISTORIAN_CONSOLE_COMMAND:
+	{
+		const int ClientID = m_Unpacker.GetInt();
+		const int FlagMask = m_Unpacker.GetInt();
+		const char *pCmd = m_Unpacker.GetString(0);
+		const int NumArgs = m_Unpacker.GetInt();
+		m_vpArgs.clear();
+		for(int i = 0; i < NumArgs && !m_Unpacker.Error(); i++)
+			m_vpArgs.push_back(m_Unpacker.GetString(0));
+		if(m_Unpacker.Error())
+			return SetError("truncated console command record");
+		m_pListener->OnConsoleCommand(ClientID, FlagMask, pCmd, NumArgs, m_vpArgs.data());
+		return true;
+	}
+	case TEEHISTORIAN_EX:
+	{
+		const unsigned char *pUuid = m_Unpacker.GetRaw(sizeof(CUuid));
+		const int DataSize = m_Unpacker.GetInt();
+		const unsigned char *pData = m_Unpacker.GetRaw(DataSize);
+		if(m_Unpacker.Error())
+			return SetError("truncated extra record");
+		CUuid Uuid;
+		mem_copy(&Uuid, pUuid, sizeof(Uuid));
+		m_pListener->OnExtra(Uuid, pData, DataSize);
+		return true;
+	}
+	}
+
+	char aError[64];
+	str_format(aError, sizeof(aError), "unknown record type %d", Type);
+	return SetError(aError);
+}
@@ -0,0 +1,101 @@
+#ifndef GAME_SERVER_TEEHISTORIAN_READER_H
+#define GAME_SERVER_TEEHISTORIAN_READER_H
+
+#include <base/hash.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/uuid_manager.h>
+#include <game/generated/protocol.h>
+
+#include <vector>
+
+typedef struct _json_value json_value;
+
+// Reads the decompressed teehistorian stream of versions 2 and 3 and keeps
+// track of the player positions and inputs like the writer does.
+class CTeeHistorianReader
+{
+public:
+	class IListener
+	{
+	public:
+		virtual ~IListener() = default;
+
+		// all records of this tick have been read, the player positions
+		// are the ones at the end of the tick and the inputs are the ones
+		// used for the next tick
+		virtual void OnTickEnd(int Tick) {}
+		virtual void OnInput(int ClientID, const CNetObj_PlayerInput *pInput) {}
+		virtual void OnJoin(int ClientID) {}
+		virtual void OnDrop(int ClientID, const char *pReason) {}
+		virtual void OnMessage(int ClientID, const void *pMsg, int MsgSize) {}
+		virtual void OnConsoleCommand(int ClientID, int FlagMask, const char *pCmd, int NumArgs, const char *const *ppArgs) {}
+		virtual void OnExtra(CUuid Uuid, const void *pData, int DataSize) {}
+	};
+
+	struct CPlayer
+	{
+		bool m_Alive;
+		int m_X;
+		int m_Y;
+		// velocity predicted by version 3
+		int m_DX;
+		int m_DY;
+
+		bool m_HasInput;
+		CNetObj_PlayerInput m_Input;
+	};
+
+	CTeeHistorianReader();
+	~CTeeHistorianReader();
+
+	void SetListener(IListener *pListener) { m_pListener = pListener; }
+	// reads the header, the data must stay valid while reading
+	bool Init(const unsigned char *pData, int Size);
+	// reads the next record, false at the end of the data or on errors
+	bool ReadRecord();
+
+	bool Finished() const { return m_Finished; }
+	const char *Error() const { return m_aError; }
+
+	int Version() const { return m_Version; }
+	int Tick() const { return m_Tick; }
+	const CPlayer *Player(int ClientID) const { return &m_aPlayers[ClientID]; }
+
+	const char *GameUuid() const { return m_aGameUuid; }
+	const char *MapName() const { return m_aMapName; }
+	bool MapSha256(SHA256_DIGEST *pSha256) const;
+	// the parsed JSON header, e.g. for the "config" and "tuning" objects
+	const json_value *Header() const { return m_pHeader; }
+
+private:
+	void EndTicks(int NumTicks);
+	void PlayerRecord(int ClientID);
+	bool ReadPlayers();
+	bool ReadInput(int Type);
+	bool SetError(const char *pError);
+
+	IListener *m_pListener;
+	CUnpacker m_Unpacker;
+	json_value *m_pHeader;
+
+	int m_Version;
+	char m_aGameUuid[UUID_MAXSTRSIZE];
+	char m_aMapName[128];
+	char m_aMapSha256[SHA256_MAXSTRSIZE];
+
+	int m_Tick;
+	// version 2: the last client ID of a player record, a lower or equal
+	// one starts a new tick
+	int m_LastPlayerClientID;
+	// version 3: a players record directly after a tick skip belongs to
+	// that tick
+	bool m_AfterTickSkip;
+	bool m_Finished;
+	char m_aError[128];
+
+	CPlayer m_aPlayers[MAX_CLIENTS];
+	std::vector<const char *> m_vpArgs;
+};
+
+#endif
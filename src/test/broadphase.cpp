@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <game/gamecore.h>
+#include <game/teamscore.h>
+
+#include <random>
+#include <vector>
+
+struct Broadphase : public testing::Test
+{
+	CWorldCore m_World;
+	CTeamsCore m_Teams;
+	CCharacterCore m_aCores[MAX_CLIENTS];
+	std::mt19937 m_Rng{42};
+
+	Broadphase()
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			m_aCores[i].Init(&m_World, nullptr, &m_Teams);
+			m_aCores[i].m_Id = i;
+			if(i % 5 != 4)
+				Add(i);
+		}
+	}
+
+	void Add(int ClientID)
+	{
+		m_World.m_apCharacters[ClientID] = &m_aCores[ClientID];
+		Place(ClientID);
+	}
+
+	void Place(int ClientID)
+	{
+		std::uniform_real_distribution<float> Coord(0.0f, 1000.0f);
+		m_aCores[ClientID].m_Pos = vec2(Coord(m_Rng), Coord(m_Rng));
+		m_Teams.Team(ClientID, m_Rng() % 8 == 0 ? (int)TEAM_SUPER : (int)(m_Rng() % 3));
+		m_aCores[ClientID].m_Super = m_Rng() % 16 == 0;
+	}
+
+	bool AnyTeam(int ClientID)
+	{
+		return m_aCores[ClientID].m_Super || m_Teams.Team(ClientID) == TEAM_SUPER;
+	}
+
+	// what the linear scan finds, minus the characters of other teams
+	std::vector<int> Expected(vec2 Pos, float Radius, int Exclude, int Include)
+	{
+		int aIds[MAX_CLIENTS];
+		CWorldCore Scan = m_World;
+		Scan.ClearBroadphase();
+		int NumIds = Scan.FindCharacters(Pos, Radius, &m_aCores[Exclude], Include, aIds);
+		std::vector<int> vExpected;
+		for(int i = 0; i < NumIds; i++)
+			if(AnyTeam(Exclude) || AnyTeam(aIds[i]) || m_Teams.Team(aIds[i]) == m_Teams.Team(Exclude) || aIds[i] == Include)
+				vExpected.push_back(aIds[i]);
+		return vExpected;
+	}
+
+	std::vector<int> Found(vec2 Pos, float Radius, int Exclude, int Include)
+	{
+		int aIds[MAX_CLIENTS];
+		int NumIds = m_World.FindCharacters(Pos, Radius, &m_aCores[Exclude], Include, aIds);
+		return std::vector<int>(aIds, aIds + NumIds);
+	}
+};
+
+TEST_F(Broadphase, SameAsScan)
+{
+	m_World.BuildBroadphase();
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_World.m_apCharacters[i])
+			continue;
+		const int Include = m_Rng() % 4 == 0 ? (int)(m_Rng() % MAX_CLIENTS) : -1;
+		const float Radius = m_Rng() % 2 ? 35.0f : 300.0f;
+		EXPECT_EQ(Found(m_aCores[i].m_Pos, Radius, i, Include), Expected(m_aCores[i].m_Pos, Radius, i, Include)) << i;
+	}
+}
+
+TEST_F(Broadphase, Updates)
+{
+	m_World.BuildBroadphase();
+	for(int Round = 0; Round < 20; Round++)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			switch(m_Rng() % 6)
+			{
+			case 0:
+				m_World.m_apCharacters[i] = nullptr;
+				break;
+			case 1:
+				Add(i);
+				break;
+			case 2:
+				if(m_World.m_apCharacters[i])
+					Place(i);
+				break;
+			default:
+				m_aCores[i].m_Pos += vec2((m_Rng() % 21) - 10.0f, (m_Rng() % 21) - 10.0f);
+			}
+			m_World.UpdateBroadphase(i);
+		}
+
+		// the updated index has to find the same as the scan
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(!m_World.m_apCharacters[i])
+				continue;
+			EXPECT_EQ(Found(m_aCores[i].m_Pos, 100.0f, i, -1), Expected(m_aCores[i].m_Pos, 100.0f, i, -1)) << Round << " " << i;
+		}
+	}
+}
@@ -0,0 +1,443 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/shared/config.h>
+#include <engine/storage.h>
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include <random>
+#include <vector>
+
+static const char *const s_apMaps[] = {
+	"data/maps/coverage.map",
+	"data/maps/Gold Mine.map",
+	"data/maps/LearnToPlay.map",
+	"data/maps/Sunny Side Up.map",
+	"data/maps/Tsunami.map",
+	"data/maps/Tutorial.map",
+	"data/maps/ctf1.map",
+	"data/maps/dm1.map",
+};
+
+class Collision : public ::testing::TestWithParam<const char *>
+{
+protected:
+	IKernel *m_pKernel;
+	IEngineMap *m_pMap;
+	CLayers m_Layers;
+	CCollision m_Collision;
+
+	void SetUp() override
+	{
+		m_pKernel = IKernel::Create();
+		m_pMap = CreateEngineMap();
+		m_pKernel->RegisterInterface(m_pMap);
+		m_pKernel->RegisterInterface(static_cast<IMap *>(m_pMap), false);
+		m_pKernel->RegisterInterface(CreateLocalStorage());
+		ASSERT_TRUE(m_pMap->Load(GetParam())) << GetParam();
+		m_Layers.Init(m_pKernel);
+		m_Collision.Init(&m_Layers);
+	}
+
+	void TearDown() override
+	{
+		m_Collision.Dest();
+		delete m_pKernel;
+	}
+
+	void ExpectFlagsMatch()
+	{
+		for(int i = 0; i < m_Collision.GetWidth() * m_Collision.GetHeight(); i++)
+		{
+			ASSERT_EQ(m_Collision.GetTileFlagsCached(i), m_Collision.ComputeTileFlags(i)) << "tile " << i;
+			ASSERT_EQ(m_Collision.TileExists(i), m_Collision.ComputeTileFlags(i) != 0) << "tile " << i;
+		}
+		EXPECT_FALSE(m_Collision.TileExists(-1));
+	}
+};
+
+TEST_P(Collision, TileFlagsMatchLayers)
+{
+	ExpectFlagsMatch();
+}
+
+TEST_P(Collision, TileFlagsFollowChanges)
+{
+	std::mt19937 Rng(1234);
+	std::uniform_int_distribution<int> RandX(0, m_Collision.GetWidth() * 32 - 1);
+	std::uniform_int_distribution<int> RandY(0, m_Collision.GetHeight() * 32 - 1);
+	static const int s_aDoorTypes[] = {0, TILE_STOP, TILE_STOPS, TILE_STOPA, TILE_FREEZE, TILE_SOLID};
+	static const int s_aRotations[] = {ROTATION_0, ROTATION_90, ROTATION_180, ROTATION_270};
+	for(int i = 0; i < 2000; i++)
+	{
+		float x = RandX(Rng);
+		float y = RandY(Rng);
+		if(i % 2)
+			m_Collision.SetDCollisionAt(x, y, s_aDoorTypes[Rng() % std::size(s_aDoorTypes)], s_aRotations[Rng() % std::size(s_aRotations)], Rng() % 4);
+		else
+			m_Collision.SetCollisionAt(x, y, s_aDoorTypes[Rng() % std::size(s_aDoorTypes)]);
+	}
+	ExpectFlagsMatch();
+}
+
+// the sampling implementation GetMapIndices has to reproduce
+static std::vector<int> ReferenceMapIndices(const CCollision &Collision, vec2 PrevPos, vec2 Pos)
+{
+	std::vector<int> vIndices;
+	float d = distance(PrevPos, Pos);
+	int End(d + 1);
+	if(!d)
+	{
+		int Index = clamp((int)Pos.y / 32, 0, Collision.GetHeight() - 1) * Collision.GetWidth() + clamp((int)Pos.x / 32, 0, Collision.GetWidth() - 1);
+		if(Collision.TileExists(Index))
+			vIndices.push_back(Index);
+		return vIndices;
+	}
+	int LastIndex = 0;
+	for(int i = 0; i < End; i++)
+	{
+		float a = i / d;
+		vec2 Tmp = mix(PrevPos, Pos, a);
+		int Nx = clamp((int)Tmp.x / 32, 0, Collision.GetWidth() - 1);
+		int Ny = clamp((int)Tmp.y / 32, 0, Collision.GetHeight() - 1);
+		int Index = Ny * Collision.GetWidth() + Nx;
+		if(Collision.TileExists(Index) && LastIndex != Index)
+		{
+			vIndices.push_back(Index);
+			LastIndex = Index;
+		}
+	}
+	return vIndices;
+}
+
+TEST_P(Collision, MapIndicesMatchSampling)
+{
+	std::mt19937 Rng(4321);
+	std::uniform_real_distribution<float> RandX(-100.0f, m_Collision.GetWidth() * 32 + 100.0f);
+	std::uniform_real_distribution<float> RandY(-100.0f, m_Collision.GetHeight() * 32 + 100.0f);
+	std::uniform_real_distribution<float> RandDelta(-300.0f, 300.0f);
+	std::vector<int> vIndices;
+	for(int i = 0; i < 20000; i++)
+	{
+		vec2 PrevPos(RandX(Rng), RandY(Rng));
+		vec2 Pos;
+		switch(i % 4)
+		{
+		case 0:
+			Pos = vec2(RandX(Rng), RandY(Rng));
+			break;
+		case 1:
+			Pos = PrevPos + vec2(RandDelta(Rng), RandDelta(Rng));
+			break;
+		case 2:
+			Pos = PrevPos + vec2(RandDelta(Rng), 0.0f);
+			break;
+		default:
+			// along a grid line
+			Pos = vec2(round_to_int(PrevPos.x / 32) * 32, PrevPos.y + RandDelta(Rng));
+			break;
+		}
+		std::vector<int> vExpected = ReferenceMapIndices(m_Collision, PrevPos, Pos);
+		vIndices.resize(vExpected.size() + 1);
+		vIndices.resize(m_Collision.GetMapIndices(PrevPos, Pos, vIndices.data(), vIndices.size()));
+		ASSERT_EQ(vIndices, vExpected) << PrevPos.x << "," << PrevPos.y << " -> " << Pos.x << "," << Pos.y;
+	}
+}
+
+TEST_P(Collision, MapIndicesLimit)
+{
+	int aIndices[2];
+	for(int y = 0; y < m_Collision.GetHeight(); y++)
+	{
+		vec2 PrevPos(0.0f, y * 32 + 16);
+		vec2 Pos(m_Collision.GetWidth() * 32 - 1, y * 32 + 16);
+		std::vector<int> vExpected = ReferenceMapIndices(m_Collision, PrevPos, Pos);
+		vExpected.resize(minimum<size_t>(vExpected.size(), std::size(aIndices)));
+		int NumIndices = m_Collision.GetMapIndices(PrevPos, Pos, aIndices, std::size(aIndices));
+		ASSERT_EQ(std::vector<int>(aIndices, aIndices + NumIndices), vExpected);
+	}
+}
+
+TEST_P(Collision, MapIndicesContinued)
+{
+	// fast tees pass more tiles than the callers' buffers hold
+	int aIndices[3];
+	for(int y = 0; y < m_Collision.GetHeight(); y++)
+	{
+		vec2 PrevPos(0.0f, y * 32 + 16);
+		vec2 Pos(m_Collision.GetWidth() * 32 - 1, y * 32 + 16 + (y % 7) * 13);
+		std::vector<int> vExpected = ReferenceMapIndices(m_Collision, PrevPos, Pos);
+		std::vector<int> vIndices;
+		int Sample = 0;
+		do
+		{
+			int NumIndices = m_Collision.GetMapIndices(PrevPos, Pos, aIndices, std::size(aIndices), &Sample);
+			vIndices.insert(vIndices.end(), aIndices, aIndices + NumIndices);
+		} while(Sample >= 0);
+		ASSERT_EQ(vIndices, vExpected) << y;
+	}
+}
+
+TEST_P(Collision, MapIndicesWalked)
+{
+	for(int y = 0; y < m_Collision.GetHeight(); y++)
+	{
+		vec2 PrevPos(0.0f, y * 32 + 16);
+		vec2 Pos(m_Collision.GetWidth() * 32 - 1, y * 32 + 16 + (y % 7) * 13);
+		std::vector<int> vExpected = ReferenceMapIndices(m_Collision, PrevPos, Pos);
+		std::vector<int> vIndices;
+		EXPECT_EQ(m_Collision.WalkMapIndices(PrevPos, Pos, [&](int Index) {
+			vIndices.push_back(Index);
+			return true;
+		}),
+			(int)vExpected.size());
+		ASSERT_EQ(vIndices, vExpected) << y;
+
+		// stops at the first tile the callback rejects
+		if(vExpected.size() < 2)
+			continue;
+		vIndices.clear();
+		EXPECT_EQ(m_Collision.WalkMapIndices(PrevPos, Pos, [&](int Index) {
+			vIndices.push_back(Index);
+			return vIndices.size() < 2;
+		}),
+			2);
+		ASSERT_EQ(vIndices, std::vector<int>(vExpected.begin(), vExpected.begin() + 2)) << y;
+	}
+}
+
+// the per-sample implementations the accelerated IntersectLine family has to reproduce
+static int ReferenceIntersectLine(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	vec2 Last = Pos0;
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i / (float)End;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+		if(Collision.CheckPoint(ix, iy))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return Collision.GetCollisionAt(ix, iy);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int ReferenceIntersectLineTele(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision, int *pTeleNr, bool Hook)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance + 1);
+	vec2 Last = Pos0;
+	int dx = 0, dy = 0;
+	ThroughOffset(Pos0, Pos1, &dx, &dy);
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i / (float)End;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int ix = round_to_int(Pos.x);
+		int iy = round_to_int(Pos.y);
+
+		int Index = Collision.GetPureMapIndex(Pos);
+		if(Hook)
+			*pTeleNr = g_Config.m_SvOldTeleportHook ? Collision.IsTeleport(Index) : Collision.IsTeleportHook(Index);
+		else
+			*pTeleNr = g_Config.m_SvOldTeleportWeapons ? Collision.IsTeleport(Index) : Collision.IsTeleportWeapon(Index);
+		if(*pTeleNr)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return Hook ? TILE_TELEINHOOK : TILE_TELEINWEAPON;
+		}
+
+		int Hit = 0;
+		if(Collision.CheckPoint(ix, iy))
+		{
+			if(!Hook || !Collision.IsThrough(ix, iy, dx, dy, Pos0, Pos1))
+				Hit = Collision.GetCollisionAt(ix, iy);
+		}
+		else if(Hook && Collision.IsHookBlocker(ix, iy, Pos0, Pos1))
+		{
+			Hit = TILE_NOHOOK;
+		}
+		if(Hit)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return Hit;
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int ReferenceIntersectNoLaser(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float d = distance(Pos0, Pos1);
+	vec2 Last = Pos0;
+	for(int i = 0, id = (int)ceilf(d); i < id; i++)
+	{
+		float a = (int)i / d;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		int Nx = clamp(round_to_int(Pos.x) / 32, 0, Collision.GetWidth() - 1);
+		int Ny = clamp(round_to_int(Pos.y) / 32, 0, Collision.GetHeight() - 1);
+		if(Collision.GetIndex(Nx, Ny) == TILE_SOLID || Collision.GetIndex(Nx, Ny) == TILE_NOHOOK || Collision.GetIndex(Nx, Ny) == TILE_NOLASER || Collision.GetFIndex(Nx, Ny) == TILE_NOLASER)
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			if(Collision.GetFIndex(Nx, Ny) == TILE_NOLASER)
+				return Collision.GetFCollisionAt(Pos.x, Pos.y);
+			else
+				return Collision.GetCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static int ReferenceIntersectNoLaserNW(const CCollision &Collision, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float d = distance(Pos0, Pos1);
+	vec2 Last = Pos0;
+	for(int i = 0, id = (int)ceilf(d); i < id; i++)
+	{
+		float a = (float)i / d;
+		vec2 Pos = mix(Pos0, Pos1, a);
+		if(Collision.IsNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)) || Collision.IsFNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			if(Collision.IsNoLaser(round_to_int(Pos.x), round_to_int(Pos.y)))
+				return Collision.GetCollisionAt(Pos.x, Pos.y);
+			else
+				return Collision.GetFCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static void ExpectSameVec(vec2 Expected, vec2 Actual)
+{
+	ASSERT_EQ(mem_comp(&Expected, &Actual, sizeof(vec2)), 0) << Expected.x << "," << Expected.y << " != " << Actual.x << "," << Actual.y;
+}
+
+static void CompareIntersections(const CCollision &Collision, vec2 Pos0, vec2 Pos1)
+{
+	SCOPED_TRACE(testing::Message() << Pos0.x << "," << Pos0.y << " -> " << Pos1.x << "," << Pos1.y);
+	vec2 aExpected[2], aActual[2];
+	int ExpectedTele, ActualTele;
+
+	ASSERT_EQ(Collision.IntersectLine(Pos0, Pos1, &aActual[0], &aActual[1]), ReferenceIntersectLine(Collision, Pos0, Pos1, &aExpected[0], &aExpected[1]));
+	ExpectSameVec(aExpected[0], aActual[0]);
+	ExpectSameVec(aExpected[1], aActual[1]);
+
+	ASSERT_EQ(Collision.IntersectLineTeleHook(Pos0, Pos1, &aActual[0], &aActual[1], &ActualTele), ReferenceIntersectLineTele(Collision, Pos0, Pos1, &aExpected[0], &aExpected[1], &ExpectedTele, true));
+	ASSERT_EQ(ActualTele, ExpectedTele);
+	ExpectSameVec(aExpected[0], aActual[0]);
+	ExpectSameVec(aExpected[1], aActual[1]);
+
+	ASSERT_EQ(Collision.IntersectLineTeleWeapon(Pos0, Pos1, &aActual[0], &aActual[1], &ActualTele), ReferenceIntersectLineTele(Collision, Pos0, Pos1, &aExpected[0], &aExpected[1], &ExpectedTele, false));
+	ASSERT_EQ(ActualTele, ExpectedTele);
+	ExpectSameVec(aExpected[0], aActual[0]);
+	ExpectSameVec(aExpected[1], aActual[1]);
+
+	ASSERT_EQ(Collision.IntersectNoLaser(Pos0, Pos1, &aActual[0], &aActual[1]), ReferenceIntersectNoLaser(Collision, Pos0, Pos1, &aExpected[0], &aExpected[1]));
+	ExpectSameVec(aExpected[0], aActual[0]);
+	ExpectSameVec(aExpected[1], aActual[1]);
+
+	ASSERT_EQ(Collision.IntersectNoLaserNW(Pos0, Pos1, &aActual[0], &aActual[1]), ReferenceIntersectNoLaserNW(Collision, Pos0, Pos1, &aExpected[0], &aExpected[1]));
+	ExpectSameVec(aExpected[0], aActual[0]);
+	ExpectSameVec(aExpected[1], aActual[1]);
+}
+
+TEST_P(Collision, IntersectLineMatchesSampling)
+{
+	std::mt19937 Rng(5678);
+	std::uniform_real_distribution<float> RandX(-200.0f, m_Collision.GetWidth() * 32 + 200.0f);
+	std::uniform_real_distribution<float> RandY(-200.0f, m_Collision.GetHeight() * 32 + 200.0f);
+	std::uniform_real_distribution<float> RandDelta(-800.0f, 800.0f);
+	std::uniform_int_distribution<int> RandTileX(0, m_Collision.GetWidth() * 32 - 1);
+	std::uniform_int_distribution<int> RandTileY(0, m_Collision.GetHeight() * 32 - 1);
+	for(int i = 0; i < 4000; i++)
+	{
+		// blockers placed at runtime, like the laser bouncing off teleporters
+		if(i % 200 == 199)
+			m_Collision.SetCollisionAt(RandTileX(Rng), RandTileY(Rng), TILE_SOLID);
+
+		vec2 Pos0(RandX(Rng), RandY(Rng));
+		vec2 Pos1 = i % 8 == 0 ? vec2(RandX(Rng), RandY(Rng)) : Pos0 + vec2(RandDelta(Rng), RandDelta(Rng));
+		CompareIntersections(m_Collision, Pos0, Pos1);
+		if(HasFatalFailure())
+			return;
+	}
+	// axis aligned rays along tile borders
+	for(int y = 0; y < m_Collision.GetHeight(); y += 3)
+	{
+		CompareIntersections(m_Collision, vec2(-10.0f, y * 32), vec2(m_Collision.GetWidth() * 32 + 10.0f, y * 32));
+		CompareIntersections(m_Collision, vec2(m_Collision.GetWidth() * 32 - 0.5f, y * 32 + 31.5f), vec2(0.5f, y * 32 + 31.5f));
+		if(HasFatalFailure())
+			return;
+	}
+}
+
+TEST_P(Collision, PackedTilesMatchLayers)
+{
+	const int OldPacked = g_Config.m_PackedCollision;
+	CCollision Packed, Plain;
+	g_Config.m_PackedCollision = 1;
+	Packed.Init(&m_Layers);
+	g_Config.m_PackedCollision = 0;
+	Plain.Init(&m_Layers);
+	g_Config.m_PackedCollision = OldPacked;
+
+	for(int i = -1; i < Plain.GetWidth() * Plain.GetHeight(); i++)
+	{
+		SCOPED_TRACE(i);
+		ASSERT_EQ(Packed.GetTileIndex(i), Plain.GetTileIndex(i));
+		ASSERT_EQ(Packed.GetFTileIndex(i), Plain.GetFTileIndex(i));
+		ASSERT_EQ(Packed.GetTileFlags(i), Plain.GetTileFlags(i));
+		ASSERT_EQ(Packed.GetFTileFlags(i), Plain.GetFTileFlags(i));
+		ASSERT_EQ(Packed.IsTeleport(i), Plain.IsTeleport(i));
+		ASSERT_EQ(Packed.IsEvilTeleport(i), Plain.IsEvilTeleport(i));
+		ASSERT_EQ(Packed.IsCheckTeleport(i), Plain.IsCheckTeleport(i));
+		ASSERT_EQ(Packed.IsCheckEvilTeleport(i), Plain.IsCheckEvilTeleport(i));
+		ASSERT_EQ(Packed.IsTeleCheckpoint(i), Plain.IsTeleCheckpoint(i));
+		ASSERT_EQ(Packed.IsTeleportWeapon(i), Plain.IsTeleportWeapon(i));
+		ASSERT_EQ(Packed.IsTeleportHook(i), Plain.IsTeleportHook(i));
+		ASSERT_EQ(Packed.IsSpeedup(i), Plain.IsSpeedup(i));
+		ASSERT_EQ(Packed.IsTune(i), Plain.IsTune(i));
+		ASSERT_EQ(Packed.GetSwitchType(i), Plain.GetSwitchType(i));
+		ASSERT_EQ(Packed.GetSwitchNumber(i), Plain.GetSwitchNumber(i));
+		ASSERT_EQ(Packed.GetSwitchDelay(i), Plain.GetSwitchDelay(i));
+		ASSERT_EQ(Packed.IsTimeCheckpoint(i), Plain.IsTimeCheckpoint(i));
+		ASSERT_EQ(Packed.IsFTimeCheckpoint(i), Plain.IsFTimeCheckpoint(i));
+
+		vec2 aDir[2] = {vec2(0, 0), vec2(0, 0)};
+		int aForce[2] = {0, 0}, aMaxSpeed[2] = {0, 0};
+		Packed.GetSpeedup(i, &aDir[0], &aForce[0], &aMaxSpeed[0]);
+		Plain.GetSpeedup(i, &aDir[1], &aForce[1], &aMaxSpeed[1]);
+		ASSERT_EQ(aForce[0], aForce[1]);
+		ASSERT_EQ(aMaxSpeed[0], aMaxSpeed[1]);
+		ExpectSameVec(aDir[1], aDir[0]);
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(Maps, Collision, ::testing::ValuesIn(s_apMaps));
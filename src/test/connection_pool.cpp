@@ -0,0 +1,115 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <engine/server/databases/connection_pool.h>
+#include <engine/shared/packer.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static std::atomic_int s_NumWritten{0};
+static std::atomic_int s_Sum{0};
+
+struct CTestWriteData : ISqlData
+{
+	CTestWriteData(int Value) :
+		ISqlData(nullptr), m_Value(Value)
+	{
+	}
+	int m_Value;
+};
+
+static bool TestWrite(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
+{
+	if(w == Write::NORMAL)
+	{
+		s_NumWritten++;
+		s_Sum += dynamic_cast<const CTestWriteData *>(pGameData)->m_Value;
+	}
+	return false;
+}
+
+static std::unique_ptr<const ISqlData> TestUnspill(CUnpacker *pUnpacker)
+{
+	return std::make_unique<CTestWriteData>(pUnpacker->GetInt());
+}
+
+TEST(ConnectionPool, ReplaySpillBiggerThanQueue)
+{
+	CTestInfo Info;
+	char aSpillFile[IO_MAX_PATH_LENGTH];
+	str_format(aSpillFile, sizeof(aSpillFile), "%s.spill", Info.m_aFilename);
+	char aDatabase[64];
+	str_format(aDatabase, sizeof(aDatabase), "%s.sqlite", Info.m_aFilename);
+
+	// many more queries than fit into the queue at once
+	const int NumQueries = 2000;
+	IOHANDLE File = io_open(aSpillFile, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_write(File, "SQLSPIL1", 8);
+	for(int i = 0; i < NumQueries; i++)
+	{
+		CPacker Packer;
+		Packer.Reset();
+		Packer.AddString("test", 0);
+		Packer.AddInt(i);
+		const unsigned Size = Packer.Size();
+		const unsigned char aSize[4] = {(unsigned char)(Size >> 24), (unsigned char)(Size >> 16), (unsigned char)(Size >> 8), (unsigned char)Size};
+		io_write(File, aSize, sizeof(aSize));
+		io_write(File, Packer.Data(), Size);
+	}
+	io_close(File);
+
+	CDbConnectionPool Pool;
+	CSqliteConfig Config{false, 0, 2000};
+	Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, aDatabase, &Config);
+	Pool.RegisterSpill("test", TestWrite, TestUnspill);
+	Pool.SetSpillFile(aSpillFile);
+	Pool.ReplaySpill();
+	File = io_open(aSpillFile, IOFLAG_READ);
+	EXPECT_FALSE(File) << "the replayed spill file should be removed";
+	if(File)
+		io_close(File);
+	Pool.OnShutdown(0);
+
+	EXPECT_EQ(s_NumWritten.load(), NumQueries);
+	EXPECT_EQ(s_Sum.load(), NumQueries * (NumQueries - 1) / 2);
+	fs_remove(aDatabase);
+}
+
+static std::atomic_bool s_Blocked{true};
+static std::atomic_int s_NumBlockedWritten{0};
+
+static bool BlockedWrite(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize)
+{
+	while(s_Blocked.load())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	if(w == Write::NORMAL)
+		s_NumBlockedWritten++;
+	return false;
+}
+
+TEST(ConnectionPool, EnqueueWithUnreachableDatabase)
+{
+	CTestInfo Info;
+	char aDatabase[64];
+	str_format(aDatabase, sizeof(aDatabase), "%s.sqlite", Info.m_aFilename);
+
+	CDbConnectionPool Pool;
+	CSqliteConfig Config{false, 0, 2000};
+	Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, aDatabase, &Config);
+
+	// the worker hangs on the first query, the others don't fit into the
+	// queue but mustn't block the caller
+	const int NumQueries = 2000;
+	for(int i = 0; i < NumQueries; i++)
+		Pool.ExecuteWrite(BlockedWrite, std::make_unique<CTestWriteData>(i), "blocked");
+	EXPECT_GE(Pool.QueueSize(), NumQueries);
+
+	s_Blocked.store(false);
+	Pool.OnShutdown(0);
+	EXPECT_EQ(Pool.QueueSize(), 0);
+	EXPECT_EQ(s_NumBlockedWritten.load(), NumQueries);
+	fs_remove(aDatabase);
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/config.h>
+#include <engine/shared/console.h>
+
+static void Count(IConsole::IResult *pResult, void *pUserData)
+{
+	(*(int *)pUserData)++;
+}
+
+TEST(Console, FindCaseInsensitive)
+{
+	CConsole Console(CFGFLAG_SERVER);
+	int Calls = 0;
+	Console.Register("sv_test_command", "", CFGFLAG_SERVER, Count, &Calls, "");
+
+	const IConsole::CCommandInfo *pInfo = Console.GetCommandInfo("sv_test_command", CFGFLAG_SERVER, false);
+	ASSERT_TRUE(pInfo);
+	EXPECT_STREQ(pInfo->m_pName, "sv_test_command");
+	EXPECT_EQ(Console.GetCommandInfo("SV_Test_Command", CFGFLAG_SERVER, false), pInfo);
+	EXPECT_FALSE(Console.GetCommandInfo("sv_test_command", CFGFLAG_CLIENT, false));
+	EXPECT_FALSE(Console.GetCommandInfo("sv_test_command", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(Console.GetCommandInfo("sv_test_comman", CFGFLAG_SERVER, false));
+
+	Console.ExecuteLine("sv_test_command");
+	Console.ExecuteLine("SV_TEST_COMMAND; sv_test_command");
+	EXPECT_EQ(Calls, 3);
+}
+
+TEST(Console, ReregisterReplaces)
+{
+	CConsole Console(CFGFLAG_SERVER);
+	int aCalls[2] = {0, 0};
+	Console.Register("test", "", CFGFLAG_SERVER, Count, &aCalls[0], "");
+	Console.Register("test", "", CFGFLAG_SERVER, Count, &aCalls[1], "");
+	Console.ExecuteLine("test");
+	EXPECT_EQ(aCalls[0], 0);
+	EXPECT_EQ(aCalls[1], 1);
+
+	int Num = 0;
+	for(const IConsole::CCommandInfo *pInfo = Console.FirstCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER); pInfo; pInfo = pInfo->NextCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER))
+	{
+		if(str_comp(pInfo->m_pName, "test") == 0)
+			Num++;
+	}
+	EXPECT_EQ(Num, 1);
+}
+
+TEST(Console, TempCommands)
+{
+	CConsole Console(CFGFLAG_CLIENT);
+	char aName[32];
+	for(int i = 0; i < 100; i++)
+	{
+		str_format(aName, sizeof(aName), "temp%d", i);
+		Console.RegisterTemp(aName, "", CFGFLAG_SERVER, "");
+	}
+	for(int i = 0; i < 100; i++)
+	{
+		str_format(aName, sizeof(aName), "temp%d", i);
+		EXPECT_TRUE(Console.GetCommandInfo(aName, CFGFLAG_SERVER, true)) << aName;
+	}
+
+	// deregistered commands are recycled under a new name
+	Console.DeregisterTemp("temp5");
+	Console.DeregisterTemp("temp7");
+	EXPECT_FALSE(Console.GetCommandInfo("temp5", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(Console.GetCommandInfo("temp7", CFGFLAG_SERVER, true));
+	EXPECT_TRUE(Console.GetCommandInfo("temp6", CFGFLAG_SERVER, true));
+	Console.RegisterTemp("recycled", "", CFGFLAG_SERVER, "");
+	const IConsole::CCommandInfo *pInfo = Console.GetCommandInfo("RECYCLED", CFGFLAG_SERVER, true);
+	ASSERT_TRUE(pInfo);
+	EXPECT_STREQ(pInfo->m_pName, "recycled");
+	EXPECT_FALSE(Console.GetCommandInfo("temp7", CFGFLAG_SERVER, true));
+
+	Console.DeregisterTempAll();
+	EXPECT_FALSE(Console.GetCommandInfo("recycled", CFGFLAG_SERVER, true));
+	for(int i = 0; i < 100; i++)
+	{
+		str_format(aName, sizeof(aName), "temp%d", i);
+		EXPECT_FALSE(Console.GetCommandInfo(aName, CFGFLAG_SERVER, true)) << aName;
+	}
+	// the commands registered by the console itself are still there
+	EXPECT_TRUE(Console.GetCommandInfo("exec", CFGFLAG_CLIENT, false));
+
+	Console.RegisterTemp("temp1", "", CFGFLAG_SERVER, "");
+	EXPECT_TRUE(Console.GetCommandInfo("temp1", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(Console.GetCommandInfo("temp2", CFGFLAG_SERVER, true));
+}
+
+TEST(Console, Chain)
+{
+	CConsole Console(CFGFLAG_SERVER);
+	int Calls = 0;
+	Console.Register("chained", "", CFGFLAG_SERVER, Count, &Calls, "");
+	static int s_ChainCalls = 0;
+	Console.Chain(
+		"chained", [](IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData) {
+			s_ChainCalls++;
+			pfnCallback(pResult, pCallbackUserData);
+		},
+		nullptr);
+	Console.ExecuteLine("Chained");
+	EXPECT_EQ(s_ChainCalls, 1);
+	EXPECT_EQ(Calls, 1);
+}
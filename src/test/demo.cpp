@@ -0,0 +1,275 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class CSnapshotListener : public CDemoPlayer::IListener
+{
+public:
+	unsigned m_LastCrc = 0;
+	int m_LastNumItems = -1;
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override
+	{
+		m_LastCrc = ((CSnapshot *)pData)->Crc();
+		m_LastNumItems = ((CSnapshot *)pData)->NumItems();
+	}
+	void OnDemoPlayerMessage(void *pData, int Size) override {}
+};
+
+class DemoRecorder : public ::testing::Test
+{
+protected:
+	std::unique_ptr<IStorage> m_pStorage;
+	std::unique_ptr<CSnapshotDelta> m_pSnapshotDelta;
+	std::unique_ptr<CSnapshotBuilder> m_pBuilder;
+	unsigned char m_aSnapshot[CSnapshot::MAX_SIZE];
+	unsigned char m_DummyMapData = 0;
+	SHA256_DIGEST m_Sha256;
+
+	DemoRecorder() :
+		m_pStorage(CreateLocalStorage()),
+		m_pSnapshotDelta(std::make_unique<CSnapshotDelta>()),
+		m_pBuilder(std::make_unique<CSnapshotBuilder>())
+	{
+		CNetBase::Init();
+		m_Sha256 = sha256("", 0);
+	}
+
+	int Start(CDemoRecorder *pRecorder, const char *pFilename)
+	{
+		return pRecorder->Start(m_pStorage.get(), nullptr, pFilename, "0.6 626fce9a778df4d4", "test", &m_Sha256, 0, "server", 0, &m_DummyMapData);
+	}
+
+	int BuildSnapshot(int Tick)
+	{
+		m_pBuilder->Init();
+		for(int i = 0; i < 8 + Tick % 5; i++)
+		{
+			int *pItem = (int *)m_pBuilder->NewItem(1 + i % 3, i, 4 * sizeof(int));
+			for(int k = 0; k < 4; k++)
+				pItem[k] = (i * 7 + k) * (k == 0 ? Tick / 3 : 1);
+		}
+		return m_pBuilder->Finish(m_aSnapshot);
+	}
+
+	void Record(CDemoRecorder *pRecorder, int NumTicks)
+	{
+		for(int Tick = 1; Tick <= NumTicks; Tick++)
+		{
+			int Size = BuildSnapshot(Tick);
+			pRecorder->RecordSnapshot(Tick, m_aSnapshot, Size);
+			if(Tick % 7 == 0)
+			{
+				int aMessage[3] = {Tick, Tick * 2, Tick * 3};
+				pRecorder->RecordMessage(aMessage, sizeof(aMessage));
+			}
+			if(Tick % 100 == 0)
+				pRecorder->AddDemoMarker();
+		}
+	}
+
+	void ReadDemo(const char *pFilename, void **ppData, unsigned *pSize)
+	{
+		ASSERT_TRUE(m_pStorage->ReadFile(pFilename, IStorage::TYPE_SAVE, ppData, pSize));
+		// the timestamp depends on when the recording started
+		ASSERT_GE(*pSize, sizeof(CDemoHeader));
+		mem_zero((char *)*ppData + offsetof(CDemoHeader, m_aTimestamp), sizeof(CDemoHeader::m_aTimestamp));
+	}
+};
+
+TEST_F(DemoRecorder, WriterMatchesSynchronous)
+{
+	CTestInfo InfoSync;
+	CTestInfo InfoAsync;
+	char aSyncFilename[128];
+	char aAsyncFilename[128];
+	str_format(aSyncFilename, sizeof(aSyncFilename), "%s-sync.demo", InfoSync.m_aFilename);
+	str_format(aAsyncFilename, sizeof(aAsyncFilename), "%s-async.demo", InfoAsync.m_aFilename);
+
+	CDemoWriter Writer;
+	CDemoRecorder Sync(m_pSnapshotDelta.get(), true);
+	CDemoRecorder Async(m_pSnapshotDelta.get(), true, &Writer);
+	ASSERT_EQ(Start(&Sync, aSyncFilename), 0);
+	ASSERT_EQ(Start(&Async, aAsyncFilename), 0);
+	Record(&Sync, 1000);
+	Record(&Async, 1000);
+	EXPECT_EQ(Sync.Length(), Async.Length());
+	EXPECT_EQ(Sync.Stop(), 0);
+	EXPECT_EQ(Async.Stop(), 0);
+	EXPECT_EQ(Writer.NumDropped(), 0);
+
+	void *pSyncData;
+	void *pAsyncData;
+	unsigned SyncSize;
+	unsigned AsyncSize;
+	ReadDemo(aSyncFilename, &pSyncData, &SyncSize);
+	ReadDemo(aAsyncFilename, &pAsyncData, &AsyncSize);
+	ASSERT_EQ(SyncSize, AsyncSize);
+	EXPECT_EQ(mem_comp(pSyncData, pAsyncData, SyncSize), 0);
+	free(pSyncData);
+	free(pAsyncData);
+
+	if(!HasFailure())
+	{
+		m_pStorage->RemoveFile(aSyncFilename, IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile(aAsyncFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST_F(DemoRecorder, WriterDropsWhenFull)
+{
+	CTestInfo Info;
+	CDemoWriter Writer(0);
+	CDemoRecorder Recorder(m_pSnapshotDelta.get(), true, &Writer);
+	ASSERT_EQ(Start(&Recorder, Info.m_aFilename), 0);
+	Record(&Recorder, 70);
+	EXPECT_EQ(Recorder.Stop(), 0);
+	// 70 snapshots and 10 messages
+	EXPECT_EQ(Writer.NumDropped(), 80);
+	EXPECT_EQ(Writer.PeakQueuedBytes(), 0);
+
+	if(!HasFailure())
+		m_pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+}
+
+TEST_F(DemoRecorder, IndexMatchesScan)
+{
+	CTestInfo Info;
+	char aUnindexedFilename[128];
+	str_format(aUnindexedFilename, sizeof(aUnindexedFilename), "%s-unindexed.demo", Info.m_aFilename);
+
+	CDemoRecorder Recorder(m_pSnapshotDelta.get(), true);
+	ASSERT_EQ(Start(&Recorder, Info.m_aFilename), 0);
+	Record(&Recorder, 3000);
+	EXPECT_EQ(Recorder.Stop(), 0);
+
+	// a copy without the pointer to the index, like older recorders write it
+	void *pData;
+	unsigned Size;
+	ASSERT_TRUE(m_pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_SAVE, &pData, &Size));
+	ASSERT_GE(Size, sizeof(CDemoHeader) + sizeof(CTimelineMarkers));
+	mem_zero((char *)pData + sizeof(CDemoHeader) + offsetof(CTimelineMarkers, m_aTimelineMarkers[MAX_TIMELINE_MARKERS - 2]), 8);
+	IOHANDLE File = m_pStorage->OpenFile(aUnindexedFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, pData, Size);
+	io_close(File);
+	free(pData);
+
+	CSnapshotListener IndexedListener;
+	CSnapshotListener ScannedListener;
+	CDemoPlayer Indexed(m_pSnapshotDelta.get());
+	CDemoPlayer Scanned(m_pSnapshotDelta.get());
+	Indexed.SetListener(&IndexedListener);
+	Scanned.SetListener(&ScannedListener);
+	ASSERT_EQ(Indexed.Load(m_pStorage.get(), nullptr, Info.m_aFilename, IStorage::TYPE_SAVE), 0);
+	ASSERT_EQ(Scanned.Load(m_pStorage.get(), nullptr, aUnindexedFilename, IStorage::TYPE_SAVE), 0);
+	EXPECT_TRUE(Indexed.IsIndexed());
+	EXPECT_FALSE(Scanned.IsIndexed());
+
+	EXPECT_EQ(Indexed.Info()->m_SeekablePoints, Scanned.Info()->m_SeekablePoints);
+	EXPECT_GT(Indexed.Info()->m_SeekablePoints, 1);
+	EXPECT_EQ(Indexed.BaseInfo()->m_FirstTick, Scanned.BaseInfo()->m_FirstTick);
+	EXPECT_EQ(Indexed.BaseInfo()->m_LastTick, Scanned.BaseInfo()->m_LastTick);
+	EXPECT_EQ(Indexed.BaseInfo()->m_NumTimelineMarkers, 30);
+
+	for(int Tick : {10, 1500, 777, 2999, 255, 3000})
+	{
+		ASSERT_EQ(Indexed.SetPos(Tick), 0);
+		ASSERT_EQ(Scanned.SetPos(Tick), 0);
+		const int CurrentTick = Indexed.BaseInfo()->m_CurrentTick;
+		EXPECT_EQ(CurrentTick, Scanned.BaseInfo()->m_CurrentTick);
+		BuildSnapshot(CurrentTick);
+		CSnapshot *pExpected = (CSnapshot *)m_aSnapshot;
+		EXPECT_EQ(IndexedListener.m_LastCrc, pExpected->Crc()) << "tick " << Tick;
+		EXPECT_EQ(IndexedListener.m_LastNumItems, pExpected->NumItems()) << "tick " << Tick;
+		EXPECT_EQ(ScannedListener.m_LastCrc, pExpected->Crc()) << "tick " << Tick;
+	}
+	Indexed.Stop();
+	Scanned.Stop();
+
+	if(!HasFailure())
+	{
+		m_pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile(aUnindexedFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST_F(DemoRecorder, NoIndexWithAllMarkers)
+{
+	CTestInfo Info;
+	CDemoRecorder Recorder(m_pSnapshotDelta.get(), true);
+	ASSERT_EQ(Start(&Recorder, Info.m_aFilename), 0);
+	Record(&Recorder, 2000);
+	for(int i = 0; i < MAX_TIMELINE_MARKERS; i++)
+		Recorder.AddDemoMarker(3000 + i * SERVER_TICK_SPEED);
+	EXPECT_EQ(Recorder.Stop(), 0);
+
+	CDemoPlayer Player(m_pSnapshotDelta.get());
+	ASSERT_EQ(Player.Load(m_pStorage.get(), nullptr, Info.m_aFilename, IStorage::TYPE_SAVE), 0);
+	EXPECT_FALSE(Player.IsIndexed());
+	EXPECT_EQ(Player.BaseInfo()->m_NumTimelineMarkers, MAX_TIMELINE_MARKERS);
+	EXPECT_EQ(Player.BaseInfo()->m_FirstTick, 1);
+	EXPECT_EQ(Player.BaseInfo()->m_LastTick, 2000);
+	Player.Stop();
+
+	if(!HasFailure())
+		m_pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+}
+
+TEST_F(DemoRecorder, ParallelPlayers)
+{
+	CTestInfo Info;
+	CDemoRecorder Recorder(m_pSnapshotDelta.get(), true);
+	ASSERT_EQ(Start(&Recorder, Info.m_aFilename), 0);
+	Record(&Recorder, 3000);
+	EXPECT_EQ(Recorder.Stop(), 0);
+
+	std::vector<unsigned> vExpectedCrcs(3001);
+	for(int Tick = 1; Tick <= 3000; Tick++)
+	{
+		BuildSnapshot(Tick);
+		vExpectedCrcs[Tick] = ((CSnapshot *)m_aSnapshot)->Crc();
+	}
+
+	// every player seeks around on its own thread, nothing may be shared
+	const int NumThreads = 4;
+	int aNumMismatches[NumThreads] = {0};
+	std::vector<std::thread> vThreads;
+	for(int i = 0; i < NumThreads; i++)
+	{
+		vThreads.emplace_back([&, i]() {
+			CSnapshotDelta SnapshotDelta(*m_pSnapshotDelta);
+			CSnapshotListener Listener;
+			std::unique_ptr<CDemoPlayer> pPlayer = std::make_unique<CDemoPlayer>(&SnapshotDelta);
+			pPlayer->SetListener(&Listener);
+			if(pPlayer->Load(m_pStorage.get(), nullptr, Info.m_aFilename, IStorage::TYPE_SAVE))
+			{
+				aNumMismatches[i]++;
+				return;
+			}
+			for(int k = 0; k < 50; k++)
+			{
+				pPlayer->SetPos(2 + (k * 397 + i * 101) % 2998);
+				if(Listener.m_LastCrc != vExpectedCrcs[pPlayer->BaseInfo()->m_CurrentTick])
+					aNumMismatches[i]++;
+			}
+			pPlayer->Stop();
+		});
+	}
+	for(auto &Thread : vThreads)
+		Thread.join();
+	for(int i = 0; i < NumThreads; i++)
+		EXPECT_EQ(aNumMismatches[i], 0) << "thread " << i;
+
+	if(!HasFailure())
+		m_pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+}
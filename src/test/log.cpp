@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <base/logger.h>
+#include <base/system.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CCollectLogger : public ILogger
+{
+public:
+	std::mutex m_Lock;
+	std::vector<CLogMessage> m_vMessages;
+	bool m_Finished = false;
+
+	void Log(const CLogMessage *pMessage) override
+	{
+		std::unique_lock<std::mutex> Lock(m_Lock);
+		m_vMessages.push_back(*pMessage);
+	}
+	void GlobalFinish() override
+	{
+		m_Finished = true;
+	}
+};
+
+static void LogTo(ILogger *pLogger, LEVEL Level, const char *pSystem, const char *pText)
+{
+	CLogMessage Msg;
+	Msg.m_Level = Level;
+	Msg.m_HaveColor = false;
+	Msg.m_Color = LOG_COLOR{0, 0, 0};
+	str_copy(Msg.m_aTimestamp, "2022-01-01 00:00:00");
+	Msg.m_TimestampLength = str_length(Msg.m_aTimestamp);
+	str_copy(Msg.m_aSystem, pSystem);
+	Msg.m_SystemLength = str_length(Msg.m_aSystem);
+	str_format(Msg.m_aLine, sizeof(Msg.m_aLine), "%s %c %s: ", Msg.m_aTimestamp, "EWIDT"[Level], Msg.m_aSystem);
+	Msg.m_LineMessageOffset = str_length(Msg.m_aLine);
+	str_append(Msg.m_aLine, pText, sizeof(Msg.m_aLine));
+	Msg.m_LineLength = str_length(Msg.m_aLine);
+	pLogger->Log(&Msg);
+}
+
+TEST(Log, RingForwardsInOrder)
+{
+	CCollectLogger *pCollect = new CCollectLogger();
+	std::unique_ptr<ILogger> pRing = log_logger_ring(std::unique_ptr<ILogger>(pCollect));
+
+	const int NumThreads = 4;
+	const int NumMessages = 5000;
+	std::vector<std::thread> vThreads;
+	for(int t = 0; t < NumThreads; t++)
+	{
+		vThreads.emplace_back([&pRing, t]() {
+			char aSystem[16];
+			str_format(aSystem, sizeof(aSystem), "thread%d", t);
+			char aText[16];
+			for(int i = 0; i < NumMessages; i++)
+			{
+				str_format(aText, sizeof(aText), "%d", i);
+				LogTo(pRing.get(), LEVEL_WARN, aSystem, aText);
+			}
+		});
+	}
+	for(auto &Thread : vThreads)
+		Thread.join();
+	pRing->GlobalFinish();
+	EXPECT_TRUE(pCollect->m_Finished);
+
+	// warnings are never dropped and each thread's messages stay in order
+	ASSERT_EQ(pCollect->m_vMessages.size(), (size_t)NumThreads * NumMessages);
+	int aNext[NumThreads] = {0};
+	for(const CLogMessage &Msg : pCollect->m_vMessages)
+	{
+		int Thread = Msg.m_aSystem[str_length("thread")] - '0';
+		ASSERT_GE(Thread, 0);
+		ASSERT_LT(Thread, NumThreads);
+		EXPECT_EQ(str_toint(Msg.Message()), aNext[Thread]) << Msg.m_aLine;
+		EXPECT_EQ(Msg.m_LineLength, str_length(Msg.m_aLine));
+		aNext[Thread]++;
+	}
+}
+
+class CBlockingLogger : public ILogger
+{
+public:
+	std::mutex m_Block;
+	std::vector<LEVEL> m_vLevels;
+	std::vector<std::string> m_vLines;
+
+	void Log(const CLogMessage *pMessage) override
+	{
+		std::unique_lock<std::mutex> Lock(m_Block);
+		m_vLevels.push_back(pMessage->m_Level);
+		m_vLines.emplace_back(pMessage->Message());
+	}
+};
+
+TEST(Log, RingDropsDebugFirst)
+{
+	CBlockingLogger *pBlocking = new CBlockingLogger();
+	std::unique_ptr<ILogger> pRing = log_logger_ring(std::unique_ptr<ILogger>(pBlocking));
+
+	// stall the logger thread so the ring runs full
+	pBlocking->m_Block.lock();
+	for(int i = 0; i < 10000; i++)
+	{
+		LogTo(pRing.get(), LEVEL_DEBUG, "test", "debug");
+	}
+	for(int i = 0; i < 10; i++)
+	{
+		LogTo(pRing.get(), LEVEL_INFO, "test", "info");
+	}
+	pBlocking->m_Block.unlock();
+	pRing->GlobalFinish();
+
+	int NumDebug = 0;
+	int NumInfo = 0;
+	bool Dropped = false;
+	for(size_t i = 0; i < pBlocking->m_vLevels.size(); i++)
+	{
+		NumDebug += pBlocking->m_vLevels[i] == LEVEL_DEBUG;
+		NumInfo += pBlocking->m_vLevels[i] == LEVEL_INFO;
+		if(pBlocking->m_vLevels[i] == LEVEL_WARN && str_startswith(pBlocking->m_vLines[i].c_str(), "dropped "))
+			Dropped = true;
+	}
+	// debug messages only fill half the ring, info messages still fit
+	EXPECT_LT(NumDebug, 10000);
+	EXPECT_EQ(NumInfo, 10);
+	EXPECT_TRUE(Dropped);
+}
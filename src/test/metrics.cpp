@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/metrics.h>
+
+#include <thread>
+#include <vector>
+
+TEST(Metrics, Format)
+{
+	CMetrics Metrics;
+	CMetricCounter *pSent = Metrics.Counter("test_sent_total", "Sent messages", "id=\"1\"");
+	Metrics.Gauge("test_queue", "Queue size")->Set(5);
+	EXPECT_EQ(Metrics.Counter("test_sent_total", "Sent messages", "id=\"1\""), pSent);
+	CMetricCounter *pSent2 = Metrics.Counter("test_sent_total", "Sent messages", "id=\"2\"");
+	EXPECT_NE(pSent2, pSent);
+	pSent->Add(3);
+	pSent2->Add();
+
+	std::string Out;
+	Metrics.Format(Out);
+	EXPECT_EQ(Out,
+		"# HELP test_sent_total Sent messages\n"
+		"# TYPE test_sent_total counter\n"
+		"test_sent_total{id=\"1\"} 3\n"
+		"test_sent_total{id=\"2\"} 1\n"
+		"# HELP test_queue Queue size\n"
+		"# TYPE test_queue gauge\n"
+		"test_queue 5\n");
+}
+
+TEST(Metrics, Histogram)
+{
+	CMetrics Metrics;
+	CMetricHistogram *pHistogram = Metrics.Histogram("test_duration_seconds", "Duration", {1000000, 10000000}, 1e9, "kind=\"a\"");
+	pHistogram->Observe(500000);
+	pHistogram->Observe(1000000);
+	pHistogram->Observe(2000000);
+	pHistogram->Observe(500000000);
+
+	std::string Out;
+	Metrics.Format(Out);
+	EXPECT_EQ(Out,
+		"# HELP test_duration_seconds Duration\n"
+		"# TYPE test_duration_seconds histogram\n"
+		"test_duration_seconds_bucket{kind=\"a\",le=\"0.001\"} 2\n"
+		"test_duration_seconds_bucket{kind=\"a\",le=\"0.01\"} 3\n"
+		"test_duration_seconds_bucket{kind=\"a\",le=\"+Inf\"} 4\n"
+		"test_duration_seconds_sum{kind=\"a\"} 0.5035\n"
+		"test_duration_seconds_count{kind=\"a\"} 4\n");
+}
+
+TEST(Metrics, ConcurrentUpdates)
+{
+	CMetrics Metrics;
+	CMetricCounter *pCounter = Metrics.Counter("test_total", "Total");
+	CMetricHistogram *pHistogram = Metrics.Histogram("test_size_bytes", "Size", {10});
+	std::vector<std::thread> vThreads;
+	for(int t = 0; t < 4; t++)
+	{
+		vThreads.emplace_back([&]() {
+			for(int i = 0; i < 10000; i++)
+			{
+				pCounter->Add();
+				pHistogram->Observe(i % 20);
+			}
+		});
+	}
+	std::string Out;
+	Metrics.Format(Out);
+	for(auto &Thread : vThreads)
+		Thread.join();
+	EXPECT_EQ(pCounter->Value(), 40000);
+	EXPECT_EQ(pHistogram->Count(0) + pHistogram->Count(1), 40000);
+	EXPECT_EQ(pHistogram->Count(0), 22000);
+}
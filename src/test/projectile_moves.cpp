@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/server/projectile_moves.h>
+
+#include <random>
+
+static const char *const s_apMaps[] = {
+	"data/maps/coverage.map",
+	"data/maps/Gold Mine.map",
+	"data/maps/Tutorial.map",
+	"data/maps/dm1.map",
+};
+
+class ProjectileMoves : public ::testing::TestWithParam<const char *>
+{
+protected:
+	IKernel *m_pKernel;
+	IEngineMap *m_pMap;
+	CLayers m_Layers;
+	CCollision m_Collision;
+
+	void SetUp() override
+	{
+		m_pKernel = IKernel::Create();
+		m_pMap = CreateEngineMap();
+		m_pKernel->RegisterInterface(m_pMap);
+		m_pKernel->RegisterInterface(static_cast<IMap *>(m_pMap), false);
+		m_pKernel->RegisterInterface(CreateLocalStorage());
+		ASSERT_TRUE(m_pMap->Load(GetParam())) << GetParam();
+		m_Layers.Init(m_pKernel);
+		m_Collision.Init(&m_Layers);
+	}
+
+	void TearDown() override
+	{
+		m_Collision.Dest();
+		delete m_pKernel;
+	}
+};
+
+TEST_P(ProjectileMoves, BatchMatchesScalar)
+{
+	std::mt19937 Rng(1234);
+	std::uniform_real_distribution<float> RandX(-64.0f, m_Collision.GetWidth() * 32 + 64.0f);
+	std::uniform_real_distribution<float> RandY(-64.0f, m_Collision.GetHeight() * 32 + 64.0f);
+	std::uniform_real_distribution<float> RandAngle(0.0f, 2 * pi);
+	// gun, shotgun and grenade tunings
+	static const float s_aCurvature[] = {1.25f, 1.25f, 7.0f, 0.0f};
+	static const float s_aSpeed[] = {2200.0f, 2750.0f, 1000.0f, 500.0f};
+
+	CProjectileMoves Moves;
+	Moves.Clear();
+	const int Num = 5000;
+	for(int i = 0; i < Num; i++)
+	{
+		const int Tuning = Rng() % std::size(s_aCurvature);
+		const int Ticks = 1 + Rng() % 100;
+		Moves.Add(nullptr, vec2(RandX(Rng), RandY(Rng)), direction(RandAngle(Rng)), s_aCurvature[Tuning], s_aSpeed[Tuning], (Ticks - 1) / 50.0f, Ticks / 50.0f);
+	}
+	Moves.Integrate(&m_Collision);
+
+	int NumCollisions = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		vec2 PrevPos, CurPos, ColPos, NewPos;
+		int Collide = CProjectileMoves::CalcMove(&m_Collision, Moves.m_vPos[i], Moves.m_vDirection[i], Moves.m_vCurvature[i], Moves.m_vSpeed[i], Moves.m_vPrevTime[i], Moves.m_vCurTime[i], &PrevPos, &CurPos, &ColPos, &NewPos);
+		// bit for bit the same, the batch only reorders the work
+		ASSERT_EQ(Moves.m_vPrevPos[i], PrevPos) << i;
+		ASSERT_EQ(Moves.m_vCurPos[i], CurPos) << i;
+		ASSERT_EQ(Moves.m_vCollide[i], Collide) << i;
+		ASSERT_EQ(Moves.m_vColPos[i], ColPos) << i;
+		ASSERT_EQ(Moves.m_vNewPos[i], NewPos) << i;
+		NumCollisions += Collide != 0;
+	}
+	// the random projectiles hit something
+	EXPECT_GT(NumCollisions, 0);
+
+	// gathering again starts over
+	Moves.Clear();
+	Moves.Integrate(&m_Collision);
+	EXPECT_TRUE(Moves.m_vCollide.empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(Maps, ProjectileMoves, ::testing::ValuesIn(s_apMaps));
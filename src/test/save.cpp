@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/config.h>
+#include <game/server/save.h>
+
+#include <memory>
+#include <string>
+
+static std::string TeeString(const char *pName, int x, int y)
+{
+	char aBuf[1024];
+	str_format(aBuf, sizeof(aBuf),
+		"%s\t1\t0\t0\t0\t0\t"
+		// weapons
+		"0\t0\t0\t1\t0\t-1\t0\t1\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t"
+		"1\t-1\t"
+		// tee stats
+		"0\t0\t0\t0\t0\t0\t0\t"
+		"1\t0\t1\t0\t0\t1\t1234\t"
+		"%d\t%d\t%d\t%d\t"
+		"0\t0\t"
+		"%d\t%d\t0.500000\t-3.250000\t"
+		"1\t1\t1\t2\t"
+		"%d\t%d\t0.000000\t0.000000\t"
+		"0\t0\t0\t0\t"
+		// time checkpoints
+		"0\t0\t0\t"
+		"1.500000\t12.250000\t0.000000\t0.000000\t0.000000\t"
+		"0.000000\t0.000000\t0.000000\t0.000000\t0.000000\t"
+		"0.000000\t0.000000\t0.000000\t0.000000\t0.000000\t"
+		"0.000000\t0.000000\t0.000000\t0.000000\t0.000000\t"
+		"0.000000\t0.000000\t0.000000\t0.000000\t0.000000\t"
+		"0\t"
+		"0\t0\t0\t"
+		"8d300ecf-5873-4297-bee5-95668fdff320\t"
+		"-1\t0\t"
+		"1\t0\t0\t0\t"
+		"0\t"
+		"1\t"
+		"0",
+		pName, x, y, x - 3, y, x, y + 1, x, y);
+	return aBuf;
+}
+
+static std::string TextSave()
+{
+	return "0\t2\t2\t0\t0\n" +
+	       TeeString("nameless tee", 528, 944) + "\n" +
+	       TeeString("brainless tee", 1040, 912) + "\n" +
+	       "1\t0\t0\n" +
+	       "0\t150\t1";
+}
+
+struct Save : public testing::Test
+{
+	int m_SaveBinary = g_Config.m_SvSaveBinary;
+	std::unique_ptr<CSaveTeam> m_pTeam = std::make_unique<CSaveTeam>(nullptr);
+	std::unique_ptr<CSaveTeam> m_pLoaded = std::make_unique<CSaveTeam>(nullptr);
+
+	~Save()
+	{
+		g_Config.m_SvSaveBinary = m_SaveBinary;
+	}
+};
+
+TEST_F(Save, TextRoundTrip)
+{
+	const std::string Text = TextSave();
+	g_Config.m_SvSaveBinary = 0;
+	ASSERT_EQ(m_pTeam->FromString(Text.c_str()), 0);
+	EXPECT_EQ(m_pTeam->GetMembersCount(), 2);
+	EXPECT_STREQ(m_pTeam->m_pSavedTees[1].GetName(), "brainless tee");
+	EXPECT_EQ(m_pTeam->GetString(), Text);
+}
+
+TEST_F(Save, BinaryRoundTrip)
+{
+	const std::string Text = TextSave();
+	ASSERT_EQ(m_pTeam->FromString(Text.c_str()), 0);
+	g_Config.m_SvSaveBinary = 1;
+	const std::string Binary = m_pTeam->GetString();
+	EXPECT_TRUE(str_startswith(Binary.c_str(), "B1\tnameless tee\tbrainless tee\t\n"));
+	EXPECT_LT(Binary.size(), Text.size());
+
+	ASSERT_EQ(m_pLoaded->FromString(Binary.c_str()), 0);
+	EXPECT_EQ(m_pLoaded->GetMembersCount(), 2);
+	EXPECT_EQ(m_pLoaded->GetString(), Binary);
+	g_Config.m_SvSaveBinary = 0;
+	EXPECT_EQ(m_pLoaded->GetString(), Text);
+}
+
+TEST_F(Save, OldTextFormat)
+{
+	// saves from before practice mode have only four team stats
+	std::string Text = "3\t1\t0\t1\n" + TeeString("nameless tee", 528, 944);
+	ASSERT_EQ(m_pTeam->FromString(Text.c_str()), 0);
+	EXPECT_EQ(m_pTeam->GetMembersCount(), 1);
+	g_Config.m_SvSaveBinary = 0;
+	EXPECT_STREQ(m_pTeam->GetString(), ("3\t1\t0\t1\t0\n" + TeeString("nameless tee", 528, 944)).c_str());
+}
+
+TEST_F(Save, Truncated)
+{
+	const std::string Text = TextSave();
+	EXPECT_NE(m_pTeam->FromString(Text.substr(0, Text.size() / 3).c_str()), 0);
+	EXPECT_NE(m_pTeam->FromString(Text.substr(0, 5).c_str()), 0);
+
+	ASSERT_EQ(m_pTeam->FromString(Text.c_str()), 0);
+	g_Config.m_SvSaveBinary = 1;
+	const std::string Binary = m_pTeam->GetString();
+	for(size_t Size : {Binary.size() - 4, Binary.size() / 2, (size_t)30, (size_t)3})
+		EXPECT_NE(m_pLoaded->FromString(Binary.substr(0, Size).c_str()), 0) << Size;
+}
+
+TEST_F(Save, Garbage)
+{
+	// an empty team
+	EXPECT_EQ(m_pTeam->FromString("B1\t\nAAAAAAAA"), 0);
+
+	EXPECT_NE(m_pTeam->FromString(""), 0);
+	EXPECT_NE(m_pTeam->FromString("garbage"), 0);
+	EXPECT_NE(m_pTeam->FromString("B1\tnameless tee\t\n!!!!"), 0);
+	EXPECT_NE(m_pTeam->FromString("B1\tnameless tee\t\nAAAA"), 0);
+	// the names don't match the number of tees
+	EXPECT_NE(m_pTeam->FromString("B1\tnameless tee\t\nAAAAAAAA"), 0);
+	// switch numbers are limited to what fits into the map
+	EXPECT_NE(m_pTeam->FromString("B1\t\nAAAAqA8AAA=="), 0);
+	EXPECT_NE(m_pTeam->FromString("0\t0\t100000000\t0\t0"), 0);
+	EXPECT_NE(m_pTeam->FromString("0\t0\t-1\t0\t0"), 0);
+}
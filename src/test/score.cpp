@@ -1,10 +1,12 @@
 #include "engine/server/databases/connection_pool.h"
+#include "test.h"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <base/detect.h>
 #include <engine/server/databases/connection.h>
 #include <engine/shared/config.h>
+#include <engine/shared/packer.h>
 #include <game/server/scoreworker.h>
 
 #include <sqlite3.h>
@@ -13,18 +15,6 @@
 int DummyMysqlInit = (MysqlInit(), 1);
 #endif
 
-char *CSaveTeam::GetString()
-{
-	// Dummy implementation for testing
-	return nullptr;
-}
-
-int CSaveTeam::FromString(char const *)
-{
-	// Dummy implementation for testing
-	return 1;
-}
-
 bool CSaveTeam::MatchPlayers(const char (*paNames)[MAX_NAME_LENGTH], const int *pClientID, int NumPlayer, char *pMessage, int MessageLen)
 {
 	// Dummy implementation for testing
@@ -36,6 +26,118 @@ TEST(SQLite, Version)
 	ASSERT_GE(sqlite3_libversion_number(), 3025000) << "SQLite >= 3.25.0 required for Window functions";
 }
 
+TEST(SQLite, Tuned)
+{
+	CTestInfo Info;
+	char aError[256] = {};
+	{
+		CSqliteConfig Config{true, 16, 4096};
+		auto pConn = CreateSqliteConnection(Info.m_aFilename, true, &Config);
+		ASSERT_FALSE(pConn->Connect(aError, sizeof(aError))) << aError;
+
+		bool End;
+		char aMode[16];
+		ASSERT_FALSE(pConn->PrepareStatement("PRAGMA journal_mode", aError, sizeof(aError))) << aError;
+		ASSERT_FALSE(pConn->Step(&End, aError, sizeof(aError))) << aError;
+		ASSERT_FALSE(End);
+		pConn->GetString(1, aMode, sizeof(aMode));
+		EXPECT_STREQ(aMode, "wal");
+
+		ASSERT_FALSE(pConn->PrepareStatement("PRAGMA synchronous", aError, sizeof(aError))) << aError;
+		ASSERT_FALSE(pConn->Step(&End, aError, sizeof(aError))) << aError;
+		ASSERT_FALSE(End);
+		EXPECT_EQ(pConn->GetInt(1), 1); // NORMAL
+
+		ASSERT_FALSE(pConn->PrepareStatement("PRAGMA cache_size", aError, sizeof(aError))) << aError;
+		ASSERT_FALSE(pConn->Step(&End, aError, sizeof(aError))) << aError;
+		ASSERT_FALSE(End);
+		EXPECT_EQ(pConn->GetInt(1), -4096);
+
+		ASSERT_FALSE(pConn->PrepareStatement("SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name IN ('record_race_MapTime', 'record_race_Name', 'record_teamrace_MapTime', 'record_teamrace_MapName')", aError, sizeof(aError))) << aError;
+		ASSERT_FALSE(pConn->Step(&End, aError, sizeof(aError))) << aError;
+		ASSERT_FALSE(End);
+		EXPECT_EQ(pConn->GetInt(1), 4);
+		pConn->Disconnect();
+	}
+	fs_remove(Info.m_aFilename);
+	char aBuf[IO_MAX_PATH_LENGTH];
+	str_format(aBuf, sizeof(aBuf), "%s-wal", Info.m_aFilename);
+	fs_remove(aBuf);
+	str_format(aBuf, sizeof(aBuf), "%s-shm", Info.m_aFilename);
+	fs_remove(aBuf);
+}
+
+TEST(SqlSpill, Score)
+{
+	CSqlScoreData ScoreData(std::make_shared<CScorePlayerResult>());
+	str_copy(ScoreData.m_aMap, "Kobra 3", sizeof(ScoreData.m_aMap));
+	str_copy(ScoreData.m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(ScoreData.m_aGameUuid));
+	str_copy(ScoreData.m_aName, "nameless tee", sizeof(ScoreData.m_aName));
+	ScoreData.m_ClientID = 3;
+	ScoreData.m_Time = 123.45f;
+	str_copy(ScoreData.m_aTimestamp, "2021-11-24 19:24:08", sizeof(ScoreData.m_aTimestamp));
+	for(int i = 0; i < NUM_CHECKPOINTS; i++)
+		ScoreData.m_aCurrentTimeCp[i] = i * 1.5f;
+	str_copy(ScoreData.m_aRequestingPlayer, "deen", sizeof(ScoreData.m_aRequestingPlayer));
+
+	CPacker Packer;
+	Packer.Reset();
+	ASSERT_TRUE(ScoreData.Spill(&Packer));
+	ASSERT_FALSE(Packer.Error());
+
+	CUnpacker Unpacker;
+	Unpacker.Reset(Packer.Data(), Packer.Size());
+	auto pSqlData = CSqlScoreData::Unspill(&Unpacker);
+	ASSERT_TRUE(pSqlData);
+	const CSqlScoreData *pData = dynamic_cast<const CSqlScoreData *>(pSqlData.get());
+	ASSERT_TRUE(pData);
+	EXPECT_TRUE(pData->m_pResult);
+	EXPECT_STREQ(pData->m_aMap, "Kobra 3");
+	EXPECT_STREQ(pData->m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320");
+	EXPECT_STREQ(pData->m_aName, "nameless tee");
+	EXPECT_EQ(pData->m_ClientID, 3);
+	EXPECT_EQ(pData->m_Time, 123.45f);
+	EXPECT_STREQ(pData->m_aTimestamp, "2021-11-24 19:24:08");
+	for(int i = 0; i < NUM_CHECKPOINTS; i++)
+		EXPECT_EQ(pData->m_aCurrentTimeCp[i], i * 1.5f);
+	EXPECT_STREQ(pData->m_aRequestingPlayer, "deen");
+
+	Unpacker.Reset(Packer.Data(), Packer.Size() - 1);
+	EXPECT_FALSE(CSqlScoreData::Unspill(&Unpacker));
+}
+
+TEST(SqlSpill, TeamScore)
+{
+	CSqlTeamScoreData TeamScoreData;
+	str_copy(TeamScoreData.m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(TeamScoreData.m_aGameUuid));
+	str_copy(TeamScoreData.m_aMap, "Kobra 3", sizeof(TeamScoreData.m_aMap));
+	TeamScoreData.m_Time = 100.0f;
+	str_copy(TeamScoreData.m_aTimestamp, "2021-11-24 19:24:08", sizeof(TeamScoreData.m_aTimestamp));
+	TeamScoreData.m_Size = 2;
+	str_copy(TeamScoreData.m_aaNames[0], "nameless tee", sizeof(TeamScoreData.m_aaNames[0]));
+	str_copy(TeamScoreData.m_aaNames[1], "brainless tee", sizeof(TeamScoreData.m_aaNames[1]));
+	TeamScoreData.m_TeamrankUuid = RandomUuid();
+
+	CPacker Packer;
+	Packer.Reset();
+	ASSERT_TRUE(TeamScoreData.Spill(&Packer));
+
+	CUnpacker Unpacker;
+	Unpacker.Reset(Packer.Data(), Packer.Size());
+	auto pSqlData = CSqlTeamScoreData::Unspill(&Unpacker);
+	ASSERT_TRUE(pSqlData);
+	const CSqlTeamScoreData *pData = dynamic_cast<const CSqlTeamScoreData *>(pSqlData.get());
+	ASSERT_TRUE(pData);
+	EXPECT_STREQ(pData->m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320");
+	EXPECT_STREQ(pData->m_aMap, "Kobra 3");
+	EXPECT_EQ(pData->m_Time, 100.0f);
+	EXPECT_STREQ(pData->m_aTimestamp, "2021-11-24 19:24:08");
+	ASSERT_EQ(pData->m_Size, 2u);
+	EXPECT_STREQ(pData->m_aaNames[0], "nameless tee");
+	EXPECT_STREQ(pData->m_aaNames[1], "brainless tee");
+	EXPECT_EQ(pData->m_TeamrankUuid, TeamScoreData.m_TeamrankUuid);
+}
+
 struct Score : public testing::TestWithParam<IDbConnection *>
 {
 	Score()
@@ -111,21 +213,24 @@ struct Score : public testing::TestWithParam<IDbConnection *>
 	{
 		EXPECT_EQ(pPlayerResult->m_MessageKind, All ? CScorePlayerResult::ALL : CScorePlayerResult::DIRECT);
 
+		ASSERT_EQ(pPlayerResult->m_Messages.Num(), (int)Lines.size());
 		int i = 0;
 		for(const char *pLine : Lines)
 		{
-			EXPECT_STREQ(pPlayerResult->m_Data.m_aaMessages[i], pLine);
+			EXPECT_STREQ(Line(pPlayerResult, i), pLine);
 			i++;
 		}
+	}
 
-		for(; i < CScorePlayerResult::MAX_MESSAGES; i++)
-		{
-			EXPECT_STREQ(pPlayerResult->m_Data.m_aaMessages[i], "");
-		}
+	const char *Line(const std::shared_ptr<CScorePlayerResult> &pPlayerResult, int Line)
+	{
+		pPlayerResult->m_Messages.Render(Line, m_aLine, sizeof(m_aLine));
+		return m_aLine;
 	}
 
 	IDbConnection *m_pConn{GetParam()};
 	char m_aError[256] = {};
+	char m_aLine[512] = {};
 	std::shared_ptr<CScorePlayerResult> m_pPlayerResult{std::make_shared<CScorePlayerResult>()};
 	CSqlPlayerRequest m_PlayerRequest{m_pPlayerResult};
 };
@@ -152,6 +257,18 @@ TEST_P(SingleScore, Top)
 			"------------ GER Top ------------"});
 }
 
+TEST_P(SingleScore, TopRetried)
+{
+	// the connection pool runs the request again on the next read database if
+	// it fails after adding some lines
+	ASSERT_FALSE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ASSERT_FALSE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult,
+		{"------------ Global Top ------------",
+			"1. nameless tee Time: 01:40.00",
+			"------------ GER Top ------------"});
+}
+
 TEST_P(SingleScore, Rank)
 {
 	ASSERT_FALSE(CScoreWorker::ShowRank(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
@@ -216,18 +333,16 @@ TEST_P(SingleScore, TimesExists)
 {
 	ASSERT_FALSE(CScoreWorker::ShowTimes(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
 	EXPECT_EQ(m_pPlayerResult->m_MessageKind, CScorePlayerResult::DIRECT);
-	EXPECT_STREQ(m_pPlayerResult->m_Data.m_aaMessages[0], "------------- Last Times -------------");
+	ASSERT_EQ(m_pPlayerResult->m_Messages.Num(), 3);
+	EXPECT_STREQ(Line(m_pPlayerResult, 0), "------------- Last Times -------------");
 	char aBuf[128];
-	str_copy(aBuf, m_pPlayerResult->m_Data.m_aaMessages[1], 7);
+	const char *pLine = Line(m_pPlayerResult, 1);
+	str_copy(aBuf, pLine, 7);
 	EXPECT_STREQ(aBuf, "[USA] ");
 
-	str_copy(aBuf, m_pPlayerResult->m_Data.m_aaMessages[1] + str_length(m_pPlayerResult->m_Data.m_aaMessages[1]) - 10, 11);
+	str_copy(aBuf, pLine + str_length(pLine) - 10, 11);
 	EXPECT_STREQ(aBuf, ", 01:40.00");
-	EXPECT_STREQ(m_pPlayerResult->m_Data.m_aaMessages[2], "----------------------------------------------------");
-	for(int i = 3; i < CScorePlayerResult::MAX_MESSAGES; i++)
-	{
-		EXPECT_STREQ(m_pPlayerResult->m_Data.m_aaMessages[i], "");
-	}
+	EXPECT_STREQ(Line(m_pPlayerResult, 2), "----------------------------------------------------");
 }
 
 TEST_P(SingleScore, TimesDoesntExist)
@@ -297,11 +412,8 @@ TEST_P(MapInfo, ExactNoFinish)
 	ASSERT_FALSE(CScoreWorker::MapInfo(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
 
 	EXPECT_EQ(m_pPlayerResult->m_MessageKind, CScorePlayerResult::DIRECT);
-	EXPECT_THAT(m_pPlayerResult->m_Data.m_aaMessages[0], testing::MatchesRegex("\"Kobra 3\" by Zerodin on Novice, ★★★★★, 5 points, released .* ago, 0 finishes by 0 tees"));
-	for(int i = 1; i < CScorePlayerResult::MAX_MESSAGES; i++)
-	{
-		EXPECT_STREQ(m_pPlayerResult->m_Data.m_aaMessages[i], "");
-	}
+	ASSERT_EQ(m_pPlayerResult->m_Messages.Num(), 1);
+	EXPECT_THAT(Line(m_pPlayerResult, 0), testing::MatchesRegex("\"Kobra 3\" by Zerodin on Novice, ★★★★★, 5 points, released .* ago, 0 finishes by 0 tees"));
 }
 
 TEST_P(MapInfo, ExactFinish)
@@ -311,11 +423,8 @@ TEST_P(MapInfo, ExactFinish)
 	ASSERT_FALSE(CScoreWorker::MapInfo(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
 
 	EXPECT_EQ(m_pPlayerResult->m_MessageKind, CScorePlayerResult::DIRECT);
-	EXPECT_THAT(m_pPlayerResult->m_Data.m_aaMessages[0], testing::MatchesRegex("\"Kobra 3\" by Zerodin on Novice, ★★★★★, 5 points, released .* ago, 1 finish by 1 tee in 01:40 median"));
-	for(int i = 1; i < CScorePlayerResult::MAX_MESSAGES; i++)
-	{
-		EXPECT_STREQ(m_pPlayerResult->m_Data.m_aaMessages[i], "");
-	}
+	ASSERT_EQ(m_pPlayerResult->m_Messages.Num(), 1);
+	EXPECT_THAT(Line(m_pPlayerResult, 0), testing::MatchesRegex("\"Kobra 3\" by Zerodin on Novice, ★★★★★, 5 points, released .* ago, 1 finish by 1 tee in 01:40 median"));
 }
 
 TEST_P(MapInfo, Fuzzy)
@@ -325,11 +434,8 @@ TEST_P(MapInfo, Fuzzy)
 	ASSERT_FALSE(CScoreWorker::MapInfo(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
 
 	EXPECT_EQ(m_pPlayerResult->m_MessageKind, CScorePlayerResult::DIRECT);
-	EXPECT_THAT(m_pPlayerResult->m_Data.m_aaMessages[0], testing::MatchesRegex("\"Kobra 3\" by Zerodin on Novice, ★★★★★, 5 points, released .* ago, 1 finish by 1 tee in 01:40 median"));
-	for(int i = 1; i < CScorePlayerResult::MAX_MESSAGES; i++)
-	{
-		EXPECT_STREQ(m_pPlayerResult->m_Data.m_aaMessages[i], "");
-	}
+	ASSERT_EQ(m_pPlayerResult->m_Messages.Num(), 1);
+	EXPECT_THAT(Line(m_pPlayerResult, 0), testing::MatchesRegex("\"Kobra 3\" by Zerodin on Novice, ★★★★★, 5 points, released .* ago, 1 finish by 1 tee in 01:40 median"));
 }
 
 TEST_P(MapInfo, DoesntExit)
@@ -456,6 +562,54 @@ TEST_P(Points, EqualPointsTop)
 			"-------------------------------"});
 }
 
+struct Saves : public Score
+{
+	void InsertSave(const char *pSavegame, const char *pCode)
+	{
+		char aBuf[512];
+		str_format(aBuf, sizeof(aBuf),
+			"INSERT INTO %s_saves(Savegame, Map, Code, Server) VALUES (?, \"Kobra 3\", ?, \"GER\")",
+			m_pConn->GetPrefix());
+		ASSERT_FALSE(m_pConn->PrepareStatement(aBuf, m_aError, sizeof(m_aError))) << m_aError;
+		m_pConn->BindString(1, pSavegame);
+		m_pConn->BindString(2, pCode);
+		int NumInserted = 0;
+		ASSERT_FALSE(m_pConn->ExecuteUpdate(&NumInserted, m_aError, sizeof(m_aError))) << m_aError;
+		ASSERT_EQ(NumInserted, 1);
+	}
+
+	Saves()
+	{
+		InsertSave("0\t2\t0\t0\t0\nnameless tee\t1\t0\nbrainless tee\t1\t0", "text");
+		InsertSave("B1\tnameless tee\tbrainless tee\t\nAAAA", "binary");
+		InsertSave("B1\tbrainless tee\t\nAAAA", "other");
+		str_copy(m_PlayerRequest.m_aMap, "Kobra 3", sizeof(m_PlayerRequest.m_aMap));
+	}
+};
+
+TEST_P(Saves, TextAndBinary)
+{
+	str_copy(m_PlayerRequest.m_aRequestingPlayer, "nameless tee", sizeof(m_PlayerRequest.m_aRequestingPlayer));
+	ASSERT_FALSE(CScoreWorker::GetSaves(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ASSERT_EQ(m_pPlayerResult->m_Messages.Num(), 1);
+	EXPECT_TRUE(str_startswith(Line(m_pPlayerResult, 0), "nameless tee has 2 saves on Kobra 3, last saved ")) << m_aLine;
+}
+
+TEST_P(Saves, LastInBinary)
+{
+	str_copy(m_PlayerRequest.m_aRequestingPlayer, "brainless tee", sizeof(m_PlayerRequest.m_aRequestingPlayer));
+	ASSERT_FALSE(CScoreWorker::GetSaves(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ASSERT_EQ(m_pPlayerResult->m_Messages.Num(), 1);
+	EXPECT_TRUE(str_startswith(Line(m_pPlayerResult, 0), "brainless tee has 3 saves on Kobra 3, last saved ")) << m_aLine;
+}
+
+TEST_P(Saves, None)
+{
+	str_copy(m_PlayerRequest.m_aRequestingPlayer, "tee", sizeof(m_PlayerRequest.m_aRequestingPlayer));
+	ASSERT_FALSE(CScoreWorker::GetSaves(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	ExpectLines(m_pPlayerResult, {"tee has 0 saves on Kobra 3"});
+}
+
 struct RandomMap : public Score
 {
 	std::shared_ptr<CScoreRandomMapResult> m_pRandomMapResult{std::make_shared<CScoreRandomMapResult>(0)};
@@ -554,4 +708,5 @@ INSTANTIATE(TeamScore);
 INSTANTIATE(MapInfo);
 INSTANTIATE(MapVote);
 INSTANTIATE(Points);
+INSTANTIATE(Saves);
 INSTANTIATE(RandomMap);
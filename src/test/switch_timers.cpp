@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <game/gamecore.h>
+#include <game/mapitems.h>
+
+#include <random>
+
+// the per-tick scan over all switchers and teams that the timers replace
+static void PollSwitchers(std::vector<SSwitchers> &vSwitchers, int Tick)
+{
+	for(auto &Switcher : vSwitchers)
+	{
+		for(int j = 0; j < MAX_CLIENTS; ++j)
+		{
+			if(Switcher.m_aEndTick[j] <= Tick && Switcher.m_aType[j] == TILE_SWITCHTIMEDOPEN)
+			{
+				Switcher.m_aStatus[j] = false;
+				Switcher.m_aEndTick[j] = 0;
+				Switcher.m_aType[j] = TILE_SWITCHCLOSE;
+			}
+			else if(Switcher.m_aEndTick[j] <= Tick && Switcher.m_aType[j] == TILE_SWITCHTIMEDCLOSE)
+			{
+				Switcher.m_aStatus[j] = true;
+				Switcher.m_aEndTick[j] = 0;
+				Switcher.m_aType[j] = TILE_SWITCHOPEN;
+			}
+		}
+	}
+}
+
+static void ExpectSameSwitchers(const std::vector<SSwitchers> &vExpected, const std::vector<SSwitchers> &vActual, int Tick)
+{
+	ASSERT_EQ(vExpected.size(), vActual.size());
+	for(size_t i = 0; i < vExpected.size(); i++)
+	{
+		for(int j = 0; j < MAX_CLIENTS; j++)
+		{
+			ASSERT_EQ(vExpected[i].m_aStatus[j], vActual[i].m_aStatus[j]) << "switch " << i << " team " << j << " tick " << Tick;
+			ASSERT_EQ(vExpected[i].m_aEndTick[j], vActual[i].m_aEndTick[j]) << "switch " << i << " team " << j << " tick " << Tick;
+			ASSERT_EQ(vExpected[i].m_aType[j], vActual[i].m_aType[j]) << "switch " << i << " team " << j << " tick " << Tick;
+		}
+	}
+}
+
+TEST(SwitchTimers, MatchPolling)
+{
+	const int NumSwitches = 20;
+	std::vector<SSwitchers> vExpected;
+	CWorldCore World;
+	World.InitSwitchers(NumSwitches);
+	vExpected = World.m_vSwitchers;
+
+	std::mt19937 Rng(0);
+	int Tick = 100;
+	for(int i = 0; i < 20000; i++)
+	{
+		// mostly single steps, sometimes jumps like a restarted prediction
+		int Step = Rng() % 50 == 0 ? (int)(Rng() % 700) - 200 : 1;
+		Tick = maximum(Tick + Step, 0);
+
+		for(int k = Rng() % 4; k > 0; k--)
+		{
+			int Number = 1 + Rng() % NumSwitches;
+			int Team = Rng() % MAX_CLIENTS;
+			int Kind = Rng() % 4;
+			int Type = Kind == 0 ? TILE_SWITCHOPEN : Kind == 1 ? TILE_SWITCHCLOSE : Kind == 2 ? TILE_SWITCHTIMEDOPEN : TILE_SWITCHTIMEDCLOSE;
+			int EndTick = Kind >= 2 ? Tick + 1 + (int)(Rng() % 600) : 0;
+			for(auto *pSwitchers : {&vExpected, &World.m_vSwitchers})
+			{
+				SSwitchers &Switcher = (*pSwitchers)[Number];
+				Switcher.m_aStatus[Team] = Type == TILE_SWITCHOPEN || Type == TILE_SWITCHTIMEDOPEN;
+				Switcher.m_aEndTick[Team] = EndTick;
+				Switcher.m_aType[Team] = Type;
+			}
+			World.ScheduleSwitch(Number, Team);
+		}
+
+		PollSwitchers(vExpected, Tick);
+		World.UpdateSwitchers(Tick);
+		ExpectSameSwitchers(vExpected, World.m_vSwitchers, Tick);
+		if(HasFatalFailure())
+			return;
+	}
+}
+
+TEST(SwitchTimers, RescheduleOnce)
+{
+	CWorldCore World;
+	World.InitSwitchers(1);
+	SSwitchers &Switcher = World.m_vSwitchers[1];
+	Switcher.m_aStatus[0] = true;
+	Switcher.m_aEndTick[0] = 50;
+	Switcher.m_aType[0] = TILE_SWITCHTIMEDOPEN;
+	for(int i = 0; i < 10; i++)
+		World.ScheduleSwitch(1, 0);
+	EXPECT_EQ(World.m_SwitchTimers.NumTimers(), 1);
+
+	World.UpdateSwitchers(49);
+	EXPECT_TRUE(Switcher.m_aStatus[0]);
+	World.UpdateSwitchers(50);
+	EXPECT_FALSE(Switcher.m_aStatus[0]);
+	EXPECT_EQ(Switcher.m_aType[0], TILE_SWITCHCLOSE);
+	EXPECT_EQ(World.m_SwitchTimers.NumTimers(), 0);
+}
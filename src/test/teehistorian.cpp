@@ -5,6 +5,9 @@
 #include <engine/shared/config.h>
 #include <game/gamecore.h>
 #include <game/server/teehistorian.h>
+#include <game/server/teehistorian_reader.h>
+
+#include <vector>
 
 void RegisterGameUuids(CUuidManager *pManager);
 
@@ -18,6 +21,8 @@ protected:
 	CTeeHistorian::CGameInfo m_GameInfo;
 
 	CPacker m_Buffer;
+	// also holds what doesn't fit into the buffer
+	std::vector<unsigned char> m_vWritten;
 
 	enum
 	{
@@ -70,6 +75,14 @@ protected:
 		m_GameInfo.m_pTuning = &m_Tuning;
 		m_GameInfo.m_pUuids = &m_UuidManager;
 
+		m_GameInfo.m_Version = CTeeHistorian::VERSION_2;
+
+		Reset(&m_GameInfo);
+	}
+
+	void SetVersion(int Version)
+	{
+		m_GameInfo.m_Version = Version;
 		Reset(&m_GameInfo);
 	}
 
@@ -77,11 +90,13 @@ protected:
 	{
 		TeeHistorian *pThis = (TeeHistorian *)pUser;
 		pThis->m_Buffer.AddRaw(pData, DataSize);
+		pThis->m_vWritten.insert(pThis->m_vWritten.end(), (const unsigned char *)pData, (const unsigned char *)pData + DataSize);
 	}
 
 	void Reset(const CTeeHistorian::CGameInfo *pGameInfo)
 	{
 		m_Buffer.Reset();
+		m_vWritten.clear();
 		m_TH.Reset(pGameInfo, Write, this);
 		m_State = STATE_NONE;
 	}
@@ -89,17 +104,20 @@ protected:
 	void Expect(const unsigned char *pOutput, int OutputSize)
 	{
 		static CUuid TEEHISTORIAN_UUID = CalculateUuid("teehistorian@ddnet.tw");
-		static const char PREFIX1[] = "{\"comment\":\"teehistorian@ddnet.tw\",\"version\":\"2\",\"version_minor\":\"4\",\"game_uuid\":\"a1eb7182-796e-3b3e-941d-38ca71b2a4a8\",\"server_version\":\"DDNet test\",\"start_time\":\"";
+		static const char PREFIX1[] = "{\"comment\":\"teehistorian@ddnet.tw\",\"version\":\"%d\",\"version_minor\":\"%s\",\"game_uuid\":\"a1eb7182-796e-3b3e-941d-38ca71b2a4a8\",\"server_version\":\"DDNet test\",\"start_time\":\"";
 		static const char PREFIX2[] = "\",\"server_name\":\"server name\",\"server_port\":\"8303\",\"game_type\":\"game type\",\"map_name\":\"Kobra 3 Solo\",\"map_size\":\"903514\",\"map_sha256\":\"0123456789012345678901234567890123456789012345678901234567890123\",\"map_crc\":\"eceaf25c\",\"prng_description\":\"test-prng:02468ace\",\"config\":{},\"tuning\":{},\"uuids\":[";
 		static const char PREFIX3[] = "]}";
 
+		char aPrefix1[256];
+		str_format(aPrefix1, sizeof(aPrefix1), PREFIX1, m_GameInfo.m_Version, m_GameInfo.m_Version == CTeeHistorian::VERSION_2 ? "4" : "0");
+
 		char aTimeBuf[64];
 		str_timestamp_ex(m_GameInfo.m_StartTime, aTimeBuf, sizeof(aTimeBuf), "%Y-%m-%dT%H:%M:%S%z");
 
 		CPacker Buffer;
 		Buffer.Reset();
 		Buffer.AddRaw(&TEEHISTORIAN_UUID, sizeof(TEEHISTORIAN_UUID));
-		Buffer.AddRaw(PREFIX1, str_length(PREFIX1));
+		Buffer.AddRaw(aPrefix1, str_length(aPrefix1));
 		Buffer.AddRaw(aTimeBuf, str_length(aTimeBuf));
 		Buffer.AddRaw(PREFIX2, str_length(PREFIX2));
 		for(int i = 0; i < m_UuidManager.NumUuids(); i++)
@@ -757,3 +775,394 @@ TEST_F(TeeHistorian, PlayerReadyMultiple)
 	Finish();
 	Expect(EXPECTED, sizeof(EXPECTED));
 }
+
+class TeeHistorianV3 : public TeeHistorian
+{
+protected:
+	TeeHistorianV3()
+	{
+		SetVersion(CTeeHistorian::VERSION_3);
+	}
+};
+
+TEST_F(TeeHistorianV3, Empty)
+{
+	Expect((const unsigned char *)"", 0);
+}
+
+TEST_F(TeeHistorianV3, TickImplicitOneTick)
+{
+	const unsigned char EXPECTED[] = {
+		// PLAYERS mask_bytes=1 mask=0x01 kinds=NEW
+		0x4b, 0x01, 0x01, 0x00,
+		0x01, 0x02, // cid=0 x=1 y=2
+		0x40, // FINISH
+	};
+	Tick(1);
+	Player(0, 1, 2);
+	Finish();
+	Expect(EXPECTED, sizeof(EXPECTED));
+}
+
+TEST_F(TeeHistorianV3, ConstantVelocity)
+{
+	const unsigned char EXPECTED[] = {
+		// PLAYERS mask_bytes=1 mask=0x01 kinds=NEW
+		0x4b, 0x01, 0x01, 0x00,
+		0x0a, 0x14, // cid=0 x=10 y=20
+		// PLAYERS mask_bytes=1 mask=0x01 kinds=ACCEL
+		0x4b, 0x01, 0x01, 0x02,
+		0x02, 0x00, // cid=0 ddx=2 ddy=0
+		// ticks 3 to 10 continue with dx=2
+		0x41, 0x08, // TICK_SKIP dt=8
+		// PLAYERS mask_bytes=1 mask=0x01 kinds=ACCEL
+		0x4b, 0x01, 0x01, 0x02,
+		0x41, 0x00, // cid=0 ddx=-2 ddy=0
+		// standing still until the end
+		0x40, // FINISH
+	};
+	Tick(1);
+	Player(0, 10, 20);
+	for(int i = 2; i <= 10; i++)
+	{
+		Tick(i);
+		Player(0, 10 + (i - 1) * 2, 20);
+	}
+	for(int i = 11; i < 100; i++)
+	{
+		Tick(i);
+		Player(0, 28, 20);
+	}
+	Finish();
+	Expect(EXPECTED, sizeof(EXPECTED));
+}
+
+TEST_F(TeeHistorianV3, FallingAndDying)
+{
+	const unsigned char EXPECTED[] = {
+		// PLAYERS mask_bytes=2 mask=0x08,0x02 kinds=NEW,NEW
+		0x4b, 0x02, 0x08, 0x02, 0x00,
+		0x00, 0x00, // cid=3 x=0 y=0
+		0x05, 0x05, // cid=9 x=5 y=5
+		// PLAYERS mask_bytes=2 mask=0x08,0x02 kinds=ACCEL_Y,OLD
+		0x4b, 0x02, 0x08, 0x02, 0x07,
+		0x01, // cid=3 ddy=1
+		// PLAYERS mask_bytes=1 mask=0x08 kinds=ACCEL_Y
+		0x4b, 0x01, 0x08, 0x03,
+		0x01, // cid=3 ddy=1
+		0x40, // FINISH
+	};
+	Tick(1);
+	Player(3, 0, 0);
+	Player(9, 5, 5);
+	Tick(2);
+	Player(3, 0, 1);
+	DeadPlayer(9);
+	Tick(3);
+	Player(3, 0, 3);
+	DeadPlayer(9);
+	Finish();
+	Expect(EXPECTED, sizeof(EXPECTED));
+}
+
+TEST_F(TeeHistorianV3, TickExplicitPlayerMessage)
+{
+	const unsigned char EXPECTED[] = {
+		0x41, 0x00, // TICK_SKIP dt=0
+		0x46, 0x3f, 0x01, 0x00, // MESSAGE cid=63 msg="\0"
+		0x40, // FINISH
+	};
+	Tick(1);
+	Inputs();
+	m_TH.RecordPlayerMessage(63, "", 1);
+	Finish();
+	Expect(EXPECTED, sizeof(EXPECTED));
+}
+
+TEST_F(TeeHistorianV3, Input)
+{
+	CNetObj_PlayerInput Input = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	const unsigned char EXPECTED[] = {
+		// TICK_SKIP dt=0
+		0x41, 0x00,
+		// new player -> InputNew
+		0x45,
+		0x00, // ClientID 0
+		0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+		// same unique id, same input -> nothing
+		// same unique id, different input -> InputDiffMasked
+		0x4c,
+		0x00, // ClientID 0
+		0x01, // mask: direction
+		0x40, // direction -1
+		// different unique id, same input -> InputNew
+		0x45,
+		0x00, // ClientID 0
+		0x00, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+		// FINISH
+		0x40};
+
+	Tick(1);
+	Inputs();
+
+	m_TH.RecordPlayerInput(0, 1, &Input);
+	m_TH.RecordPlayerInput(0, 1, &Input);
+	Input.m_Direction = 0;
+	m_TH.RecordPlayerInput(0, 1, &Input);
+	m_TH.RecordPlayerInput(0, 2, &Input);
+
+	Finish();
+	Expect(EXPECTED, sizeof(EXPECTED));
+}
+
+TEST_F(TeeHistorianV3, SaveLoadDuringPlayers)
+{
+	const unsigned char EXPECTED[] = {
+		// PLAYERS mask_bytes=1 mask=0x01 kinds=NEW
+		0x4b, 0x01, 0x01, 0x00,
+		0x01, 0x02, // cid=0 x=1 y=2
+		// EX uuid=b29901d5-1244-3bd0-bbde-23d04b1f7ba9 datalen=1
+		0x4a,
+		0xb2, 0x99, 0x01, 0xd5, 0x12, 0x44, 0x3b, 0xd0,
+		0xbb, 0xde, 0x23, 0xd0, 0x4b, 0x1f, 0x7b, 0xa9,
+		0x01,
+		0x0c, // team=12
+		// player 0 is predicted, the load needs an explicit tick
+		0x41, 0x00, // TICK_SKIP dt=0
+		// EX uuid=ef8905a2-c695-3591-a1cd-53d2015992dd datalen=1
+		0x4a,
+		0xef, 0x89, 0x05, 0xa2, 0xc6, 0x95, 0x35, 0x91,
+		0xa1, 0xcd, 0x53, 0xd2, 0x01, 0x59, 0x92, 0xdd,
+		0x01,
+		0x03, // team=3
+		0x40, // FINISH
+	};
+	// saves and loads happen while the world ticks, before the players
+	// are recorded
+	Tick(1);
+	m_TH.RecordTeamSaveFailure(12);
+	Player(0, 1, 2);
+	Tick(2);
+	m_TH.RecordTeamLoadFailure(3);
+	Player(0, 1, 2);
+	Finish();
+	Expect(EXPECTED, sizeof(EXPECTED));
+}
+
+class CEmptyResult : public IConsole::IResult
+{
+public:
+	int GetInteger(unsigned Index) const override { return 0; }
+	float GetFloat(unsigned Index) const override { return 0.0f; }
+	const char *GetString(unsigned Index) const override { return ""; }
+	ColorHSLA GetColor(unsigned Index, bool Light) const override { return ColorHSLA(0, 0, 0); }
+	void RemoveArgument(unsigned Index) override {}
+	int GetVictim() const override { return -1; }
+};
+
+TEST_F(TeeHistorianV3, ConsoleCommandDuringPlayers)
+{
+	const unsigned char EXPECTED[] = {
+		// PLAYERS mask_bytes=1 mask=0x02 kinds=NEW
+		0x4b, 0x01, 0x02, 0x00,
+		0x05, 0x06, // cid=1 x=5 y=6
+		// CONSOLE_COMMAND cid=-1 flag_mask=1 cmd="vote" num_args=0
+		0x49, 0x40, 0x01, 'v', 'o', 't', 'e', 0x00, 0x00,
+		// PLAYERS mask_bytes=1 mask=0x02 kinds=ACCEL
+		0x4b, 0x01, 0x02, 0x02,
+		0x01, 0x00, // cid=1 ddx=1 ddy=0
+		// CONSOLE_COMMAND cid=1 flag_mask=1 cmd="kill" num_args=0
+		0x49, 0x01, 0x01, 'k', 'i', 'l', 'l', 0x00, 0x00,
+		0x40, // FINISH
+	};
+	CEmptyResult Result;
+	Tick(1);
+	m_TH.RecordConsoleCommand(-1, 1, "vote", &Result);
+	Player(1, 5, 6);
+	Tick(2);
+	Player(1, 6, 6);
+	m_TH.RecordConsoleCommand(1, 1, "kill", &Result);
+	Finish();
+	Expect(EXPECTED, sizeof(EXPECTED));
+}
+
+TEST_F(TeeHistorian, Version3Smaller)
+{
+	// a race with frozen, running, falling and hooking players
+	int aSize[2];
+	for(int Version = CTeeHistorian::VERSION_2; Version <= CTeeHistorian::VERSION_3; Version++)
+	{
+		SetVersion(Version);
+		const int HeaderSize = m_vWritten.size();
+		int aFallY[MAX_CLIENTS] = {0};
+		int aFallSpeed[MAX_CLIENTS] = {0};
+		for(int t = 1; t < 3000; t++)
+		{
+			Tick(t);
+			for(int i = 0; i < 32; i++)
+			{
+				switch(i % 4)
+				{
+				case 0:
+					Player(i, 100 * i, 500);
+					break;
+				case 1:
+					Player(i, (t / 100 % 2 ? 1000 - t % 100 * 10 : t % 100 * 10), 600);
+					break;
+				case 2:
+					if(t % 200 == 0)
+					{
+						DeadPlayer(i);
+						aFallY[i] = 0;
+						aFallSpeed[i] = 0;
+						break;
+					}
+					aFallSpeed[i] = minimum(aFallSpeed[i] + 1, 20);
+					aFallY[i] += aFallSpeed[i];
+					Player(i, 100 * i, aFallY[i]);
+					break;
+				case 3:
+					Player(i, 100 * i + (t * 7 + i) % 5, 700 + (t * 3 + i) % 7);
+					break;
+				}
+			}
+			Inputs();
+			for(int i = 0; i < 32; i++)
+			{
+				CNetObj_PlayerInput Input = {0};
+				Input.m_Direction = t / 100 % 2 ? -1 : 1;
+				Input.m_TargetX = i % 4 == 3 ? t / 10 % 20 : 0;
+				Input.m_TargetY = -1;
+				m_TH.RecordPlayerInput(i, i + 1, &Input);
+			}
+		}
+		Finish();
+		aSize[Version - CTeeHistorian::VERSION_2] = m_vWritten.size() - HeaderSize;
+	}
+	EXPECT_LT(aSize[1] * 2, aSize[0]);
+}
+
+class CTickChecker : public CTeeHistorianReader::IListener
+{
+public:
+	const CTeeHistorianReader *m_pReader;
+	std::vector<std::vector<CTeeHistorianReader::CPlayer>> m_vvExpected;
+	int m_NumTicks = 0;
+
+	void OnTickEnd(int Tick) override
+	{
+		m_NumTicks++;
+		ASSERT_LT(Tick, (int)m_vvExpected.size());
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			const CTeeHistorianReader::CPlayer &Expected = m_vvExpected[Tick][i];
+			const CTeeHistorianReader::CPlayer *pPlayer = m_pReader->Player(i);
+			ASSERT_EQ(pPlayer->m_Alive, Expected.m_Alive) << "tick=" << Tick << " cid=" << i;
+			if(Expected.m_Alive)
+			{
+				EXPECT_EQ(pPlayer->m_X, Expected.m_X) << "tick=" << Tick << " cid=" << i;
+				EXPECT_EQ(pPlayer->m_Y, Expected.m_Y) << "tick=" << Tick << " cid=" << i;
+			}
+			ASSERT_EQ(pPlayer->m_HasInput, Expected.m_HasInput) << "tick=" << Tick << " cid=" << i;
+			if(Expected.m_HasInput)
+			{
+				EXPECT_EQ(mem_comp(&pPlayer->m_Input, &Expected.m_Input, sizeof(Expected.m_Input)), 0) << "tick=" << Tick << " cid=" << i;
+			}
+		}
+	}
+};
+
+TEST_F(TeeHistorian, ReadBothVersions)
+{
+	for(int Version = CTeeHistorian::VERSION_2; Version <= CTeeHistorian::VERSION_3; Version++)
+	{
+		SetVersion(Version);
+		CTickChecker Checker;
+		std::vector<CTeeHistorianReader::CPlayer> vPlayers(MAX_CLIENTS);
+		for(auto &Player : vPlayers)
+			mem_zero(&Player, sizeof(Player));
+		// tick 0 is before the game
+		Checker.m_vvExpected.push_back(vPlayers);
+		// zero means no client, a client reconnecting gets a new one
+		uint32_t aUniqueClientIDs[10];
+		for(int i = 0; i < 10; i++)
+			aUniqueClientIDs[i] = i + 1;
+
+		for(int t = 1; t < 1000; t++)
+		{
+			// nothing changes in the ticks between 400 and 500
+			if(t >= 400 && t < 500)
+			{
+				Tick(t);
+				for(int i = 0; i < 10; i++)
+				{
+					if(vPlayers[i].m_Alive)
+						Player(i, vPlayers[i].m_X, vPlayers[i].m_Y);
+					else
+						DeadPlayer(i);
+				}
+				Checker.m_vvExpected.push_back(vPlayers);
+				continue;
+			}
+			Tick(t);
+			for(int i = 0; i < 10; i++)
+			{
+				CTeeHistorianReader::CPlayer *pPlayer = &vPlayers[i];
+				pPlayer->m_Alive = (t + i * 37) % 150 > 10;
+				if(!pPlayer->m_Alive)
+				{
+					DeadPlayer(i);
+					continue;
+				}
+				switch(i % 3)
+				{
+				case 0:
+					pPlayer->m_X = 100 * i;
+					pPlayer->m_Y = 100;
+					break;
+				case 1:
+					pPlayer->m_X = 100 * i + t % 50 * 3;
+					pPlayer->m_Y = 200 + t % 20 * t % 20;
+					break;
+				case 2:
+					pPlayer->m_X = -100 * i + (t * 13 + i) % 7;
+					pPlayer->m_Y = -300 + t % 9;
+					break;
+				}
+				Player(i, pPlayer->m_X, pPlayer->m_Y);
+			}
+			Inputs();
+			for(int i = 0; i < 10; i++)
+			{
+				CTeeHistorianReader::CPlayer *pPlayer = &vPlayers[i];
+				if(t % 100 == i)
+				{
+					m_TH.RecordPlayerDrop(i, "reconnect");
+					pPlayer->m_HasInput = false;
+					aUniqueClientIDs[i] += 10;
+					continue;
+				}
+				pPlayer->m_Input.m_Direction = (t / 30 + i) % 3 - 1;
+				pPlayer->m_Input.m_TargetX = i % 2 ? t % 40 : 10;
+				pPlayer->m_Input.m_TargetY = -1;
+				pPlayer->m_Input.m_Jump = t % 17 == 0;
+				pPlayer->m_HasInput = true;
+				m_TH.RecordPlayerInput(i, aUniqueClientIDs[i], &pPlayer->m_Input);
+			}
+			Checker.m_vvExpected.push_back(vPlayers);
+		}
+		Finish();
+
+		CTeeHistorianReader Reader;
+		ASSERT_TRUE(Reader.Init(m_vWritten.data(), m_vWritten.size())) << Reader.Error();
+		EXPECT_EQ(Reader.Version(), Version);
+		EXPECT_STREQ(Reader.MapName(), "Kobra 3 Solo");
+		Checker.m_pReader = &Reader;
+		Reader.SetListener(&Checker);
+		while(Reader.ReadRecord())
+		{
+		}
+		EXPECT_TRUE(Reader.Finished()) << Reader.Error();
+		EXPECT_EQ(Checker.m_NumTicks, 1000);
+	}
+}
@@ -0,0 +1,145 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <engine/shared/linereader.h>
+#include <engine/storage.h>
+#include <game/server/teehistorian_file.h>
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+static void TestWriteRead(bool Compress, int64_t RotateSize, int RotateTicks)
+{
+	CTestInfo Info;
+	std::unique_ptr<IStorage> pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	const bool Rotate = RotateSize || RotateTicks;
+
+	// like the header and the ticks of a teehistorian file, somewhat compressible
+	std::vector<unsigned char> vExpected;
+	std::map<int, int64_t> TickOffsets;
+	std::mt19937 Rng(0);
+	CTeeHistorianFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage.get(), Info.m_aFilename, Compress, RotateSize, RotateTicks, 100));
+	for(int Tick = -1; Tick < 3000; Tick++)
+	{
+		if(Tick >= 0)
+		{
+			Writer.MarkTick(Tick);
+			TickOffsets[Tick] = vExpected.size();
+		}
+		std::vector<unsigned char> vData(Tick < 0 ? 1000 : Rng() % 300);
+		for(auto &Char : vData)
+			Char = 'a' + Rng() % 8;
+		Writer.Write(vData.data(), vData.size());
+		vExpected.insert(vExpected.end(), vData.begin(), vData.end());
+	}
+	Writer.Close();
+	EXPECT_EQ(Writer.Error(), 0);
+	if(Rotate)
+	{
+		EXPECT_GT(Writer.NumFiles(), 1);
+	}
+	else
+	{
+		EXPECT_EQ(Writer.NumFiles(), 1);
+	}
+
+	std::vector<unsigned char> vData;
+	std::vector<std::vector<unsigned char>> vvFiles;
+	for(int i = 0; i < Writer.NumFiles(); i++)
+	{
+		char aFilename[IO_MAX_PATH_LENGTH];
+		CTeeHistorianFileWriter::FileName(aFilename, sizeof(aFilename), Info.m_aFilename, Compress, Rotate, i);
+		IOHANDLE File = pStorage->OpenFile(aFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File) << aFilename;
+		EXPECT_TRUE(CTeeHistorianFileWriter::ReadFile(File, &vData)) << aFilename;
+		io_seek(File, 0, IOSEEK_START);
+		vvFiles.emplace_back(io_length(File));
+		io_read(File, vvFiles.back().data(), vvFiles.back().size());
+		io_close(File);
+	}
+	ASSERT_EQ(vData.size(), vExpected.size());
+	EXPECT_TRUE(vData == vExpected);
+	if(Compress)
+	{
+		EXPECT_LT(vvFiles[0].size() * 2, vExpected.size() / Writer.NumFiles());
+	}
+
+	char aIndexFilename[IO_MAX_PATH_LENGTH];
+	str_format(aIndexFilename, sizeof(aIndexFilename), "%s.teehistorian.index", Info.m_aFilename);
+	IOHANDLE IndexFile = pStorage->OpenFile(aIndexFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!Compress && !Rotate)
+	{
+		EXPECT_FALSE(IndexFile);
+	}
+	else
+	{
+		ASSERT_TRUE(IndexFile);
+		CLineReader Reader;
+		Reader.Init(IndexFile);
+		int NumLines = 0;
+		while(const char *pLine = Reader.Get())
+		{
+			int Tick, FileIndex;
+			long long Offset, StreamOffset;
+			ASSERT_EQ(sscanf(pLine, "%d %d %lld %lld", &Tick, &FileIndex, &Offset, &StreamOffset), 4) << pLine;
+			ASSERT_GE(FileIndex, 0);
+			ASSERT_LT(FileIndex, Writer.NumFiles());
+			EXPECT_EQ(StreamOffset, Tick < 0 ? 0 : TickOffsets[Tick]) << pLine;
+
+			// every frame can be read on its own
+			const std::vector<unsigned char> &vFile = vvFiles[FileIndex];
+			ASSERT_LE(Offset, (long long)vFile.size());
+			if(Compress)
+			{
+				ASSERT_LE(Offset + 8, (long long)vFile.size());
+				unsigned FrameSize = bytes_be_to_uint(&vFile[Offset]);
+				uLongf DataSize = bytes_be_to_uint(&vFile[Offset + 4]);
+				std::vector<unsigned char> vFrame(DataSize);
+				ASSERT_EQ(uncompress(vFrame.data(), &DataSize, &vFile[Offset + 8], FrameSize), Z_OK) << pLine;
+				EXPECT_EQ(mem_comp(vFrame.data(), &vExpected[StreamOffset], vFrame.size()), 0) << pLine;
+			}
+			else
+			{
+				EXPECT_EQ(vFile[Offset], vExpected[StreamOffset]) << pLine;
+			}
+			NumLines++;
+		}
+		io_close(IndexFile);
+		EXPECT_GT(NumLines, 3000 / 100);
+	}
+
+	if(!::testing::Test::HasFailure())
+	{
+		for(int i = 0; i < Writer.NumFiles(); i++)
+		{
+			char aFilename[IO_MAX_PATH_LENGTH];
+			CTeeHistorianFileWriter::FileName(aFilename, sizeof(aFilename), Info.m_aFilename, Compress, Rotate, i);
+			pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE);
+		}
+		pStorage->RemoveFile(aIndexFilename, IStorage::TYPE_SAVE);
+	}
+}
+
+TEST(TeeHistorianFile, Raw)
+{
+	TestWriteRead(false, 0, 0);
+}
+
+TEST(TeeHistorianFile, Compressed)
+{
+	TestWriteRead(true, 0, 0);
+}
+
+TEST(TeeHistorianFile, CompressedRotateSize)
+{
+	TestWriteRead(true, 20 * 1024, 0);
+}
+
+TEST(TeeHistorianFile, RawRotateTicks)
+{
+	TestWriteRead(false, 0, 1000);
+}
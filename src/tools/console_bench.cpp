@@ -0,0 +1,124 @@
+// Registers the config variables and DDRace commands of a server in a
+// console and times command lookups and executed lines, compared to a
+// linear search of the command list.
+#include <base/logger.h>
+#include <base/system.h>
+#include <engine/shared/config.h>
+#include <engine/shared/console.h>
+
+#include <vector>
+
+static void Noop(IConsole::IResult *pResult, void *pUserData)
+{
+}
+
+static void Usage(const char *pProgram)
+{
+	dbg_msg("console_bench", "usage: %s [-n iterations]", pProgram);
+}
+
+static const IConsole::CCommandInfo *FindLinear(IConsole *pConsole, const char *pName, int FlagMask)
+{
+	for(const IConsole::CCommandInfo *pInfo = pConsole->FirstCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, FlagMask); pInfo; pInfo = pInfo->NextCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, FlagMask))
+	{
+		if(str_comp_nocase(pInfo->m_pName, pName) == 0)
+			return pInfo;
+	}
+	return nullptr;
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	int NumIterations = 200;
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-n") == 0 && i + 1 < argc)
+			NumIterations = maximum(str_toint(argv[++i]), 1);
+		else
+		{
+			Usage(argv[0]);
+			return -1;
+		}
+	}
+
+	CConsole Console(CFGFLAG_SERVER);
+	std::vector<const char *> vpNames;
+	// the same commands a server registers, but without their callbacks
+#define MACRO_CONFIG_INT(Name, ScriptName, Def, Min, Max, Flags, Desc) \
+	Console.Register(#ScriptName, "?i", Flags, Noop, nullptr, Desc); \
+	vpNames.push_back(#ScriptName);
+#define MACRO_CONFIG_COL(Name, ScriptName, Def, Flags, Desc) \
+	Console.Register(#ScriptName, "?i", Flags, Noop, nullptr, Desc); \
+	vpNames.push_back(#ScriptName);
+#define MACRO_CONFIG_STR(Name, ScriptName, Len, Def, Flags, Desc) \
+	Console.Register(#ScriptName, "?r", Flags, Noop, nullptr, Desc); \
+	vpNames.push_back(#ScriptName);
+#include <engine/shared/config_variables.h>
+#undef MACRO_CONFIG_INT
+#undef MACRO_CONFIG_COL
+#undef MACRO_CONFIG_STR
+
+#define CONSOLE_COMMAND(name, params, flags, callback, userdata, help) \
+	Console.Register(name, params, flags, Noop, nullptr, help); \
+	vpNames.push_back(name);
+#include <game/ddracecommands.h>
+#undef CONSOLE_COMMAND
+
+	// the chat commands are registered by the game context
+	const char *apChatCommands[] = {"rank", "points", "top5", "timeout", "spec", "pause", "me"};
+	for(const char *pName : apChatCommands)
+	{
+		Console.Register(pName, "?r", CFGFLAG_CHAT | CFGFLAG_SERVER, Noop, nullptr, "");
+		vpNames.push_back(pName);
+	}
+	const char *apChatLines[] = {"rank", "points", "top5 1", "timeout abcdef", "spec", "pause", "me waves"};
+	dbg_msg("console_bench", "%d commands registered", (int)vpNames.size());
+
+	int64_t Start = time_get_nanoseconds().count();
+	int Found = 0;
+	for(int n = 0; n < NumIterations; n++)
+		for(const char *pName : vpNames)
+			Found += FindLinear(&Console, pName, CFGFLAG_SERVER) != nullptr;
+	const int64_t LinearNs = time_get_nanoseconds().count() - Start;
+
+	Start = time_get_nanoseconds().count();
+	for(int n = 0; n < NumIterations; n++)
+		for(const char *pName : vpNames)
+			Found -= Console.GetCommandInfo(pName, CFGFLAG_SERVER, false) != nullptr;
+	const int64_t HashNs = time_get_nanoseconds().count() - Start;
+	if(Found != 0)
+	{
+		dbg_msg("console_bench", "lookups disagree");
+		return 1;
+	}
+	const int NumLookups = NumIterations * (int)vpNames.size();
+	dbg_msg("console_bench", "lookup: %.1f ns linear, %.1f ns hashed", (double)LinearNs / NumLookups, (double)HashNs / NumLookups);
+
+	// unknown commands have to walk the whole list
+	const char *apUnknown[] = {"sv_mpa", "zzz", "a", "tune_zone_reset_all"};
+	Start = time_get_nanoseconds().count();
+	for(int n = 0; n < NumIterations * 100; n++)
+		for(const char *pName : apUnknown)
+			Found += FindLinear(&Console, pName, CFGFLAG_SERVER) != nullptr;
+	const int64_t LinearMissNs = time_get_nanoseconds().count() - Start;
+	Start = time_get_nanoseconds().count();
+	for(int n = 0; n < NumIterations * 100; n++)
+		for(const char *pName : apUnknown)
+			Found += Console.GetCommandInfo(pName, CFGFLAG_SERVER, false) != nullptr;
+	const int64_t HashMissNs = time_get_nanoseconds().count() - Start;
+	const int NumMisses = NumIterations * 100 * (int)std::size(apUnknown);
+	dbg_msg("console_bench", "miss: %.1f ns linear, %.1f ns hashed%s", (double)LinearMissNs / NumMisses, (double)HashMissNs / NumMisses, Found ? " (unexpected hits)" : "");
+
+	// chat command spam of 64 clients
+	const int NumLines = NumIterations * 64 * (int)std::size(apChatLines);
+	Start = time_get_nanoseconds().count();
+	for(int n = 0; n < NumIterations * 64; n++)
+		for(const char *pLine : apChatLines)
+			Console.ExecuteLineFlag(pLine, CFGFLAG_CHAT, n % 64);
+	const int64_t ChatNs = time_get_nanoseconds().count() - Start;
+	dbg_msg("console_bench", "chat line: %.1f ns", (double)ChatNs / NumLines);
+	return 0;
+}
@@ -0,0 +1,232 @@
+// Slices, validates or prints the map info of many demos at once, one job
+// per demo on a job pool, and reports the throughput.
+#include <base/logger.h>
+#include <base/system.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/jobs.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+#include <game/generated/protocol.h>
+#include <game/version.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+enum
+{
+	MODE_VALIDATE = 0,
+	MODE_MAPINFO,
+	MODE_SLICE,
+};
+
+class CDemoBatchJob : public IJob, public CDemoPlayer::IListener
+{
+	IStorage *m_pStorage;
+	CSnapshotDelta m_SnapshotDelta;
+	int m_Mode;
+	char m_aDemo[IO_MAX_PATH_LENGTH];
+	char m_aDst[IO_MAX_PATH_LENGTH];
+	int m_StartTick;
+	int m_EndTick;
+
+	int m_NumSnapshots = 0;
+	int m_NumMessages = 0;
+
+	void Validate()
+	{
+		std::unique_ptr<CDemoPlayer> pPlayer = std::make_unique<CDemoPlayer>(&m_SnapshotDelta);
+		pPlayer->SetListener(this);
+		if(pPlayer->Load(m_pStorage, nullptr, m_aDemo, IStorage::TYPE_ALL_OR_ABSOLUTE))
+		{
+			str_copy(m_aResult, "could not load demo");
+			return;
+		}
+
+		// plays as fast as possible until the end, errors stop the player
+		const CDemoPlayer::CPlaybackInfo *pInfo = pPlayer->Info();
+		pPlayer->Play();
+		while(pPlayer->IsPlaying() && !pInfo->m_Info.m_Paused)
+			pPlayer->Update(false);
+
+		if(!pPlayer->IsPlaying())
+		{
+			str_format(m_aResult, sizeof(m_aResult), "broken chunk after tick %d", pInfo->m_Info.m_CurrentTick);
+			return;
+		}
+		m_Success = pInfo->m_Info.m_CurrentTick == pInfo->m_Info.m_LastTick;
+		str_format(m_aResult, sizeof(m_aResult), "%s ticks=%d-%d snapshots=%d messages=%d keyframes=%d%s",
+			m_Success ? "ok" : "ended early",
+			pInfo->m_Info.m_FirstTick, pInfo->m_Info.m_LastTick, m_NumSnapshots, m_NumMessages,
+			pInfo->m_SeekablePoints, pPlayer->IsIndexed() ? " indexed" : "");
+		pPlayer->Stop();
+	}
+
+	void MapInfo()
+	{
+		std::unique_ptr<CDemoPlayer> pPlayer = std::make_unique<CDemoPlayer>(&m_SnapshotDelta);
+		if(pPlayer->Load(m_pStorage, nullptr, m_aDemo, IStorage::TYPE_ALL_OR_ABSOLUTE))
+		{
+			str_copy(m_aResult, "could not load demo");
+			return;
+		}
+
+		const CMapInfo *pMapInfo = pPlayer->GetMapInfo();
+		char aSha256[SHA256_MAXSTRSIZE];
+		sha256_str(pMapInfo->m_Sha256, aSha256, sizeof(aSha256));
+		str_format(m_aResult, sizeof(m_aResult), "map=%s size=%d crc=%08x sha256=%s type=%s length=%d",
+			pMapInfo->m_aName, pMapInfo->m_Size, pMapInfo->m_Crc, aSha256,
+			pPlayer->Info()->m_Header.m_aType, bytes_be_to_int(pPlayer->Info()->m_Header.m_aLength));
+		m_Success = true;
+		pPlayer->Stop();
+	}
+
+	void Slice()
+	{
+		CDemoEditor Editor;
+		Editor.Init(GAME_NETVERSION, &m_SnapshotDelta, nullptr, m_pStorage);
+		m_Success = Editor.Slice(m_aDemo, m_aDst, m_StartTick, m_EndTick, nullptr, nullptr);
+		if(m_Success)
+			str_format(m_aResult, sizeof(m_aResult), "sliced to '%s'", m_aDst);
+		else
+			str_format(m_aResult, sizeof(m_aResult), "could not slice to '%s'", m_aDst);
+	}
+
+	void Run() override
+	{
+		IOHANDLE File = m_pStorage->OpenFile(m_aDemo, IOFLAG_READ, IStorage::TYPE_ALL_OR_ABSOLUTE);
+		if(File)
+		{
+			m_Size = io_length(File);
+			io_close(File);
+		}
+
+		if(m_Mode == MODE_VALIDATE)
+			Validate();
+		else if(m_Mode == MODE_MAPINFO)
+			MapInfo();
+		else
+			Slice();
+	}
+
+public:
+	bool m_Success = false;
+	char m_aResult[256] = "";
+	long m_Size = 0;
+
+	CDemoBatchJob(IStorage *pStorage, const CSnapshotDelta *pSnapshotDelta, int Mode, const char *pDemo, int StartTick, int EndTick) :
+		m_pStorage(pStorage),
+		m_SnapshotDelta(*pSnapshotDelta),
+		m_Mode(Mode),
+		m_StartTick(StartTick),
+		m_EndTick(EndTick)
+	{
+		str_copy(m_aDemo, pDemo);
+
+		// the slices are written to the current directory
+		const char *pName = maximum(str_rchr(pDemo, '/'), str_rchr(pDemo, '\\'));
+		pName = pName ? pName + 1 : pDemo;
+		char aName[IO_MAX_PATH_LENGTH];
+		str_copy(aName, pName);
+		if(str_endswith(aName, ".demo"))
+			aName[str_length(aName) - str_length(".demo")] = '\0';
+		str_format(m_aDst, sizeof(m_aDst), "%s_%d-%d.demo", aName, StartTick, EndTick);
+	}
+
+	const char *Demo() const { return m_aDemo; }
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override { m_NumSnapshots++; }
+	void OnDemoPlayerMessage(void *pData, int Size) override { m_NumMessages++; }
+};
+
+static void Usage(const char *pProgram)
+{
+	dbg_msg("demo_batch", "usage: %s [-j threads] validate|mapinfo|slice <start_tick> <end_tick> <demo>...", pProgram);
+	dbg_msg("demo_batch", "  ticks are absolute, -1 means the start or end of the demo");
+	dbg_msg("demo_batch", "  slices are written to the current directory as <name>_<start>-<end>.demo");
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	int NumThreads = maximum((int)std::thread::hardware_concurrency(), 1);
+	int Mode = -1;
+	int StartTick = -1;
+	int EndTick = -1;
+	std::vector<const char *> vpDemos;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(Mode == -1 && str_comp(argv[i], "-j") == 0 && i + 1 < argc)
+			NumThreads = clamp(str_toint(argv[++i]), 1, 32);
+		else if(Mode == -1 && str_comp(argv[i], "validate") == 0)
+			Mode = MODE_VALIDATE;
+		else if(Mode == -1 && str_comp(argv[i], "mapinfo") == 0)
+			Mode = MODE_MAPINFO;
+		else if(Mode == -1 && str_comp(argv[i], "slice") == 0 && i + 2 < argc)
+		{
+			Mode = MODE_SLICE;
+			StartTick = str_toint(argv[++i]);
+			EndTick = str_toint(argv[++i]);
+		}
+		else if(Mode != -1)
+			vpDemos.push_back(argv[i]);
+		else
+		{
+			Usage(argv[0]);
+			return -1;
+		}
+	}
+	if(Mode == -1 || vpDemos.empty())
+	{
+		Usage(argv[0]);
+		return -1;
+	}
+
+	IStorage *pStorage = CreateLocalStorage();
+	if(!pStorage)
+	{
+		dbg_msg("demo_batch", "could not initialize storage");
+		return -1;
+	}
+	CNetBase::Init();
+
+	// the same item sizes as the client, otherwise the deltas can't be read
+	CSnapshotDelta SnapshotDelta;
+	CNetObjHandler NetObjHandler;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		SnapshotDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	std::vector<std::shared_ptr<CDemoBatchJob>> vpJobs;
+	for(const char *pDemo : vpDemos)
+		vpJobs.push_back(std::make_shared<CDemoBatchJob>(pStorage, &SnapshotDelta, Mode, pDemo, StartTick, EndTick));
+
+	CJobPool JobPool;
+	JobPool.Init(NumThreads);
+	const int64_t StartTime = time_get_nanoseconds().count();
+	for(auto &pJob : vpJobs)
+		JobPool.Add(pJob);
+
+	// print the results in order as they become available
+	int NumFailed = 0;
+	int64_t TotalSize = 0;
+	for(auto &pJob : vpJobs)
+	{
+		while(pJob->Status() != IJob::STATE_DONE)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		dbg_msg("demo_batch", "%s: %s", pJob->Demo(), pJob->m_aResult);
+		if(!pJob->m_Success)
+			NumFailed++;
+		TotalSize += pJob->m_Size;
+	}
+	const double Seconds = maximum(time_get_nanoseconds().count() - StartTime, (int64_t)1) / 1e9;
+
+	dbg_msg("demo_batch", "%d demos (%d failed) in %.2fs with %d threads: %.1f demos/s, %.1f MiB/s",
+		(int)vpJobs.size(), NumFailed, Seconds, NumThreads, vpJobs.size() / Seconds, TotalSize / Seconds / (1024.0 * 1024.0));
+	delete pStorage;
+	return NumFailed ? 1 : 0;
+}
@@ -0,0 +1,474 @@
+// Runs characters through CWorldCore on a real map, hashes the character
+// cores every tick and reports ns per character-tick. Golden hashes can be
+// written with -w and verified with -g, so physics optimizations can be
+// checked against the unmodified code.
+//
+// The characters either get synthetic inputs, or (-r) the inputs, teams and
+// positions of a teehistorian recording. With a recording, every tick starts
+// from the recorded positions, so the workload stays where the players were.
+// Only the CCharacterCore physics run, not the game logic of the server
+// (freeze, weapons, teleporters...), so the simulated positions aren't
+// compared to the recorded ones.
+#include <base/hash_ctxt.h>
+#include <base/logger.h>
+#include <base/system.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/shared/config.h>
+#include <engine/shared/json.h>
+#include <engine/shared/linereader.h>
+#include <engine/shared/packer.h>
+#include <engine/storage.h>
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+#include <game/server/teehistorian_file.h>
+#include <game/server/teehistorian_reader.h>
+#include <game/teamscore.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#define UUID(id, name) static const CUuid UUID_##id = CalculateUuid(name);
+#include <engine/shared/teehistorian_ex_chunks.h>
+#undef UUID
+
+// Deterministic input stream: every character changes its direction, jump
+// and hook state at random intervals and aims at a random target.
+class CInputGenerator
+{
+	std::mt19937 m_Rng;
+
+	int Random(int BelowThis) { return m_Rng() % BelowThis; }
+
+public:
+	CInputGenerator(unsigned Seed) :
+		m_Rng(Seed) {}
+
+	void Next(CNetObj_PlayerInput *pInput)
+	{
+		if(Random(10) == 0)
+			pInput->m_Direction = Random(3) - 1;
+		if(Random(8) == 0)
+			pInput->m_Jump ^= 1;
+		if(Random(15) == 0)
+		{
+			pInput->m_Hook ^= 1;
+			pInput->m_TargetX = Random(801) - 400;
+			pInput->m_TargetY = Random(801) - 400;
+			if(pInput->m_TargetX == 0 && pInput->m_TargetY == 0)
+				pInput->m_TargetY = -1;
+		}
+	}
+};
+
+static void HashCore(SHA256_CTX *pCtx, CCharacterCore *pCore)
+{
+	// Write() leaves m_Tick alone
+	CNetObj_CharacterCore Obj = {};
+	pCore->Write(&Obj);
+	sha256_update(pCtx, &Obj, sizeof(Obj));
+	// the network object is rounded, so also include the exact floats
+	const float aExact[] = {pCore->m_Pos.x, pCore->m_Pos.y, pCore->m_Vel.x, pCore->m_Vel.y, pCore->m_HookPos.x, pCore->m_HookPos.y, pCore->m_HookDir.x, pCore->m_HookDir.y};
+	sha256_update(pCtx, aExact, sizeof(aExact));
+}
+
+// The characters and the golden output, shared by both kinds of inputs.
+class CBench
+{
+	CCollision *m_pCollision;
+	std::map<int, std::vector<vec2>> *m_pTeleOuts;
+	IOHANDLE m_GoldenFile = 0;
+	bool m_WriteGolden = false;
+	CLineReader m_GoldenReader;
+
+public:
+	CWorldCore m_World;
+	CTeamsCore m_Teams;
+	CCharacterCore m_aCores[MAX_CLIENTS];
+
+	int m_NumTicks = 0;
+	int64_t m_NumCharacterTicks = 0;
+	int64_t m_TotalNs = 0;
+	int m_Mismatch = -1;
+
+	CBench(CCollision *pCollision, std::map<int, std::vector<vec2>> *pTeleOuts) :
+		m_pCollision(pCollision),
+		m_pTeleOuts(pTeleOuts)
+	{
+		m_World.InitSwitchers(pCollision->m_HighestSwitchNumber);
+	}
+
+	~CBench()
+	{
+		if(m_GoldenFile)
+			io_close(m_GoldenFile);
+	}
+
+	bool OpenGolden(const char *pFilename, bool Write)
+	{
+		m_GoldenFile = io_open(pFilename, Write ? IOFLAG_WRITE : IOFLAG_READ);
+		if(!m_GoldenFile)
+			return false;
+		m_WriteGolden = Write;
+		if(!Write)
+			m_GoldenReader.Init(m_GoldenFile);
+		return true;
+	}
+
+	void Add(int ClientID, vec2 Pos)
+	{
+		// Reset() doesn't cover every member
+		m_aCores[ClientID] = CCharacterCore();
+		CCharacterCore *pCore = &m_aCores[ClientID];
+		pCore->Init(&m_World, m_pCollision, &m_Teams, m_pTeleOuts);
+		pCore->m_Id = ClientID;
+		pCore->m_Pos = Pos;
+		mem_zero(&pCore->m_Input, sizeof(pCore->m_Input));
+		pCore->m_Input.m_TargetY = -1;
+		m_World.m_apCharacters[ClientID] = pCore;
+	}
+
+	void Remove(int ClientID)
+	{
+		m_World.m_apCharacters[ClientID] = nullptr;
+	}
+
+	// returns false once the cores differ from the golden output
+	bool Step()
+	{
+		// same order as the server: all cores tick, then all of them move
+		int64_t Start = time_get_nanoseconds().count();
+		m_World.BuildBroadphase();
+		for(auto *pCore : m_World.m_apCharacters)
+			if(pCore)
+				pCore->Tick(true);
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			CCharacterCore *pCore = m_World.m_apCharacters[i];
+			if(!pCore)
+				continue;
+			pCore->Move();
+			pCore->Quantize();
+			m_World.UpdateBroadphase(i);
+			m_NumCharacterTicks++;
+		}
+		m_World.ClearBroadphase();
+		m_TotalNs += time_get_nanoseconds().count() - Start;
+		const int Tick = m_NumTicks++;
+
+		if(!m_GoldenFile)
+			return true;
+
+		SHA256_CTX Ctx;
+		sha256_init(&Ctx);
+		for(auto *pCore : m_World.m_apCharacters)
+			if(pCore)
+				HashCore(&Ctx, pCore);
+		char aHash[SHA256_MAXSTRSIZE];
+		sha256_str(sha256_finish(&Ctx), aHash, sizeof(aHash));
+
+		char aLine[16 + SHA256_MAXSTRSIZE];
+		str_format(aLine, sizeof(aLine), "%d %s", Tick, aHash);
+		if(m_WriteGolden)
+		{
+			io_write(m_GoldenFile, aLine, str_length(aLine));
+			io_write_newline(m_GoldenFile);
+			return true;
+		}
+		const char *pExpected = m_GoldenReader.Get();
+		if(!pExpected || str_comp(pExpected, aLine) != 0)
+		{
+			m_Mismatch = Tick;
+			return false;
+		}
+		return true;
+	}
+};
+
+// Feeds the players of a teehistorian recording into the bench, one step per
+// recorded tick.
+class CRecording : public CTeeHistorianReader::IListener
+{
+	const CTeeHistorianReader *m_pReader;
+	CBench *m_pBench;
+	int m_MaxTicks;
+
+	// recorded positions of the previous tick, to estimate the velocity
+	bool m_aPrevAlive[MAX_CLIENTS] = {false};
+	ivec2 m_aPrevPos[MAX_CLIENTS];
+
+public:
+	bool m_Done = false;
+
+	CRecording(const CTeeHistorianReader *pReader, CBench *pBench, int MaxTicks) :
+		m_pReader(pReader),
+		m_pBench(pBench),
+		m_MaxTicks(MaxTicks)
+	{
+	}
+
+	void OnTickEnd(int Tick) override
+	{
+		if(m_Done)
+			return;
+
+		for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+		{
+			const CTeeHistorianReader::CPlayer *pPlayer = m_pReader->Player(ClientID);
+			CCharacterCore *pCore = m_pBench->m_World.m_apCharacters[ClientID];
+			if(!pPlayer->m_Alive)
+			{
+				if(pCore)
+					m_pBench->Remove(ClientID);
+			}
+			else
+			{
+				const vec2 Pos(pPlayer->m_X, pPlayer->m_Y);
+				if(!pCore)
+				{
+					m_pBench->Add(ClientID, Pos);
+					pCore = &m_pBench->m_aCores[ClientID];
+				}
+				pCore->m_Pos = Pos;
+				if(m_aPrevAlive[ClientID])
+					pCore->m_Vel = vec2(pPlayer->m_X - m_aPrevPos[ClientID].x, pPlayer->m_Y - m_aPrevPos[ClientID].y);
+				// the inputs recorded in this tick are applied in the next one
+				if(pPlayer->m_HasInput)
+					pCore->m_Input = pPlayer->m_Input;
+			}
+			m_aPrevAlive[ClientID] = pPlayer->m_Alive;
+			m_aPrevPos[ClientID] = ivec2(pPlayer->m_X, pPlayer->m_Y);
+		}
+
+		m_Done = !m_pBench->Step() || m_pBench->m_NumTicks == m_MaxTicks;
+	}
+
+	void OnDrop(int ClientID, const char *pReason) override
+	{
+		if(m_pBench->m_World.m_apCharacters[ClientID])
+			m_pBench->Remove(ClientID);
+		m_aPrevAlive[ClientID] = false;
+		m_pBench->m_Teams.Team(ClientID, TEAM_FLOCK);
+	}
+
+	void OnExtra(CUuid Uuid, const void *pData, int DataSize) override
+	{
+		if(Uuid != UUID_TEEHISTORIAN_PLAYER_TEAM)
+			return;
+		CUnpacker Unpacker;
+		Unpacker.Reset(pData, DataSize);
+		const int ClientID = Unpacker.GetInt();
+		const int Team = Unpacker.GetInt();
+		if(!Unpacker.Error() && ClientID >= 0 && ClientID < MAX_CLIENTS && Team >= TEAM_FLOCK && Team < NUM_TEAMS)
+			m_pBench->m_Teams.Team(ClientID, Team);
+	}
+};
+
+static void Usage(const char *pProgram)
+{
+	dbg_msg("physics_bench", "usage: %s [-n ticks] [-c characters] [-t teams] [-s seed] [-w golden_out | -g golden_in] <map>", pProgram);
+	dbg_msg("physics_bench", "       %s [-n ticks] [-w golden_out | -g golden_in] -r <teehistorian> [-r <teehistorian>...] [map]", pProgram);
+	dbg_msg("physics_bench", "  the map is looked up in the storage paths, e.g. maps/Tutorial.map");
+	dbg_msg("physics_bench", "  several recordings are read as one, e.g. the rotated files of a game");
+	dbg_msg("physics_bench", "  the map of a recording defaults to maps/<map_name>.map from its header");
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	int NumTicks = -1;
+	int NumCharacters = 16;
+	int NumTeams = 1;
+	unsigned Seed = 0;
+	const char *pWriteGolden = nullptr;
+	const char *pCheckGolden = nullptr;
+	const char *pMapName = nullptr;
+	std::vector<const char *> vpRecordings;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-n") == 0 && i + 1 < argc)
+			NumTicks = maximum(str_toint(argv[++i]), 1);
+		else if(str_comp(argv[i], "-c") == 0 && i + 1 < argc)
+			NumCharacters = clamp(str_toint(argv[++i]), 1, (int)MAX_CLIENTS);
+		else if(str_comp(argv[i], "-t") == 0 && i + 1 < argc)
+			NumTeams = clamp(str_toint(argv[++i]), 1, (int)MAX_CLIENTS);
+		else if(str_comp(argv[i], "-s") == 0 && i + 1 < argc)
+			Seed = str_toint(argv[++i]);
+		else if(str_comp(argv[i], "-w") == 0 && i + 1 < argc)
+			pWriteGolden = argv[++i];
+		else if(str_comp(argv[i], "-g") == 0 && i + 1 < argc)
+			pCheckGolden = argv[++i];
+		else if(str_comp(argv[i], "-r") == 0 && i + 1 < argc)
+			vpRecordings.push_back(argv[++i]);
+		else if(argv[i][0] != '-' && !pMapName)
+			pMapName = argv[i];
+		else
+		{
+			Usage(argv[0]);
+			return -1;
+		}
+	}
+	if((!pMapName && vpRecordings.empty()) || (pWriteGolden && pCheckGolden))
+	{
+		Usage(argv[0]);
+		return -1;
+	}
+
+	std::unique_ptr<IKernel> pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+	IStorage *pStorage = CreateStorage(IStorage::STORAGETYPE_BASIC, argc, argv);
+	IEngineMap *pMap = CreateEngineMap();
+	if(!pStorage)
+	{
+		dbg_msg("physics_bench", "could not initialize storage");
+		return -1;
+	}
+	pKernel->RegisterInterface(pStorage);
+	pKernel->RegisterInterface(pMap);
+	pKernel->RegisterInterface(static_cast<IMap *>(pMap), false);
+
+	std::vector<unsigned char> vRecording;
+	CTeeHistorianReader Reader;
+	char aMapFilename[IO_MAX_PATH_LENGTH];
+	if(pMapName)
+		str_copy(aMapFilename, pMapName);
+	if(!vpRecordings.empty())
+	{
+		for(const char *pFile : vpRecordings)
+		{
+			IOHANDLE File = pStorage->OpenFile(pFile, IOFLAG_READ, IStorage::TYPE_ALL_OR_ABSOLUTE);
+			if(!File)
+			{
+				dbg_msg("physics_bench", "could not open '%s'", pFile);
+				return -1;
+			}
+			const bool Success = CTeeHistorianFileWriter::ReadFile(File, &vRecording);
+			io_close(File);
+			if(!Success)
+			{
+				dbg_msg("physics_bench", "could not read '%s'", pFile);
+				return -1;
+			}
+		}
+		if(!Reader.Init(vRecording.data(), vRecording.size()))
+		{
+			dbg_msg("physics_bench", "%s", Reader.Error());
+			return -1;
+		}
+		if(!pMapName)
+			str_format(aMapFilename, sizeof(aMapFilename), "maps/%s.map", Reader.MapName());
+	}
+
+	if(!pMap->Load(aMapFilename))
+	{
+		dbg_msg("physics_bench", "could not load map '%s'", aMapFilename);
+		return -1;
+	}
+	SHA256_DIGEST Sha256;
+	if(!vpRecordings.empty() && Reader.MapSha256(&Sha256) && Sha256 != pMap->Sha256())
+		dbg_msg("physics_bench", "warning: map '%s' differs from the recorded one", aMapFilename);
+
+	CLayers Layers;
+	Layers.Init(pKernel.get());
+	CCollision Collision;
+	Collision.Init(&Layers);
+
+	// hooks through teleporters need the outputs, like CGameControllerDDRace::InitTeleporter
+	std::map<int, std::vector<vec2>> TeleOuts;
+	if(Collision.TeleLayer())
+	{
+		for(int i = 0; i < Collision.GetWidth() * Collision.GetHeight(); i++)
+		{
+			if(Collision.TeleLayer()[i].m_Number > 0 && Collision.TeleLayer()[i].m_Type == TILE_TELEOUT)
+				TeleOuts[Collision.TeleLayer()[i].m_Number - 1].push_back(vec2(i % Collision.GetWidth() * 32 + 16, i / Collision.GetWidth() * 32 + 16));
+		}
+	}
+
+	CBench Bench(&Collision, &TeleOuts);
+	if(pWriteGolden || pCheckGolden)
+	{
+		const char *pFilename = pWriteGolden ? pWriteGolden : pCheckGolden;
+		if(!Bench.OpenGolden(pFilename, pWriteGolden))
+		{
+			dbg_msg("physics_bench", "could not open '%s'", pFilename);
+			return -1;
+		}
+	}
+
+	if(!vpRecordings.empty())
+	{
+		// the header only lists the tuning that differs from the default
+		const json_value *pTuning = json_object_get(Reader.Header(), "tuning");
+		if(pTuning->type == json_object)
+		{
+			for(unsigned i = 0; i < pTuning->u.object.length; i++)
+			{
+				const json_value *pValue = pTuning->u.object.values[i].value;
+				if(pValue->type == json_string)
+					Bench.m_World.m_aTuning[0].Set(pTuning->u.object.values[i].name, str_toint(json_string_get(pValue)) / 100.0f);
+			}
+		}
+
+		CRecording Recording(&Reader, &Bench, NumTicks);
+		Reader.SetListener(&Recording);
+		while(!Recording.m_Done && Reader.ReadRecord())
+		{
+		}
+		if(!Recording.m_Done && !Reader.Finished())
+			dbg_msg("physics_bench", "stopped reading: %s", Reader.Error());
+	}
+	else
+	{
+		std::vector<vec2> vSpawns;
+		for(int y = 0; y < Collision.GetHeight(); y++)
+		{
+			for(int x = 0; x < Collision.GetWidth(); x++)
+			{
+				int Index = Collision.GetIndex(x, y) - ENTITY_OFFSET;
+				if(Index == ENTITY_SPAWN || Index == ENTITY_SPAWN_RED || Index == ENTITY_SPAWN_BLUE)
+					vSpawns.emplace_back(x * 32.0f + 16.0f, y * 32.0f + 16.0f);
+			}
+		}
+		if(vSpawns.empty())
+		{
+			dbg_msg("physics_bench", "map '%s' has no spawn tiles", aMapFilename);
+			return -1;
+		}
+
+		std::vector<CInputGenerator> vInputs;
+		for(int i = 0; i < NumCharacters; i++)
+		{
+			Bench.Add(i, vSpawns[i % vSpawns.size()]);
+			// team 0 is the flock, the others only collide among themselves
+			Bench.m_Teams.Team(i, i % NumTeams);
+			vInputs.emplace_back(Seed * MAX_CLIENTS + i);
+		}
+
+		for(int Tick = 0; Tick < (NumTicks < 0 ? 3000 : NumTicks); Tick++)
+		{
+			for(int i = 0; i < NumCharacters; i++)
+				vInputs[i].Next(&Bench.m_aCores[i].m_Input);
+			if(!Bench.Step())
+				break;
+		}
+	}
+
+	if(Bench.m_Mismatch >= 0)
+	{
+		dbg_msg("physics_bench", "character cores differ from the golden output at tick %d", Bench.m_Mismatch);
+		return 1;
+	}
+	if(!vpRecordings.empty())
+		dbg_msg("physics_bench", "recorded game %s on '%s', version %d", Reader.GameUuid(), Reader.MapName(), Reader.Version());
+	dbg_msg("physics_bench", "%lld character-ticks in %d ticks: %.1f ns per character-tick",
+		(long long)Bench.m_NumCharacterTicks, Bench.m_NumTicks, (double)Bench.m_TotalNs / maximum(Bench.m_NumCharacterTicks, (int64_t)1));
+	if(pCheckGolden)
+		dbg_msg("physics_bench", "matches golden output '%s'", pCheckGolden);
+	return 0;
+}
@@ -0,0 +1,403 @@
+// Drives CDbConnectionPool with a mix of score queries and reports
+// throughput and latency percentiles per query type.
+#include <base/logger.h>
+#include <base/system.h>
+#include <engine/server/databases/connection.h>
+#include <engine/server/databases/connection_pool.h>
+#include <engine/shared/config.h>
+#include <engine/shared/uuid_manager.h>
+#include <game/server/scoreworker.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const char *const s_pMap = "Kobra 3";
+static const char *const s_pServer = "GER";
+
+// The score worker only needs the serialized save state of a team, so the
+// benchmark provides a fixed one instead of linking the game server.
+static char s_aSaveState[2048];
+
+char *CSaveTeam::GetString()
+{
+	return s_aSaveState;
+}
+
+int CSaveTeam::FromString(char const *)
+{
+	return 1;
+}
+
+bool CSaveTeam::MatchPlayers(const char (*paNames)[MAX_NAME_LENGTH], const int *pClientID, int NumPlayer, char *pMessage, int MessageLen)
+{
+	return false;
+}
+
+CSaveTeam::CSaveTeam(IGameController *pController)
+{
+	m_pController = pController;
+	m_pSwitchers = 0;
+	m_pSavedTees = 0;
+}
+
+CSaveTeam::~CSaveTeam()
+{
+	delete[] m_pSwitchers;
+	delete[] m_pSavedTees;
+}
+
+enum
+{
+	QUERY_LOAD_PLAYER_DATA,
+	QUERY_SAVE_SCORE,
+	QUERY_SHOW_RANK,
+	QUERY_SHOW_TOP,
+	QUERY_SAVE_TEAM,
+	NUM_QUERIES,
+};
+
+static const char *const s_apQueryNames[NUM_QUERIES] = {
+	"load",
+	"save",
+	"rank",
+	"top",
+	"saveteam",
+};
+
+struct CInFlight
+{
+	int m_Type;
+	int64_t m_Start;
+	std::shared_ptr<ISqlResult> m_pResult;
+};
+
+static void PlayerName(int Player, char *pBuf, int BufferSize)
+{
+	str_format(pBuf, BufferSize, "bench tee %d", Player);
+}
+
+static void FillScoreData(CSqlScoreData *pData, int Player, float Time)
+{
+	str_copy(pData->m_aMap, s_pMap, sizeof(pData->m_aMap));
+	FormatUuid(RandomUuid(), pData->m_aGameUuid, sizeof(pData->m_aGameUuid));
+	PlayerName(Player, pData->m_aName, sizeof(pData->m_aName));
+	pData->m_ClientID = Player % MAX_CLIENTS;
+	pData->m_Time = Time;
+	str_timestamp_format(pData->m_aTimestamp, sizeof(pData->m_aTimestamp), FORMAT_SPACE);
+	for(float &TimeCp : pData->m_aCurrentTimeCp)
+		TimeCp = 0;
+	str_copy(pData->m_aRequestingPlayer, pData->m_aName, sizeof(pData->m_aRequestingPlayer));
+}
+
+static bool Seed(IDbConnection *pConn, int NumPlayers, std::mt19937 &Rng)
+{
+	char aError[256] = {};
+	if(pConn->Connect(aError, sizeof(aError)))
+	{
+		dbg_msg("score_bench", "failed to connect: %s", aError);
+		return false;
+	}
+
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf),
+		"%s into %s_maps(Map, Server, Mapper, Points, Stars, Timestamp) "
+		"VALUES (?, \"Novice\", \"bench\", 5, 5, CURRENT_TIMESTAMP)",
+		pConn->InsertIgnore(), pConn->GetPrefix());
+	int NumInserted;
+	if(pConn->PrepareStatement(aBuf, aError, sizeof(aError)))
+	{
+		dbg_msg("score_bench", "failed to insert map: %s", aError);
+		pConn->Disconnect();
+		return false;
+	}
+	pConn->BindString(1, s_pMap);
+	if(pConn->ExecuteUpdate(&NumInserted, aError, sizeof(aError)))
+	{
+		dbg_msg("score_bench", "failed to insert map: %s", aError);
+		pConn->Disconnect();
+		return false;
+	}
+
+	std::uniform_real_distribution<float> Time(20.0f, 600.0f);
+	for(int i = 0; i < NumPlayers; i++)
+	{
+		CSqlScoreData ScoreData(std::make_shared<CScorePlayerResult>());
+		FillScoreData(&ScoreData, i, Time(Rng));
+		if(CScoreWorker::SaveScore(pConn, &ScoreData, Write::NORMAL, aError, sizeof(aError)))
+		{
+			dbg_msg("score_bench", "failed to seed rank: %s", aError);
+			pConn->Disconnect();
+			return false;
+		}
+	}
+	pConn->Disconnect();
+	return true;
+}
+
+static bool ParseMix(const char *pMix, int *pWeights)
+{
+	for(int i = 0; i < NUM_QUERIES; i++)
+		pWeights[i] = 0;
+
+	char aEntry[64];
+	while((pMix = str_next_token(pMix, ",", aEntry, sizeof(aEntry))))
+	{
+		const char *pWeight = str_find(aEntry, ":");
+		if(!pWeight)
+			return false;
+		int Query = -1;
+		for(int i = 0; i < NUM_QUERIES; i++)
+			if(str_comp_num(aEntry, s_apQueryNames[i], pWeight - aEntry) == 0 && str_length(s_apQueryNames[i]) == pWeight - aEntry)
+				Query = i;
+		if(Query < 0)
+			return false;
+		pWeights[Query] = str_toint(pWeight + 1);
+	}
+
+	int Sum = 0;
+	for(int i = 0; i < NUM_QUERIES; i++)
+		Sum += maximum(pWeights[i], 0);
+	return Sum > 0;
+}
+
+static void Submit(CDbConnectionPool *pPool, int Type, int Num, int NumPlayers, std::mt19937 &Rng, std::vector<CInFlight> *pvInFlight)
+{
+	std::uniform_int_distribution<int> Player(0, NumPlayers - 1);
+	CInFlight Request;
+	Request.m_Type = Type;
+	Request.m_Start = time_get();
+	switch(Type)
+	{
+	case QUERY_LOAD_PLAYER_DATA:
+	case QUERY_SHOW_RANK:
+	case QUERY_SHOW_TOP:
+	{
+		auto pResult = std::make_shared<CScorePlayerResult>();
+		auto pRequest = std::make_unique<CSqlPlayerRequest>(pResult);
+		PlayerName(Player(Rng), pRequest->m_aName, sizeof(pRequest->m_aName));
+		str_copy(pRequest->m_aMap, s_pMap, sizeof(pRequest->m_aMap));
+		str_copy(pRequest->m_aRequestingPlayer, pRequest->m_aName, sizeof(pRequest->m_aRequestingPlayer));
+		str_copy(pRequest->m_aServer, s_pServer, sizeof(pRequest->m_aServer));
+		pRequest->m_Offset = Type == QUERY_SHOW_TOP ? 1 + Num % 50 : 0;
+		Request.m_pResult = pResult;
+		if(Type == QUERY_LOAD_PLAYER_DATA)
+		{
+			pRequest->m_aName[0] = '\0';
+			pPool->Execute(CScoreWorker::LoadPlayerData, std::move(pRequest), "load player data");
+		}
+		else if(Type == QUERY_SHOW_RANK)
+			pPool->Execute(CScoreWorker::ShowRank, std::move(pRequest), "show rank");
+		else
+			pPool->Execute(CScoreWorker::ShowTop, std::move(pRequest), "show top");
+		break;
+	}
+	case QUERY_SAVE_SCORE:
+	{
+		auto pResult = std::make_shared<CScorePlayerResult>();
+		auto pRequest = std::make_unique<CSqlScoreData>(pResult);
+		std::uniform_real_distribution<float> Time(20.0f, 600.0f);
+		FillScoreData(pRequest.get(), Player(Rng), Time(Rng));
+		Request.m_pResult = pResult;
+		pPool->ExecuteWrite(CScoreWorker::SaveScore, std::move(pRequest), "save score");
+		break;
+	}
+	case QUERY_SAVE_TEAM:
+	{
+		auto pResult = std::make_shared<CScoreSaveResult>(0, nullptr);
+		pResult->m_SaveID = RandomUuid();
+		auto pRequest = std::make_unique<CSqlTeamSave>(pResult);
+		PlayerName(Player(Rng), pRequest->m_aClientName, sizeof(pRequest->m_aClientName));
+		str_copy(pRequest->m_aMap, s_pMap, sizeof(pRequest->m_aMap));
+		pRequest->m_aCode[0] = '\0';
+		FormatUuid(pResult->m_SaveID, pRequest->m_aGeneratedCode, sizeof(pRequest->m_aGeneratedCode));
+		str_copy(pRequest->m_aServer, s_pServer, sizeof(pRequest->m_aServer));
+		Request.m_pResult = pResult;
+		pPool->ExecuteWrite(CScoreWorker::SaveTeam, std::move(pRequest), "save team");
+		break;
+	}
+	}
+	pvInFlight->push_back(std::move(Request));
+}
+
+static double Percentile(const std::vector<int64_t> &vSorted, double Fraction)
+{
+	size_t Index = (size_t)(Fraction * (vSorted.size() - 1) + 0.5);
+	return vSorted[Index] * 1000.0 / time_freq();
+}
+
+static void Usage(const char *pProgram)
+{
+	dbg_msg("usage", "%s [-n requests] [-c in_flight] [-p players] [-m mix] [-u (untuned sqlite)] <database.sqlite>", pProgram);
+#if defined(CONF_MYSQL)
+	dbg_msg("usage", "%s [options] -mysql <host> <port> <database> <user> <pass> <backup.sqlite>", pProgram);
+#endif
+	dbg_msg("usage", "mix defaults to load:20,save:15,rank:35,top:25,saveteam:5");
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("score_bench", "could not initialize secure RNG");
+		return -1;
+	}
+
+	int NumRequests = 10000;
+	int MaxInFlight = 64;
+	int NumPlayers = 1000;
+	bool Tuned = true;
+	int aWeights[NUM_QUERIES];
+	ParseMix("load:20,save:15,rank:35,top:25,saveteam:5", aWeights);
+	const char *pSqliteFile = nullptr;
+	bool UseMysql = false;
+	CMysqlConfig MysqlConfig = {};
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-n") == 0 && i + 1 < argc)
+			NumRequests = maximum(str_toint(argv[++i]), 1);
+		else if(str_comp(argv[i], "-c") == 0 && i + 1 < argc)
+			MaxInFlight = clamp(str_toint(argv[++i]), 1, 256); // the pool's queue holds 512 entries
+		else if(str_comp(argv[i], "-p") == 0 && i + 1 < argc)
+			NumPlayers = maximum(str_toint(argv[++i]), 1);
+		else if(str_comp(argv[i], "-u") == 0)
+			Tuned = false;
+		else if(str_comp(argv[i], "-m") == 0 && i + 1 < argc)
+		{
+			if(!ParseMix(argv[++i], aWeights))
+			{
+				dbg_msg("score_bench", "invalid mix '%s'", argv[i]);
+				return -1;
+			}
+		}
+#if defined(CONF_MYSQL)
+		else if(str_comp(argv[i], "-mysql") == 0 && i + 5 < argc)
+		{
+			UseMysql = true;
+			str_copy(MysqlConfig.m_aIp, argv[++i], sizeof(MysqlConfig.m_aIp));
+			MysqlConfig.m_Port = str_toint(argv[++i]);
+			str_copy(MysqlConfig.m_aDatabase, argv[++i], sizeof(MysqlConfig.m_aDatabase));
+			str_copy(MysqlConfig.m_aUser, argv[++i], sizeof(MysqlConfig.m_aUser));
+			str_copy(MysqlConfig.m_aPass, argv[++i], sizeof(MysqlConfig.m_aPass));
+			str_copy(MysqlConfig.m_aPrefix, "record", sizeof(MysqlConfig.m_aPrefix));
+			MysqlConfig.m_Setup = true;
+		}
+#endif
+		else if(argv[i][0] != '-' && !pSqliteFile)
+			pSqliteFile = argv[i];
+		else
+		{
+			Usage(argv[0]);
+			return -1;
+		}
+	}
+	if(!pSqliteFile || str_length(pSqliteFile) >= 64)
+	{
+		Usage(argv[0]);
+		return -1;
+	}
+
+	if(MysqlInit() != 0)
+	{
+		dbg_msg("score_bench", "failed to initialize mysql library");
+		return -1;
+	}
+
+	str_copy(g_Config.m_SvSqlServerName, s_pServer, sizeof(g_Config.m_SvSqlServerName));
+	for(int i = 0; i < (int)sizeof(s_aSaveState) - 1; i++)
+		s_aSaveState[i] = 'a' + i % 26;
+
+	std::mt19937 Rng(0);
+	CSqliteConfig SqliteConfig;
+	SqliteConfig.m_Tuned = Tuned;
+	SqliteConfig.m_MmapSize = g_Config.m_SvSqliteMmapSize;
+	SqliteConfig.m_CacheSize = g_Config.m_SvSqliteCacheSize;
+
+	std::unique_ptr<IDbConnection> pSeedConn = UseMysql ?
+							   CreateMysqlConnection(MysqlConfig) :
+							   CreateSqliteConnection(pSqliteFile, true, &SqliteConfig);
+	if(!pSeedConn)
+	{
+		dbg_msg("score_bench", "failed to create database connection");
+		return -1;
+	}
+	int64_t SeedStart = time_get();
+	if(!Seed(pSeedConn.get(), NumPlayers, Rng))
+		return -1;
+	dbg_msg("score_bench", "seeded %d ranks in %.2fs", NumPlayers, (time_get() - SeedStart) / (double)time_freq());
+
+	int64_t Start;
+	std::vector<int64_t> avLatencies[NUM_QUERIES];
+	int aNumFailed[NUM_QUERIES] = {};
+	{
+		CDbConnectionPool Pool;
+		if(UseMysql)
+		{
+			Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE_BACKUP, pSqliteFile, &SqliteConfig);
+			Pool.RegisterMysqlDatabase(CDbConnectionPool::READ, &MysqlConfig);
+			Pool.RegisterMysqlDatabase(CDbConnectionPool::WRITE, &MysqlConfig);
+		}
+		else
+		{
+			Pool.RegisterSqliteDatabase(CDbConnectionPool::READ, pSqliteFile, &SqliteConfig);
+			Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, pSqliteFile, &SqliteConfig);
+		}
+
+		std::discrete_distribution<int> Mix(std::begin(aWeights), std::end(aWeights));
+		std::vector<CInFlight> vInFlight;
+		int NumSubmitted = 0;
+		Start = time_get();
+		while(NumSubmitted < NumRequests || !vInFlight.empty())
+		{
+			while(NumSubmitted < NumRequests && (int)vInFlight.size() < MaxInFlight)
+			{
+				Submit(&Pool, Mix(Rng), NumSubmitted, NumPlayers, Rng, &vInFlight);
+				NumSubmitted++;
+			}
+
+			int64_t Now = time_get();
+			bool Progress = false;
+			for(size_t i = 0; i < vInFlight.size();)
+			{
+				if(!vInFlight[i].m_pResult->m_Completed.load())
+				{
+					i++;
+					continue;
+				}
+				avLatencies[vInFlight[i].m_Type].push_back(Now - vInFlight[i].m_Start);
+				if(!vInFlight[i].m_pResult->m_Success)
+					aNumFailed[vInFlight[i].m_Type]++;
+				vInFlight[i] = std::move(vInFlight.back());
+				vInFlight.pop_back();
+				Progress = true;
+			}
+			if(!Progress)
+				std::this_thread::yield();
+		}
+		Pool.OnShutdown(0);
+	}
+	double Seconds = (time_get() - Start) / (double)time_freq();
+
+	dbg_msg("score_bench", "%d requests in %.2fs, %.1f req/s, %d in flight",
+		NumRequests, Seconds, NumRequests / Seconds, MaxInFlight);
+	dbg_msg("score_bench", "%-9s %7s %7s %10s %10s %10s %10s", "query", "count", "failed", "req/s", "p50 ms", "p99 ms", "p999 ms");
+	for(int i = 0; i < NUM_QUERIES; i++)
+	{
+		std::vector<int64_t> &vLatencies = avLatencies[i];
+		if(vLatencies.empty())
+			continue;
+		std::sort(vLatencies.begin(), vLatencies.end());
+		dbg_msg("score_bench", "%-9s %7d %7d %10.1f %10.3f %10.3f %10.3f",
+			s_apQueryNames[i], (int)vLatencies.size(), aNumFailed[i], vLatencies.size() / Seconds,
+			Percentile(vLatencies, 0.5), Percentile(vLatencies, 0.99), Percentile(vLatencies, 0.999));
+	}
+
+	MysqlUninit();
+	return 0;
+}
@@ -0,0 +1,848 @@
+// Re-simulates a teehistorian recording with the game server code and
+// reports the ticks at which the simulated characters diverge from the
+// recorded positions.
+//
+// A headless CGameContext runs on a stub server without networking. The
+// recorded joins, drops, game messages, console commands and inputs are fed
+// into it in the order of the server tick loop, as fast as the CPU allows,
+// so the tool doubles as a throughput benchmark of the whole game
+// simulation. The characters are never moved back to the recorded
+// positions, divergences are reported as they are.
+//
+// Not replayed: votes (the commands of passed votes are recorded), the
+// timing of the input packets within a tick, the database results of
+// /load and the like, and the persistent client data over map changes.
+#include <base/logger.h>
+#include <base/system.h>
+#include <engine/antibot.h>
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/engine.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/server.h>
+#include <engine/server/antibot.h>
+#include <engine/server/databases/connection_pool.h>
+#include <engine/shared/config.h>
+#include <engine/shared/json.h>
+#include <engine/shared/metrics.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol_ex.h>
+#include <engine/storage.h>
+#include <game/server/entities/character.h>
+#include <game/server/gamecontext.h>
+#include <game/server/player.h>
+#include <game/server/teehistorian_file.h>
+#include <game/server/teehistorian_reader.h>
+#include <game/version.h>
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#define UUID(id, name) static const CUuid UUID_##id = CalculateUuid(name);
+#include <engine/shared/teehistorian_ex_chunks.h>
+#undef UUID
+
+// Only lets the messages of the tool through, unless the game server should
+// be verbose. It is the global logger to also cover the database threads.
+class CReplayLogger : public ILogger
+{
+	std::unique_ptr<ILogger> m_pOuterLogger;
+	bool m_Verbose = false;
+
+public:
+	CReplayLogger(std::unique_ptr<ILogger> &&pOuterLogger) :
+		m_pOuterLogger(std::move(pOuterLogger))
+	{
+	}
+	void SetVerbose(bool Verbose) { m_Verbose = Verbose; }
+	void Log(const CLogMessage *pMessage) override
+	{
+		if(m_Verbose || str_comp(pMessage->m_aSystem, "teehistorian_replay") == 0)
+			m_pOuterLogger->Log(pMessage);
+	}
+	void GlobalFinish() override
+	{
+		m_pOuterLogger->GlobalFinish();
+	}
+};
+
+// The parts of CServer the game server needs, without networking, snapshots
+// or demos. Clients are connected and entered by the replay.
+class CReplayServer : public IServer
+{
+	struct CClient
+	{
+		bool m_Connected;
+		bool m_Ingame;
+		bool m_Sixup;
+		char m_aName[MAX_NAME_LENGTH];
+		char m_aClan[MAX_CLAN_LENGTH];
+		int m_Country;
+		int m_AuthLevel;
+		char m_aAuthName[64];
+		int m_DDNetVersion;
+		bool m_DDNetVersionSettled;
+		bool m_GotDDNetVersionPacket;
+		CUuid m_ConnectionID;
+		char m_aDDNetVersionStr[64];
+		int m_aIdMap[VANILLA_MAX_CLIENTS];
+	};
+
+	CClient m_aClients[MAX_CLIENTS];
+	char m_aMapName[128];
+	int m_MapSize;
+	SHA256_DIGEST m_MapSha256;
+	unsigned m_MapCrc;
+
+	CMetrics m_Metrics;
+	CDbConnectionPool m_DbPool;
+
+	// game objects only write into snapshot items, they are never sent
+	alignas(8) char m_aSnapItem[1024];
+	int m_NextSnapID = 0;
+	std::vector<int> m_vFreeSnapIDs;
+
+public:
+	CReplayServer(const char *pMapName, IEngineMap *pMap)
+	{
+		m_CurrentGameTick = 0;
+		m_TickSpeed = SERVER_TICK_SPEED;
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			Reset(i);
+		str_copy(m_aMapName, pMapName);
+		m_MapSize = pMap->MapSize();
+		m_MapSha256 = pMap->Sha256();
+		m_MapCrc = pMap->Crc();
+
+		// queries run on empty in-memory databases instead of failing
+		char aFilename[64] = ":memory:";
+		CSqliteConfig SqliteConfig = {false, 0, 0};
+		m_DbPool.RegisterSqliteDatabase(CDbConnectionPool::READ, aFilename, &SqliteConfig);
+		m_DbPool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, aFilename, &SqliteConfig);
+	}
+
+	void Reset(int ClientID)
+	{
+		CClient *pClient = &m_aClients[ClientID];
+		mem_zero(pClient, sizeof(*pClient));
+		pClient->m_Country = -1;
+		pClient->m_DDNetVersion = VERSION_NONE;
+		for(int &Id : pClient->m_aIdMap)
+			Id = -1;
+	}
+
+	void Connect(int ClientID, bool Sixup)
+	{
+		Reset(ClientID);
+		m_aClients[ClientID].m_Connected = true;
+		m_aClients[ClientID].m_Sixup = Sixup;
+	}
+	void Enter(int ClientID) { m_aClients[ClientID].m_Ingame = true; }
+	bool Connected(int ClientID) const { return m_aClients[ClientID].m_Connected; }
+
+	void SetAuthed(int ClientID, int Level, const char *pAuthName)
+	{
+		m_aClients[ClientID].m_AuthLevel = Level;
+		str_copy(m_aClients[ClientID].m_aAuthName, pAuthName);
+	}
+
+	void SetDDNetVersionPacket(int ClientID, CUuid ConnectionID, int DDNetVersion, const char *pDDNetVersionStr)
+	{
+		CClient *pClient = &m_aClients[ClientID];
+		pClient->m_DDNetVersion = DDNetVersion;
+		pClient->m_DDNetVersionSettled = true;
+		pClient->m_GotDDNetVersionPacket = true;
+		pClient->m_ConnectionID = ConnectionID;
+		str_copy(pClient->m_aDDNetVersionStr, pDDNetVersionStr);
+	}
+
+	void NextTick() { m_CurrentGameTick++; }
+	CDbConnectionPool *Pool() { return &m_DbPool; }
+
+	int Port() const override { return 8303; }
+	int MaxClients() const override { return MAX_CLIENTS; }
+	int ClientCount() const override
+	{
+		int Count = 0;
+		for(const auto &Client : m_aClients)
+			Count += Client.m_Connected;
+		return Count;
+	}
+	int DistinctClientCount() const override { return ClientCount(); }
+	const char *ClientName(int ClientID) const override
+	{
+		if(ClientID < 0 || ClientID >= MAX_CLIENTS || !m_aClients[ClientID].m_Connected)
+			return "(invalid)";
+		return m_aClients[ClientID].m_aName;
+	}
+	const char *ClientClan(int ClientID) const override
+	{
+		if(ClientID < 0 || ClientID >= MAX_CLIENTS || !m_aClients[ClientID].m_Connected)
+			return "";
+		return m_aClients[ClientID].m_aClan;
+	}
+	int ClientCountry(int ClientID) const override
+	{
+		if(ClientID < 0 || ClientID >= MAX_CLIENTS || !m_aClients[ClientID].m_Connected)
+			return -1;
+		return m_aClients[ClientID].m_Country;
+	}
+	bool ClientIngame(int ClientID) const override
+	{
+		return ClientID >= 0 && ClientID < MAX_CLIENTS && m_aClients[ClientID].m_Ingame;
+	}
+	bool ClientAuthed(int ClientID) const override { return m_aClients[ClientID].m_AuthLevel != 0; }
+	bool GetClientInfo(int ClientID, CClientInfo *pInfo) const override
+	{
+		const CClient *pClient = &m_aClients[ClientID];
+		if(!pClient->m_Ingame)
+			return false;
+		pInfo->m_pName = pClient->m_aName;
+		pInfo->m_Latency = 0;
+		pInfo->m_GotDDNetVersion = pClient->m_DDNetVersionSettled;
+		pInfo->m_DDNetVersion = pClient->m_DDNetVersion >= 0 ? pClient->m_DDNetVersion : VERSION_VANILLA;
+		pInfo->m_pConnectionID = pClient->m_GotDDNetVersionPacket ? &pClient->m_ConnectionID : nullptr;
+		pInfo->m_pDDNetVersionStr = pClient->m_GotDDNetVersionPacket ? pClient->m_aDDNetVersionStr : nullptr;
+		return true;
+	}
+	void SetClientDDNetVersion(int ClientID, int DDNetVersion) override
+	{
+		if(m_aClients[ClientID].m_Ingame)
+		{
+			m_aClients[ClientID].m_DDNetVersion = DDNetVersion;
+			m_aClients[ClientID].m_DDNetVersionSettled = true;
+		}
+	}
+	void GetClientAddr(int ClientID, char *pAddrStr, int Size) const override { str_copy(pAddrStr, "0.0.0.0", Size); }
+	int GetClientVersion(int ClientID) const override
+	{
+		if(ClientID == SERVER_DEMO_CLIENT)
+			return CLIENT_VERSIONNR;
+		CClientInfo Info;
+		if(GetClientInfo(ClientID, &Info))
+			return Info.m_DDNetVersion;
+		return VERSION_NONE;
+	}
+	int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) override { return 0; }
+
+	void GetMapInfo(char *pMapName, int MapNameSize, int *pMapSize, SHA256_DIGEST *pSha256, int *pMapCrc) override
+	{
+		str_copy(pMapName, m_aMapName, MapNameSize);
+		*pMapSize = m_MapSize;
+		*pSha256 = m_MapSha256;
+		*pMapCrc = m_MapCrc;
+	}
+
+	bool WouldClientNameChange(int ClientID, const char *pNameRequest) override { return str_comp(m_aClients[ClientID].m_aName, pNameRequest) != 0; }
+	void SetClientName(int ClientID, const char *pName) override { str_copy(m_aClients[ClientID].m_aName, pName); }
+	void SetClientClan(int ClientID, const char *pClan) override { str_copy(m_aClients[ClientID].m_aClan, pClan); }
+	void SetClientCountry(int ClientID, int Country) override { m_aClients[ClientID].m_Country = Country; }
+	void SetClientScore(int ClientID, int Score) override {}
+	void SetClientFlags(int ClientID, int Flags) override {}
+
+	int SnapNewID() override
+	{
+		if(m_vFreeSnapIDs.empty())
+			return m_NextSnapID++;
+		const int ID = m_vFreeSnapIDs.back();
+		m_vFreeSnapIDs.pop_back();
+		return ID;
+	}
+	void SnapFreeID(int ID) override { m_vFreeSnapIDs.push_back(ID); }
+	void *SnapNewItem(int Type, int ID, int Size) override
+	{
+		if(Size > (int)sizeof(m_aSnapItem))
+			return nullptr;
+		mem_zero(m_aSnapItem, Size);
+		return m_aSnapItem;
+	}
+	void SnapSetStaticsize(int ItemType, int Size) override {}
+
+	void SetRconCID(int ClientID) override {}
+	int GetAuthedState(int ClientID) const override { return m_aClients[ClientID].m_AuthLevel; }
+	const char *GetAuthName(int ClientID) const override { return m_aClients[ClientID].m_aAuthName; }
+	// the recorded drop follows
+	void Kick(int ClientID, const char *pReason) override {}
+	void Ban(int ClientID, int Seconds, const char *pReason) override {}
+	// a map change ends the recording
+	void ChangeMap(const char *pMap) override {}
+
+	void DemoRecorder_HandleAutoStart() override {}
+
+	void SaveDemo(int ClientID, float Time) override {}
+	void StartRecord(int ClientID) override {}
+	void StopRecord(int ClientID) override {}
+	bool IsRecording(int ClientID) override { return false; }
+
+	void GetClientAddr(int ClientID, NETADDR *pAddr) const override
+	{
+		mem_zero(pAddr, sizeof(*pAddr));
+		pAddr->type = NETTYPE_IPV4;
+	}
+
+	int *GetIdMap(int ClientID) override { return m_aClients[ClientID].m_aIdMap; }
+
+	bool DnsblWhite(int ClientID) override { return true; }
+	bool DnsblPending(int ClientID) override { return false; }
+	bool DnsblBlack(int ClientID) override { return false; }
+	const char *GetAnnouncementLine(const char *pFileName) override { return ""; }
+	bool ClientPrevIngame(int ClientID) override { return false; }
+	const char *GetNetErrorString(int ClientID) override { return ""; }
+	void ResetNetErrorString(int ClientID) override {}
+	bool SetTimedOut(int ClientID, int OrigID) override { return false; }
+	void SetTimeoutProtected(int ClientID) override {}
+
+	void SetErrorShutdown(const char *pReason) override { dbg_msg("teehistorian_replay", "game server error: %s", pReason); }
+	void ExpireServerInfo() override {}
+
+	void SendMsgRaw(int ClientID, const void *pData, int Size, int Flags) override {}
+
+	const char *GetMapName() const override { return m_aMapName; }
+
+	bool IsSixup(int ClientID) const override { return ClientID >= 0 && ClientID < MAX_CLIENTS && m_aClients[ClientID].m_Sixup; }
+
+	CMetrics *Metrics() override { return &m_Metrics; }
+	CDbConnectionPool *DbPool() override { return &m_DbPool; }
+};
+
+class CReplay : public CTeeHistorianReader::IListener
+{
+	struct CPlayerStats
+	{
+		int m_ClientID;
+		char m_aName[MAX_NAME_LENGTH];
+		int m_Ticks;
+		int m_DivergentTicks;
+		int m_FirstDivergence;
+	};
+
+	const CTeeHistorianReader *m_pReader;
+	CReplayServer *m_pServer;
+	CGameContext *m_pGameServer;
+	IConsole *m_pConsole;
+
+	bool m_aSixup[MAX_CLIENTS] = {false};
+	// the server passes every input packet on directly, only the changes
+	// of the input are recorded
+	bool m_aHasDirectInput[MAX_CLIENTS] = {false};
+	CNetObj_PlayerInput m_aDirectInput[MAX_CLIENTS];
+	CPlayerStats m_aStats[MAX_CLIENTS];
+
+	int m_StartTick;
+	int m_EndTick;
+	int m_MaxReports;
+	int m_ComparedTick = -1;
+
+	void StartStats(int ClientID)
+	{
+		m_aStats[ClientID] = {ClientID, "", 0, 0, -1};
+	}
+
+	void FinishStats(int ClientID)
+	{
+		CPlayerStats *pStats = &m_aStats[ClientID];
+		if(!pStats->m_Ticks)
+			return;
+		str_copy(pStats->m_aName, m_pServer->ClientName(ClientID));
+		m_vFinishedStats.push_back(*pStats);
+		StartStats(ClientID);
+	}
+
+	void Compare(int Tick)
+	{
+		for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+		{
+			const CTeeHistorianReader::CPlayer *pPlayer = m_pReader->Player(ClientID);
+			CPlayer *pGamePlayer = m_pGameServer->m_apPlayers[ClientID];
+			CCharacter *pChr = pGamePlayer ? pGamePlayer->GetCharacter() : nullptr;
+			if(!pPlayer->m_Alive && !pChr)
+				continue;
+
+			CPlayerStats *pStats = &m_aStats[ClientID];
+			pStats->m_Ticks++;
+			CNetObj_CharacterCore Core;
+			if(pChr)
+				pChr->GetCore().Write(&Core);
+			if(pPlayer->m_Alive && pChr && Core.m_X == pPlayer->m_X && Core.m_Y == pPlayer->m_Y)
+				continue;
+
+			if(m_NumDivergences < m_MaxReports)
+			{
+				char aRecorded[32];
+				char aSimulated[32];
+				if(pPlayer->m_Alive)
+					str_format(aRecorded, sizeof(aRecorded), "(%d, %d)", pPlayer->m_X, pPlayer->m_Y);
+				else
+					str_copy(aRecorded, "dead");
+				if(pChr)
+					str_format(aSimulated, sizeof(aSimulated), "(%d, %d)", Core.m_X, Core.m_Y);
+				else
+					str_copy(aSimulated, "dead");
+				dbg_msg("teehistorian_replay", "tick=%d cid=%d recorded=%s simulated=%s", Tick, ClientID, aRecorded, aSimulated);
+			}
+			m_NumDivergences++;
+			pStats->m_DivergentTicks++;
+			if(pStats->m_FirstDivergence < 0)
+				pStats->m_FirstDivergence = Tick;
+		}
+	}
+
+	// the positions of a tick are complete once anything after them is read,
+	// the joins, messages and commands before the next tick are read before
+	// the end of the tick
+	void ComparePositions()
+	{
+		const int Tick = m_pServer->Tick();
+		if(Tick == m_ComparedTick || Tick < m_StartTick || Tick > m_EndTick)
+			return;
+		m_ComparedTick = Tick;
+		Compare(Tick);
+	}
+
+	// same order as the tick loop of CServer::Run
+	void Step()
+	{
+		CNetObj_PlayerInput aInputs[MAX_CLIENTS];
+		bool aHasInput[MAX_CLIENTS];
+		for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+		{
+			const CTeeHistorianReader::CPlayer *pPlayer = m_pReader->Player(ClientID);
+			aHasInput[ClientID] = m_pServer->ClientIngame(ClientID) && pPlayer->m_HasInput;
+			if(!aHasInput[ClientID])
+				continue;
+			aInputs[ClientID] = pPlayer->m_Input;
+			if(!m_aHasDirectInput[ClientID] || mem_comp(&m_aDirectInput[ClientID], &pPlayer->m_Input, sizeof(pPlayer->m_Input)) != 0)
+			{
+				m_aDirectInput[ClientID] = pPlayer->m_Input;
+				m_aHasDirectInput[ClientID] = true;
+				m_pGameServer->OnClientDirectInput(ClientID, &m_aDirectInput[ClientID]);
+			}
+		}
+
+		m_pGameServer->OnPreTickTeehistorian();
+		for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+		{
+			if(m_pServer->ClientIngame(ClientID))
+				m_pGameServer->OnClientPredictedEarlyInput(ClientID, aHasInput[ClientID] ? &aInputs[ClientID] : nullptr);
+		}
+		m_pServer->NextTick();
+		for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+		{
+			if(m_pServer->ClientIngame(ClientID))
+				m_pGameServer->OnClientPredictedInput(ClientID, aHasInput[ClientID] ? &aInputs[ClientID] : nullptr);
+		}
+		m_pGameServer->OnTick();
+
+		if(g_Config.m_SvHighBandwidth || m_pServer->Tick() % 2 == 0)
+		{
+			m_pGameServer->OnPreSnap();
+			for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+			{
+				if(m_pServer->ClientIngame(ClientID))
+					m_pGameServer->OnSnap(ClientID);
+			}
+			m_pGameServer->OnPostSnap();
+			m_pServer->Pool()->Update();
+		}
+	}
+
+public:
+	std::vector<CPlayerStats> m_vFinishedStats;
+	int64_t m_NumTicks = 0;
+	int64_t m_NumCharacterTicks = 0;
+	int64_t m_NumDivergences = 0;
+	int64_t m_SimulationNs = 0;
+
+	CReplay(const CTeeHistorianReader *pReader, CReplayServer *pServer, CGameContext *pGameServer, IConsole *pConsole, int StartTick, int EndTick, int MaxReports) :
+		m_pReader(pReader),
+		m_pServer(pServer),
+		m_pGameServer(pGameServer),
+		m_pConsole(pConsole),
+		m_StartTick(StartTick),
+		m_EndTick(EndTick),
+		m_MaxReports(MaxReports)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			StartStats(i);
+	}
+
+	void Finish()
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			FinishStats(i);
+	}
+
+	void OnTickEnd(int Tick) override
+	{
+		if(Tick > m_EndTick)
+			return;
+		dbg_assert(m_pServer->Tick() == Tick, "replay out of sync with the recorded ticks");
+
+		// the ticks before the start tick only rebuild the game state
+		ComparePositions();
+		if(Tick == m_EndTick)
+			return;
+
+		const int64_t Start = time_get_nanoseconds().count();
+		Step();
+		if(Tick < m_StartTick)
+			return;
+		m_SimulationNs += time_get_nanoseconds().count() - Start;
+		m_NumTicks++;
+		for(auto *pPlayer : m_pGameServer->m_apPlayers)
+			m_NumCharacterTicks += pPlayer && pPlayer->GetCharacter();
+	}
+
+	void OnJoin(int ClientID) override
+	{
+		ComparePositions();
+		m_pServer->Connect(ClientID, m_aSixup[ClientID]);
+		m_aHasDirectInput[ClientID] = false;
+		m_pGameServer->OnClientConnected(ClientID, nullptr);
+	}
+
+	void OnDrop(int ClientID, const char *pReason) override
+	{
+		ComparePositions();
+		if(!m_pServer->Connected(ClientID))
+			return;
+		m_pGameServer->OnClientDrop(ClientID, pReason);
+		FinishStats(ClientID);
+		m_pServer->Reset(ClientID);
+	}
+
+	void OnMessage(int ClientID, const void *pMsg, int MsgSize) override
+	{
+		ComparePositions();
+		if(ClientID < 0 || ClientID >= MAX_CLIENTS || !m_pServer->Connected(ClientID))
+			return;
+
+		CUnpacker Unpacker;
+		Unpacker.Reset(pMsg, MsgSize);
+		CMsgPacker Packer(NETMSG_EX, true);
+		int Msg;
+		bool Sys;
+		CUuid Uuid;
+		if(UnpackMessageID(&Msg, &Sys, &Uuid, &Unpacker, &Packer) == UNPACKMESSAGE_ERROR || Sys)
+			return;
+
+		// the commands of passed votes are replayed from the recording,
+		// the vote timeouts depend on the real time
+		const bool Sixup = m_pServer->IsSixup(ClientID);
+		if(Msg == (Sixup ? (int)protocol7::NETMSGTYPE_CL_CALLVOTE : (int)NETMSGTYPE_CL_CALLVOTE) ||
+			Msg == (Sixup ? (int)protocol7::NETMSGTYPE_CL_VOTE : (int)NETMSGTYPE_CL_VOTE))
+			return;
+
+		m_pGameServer->OnMessage(Msg, &Unpacker, ClientID);
+	}
+
+	void OnConsoleCommand(int ClientID, int FlagMask, const char *pCmd, int NumArgs, const char *const *ppArgs) override
+	{
+		ComparePositions();
+		// chat commands run again with the replayed chat messages
+		if(FlagMask & CFGFLAG_CHAT)
+			return;
+
+		char aLine[1024];
+		str_copy(aLine, pCmd);
+		char *pDst = aLine + str_length(aLine);
+		for(int i = 0; i < NumArgs && pDst < aLine + sizeof(aLine) - 3; i++)
+		{
+			str_copy(pDst, " \"", aLine + sizeof(aLine) - pDst);
+			pDst += 2;
+			str_escape(&pDst, ppArgs[i], aLine + sizeof(aLine) - 1);
+			str_copy(pDst, "\"", aLine + sizeof(aLine) - pDst);
+			pDst += str_length(pDst);
+		}
+		m_pConsole->ExecuteLineFlag(aLine, FlagMask, ClientID, false);
+	}
+
+	void OnExtra(CUuid Uuid, const void *pData, int DataSize) override
+	{
+		ComparePositions();
+		CUnpacker Unpacker;
+		Unpacker.Reset(pData, DataSize);
+		const int ClientID = Unpacker.GetInt();
+		if(Unpacker.Error() || ClientID < 0 || ClientID >= MAX_CLIENTS)
+			return;
+
+		if(Uuid == UUID_TEEHISTORIAN_JOINVER6 || Uuid == UUID_TEEHISTORIAN_JOINVER7)
+		{
+			// written right before the join
+			m_aSixup[ClientID] = Uuid == UUID_TEEHISTORIAN_JOINVER7;
+		}
+		else if(Uuid == UUID_TEEHISTORIAN_PLAYER_READY)
+		{
+			if(!m_pServer->Connected(ClientID))
+				return;
+			m_pServer->Enter(ClientID);
+			m_pGameServer->OnClientEnter(ClientID);
+		}
+		else if(Uuid == UUID_TEEHISTORIAN_DDNETVER)
+		{
+			// the old version message is a game message and replayed as such
+			const CUuid *pConnectionID = (const CUuid *)Unpacker.GetRaw(sizeof(CUuid));
+			const int DDNetVersion = Unpacker.GetInt();
+			const char *pDDNetVersionStr = Unpacker.GetString();
+			if(Unpacker.Error() || !m_pServer->ClientIngame(ClientID))
+				return;
+			CUuid ConnectionID;
+			mem_copy(&ConnectionID, pConnectionID, sizeof(ConnectionID));
+			m_pServer->SetDDNetVersionPacket(ClientID, ConnectionID, DDNetVersion, pDDNetVersionStr);
+			m_pGameServer->OnClientDDNetVersionKnown(ClientID);
+		}
+		else if(Uuid == UUID_TEEHISTORIAN_AUTH_INIT || Uuid == UUID_TEEHISTORIAN_AUTH_LOGIN)
+		{
+			const int Level = Unpacker.GetInt();
+			const char *pAuthName = Unpacker.GetString();
+			if(Unpacker.Error())
+				return;
+			m_pServer->SetAuthed(ClientID, Level, pAuthName);
+			// the authentication of the previous map is kept
+			if(Uuid == UUID_TEEHISTORIAN_AUTH_LOGIN)
+				m_pGameServer->OnSetAuthed(ClientID, Level);
+		}
+		else if(Uuid == UUID_TEEHISTORIAN_AUTH_LOGOUT)
+		{
+			m_pServer->SetAuthed(ClientID, 0, "");
+			m_pGameServer->OnSetAuthed(ClientID, 0);
+		}
+	}
+};
+
+// applies the config of the header, it only lists the values that differ
+// from the default
+static void ApplyConfig(IConsole *pConsole, const json_value *pConfig)
+{
+	if(pConfig->type != json_object)
+		return;
+	for(unsigned i = 0; i < pConfig->u.object.length; i++)
+	{
+		const json_value *pValue = pConfig->u.object.values[i].value;
+		if(pValue->type != json_string)
+			continue;
+		char aLine[1024];
+		str_format(aLine, sizeof(aLine), "%s \"", pConfig->u.object.values[i].name);
+		char *pDst = aLine + str_length(aLine);
+		str_escape(&pDst, json_string_get(pValue), aLine + sizeof(aLine) - 1);
+		str_copy(pDst, "\"", aLine + sizeof(aLine) - pDst);
+		pConsole->ExecuteLine(aLine);
+	}
+	// the replay must not write a recording of its own
+	g_Config.m_SvTeeHistorian = 0;
+}
+
+// "<name>:<seed 0>:<seed 1>" with 16 hex digits per seed, see CPrng::Seed
+static bool ParsePrngSeed(const char *pDescription, uint64_t aSeed[2])
+{
+	const char *pSeed = str_find(pDescription, ":");
+	for(int i = 0; i < 2; i++)
+	{
+		if(!pSeed)
+			return false;
+		char aHex[17];
+		str_copy(aHex, pSeed + 1);
+		unsigned char aBytes[8];
+		if(str_hex_decode(aBytes, sizeof(aBytes), aHex))
+			return false;
+		aSeed[i] = 0;
+		for(unsigned char Part : aBytes)
+			aSeed[i] = aSeed[i] << 8 | Part;
+		pSeed = str_find(pSeed + 1, ":");
+	}
+	return true;
+}
+
+static void Usage(const char *pProgram)
+{
+	dbg_msg("teehistorian_replay", "usage: %s [-t start_tick] [-e end_tick] [-r max_reports] [-m map] [-v] <teehistorian>...", pProgram);
+	dbg_msg("teehistorian_replay", "  several files are read as one recording, e.g. the rotated files of a game");
+	dbg_msg("teehistorian_replay", "  the ticks before the start tick are simulated without comparing and timing them");
+	dbg_msg("teehistorian_replay", "  the map defaults to maps/<map_name>.map from the header");
+	dbg_msg("teehistorian_replay", "  -v also prints the log of the game server");
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	CReplayLogger *pLogger = new CReplayLogger(log_logger_stdout());
+	log_set_global_logger(pLogger);
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("teehistorian_replay", "could not initialize secure RNG");
+		return -1;
+	}
+
+	int StartTick = 0;
+	int EndTick = std::numeric_limits<int>::max();
+	int MaxReports = 20;
+	bool Verbose = false;
+	const char *pMapName = nullptr;
+	std::vector<const char *> vpFiles;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-t") == 0 && i + 1 < argc)
+			StartTick = maximum(str_toint(argv[++i]), 0);
+		else if(str_comp(argv[i], "-e") == 0 && i + 1 < argc)
+			EndTick = str_toint(argv[++i]);
+		else if(str_comp(argv[i], "-r") == 0 && i + 1 < argc)
+			MaxReports = maximum(str_toint(argv[++i]), 0);
+		else if(str_comp(argv[i], "-m") == 0 && i + 1 < argc)
+			pMapName = argv[++i];
+		else if(str_comp(argv[i], "-v") == 0)
+			Verbose = true;
+		else if(argv[i][0] != '-')
+			vpFiles.push_back(argv[i]);
+		else
+		{
+			Usage(argv[0]);
+			return -1;
+		}
+	}
+	if(vpFiles.empty() || EndTick < StartTick)
+	{
+		Usage(argv[0]);
+		return -1;
+	}
+
+	pLogger->SetVerbose(Verbose);
+
+	std::unique_ptr<IKernel> pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+	IStorage *pStorage = CreateStorage(IStorage::STORAGETYPE_SERVER, argc, argv);
+	if(!pStorage)
+	{
+		dbg_msg("teehistorian_replay", "could not initialize storage");
+		return -1;
+	}
+	IEngineMap *pMap = CreateEngineMap();
+	pKernel->RegisterInterface(pStorage);
+	pKernel->RegisterInterface(pMap);
+	pKernel->RegisterInterface(static_cast<IMap *>(pMap), false);
+
+	const int64_t ReadStart = time_get_nanoseconds().count();
+	std::vector<unsigned char> vData;
+	for(const char *pFile : vpFiles)
+	{
+		IOHANDLE File = pStorage->OpenFile(pFile, IOFLAG_READ, IStorage::TYPE_ALL_OR_ABSOLUTE);
+		if(!File)
+		{
+			dbg_msg("teehistorian_replay", "could not open '%s'", pFile);
+			return -1;
+		}
+		const bool Success = CTeeHistorianFileWriter::ReadFile(File, &vData);
+		io_close(File);
+		if(!Success)
+		{
+			dbg_msg("teehistorian_replay", "could not read '%s'", pFile);
+			return -1;
+		}
+	}
+	const int64_t ReadNs = time_get_nanoseconds().count() - ReadStart;
+
+	CTeeHistorianReader Reader;
+	if(!Reader.Init(vData.data(), vData.size()))
+	{
+		dbg_msg("teehistorian_replay", "%s", Reader.Error());
+		return -1;
+	}
+
+	char aMapFilename[IO_MAX_PATH_LENGTH];
+	if(pMapName)
+		str_copy(aMapFilename, pMapName);
+	else
+		str_format(aMapFilename, sizeof(aMapFilename), "maps/%s.map", Reader.MapName());
+	if(!pMap->Load(aMapFilename))
+	{
+		dbg_msg("teehistorian_replay", "could not load map '%s'", aMapFilename);
+		return -1;
+	}
+	SHA256_DIGEST Sha256;
+	if(Reader.MapSha256(&Sha256) && Sha256 != pMap->Sha256())
+		dbg_msg("teehistorian_replay", "warning: map '%s' differs from the recorded one", aMapFilename);
+
+	CReplayServer *pServer = new CReplayServer(Reader.MapName(), pMap);
+	IEngine *pEngine = CreateEngine(GAME_NAME, nullptr, 2);
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER).release();
+	IConfigManager *pConfigManager = CreateConfigManager();
+	IEngineAntibot *pEngineAntibot = CreateEngineAntibot();
+	CGameContext *pGameServer = static_cast<CGameContext *>(CreateGameServer());
+	pKernel->RegisterInterface(static_cast<IServer *>(pServer));
+	pKernel->RegisterInterface(pEngine);
+	pKernel->RegisterInterface(pConsole);
+	pKernel->RegisterInterface(pConfigManager);
+	pKernel->RegisterInterface(pEngineAntibot);
+	pKernel->RegisterInterface(static_cast<IAntibot *>(pEngineAntibot), false);
+	pKernel->RegisterInterface(static_cast<IGameServer *>(pGameServer));
+
+	pEngine->Init();
+	pConfigManager->Init();
+	pConsole->Init();
+	pEngineAntibot->Init();
+	pGameServer->OnConsoleInit();
+
+	// once for the initialization of the game and once to override what
+	// the reset file and the map settings changed
+	const json_value *pConfig = json_object_get(Reader.Header(), "config");
+	ApplyConfig(pConsole, pConfig);
+	pGameServer->OnInit();
+	ApplyConfig(pConsole, pConfig);
+
+	const json_value *pTuning = json_object_get(Reader.Header(), "tuning");
+	if(pTuning->type == json_object)
+	{
+		for(unsigned i = 0; i < pTuning->u.object.length; i++)
+		{
+			const json_value *pValue = pTuning->u.object.values[i].value;
+			if(pValue->type == json_string)
+				pGameServer->Tuning()->Set(pTuning->u.object.values[i].name, str_toint(json_string_get(pValue)) / 100.0f);
+		}
+	}
+
+	const json_value *pPrng = json_object_get(Reader.Header(), "prng_description");
+	uint64_t aSeed[2];
+	if(pPrng->type == json_string && ParsePrngSeed(json_string_get(pPrng), aSeed))
+		pGameServer->SeedPrng(aSeed);
+	else
+		dbg_msg("teehistorian_replay", "warning: no recorded random seed, random game events differ");
+
+	CReplay Replay(&Reader, pServer, pGameServer, pConsole, StartTick, EndTick, MaxReports);
+	Reader.SetListener(&Replay);
+
+	const int64_t Start = time_get_nanoseconds().count();
+	while(Reader.ReadRecord() && Reader.Tick() <= EndTick)
+	{
+	}
+	const double Seconds = maximum(time_get_nanoseconds().count() - Start, (int64_t)1) / 1e9;
+	Replay.Finish();
+
+	if(!Reader.Finished() && Reader.Tick() <= EndTick)
+		dbg_msg("teehistorian_replay", "stopped reading: %s", Reader.Error());
+
+	dbg_msg("teehistorian_replay", "version %d, game %s, map '%s', %d ticks, %.1f MiB",
+		Reader.Version(), Reader.GameUuid(), Reader.MapName(), Reader.Tick(), vData.size() / (1024.0 * 1024.0));
+	dbg_msg("teehistorian_replay", "decompressed in %.3fs, read and replayed in %.3fs",
+		ReadNs / 1e9, Seconds);
+	if(Replay.m_NumTicks)
+	{
+		const double SimulationSeconds = maximum(Replay.m_SimulationNs, (int64_t)1) / 1e9;
+		dbg_msg("teehistorian_replay", "simulated %lld ticks from tick %d in %.3fs: %.0f ticks/s, %.1fx real time",
+			(long long)Replay.m_NumTicks, StartTick, SimulationSeconds, Replay.m_NumTicks / SimulationSeconds, Replay.m_NumTicks / SimulationSeconds / SERVER_TICK_SPEED);
+	}
+	if(Replay.m_NumCharacterTicks)
+		dbg_msg("teehistorian_replay", "%lld character-ticks, %.1f ns per character-tick",
+			(long long)Replay.m_NumCharacterTicks, (double)Replay.m_SimulationNs / Replay.m_NumCharacterTicks);
+	for(const auto &Stats : Replay.m_vFinishedStats)
+	{
+		if(Stats.m_DivergentTicks)
+			dbg_msg("teehistorian_replay", "cid=%d name='%s' diverged in %d of %d ticks, first at tick %d",
+				Stats.m_ClientID, Stats.m_aName, Stats.m_DivergentTicks, Stats.m_Ticks, Stats.m_FirstDivergence);
+	}
+	dbg_msg("teehistorian_replay", "%lld divergences from the recorded positions", (long long)Replay.m_NumDivergences);
+
+	pGameServer->OnShutdown();
+	pServer->Pool()->OnShutdown(0);
+	return Replay.m_NumDivergences ? 1 : 0;
+}